@@ -4,10 +4,15 @@
 
 #pragma once
 
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
 #include <cubos/core/data/old/binary_deserializer.hpp>
 #include <cubos/core/data/old/binary_serializer.hpp>
 #include <cubos/core/data/old/serialization_map.hpp>
 #include <cubos/core/ecs/entity/hash.hpp>
+#include <cubos/core/ecs/entity/reference_recorder.hpp>
 #include <cubos/core/ecs/system/commands.hpp>
 #include <cubos/core/memory/buffer_stream.hpp>
 #include <cubos/core/memory/type_map.hpp>
@@ -63,6 +68,25 @@ namespace cubos::core::ecs
         /// @brief Clears the blueprint, removing any added entities and components.
         void clear();
 
+        /// @brief Prepares the blueprint for fast repeated spawning.
+        ///
+        /// Deserializes every component once and finds where, within each one, references to
+        /// entities of the blueprint are stored. Spawning a compiled blueprint only copies the
+        /// components and patches those references, instead of deserializing everything again.
+        ///
+        /// Component types which can't be copied, or which store entity references outside of
+        /// the component itself (e.g., in a `std::vector`), are still deserialized on each spawn.
+        /// Adding components or merging other blueprints discards the compiled data of the
+        /// affected types, and thus this should be called after the blueprint is complete.
+        void compile();
+
+        /// @brief Gets the number of entities in the blueprint.
+        /// @return Number of entities.
+        std::size_t size() const
+        {
+            return mMap.size();
+        }
+
         /// @brief Returns the internal map that maps entities to their names
         /// @return Map of entities and names.
         inline std::unordered_map<Entity, std::string, EntityHash> getMap() const
@@ -80,6 +104,7 @@ namespace cubos::core::ecs
             std::vector<std::string> names;
             memory::BufferStream stream; ///< Self growing buffer stream where the component data is stored.
             std::mutex mutex;            ///< Protect the stream.
+            bool compiled = false;       ///< Whether the components were compiled, see @ref Blueprint::compile().
 
             virtual ~IBuffer() = default;
 
@@ -99,6 +124,19 @@ namespace cubos::core::ecs
             /// @brief Creates a new buffer of the same type as this one.
             /// @return New buffer.
             virtual IBuffer* create() = 0;
+
+            /// @brief Deserializes the components once and records where their entity references
+            /// are, setting @ref compiled on success.
+            /// @param context Context to use when deserializing the components.
+            virtual void compile(data::old::Context& context) = 0;
+
+            /// @brief Discards the compiled components.
+            virtual void decompile() = 0;
+
+            /// @brief Adds copies of the compiled components to the specified commands object.
+            /// @param commands Commands object to add the components to.
+            /// @param entities Spawned entities, indexed by the index of their blueprint entity.
+            virtual void addCompiled(CommandBuffer& commands, const Entity* entities) = 0;
         };
 
         /// @brief Implementation of the IBuffer interface for the component type @p ComponentType.
@@ -163,6 +201,91 @@ namespace cubos::core::ecs
             {
                 return new Buffer<ComponentType>();
             }
+
+            inline void compile(data::old::Context& context) override
+            {
+                this->decompile();
+                if constexpr (std::is_copy_constructible_v<ComponentType>)
+                {
+                    this->mutex.lock();
+                    auto pos = this->stream.tell();
+                    this->stream.seek(0, memory::SeekOrigin::Begin);
+                    auto des = data::old::BinaryDeserializer(this->stream);
+                    des.context().pushSubContext(context);
+                    EntityReferenceRecorder recorder;
+                    des.context().push(&recorder);
+
+                    // Reserve beforehand, as the recorder needs the addresses of the values to
+                    // stay the same while they're being deserialized.
+                    auto& map = des.context().get<data::old::SerializationMap<Entity, std::string, EntityHash>>();
+                    values.reserve(this->names.size());
+                    for (const auto& name : this->names)
+                    {
+                        auto& value = values.emplace_back();
+                        recorder.object = &value;
+                        recorder.size = sizeof(ComponentType);
+                        recorder.offsets.clear();
+                        des.read(value);
+
+                        for (auto offset : recorder.offsets)
+                        {
+                            fixups.push_back({static_cast<uint32_t>(values.size() - 1), offset});
+                        }
+                        owners.push_back(map.getRef(name).index);
+                    }
+                    this->stream.seek(static_cast<ptrdiff_t>(pos), memory::SeekOrigin::Begin);
+                    this->mutex.unlock();
+
+                    if (des.failed() || recorder.escaped)
+                    {
+                        // Fall back to deserializing the components on each spawn.
+                        this->decompile();
+                        return;
+                    }
+
+                    this->compiled = true;
+                }
+            }
+
+            inline void decompile() override
+            {
+                this->compiled = false;
+                values.clear();
+                owners.clear();
+                fixups.clear();
+            }
+
+            inline void addCompiled(CommandBuffer& commands, const Entity* entities) override
+            {
+                if constexpr (std::is_copy_constructible_v<ComponentType>)
+                {
+                    std::size_t fixup = 0;
+                    for (std::size_t i = 0; i < values.size(); ++i)
+                    {
+                        ComponentType value = values[i];
+                        for (; fixup < fixups.size() && fixups[fixup].value == i; ++fixup)
+                        {
+                            // Compiled references point to blueprint entities, whose index is
+                            // their position in the spawned entities array.
+                            auto* bytes = reinterpret_cast<unsigned char*>(&value) + fixups[fixup].offset;
+                            auto* entity = reinterpret_cast<Entity*>(bytes);
+                            *entity = entities[entity->index];
+                        }
+                        commands.add(entities[owners[i]], std::move(value));
+                    }
+                }
+            }
+
+            /// @brief Location of an entity reference within a compiled component.
+            struct Fixup
+            {
+                uint32_t value;     ///< Index of the component in @ref values.
+                std::size_t offset; ///< Offset of the entity within the component, in bytes.
+            };
+
+            std::vector<ComponentType> values; ///< Compiled components.
+            std::vector<uint32_t> owners;      ///< Index of the blueprint entity of each compiled component.
+            std::vector<Fixup> fixups;         ///< Entity references within the compiled components.
         };
 
         /// @brief Stores the entity handles and the associated names.
@@ -203,6 +326,7 @@ namespace cubos::core::ecs
                     buf = *ptr;
                 }
 
+                buf->decompile();
                 auto ser = data::old::BinarySerializer(buf->stream);
                 ser.context().push(mMap);
                 ser.write(components, "data");
@@ -123,6 +123,13 @@ namespace cubos::core::ecs
         template <typename T>
         std::size_t getID() const;
 
+        /// @brief Gets the number of registered component types.
+        ///
+        /// Component identifiers go from 1 to this value, inclusive.
+        ///
+        /// @return Number of registered component types.
+        std::size_t size() const;
+
         /// @brief Gets the type of a component from its identifier.
         /// @param id Component identifier.
         /// @return Component type index.
@@ -162,6 +169,33 @@ namespace cubos::core::ecs
         /// @param id Entity index.
         void removeAll(uint32_t id);
 
+        /// @brief Moves a component from an entity of another component manager into an entity of
+        /// this one.
+        /// @param id Entity index.
+        /// @param componentId Component identifier.
+        /// @param source Component manager to move the component from.
+        /// @param sourceId Entity index in the source manager.
+        /// @param sourceComponentId Component identifier in the source manager.
+        void move(uint32_t id, std::size_t componentId, ComponentManager& source, uint32_t sourceId,
+                  std::size_t sourceComponentId);
+
+        /// @brief Finds where the entity handles stored inside a component of an entity are.
+        /// @param id Entity index.
+        /// @param componentId Component identifier.
+        /// @param[out] offsets Offsets of the handles inside the component.
+        /// @return Whether every handle was found inside the component.
+        /// @see IStorage::findHandles()
+        bool findHandles(uint32_t id, std::size_t componentId, std::vector<std::size_t>& offsets) const;
+
+        /// @brief Rewrites the entity handles at the given offsets of a component of an entity.
+        /// @param id Entity index.
+        /// @param componentId Component identifier.
+        /// @param offsets Offsets of the handles inside the component.
+        /// @param map Map from old handles to new handles.
+        /// @see IStorage::remap()
+        void remap(uint32_t id, std::size_t componentId, const std::vector<std::size_t>& offsets,
+                   const std::unordered_map<Entity, Entity, EntityHash>& map);
+
         /// @brief Creates a package from a component of an entity.
         /// @param id Entity index.
         /// @param componentId Component identifier.
@@ -178,6 +212,15 @@ namespace cubos::core::ecs
         bool unpack(uint32_t id, std::size_t componentId, const data::old::Package& package,
                     data::old::Context* context);
 
+        /// @brief Gets memory usage statistics of the storage of a component type.
+        /// @param componentId Component identifier.
+        /// @return Storage statistics.
+        StorageStats stats(std::size_t componentId) const;
+
+        /// @brief Gets memory usage statistics summed over the storages of all component types.
+        /// @return Storage statistics.
+        StorageStats stats() const;
+
     private:
         struct Entry
         {
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <unordered_map>
+
 #include <cubos/core/ecs/component/storage.hpp>
 
 namespace cubos::core::ecs
@@ -20,6 +22,7 @@ namespace cubos::core::ecs
         T* get(uint32_t index) override;
         const T* get(uint32_t index) const override;
         void erase(uint32_t index) override;
+        StorageStats stats() const override;
 
     private:
         std::unordered_map<uint32_t, T> mData;
@@ -28,8 +31,7 @@ namespace cubos::core::ecs
     template <typename T>
     T* MapStorage<T>::insert(uint32_t index, T value)
     {
-        mData[index] = value;
-        return &mData[index];
+        return &mData.insert_or_assign(index, std::move(value)).first->second;
     }
 
     template <typename T>
@@ -50,4 +52,17 @@ namespace cubos::core::ecs
         mData.erase(index);
     }
 
+    template <typename T>
+    StorageStats MapStorage<T>::stats() const
+    {
+        // Each node holds the key-value pair plus, at least, a pointer to the next node.
+        constexpr std::size_t NodeSize = sizeof(std::pair<const uint32_t, T>) + sizeof(void*);
+
+        return {
+            .count = mData.size(),
+            .bytesReserved = mData.size() * NodeSize + mData.bucket_count() * sizeof(void*),
+            .bytesUsed = mData.size() * sizeof(T),
+        };
+    }
+
 } // namespace cubos::core::ecs
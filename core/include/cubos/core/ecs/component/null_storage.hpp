@@ -21,6 +21,7 @@ namespace cubos::core::ecs
         T* get(uint32_t index) override;
         const T* get(uint32_t index) const override;
         void erase(uint32_t index) override;
+        StorageStats stats() const override;
 
     private:
         T mData;
@@ -49,4 +50,10 @@ namespace cubos::core::ecs
     {
     }
 
+    template <typename T>
+    StorageStats NullStorage<T>::stats() const
+    {
+        return {};
+    }
+
 } // namespace cubos::core::ecs
@@ -0,0 +1,254 @@
+/// @file
+/// @brief Class @ref cubos::core::ecs::SharedStorage.
+/// @ingroup core-ecs-component
+
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <cubos/core/ecs/component/storage.hpp>
+
+namespace cubos::core::ecs
+{
+    /// @brief Storage implementation in which many entities may reference the same value, stored
+    /// only once.
+    ///
+    /// Meant for components which are rarely mutated and usually identical between many entities,
+    /// such as collision shapes of entities spawned from the same blueprint. Each index only stores
+    /// a handle to a reference-counted instance.
+    ///
+    /// If @p T is equality comparable, inserting a value equal to the last inserted one reuses its
+    /// instance, which makes spawning many copies of the same entity store the value only once.
+    /// Instances can also be shared explicitly through @ref share().
+    ///
+    /// Getting a mutable pointer to a value referenced by more than one index copies it first, so
+    /// that the other indices are not affected (copy-on-write). Thus, components stored here should
+    /// preferably be accessed through `Read` instead of `Write`.
+    ///
+    /// @tparam T Component type.
+    /// @ingroup core-ecs-component
+    template <typename T>
+    class SharedStorage : public Storage<T>
+    {
+    public:
+        /// @brief Value returned by @ref instance() for indices without a value.
+        static constexpr uint32_t NoInstance = UINT32_MAX;
+
+        T* insert(uint32_t index, T value) override;
+        T* get(uint32_t index) override;
+        const T* get(uint32_t index) const override;
+        void erase(uint32_t index) override;
+        void moveFrom(uint32_t index, IStorage& source, uint32_t sourceIndex) override;
+        StorageStats stats() const override;
+
+        /// @brief Makes an index reference the same value as another index.
+        /// @param index Index to set.
+        /// @param source Index whose value will be shared. Must have a value.
+        /// @return Pointer to the shared value.
+        const T* share(uint32_t index, uint32_t source);
+
+        /// @brief Gets the identifier of the instance referenced by an index.
+        ///
+        /// Indices with the same instance identifier share the same value, which can be used, for
+        /// example, to batch work done on identical components.
+        ///
+        /// @param index Index.
+        /// @return Instance identifier, or @ref NoInstance if the index has no value.
+        uint32_t instance(uint32_t index) const;
+
+        /// @brief Gets the number of distinct values currently stored.
+        /// @return Number of instances.
+        std::size_t instanceCount() const;
+
+    private:
+        /// @brief Value referenced by one or more indices.
+        struct Instance
+        {
+            std::unique_ptr<T> value; ///< Stored value, or null if the instance is free.
+            uint32_t references = 0;  ///< Number of indices referencing the instance.
+        };
+
+        /// @brief Makes @p index reference @p instance, releasing the instance it referenced before.
+        /// @param index Index.
+        /// @param instance Instance, whose reference count was already incremented.
+        void assign(uint32_t index, uint32_t instance);
+
+        /// @brief Creates a new instance with the given value.
+        /// @param value Value.
+        /// @return Instance identifier, with a reference count of one.
+        uint32_t create(T value);
+
+        /// @brief Decrements the reference count of an instance, destroying it if it reaches zero.
+        /// @param instance Instance identifier.
+        void release(uint32_t instance);
+
+        std::vector<uint32_t> mHandles;      ///< Instance referenced by each index.
+        std::vector<Instance> mInstances;    ///< All instances, including free ones.
+        std::vector<uint32_t> mFree;         ///< Identifiers of free instances.
+        uint32_t mLastInstance = NoInstance; ///< Last instance created by an insertion.
+        std::size_t mCount = 0;              ///< Number of indices with a value.
+    };
+
+    template <typename T>
+    T* SharedStorage<T>::insert(uint32_t index, T value)
+    {
+        if constexpr (std::equality_comparable<T>)
+        {
+            if (mLastInstance != NoInstance && *mInstances[mLastInstance].value == value)
+            {
+                mInstances[mLastInstance].references += 1;
+                this->assign(index, mLastInstance);
+                return mInstances[mLastInstance].value.get();
+            }
+        }
+
+        uint32_t instance = this->create(std::move(value));
+        mLastInstance = instance;
+        this->assign(index, instance);
+        return mInstances[instance].value.get();
+    }
+
+    template <typename T>
+    T* SharedStorage<T>::get(uint32_t index)
+    {
+        uint32_t instance = mHandles[index];
+        if (mInstances[instance].references > 1)
+        {
+            // The value is shared with other indices: copy it before handing out a mutable pointer.
+            uint32_t copy = this->create(*mInstances[instance].value);
+            this->assign(index, copy);
+            instance = copy;
+        }
+
+        return mInstances[instance].value.get();
+    }
+
+    template <typename T>
+    const T* SharedStorage<T>::get(uint32_t index) const
+    {
+        return mInstances[mHandles[index]].value.get();
+    }
+
+    template <typename T>
+    void SharedStorage<T>::erase(uint32_t index)
+    {
+        if (static_cast<std::size_t>(index) >= mHandles.size() || mHandles[index] == NoInstance)
+        {
+            return;
+        }
+
+        this->release(mHandles[index]);
+        mHandles[index] = NoInstance;
+        mCount -= 1;
+    }
+
+    template <typename T>
+    void SharedStorage<T>::moveFrom(uint32_t index, IStorage& source, uint32_t sourceIndex)
+    {
+        // Copy through a const reference: a mutable access would copy shared values in the
+        // source, and inserting a copy lets consecutive equal values be shared again here.
+        const auto& typed = static_cast<const Storage<T>&>(source);
+        this->insert(index, *typed.get(sourceIndex));
+        source.erase(sourceIndex);
+    }
+
+    template <typename T>
+    StorageStats SharedStorage<T>::stats() const
+    {
+        std::size_t liveInstances = this->instanceCount();
+        return {
+            .count = mCount,
+            .bytesReserved = mHandles.capacity() * sizeof(uint32_t) + mInstances.capacity() * sizeof(Instance) +
+                             mFree.capacity() * sizeof(uint32_t) + liveInstances * sizeof(T),
+            .bytesUsed = mCount * sizeof(uint32_t) + liveInstances * sizeof(T),
+        };
+    }
+
+    template <typename T>
+    const T* SharedStorage<T>::share(uint32_t index, uint32_t source)
+    {
+        uint32_t instance = mHandles[source];
+        mInstances[instance].references += 1;
+        this->assign(index, instance);
+        return mInstances[instance].value.get();
+    }
+
+    template <typename T>
+    uint32_t SharedStorage<T>::instance(uint32_t index) const
+    {
+        if (static_cast<std::size_t>(index) >= mHandles.size())
+        {
+            return NoInstance;
+        }
+
+        return mHandles[index];
+    }
+
+    template <typename T>
+    std::size_t SharedStorage<T>::instanceCount() const
+    {
+        return mInstances.size() - mFree.size();
+    }
+
+    template <typename T>
+    void SharedStorage<T>::assign(uint32_t index, uint32_t instance)
+    {
+        if (mHandles.size() <= index)
+        {
+            mHandles.resize(index + 1, NoInstance);
+        }
+
+        // The new instance is referenced before the old one is released, so that reassigning an
+        // index to its own instance never destroys it.
+        uint32_t previous = mHandles[index];
+        mHandles[index] = instance;
+        if (previous == NoInstance)
+        {
+            mCount += 1;
+        }
+        else
+        {
+            this->release(previous);
+        }
+    }
+
+    template <typename T>
+    uint32_t SharedStorage<T>::create(T value)
+    {
+        uint32_t instance;
+        if (mFree.empty())
+        {
+            instance = static_cast<uint32_t>(mInstances.size());
+            mInstances.emplace_back();
+        }
+        else
+        {
+            instance = mFree.back();
+            mFree.pop_back();
+        }
+
+        mInstances[instance].value = std::make_unique<T>(std::move(value));
+        mInstances[instance].references = 1;
+        return instance;
+    }
+
+    template <typename T>
+    void SharedStorage<T>::release(uint32_t instance)
+    {
+        auto& entry = mInstances[instance];
+        entry.references -= 1;
+        if (entry.references == 0)
+        {
+            entry.value.reset();
+            mFree.push_back(instance);
+            if (mLastInstance == instance)
+            {
+                mLastInstance = NoInstance;
+            }
+        }
+    }
+} // namespace cubos::core::ecs
@@ -4,12 +4,39 @@
 
 #pragma once
 
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
 #include <cubos/core/data/old/package.hpp>
 #include <cubos/core/data/old/serialization_map.hpp>
+#include <cubos/core/ecs/entity/hash.hpp>
 #include <cubos/core/ecs/entity/manager.hpp>
+#include <cubos/core/ecs/entity/reference_recorder.hpp>
 
 namespace cubos::core::ecs
 {
+    /// @brief Memory usage statistics of a storage.
+    /// @ingroup core-ecs-component
+    struct StorageStats
+    {
+        std::size_t count = 0;         ///< Number of values currently stored.
+        std::size_t bytesReserved = 0; ///< Bytes allocated by the storage.
+        std::size_t bytesUsed = 0;     ///< Bytes occupied by live values.
+
+        /// @brief Gets the fraction of the reserved memory which isn't being used by live values.
+        /// @return Value between 0 (no waste) and 1 (everything wasted).
+        double fragmentation() const
+        {
+            if (bytesReserved == 0)
+            {
+                return 0.0;
+            }
+
+            return 1.0 - static_cast<double>(bytesUsed) / static_cast<double>(bytesReserved);
+        }
+    };
+
     /// @brief Abstract parent class for all storages.
     ///
     /// Necessary to provide a type-erased interface for erasing and packaging/unpackaging
@@ -25,6 +52,35 @@ namespace cubos::core::ecs
         /// @param index Index of the value to be removed.
         virtual void erase(uint32_t index) = 0;
 
+        /// @brief Moves a value from another storage of the same type into this one, erasing it
+        /// from the source storage.
+        /// @param index Index where to insert the value.
+        /// @param source Storage to move the value from. Must store the same component type.
+        /// @param sourceIndex Index of the value in the source storage.
+        virtual void moveFrom(uint32_t index, IStorage& source, uint32_t sourceIndex) = 0;
+
+        /// @brief Finds where the entity handles stored inside a value are.
+        ///
+        /// The handles are found by serializing the value with an @ref EntityReferenceRecorder,
+        /// as done by @ref Blueprint::compile(). Null handles aren't reported.
+        ///
+        /// @param index Index of the value.
+        /// @param[out] offsets Offsets, in bytes, of the handles found inside the value.
+        /// @return Whether every handle was found inside the value, which fails if some are
+        /// stored elsewhere, e.g., on the heap.
+        virtual bool findHandles(uint32_t index, std::vector<std::size_t>& offsets) const = 0;
+
+        /// @brief Rewrites the entity handles at the given offsets of a value, in place.
+        ///
+        /// Nothing is serialized, so fields which aren't serialized are kept. Handles missing from
+        /// @p map become null.
+        ///
+        /// @param index Index of the value.
+        /// @param offsets Offsets of the handles, as found by @ref findHandles().
+        /// @param map Map from old handles to new handles.
+        virtual void remap(uint32_t index, const std::vector<std::size_t>& offsets,
+                           const std::unordered_map<Entity, Entity, EntityHash>& map) = 0;
+
         /// @brief Packages a value. If the value doesn't exist, undefined behavior will occur.
         /// @param index Index of the value to package.
         /// @param context Optional context used for serialization.
@@ -41,6 +97,10 @@ namespace cubos::core::ecs
         /// @brief Gets the type the components being stored here.
         /// @return Component type.
         virtual std::type_index type() const = 0;
+
+        /// @brief Gets memory usage statistics of the storage.
+        /// @return Storage statistics.
+        virtual StorageStats stats() const = 0;
     };
 
     /// @brief Abstract container for a component type @p T.
@@ -70,6 +130,38 @@ namespace cubos::core::ecs
 
         // Implementation.
 
+        inline void moveFrom(uint32_t index, IStorage& source, uint32_t sourceIndex) override
+        {
+            auto& typed = static_cast<Storage<T>&>(source);
+            this->insert(index, std::move(*typed.get(sourceIndex)));
+            typed.erase(sourceIndex);
+        }
+
+        inline bool findHandles(uint32_t index, std::vector<std::size_t>& offsets) const override
+        {
+            const T* value = this->get(index);
+            EntityReferenceRecorder recorder;
+            recorder.object = value;
+            recorder.size = sizeof(T);
+            data::old::Context context;
+            context.push(&recorder);
+            data::old::Package::from(*value, &context);
+            offsets = std::move(recorder.offsets);
+            return !recorder.escaped;
+        }
+
+        inline void remap(uint32_t index, const std::vector<std::size_t>& offsets,
+                          const std::unordered_map<Entity, Entity, EntityHash>& map) override
+        {
+            auto* bytes = reinterpret_cast<unsigned char*>(this->get(index));
+            for (auto offset : offsets)
+            {
+                auto* entity = reinterpret_cast<Entity*>(bytes + offset);
+                auto it = map.find(*entity);
+                *entity = it == map.end() ? Entity{} : it->second;
+            }
+        }
+
         inline data::old::Package pack(uint32_t index, data::old::Context* context) const override
         {
             return data::old::Package::from(*this->get(index), context);
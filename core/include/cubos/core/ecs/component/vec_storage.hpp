@@ -4,62 +4,177 @@
 
 #pragma once
 
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
 #include <cubos/core/ecs/component/storage.hpp>
+#include <cubos/core/log.hpp>
 
 namespace cubos::core::ecs
 {
-    /// @brief Storage implementation that uses a `std::vector`.
+    /// @brief Storage implementation that keeps values in fixed-size pages, indexed by a
+    /// `std::vector` of page pointers.
+    ///
+    /// Pages are allocated lazily when a value is first inserted in their index range and are
+    /// released as soon as they become empty. Since pages are never relocated, pointers to stored
+    /// values remain valid until the value itself is erased.
+    ///
     /// @tparam T Component type.
     /// @ingroup core-ecs-component
     template <typename T>
     class VecStorage : public Storage<T>
     {
     public:
+        /// @brief Number of values which fit in a single page.
+        static constexpr uint32_t PageSize = 64;
+
+        ~VecStorage() override;
+
         T* insert(uint32_t index, T value) override;
         T* get(uint32_t index) override;
         const T* get(uint32_t index) const override;
         void erase(uint32_t index) override;
+        StorageStats stats() const override;
 
     private:
-        std::vector<T> mData;
+        /// @brief Fixed-size block of values.
+        struct Page
+        {
+            alignas(T) unsigned char data[sizeof(T) * PageSize]; ///< Raw storage for the values.
+            uint64_t alive = 0;                                  ///< Bit mask of the occupied slots.
+
+            /// @brief Gets a pointer to the slot with the given index.
+            /// @param index Slot index.
+            /// @return Pointer to the slot.
+            T* slot(uint32_t index)
+            {
+                return std::launder(reinterpret_cast<T*>(data + sizeof(T) * index));
+            }
+
+            /// @copydoc slot(uint32_t)
+            const T* slot(uint32_t index) const
+            {
+                return std::launder(reinterpret_cast<const T*>(data + sizeof(T) * index));
+            }
+        };
+
+        static_assert(PageSize == 64, "Page occupancy is tracked with a single 64-bit mask");
+
+        /// @brief Checks whether a value is stored at the given index.
+        /// @param index Index.
+        /// @return Whether the index is occupied.
+        bool contains(uint32_t index) const;
+
+        std::vector<std::unique_ptr<Page>> mPages; ///< Pages, indexed by `index / PageSize`.
+        std::size_t mCount = 0;                    ///< Number of values stored.
+        std::size_t mPageCount = 0;                ///< Number of allocated pages.
     };
 
+    template <typename T>
+    VecStorage<T>::~VecStorage()
+    {
+        for (auto& page : mPages)
+        {
+            if (page == nullptr)
+            {
+                continue;
+            }
+
+            for (uint64_t alive = page->alive; alive != 0; alive &= alive - 1)
+            {
+                page->slot(static_cast<uint32_t>(std::countr_zero(alive)))->~T();
+            }
+        }
+    }
+
     template <typename T>
     T* VecStorage<T>::insert(uint32_t index, T value)
     {
-        if (mData.size() <= index)
+        const uint32_t pageIndex = index / PageSize;
+        const uint32_t slotIndex = index % PageSize;
+        const uint64_t bit = uint64_t{1} << slotIndex;
+
+        if (mPages.size() <= pageIndex)
         {
-            mData.resize(index);
-            mData.emplace_back(std::move(value));
+            mPages.resize(pageIndex + 1);
+        }
+
+        auto& page = mPages[pageIndex];
+        if (page == nullptr)
+        {
+            page = std::make_unique<Page>();
+            mPageCount += 1;
+        }
+
+        T* slot = page->slot(slotIndex);
+        if ((page->alive & bit) != 0)
+        {
+            slot->~T();
         }
         else
         {
-            mData[index].~T();
-            new (&mData[index]) T(std::move(value));
+            page->alive |= bit;
+            mCount += 1;
         }
 
-        return &mData[index];
+        return new (slot) T(std::move(value));
     }
 
     template <typename T>
     T* VecStorage<T>::get(uint32_t index)
     {
-        return &mData[index];
+        CUBOS_ASSERT(this->contains(index), "No value stored at index {}", index);
+        return mPages[index / PageSize]->slot(index % PageSize);
     }
 
     template <typename T>
     const T* VecStorage<T>::get(uint32_t index) const
     {
-        return &mData[index];
+        CUBOS_ASSERT(this->contains(index), "No value stored at index {}", index);
+        return mPages[index / PageSize]->slot(index % PageSize);
     }
 
     template <typename T>
     void VecStorage<T>::erase(uint32_t index)
     {
-        if (static_cast<size_t>(index) < mData.size())
+        if (!this->contains(index))
+        {
+            return;
+        }
+
+        const uint64_t bit = uint64_t{1} << (index % PageSize);
+        auto& page = mPages[index / PageSize];
+        page->slot(index % PageSize)->~T();
+        page->alive &= ~bit;
+        mCount -= 1;
+
+        // Release the page as soon as it becomes empty.
+        if (page->alive == 0)
         {
-            mData[index].~T();
-            new (&mData[index]) T;
+            page.reset();
+            mPageCount -= 1;
         }
     }
+
+    template <typename T>
+    bool VecStorage<T>::contains(uint32_t index) const
+    {
+        const uint32_t pageIndex = index / PageSize;
+        return static_cast<std::size_t>(pageIndex) < mPages.size() && mPages[pageIndex] != nullptr &&
+               (mPages[pageIndex]->alive & (uint64_t{1} << (index % PageSize))) != 0;
+    }
+
+    template <typename T>
+    StorageStats VecStorage<T>::stats() const
+    {
+        return {
+            .count = mCount,
+            .bytesReserved = mPageCount * sizeof(Page) + mPages.capacity() * sizeof(std::unique_ptr<Page>),
+            .bytesUsed = mCount * sizeof(T),
+        };
+    }
 } // namespace cubos::core::ecs
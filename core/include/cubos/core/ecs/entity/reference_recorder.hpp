@@ -0,0 +1,50 @@
+/// @file
+/// @brief Struct @ref cubos::core::ecs::EntityReferenceRecorder.
+/// @ingroup core-ecs-entity
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <cubos/core/ecs/entity/entity.hpp>
+
+namespace cubos::core::ecs
+{
+    /// @brief Finds where entity identifiers are stored within an object while it is being
+    /// serialized or deserialized.
+    ///
+    /// When a pointer to a recorder is present in the context of a deserializer, along with a
+    /// data::old::SerializationMap<Entity, std::string, EntityHash>, every non-null entity read
+    /// through it is reported to the recorder. Used by @ref Blueprint::compile() to know which
+    /// bytes of a component must be patched when it is copied into a new entity.
+    ///
+    /// When present in the context of a serializer, every non-null entity written through it is
+    /// reported, which is used by @ref World::stage() to find the entities of components to merge.
+    ///
+    /// @ingroup core-ecs-entity
+    struct EntityReferenceRecorder
+    {
+        const void* object = nullptr;     ///< Object being deserialized.
+        std::size_t size = 0;             ///< Size of the object being deserialized.
+        std::vector<std::size_t> offsets; ///< Offsets of the entities found within the object.
+        bool escaped = false;             ///< Whether an entity was found outside the object, e.g., on the heap.
+
+        /// @brief Reports an entity which was just serialized or deserialized.
+        /// @param entity Reference to where the entity is stored.
+        void record(const Entity& entity)
+        {
+            auto begin = reinterpret_cast<std::uintptr_t>(object);
+            auto address = reinterpret_cast<std::uintptr_t>(&entity);
+            if (address >= begin && address + sizeof(Entity) <= begin + size)
+            {
+                offsets.push_back(static_cast<std::size_t>(address - begin));
+            }
+            else
+            {
+                escaped = true;
+            }
+        }
+    };
+} // namespace cubos::core::ecs
@@ -4,12 +4,15 @@
 
 #pragma once
 
+#include <memory_resource>
 #include <mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <cubos/core/ecs/entity/hash.hpp>
 #include <cubos/core/ecs/world.hpp>
+#include <cubos/core/memory/pool_allocator.hpp>
 
 namespace cubos::core::ecs
 {
@@ -146,6 +149,17 @@ namespace cubos::core::ecs
         /// @return Blueprint builder.
         BlueprintBuilder spawn(const Blueprint& blueprint);
 
+        /// @brief Spawns many copies of a blueprint into the world.
+        ///
+        /// Much faster than calling @ref spawn() repeatedly if the blueprint was compiled with
+        /// @ref Blueprint::compile().
+        ///
+        /// @param blueprint Blueprint to spawn.
+        /// @param count Number of copies to spawn.
+        /// @return Spawned entities. Entity `i` of copy `c` is at index `c * blueprint.size() + i`,
+        /// where `i` is the index of the entity's identifier in the blueprint.
+        std::vector<Entity> spawnMany(const Blueprint& blueprint, std::size_t count);
+
     private:
         CommandBuffer& mBuffer; ///< Command buffer to write to.
     };
@@ -189,6 +203,17 @@ namespace cubos::core::ecs
         /// @return Blueprint builder.
         BlueprintBuilder spawn(const Blueprint& blueprint);
 
+        /// @brief Spawns many copies of a blueprint into the world.
+        ///
+        /// Much faster than calling @ref spawn() repeatedly if the blueprint was compiled with
+        /// @ref Blueprint::compile().
+        ///
+        /// @param blueprint Blueprint to spawn.
+        /// @param count Number of copies to spawn.
+        /// @return Spawned entities. Entity `i` of copy `c` is at index `c * blueprint.size() + i`,
+        /// where `i` is the index of the entity's identifier in the blueprint.
+        std::vector<Entity> spawnMany(const Blueprint& blueprint, std::size_t count);
+
         /// @brief Aborts the commands, rolling back any changes made.
         void abort();
 
@@ -214,6 +239,8 @@ namespace cubos::core::ecs
             /// @param entity Entity identifier.
             /// @param manager Component manager.
             virtual void move(Entity entity, ComponentManager& manager) = 0;
+
+            bool dirty = false; ///< Whether components were queued since the last commit or abort.
         };
 
         /// @brief Implementation of the above interface for a component type
@@ -222,26 +249,51 @@ namespace cubos::core::ecs
         template <typename ComponentType>
         struct Buffer : IBuffer
         {
+            /// @brief Constructs.
+            /// @param memory Resource used to allocate the buffered components.
+            Buffer(std::pmr::memory_resource* memory);
+
             // Interface methods implementation.
 
             void clear() override;
             void move(Entity entity, ComponentManager& manager) override;
 
-            std::unordered_map<Entity, ComponentType, EntityHash> components; ///< Components in the buffer.
+            std::pmr::unordered_map<Entity, ComponentType, EntityHash> components; ///< Components in the buffer.
         };
 
+        /// @brief Gets the buffer of a component type, creating it if it doesn't exist yet, and marks
+        /// it as dirty.
+        /// @tparam ComponentType Component type.
+        /// @return Component buffer.
+        template <typename ComponentType>
+        Buffer<ComponentType>& buffer();
+
+        /// @brief Adds the components of a blueprint to already created entities.
+        /// @param blueprint Blueprint to instantiate.
+        /// @param entities Entities to add the components to, indexed by blueprint entity index.
+        /// @param context Context with a map of the entities' names, or null if not yet built.
+        void instantiate(const Blueprint& blueprint, const Entity* entities, data::old::Context* context);
+
         /// @brief Clears the commands.
+        ///
+        /// Component buffers are kept around, empty, so that they can be reused by the next
+        /// commands without reallocating them.
         void clear();
 
         std::mutex mMutex; ///< Make this thread-safe.
         World& mWorld;     ///< World to which the commands will be applied.
 
-        std::unordered_map<std::type_index, IBuffer*> mBuffers;        ///< Component buffers per component type.
-        std::unordered_set<Entity, EntityHash> mCreated;               ///< Uncommitted created entities.
-        std::unordered_set<Entity, EntityHash> mDestroyed;             ///< Uncommitted destroyed entities.
-        std::unordered_map<Entity, Entity::Mask, EntityHash> mAdded;   ///< Mask of the uncommitted added components.
-        std::unordered_map<Entity, Entity::Mask, EntityHash> mRemoved; ///< Mask of the uncommitted removed components.
-        std::unordered_set<Entity, EntityHash> mChanged;               ///< Entities whose mask has changed.
+        /// @brief Pool from which the container nodes below are allocated. Since the containers
+        /// are cleared on every commit, nodes are recycled instead of going through the heap.
+        memory::PoolAllocator mPool;
+
+        std::unordered_map<std::type_index, IBuffer*> mBuffers;             ///< Component buffers per component type.
+        std::vector<IBuffer*> mDirty; ///< Buffers with components queued since the last commit or abort.
+        std::pmr::unordered_set<Entity, EntityHash> mCreated;               ///< Uncommitted created entities.
+        std::pmr::unordered_set<Entity, EntityHash> mDestroyed;             ///< Uncommitted destroyed entities.
+        std::pmr::unordered_map<Entity, Entity::Mask, EntityHash> mAdded;   ///< Masks of uncommitted added components.
+        std::pmr::unordered_map<Entity, Entity::Mask, EntityHash> mRemoved; ///< Masks of uncommitted removed ones.
+        std::pmr::unordered_set<Entity, EntityHash> mChanged;               ///< Entities whose mask has changed.
     };
 
     // Implementation.
@@ -323,16 +375,11 @@ namespace cubos::core::ecs
 
         (
             [&]() {
-                auto it = mBuffers.find(typeid(ComponentTypes));
-                if (it == mBuffers.end())
-                {
-                    it = mBuffers.emplace(typeid(ComponentTypes), new Buffer<ComponentTypes>()).first;
-                }
-
                 std::size_t componentID = mWorld.mComponentManager.getID<ComponentTypes>();
                 mask.set(componentID);
-                static_cast<Buffer<ComponentTypes>*>(it->second)->components.erase(entity);
-                static_cast<Buffer<ComponentTypes>*>(it->second)->components.emplace(entity, std::move(components));
+                auto& buf = this->buffer<ComponentTypes>();
+                buf.components.erase(entity);
+                buf.components.emplace(entity, std::move(components));
             }(),
             ...);
     }
@@ -364,22 +411,42 @@ namespace cubos::core::ecs
 
         (
             [&]() {
-                auto it = mBuffers.find(typeid(ComponentTypes));
-                if (it == mBuffers.end())
-                {
-                    it = mBuffers.emplace(typeid(ComponentTypes), new Buffer<ComponentTypes>()).first;
-                }
-
                 std::size_t componentID = mWorld.mComponentManager.getID<ComponentTypes>();
                 mask.set(componentID);
-                static_cast<Buffer<ComponentTypes>*>(it->second)->components.erase(entity);
-                static_cast<Buffer<ComponentTypes>*>(it->second)->components.emplace(entity, components);
+                auto& buf = this->buffer<ComponentTypes>();
+                buf.components.erase(entity);
+                buf.components.emplace(entity, components);
             }(),
             ...);
 
         return {entity, *this};
     }
 
+    template <typename ComponentType>
+    CommandBuffer::Buffer<ComponentType>& CommandBuffer::buffer()
+    {
+        auto it = mBuffers.find(typeid(ComponentType));
+        if (it == mBuffers.end())
+        {
+            it = mBuffers.emplace(typeid(ComponentType), new Buffer<ComponentType>(&mPool)).first;
+        }
+
+        if (!it->second->dirty)
+        {
+            it->second->dirty = true;
+            mDirty.push_back(it->second);
+        }
+
+        return *static_cast<Buffer<ComponentType>*>(it->second);
+    }
+
+    template <typename ComponentType>
+    CommandBuffer::Buffer<ComponentType>::Buffer(std::pmr::memory_resource* memory)
+        : components(memory)
+    {
+        // Do nothing.
+    }
+
     template <typename ComponentType>
     void CommandBuffer::Buffer<ComponentType>::clear()
     {
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
@@ -110,6 +111,9 @@ namespace cubos::core::ecs
 
         /// @brief Calls all systems in the compiled call chain. @ref compileChain() must be called
         /// prior to this.
+        ///
+        /// When allocation tracking is enabled, the allocations made by each system are attributed
+        /// to a @ref memory::AllocationTracker scope named after the system's tags.
         /// @param world World to call the systems in.
         /// @param cmds Command buffer.
         void callSystems(World& world, CommandBuffer& cmds);
@@ -143,6 +147,7 @@ namespace cubos::core::ecs
             std::shared_ptr<SystemSettings> settings;
             std::shared_ptr<AnySystemWrapper<void>> system;
             std::unordered_set<std::string> tags;
+            std::uint32_t allocationScope = 0; ///< Scope to which the system's allocations are attributed.
         };
 
         /// @brief Internal class used to implement a DFS algorithm for call chain compilation
@@ -206,7 +211,7 @@ namespace cubos::core::ecs
     void Dispatcher::addSystem(F func)
     {
         // Wrap the system and put it in the pending queue
-        auto* system = new System{nullptr, std::make_shared<SystemWrapper<F>>(func), {}};
+        auto* system = new System{nullptr, std::make_shared<SystemWrapper<F>>(func), {}, 0};
         mPendingSystems.push_back(system);
         mCurrSystem = mPendingSystems.back();
     }
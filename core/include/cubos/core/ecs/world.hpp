@@ -7,6 +7,7 @@
 #include <cassert>
 #include <cstddef>
 #include <unordered_map>
+#include <vector>
 
 #include <cubos/core/ecs/component/manager.hpp>
 #include <cubos/core/ecs/entity/manager.hpp>
@@ -118,6 +119,47 @@ namespace cubos::core::ecs
         /// @return Whether the package was unpacked successfully.
         bool unpack(Entity entity, const data::old::Package& package, data::old::Context* context = nullptr);
 
+        /// @brief Prepares this world to be merged into another through @ref merge().
+        ///
+        /// Finds where the entity handles are stored inside each component, which requires
+        /// serializing them, so that @ref merge() only has to patch them in place. Meant to be
+        /// called on the thread which filled this staging world, once it's done, so that the main
+        /// thread never serializes anything. The world must not be changed between this call and
+        /// the merge.
+        ///
+        /// Handles stored outside of their component, such as in a `std::vector`, can't be
+        /// patched in place, and thus aren't rewritten by the merge. A warning is logged for each
+        /// component type which holds them, and the map returned by @ref merge() can be used to
+        /// rewrite them.
+        void stage();
+
+        /// @brief Moves every entity of another world, and their components, into this one.
+        ///
+        /// Meant to be used with a staging world, which can be filled on another thread (for
+        /// example, by spawning a blueprint through a @ref CommandBuffer of its own), prepared
+        /// with @ref stage() on that same thread, and then merged into the main world in one go.
+        /// Both worlds must not be accessed by anyone else during the merge. If @p other wasn't
+        /// staged, it is staged here.
+        ///
+        /// Components are matched by type, and any component type registered in @p other but not
+        /// in this world is registered automatically. Resources are not moved. Entity handles
+        /// found inside components by @ref stage() are rewritten to the new handles, or to null
+        /// if they refer to entities which weren't in @p other.
+        ///
+        /// @param other World to take the entities from. Left without entities.
+        /// @return Map from the handles of the entities in @p other to their new handles.
+        std::unordered_map<Entity, Entity, EntityHash> merge(World& other);
+
+        /// @brief Gets memory usage statistics of the storage of a component type.
+        /// @tparam T Component type.
+        /// @return Storage statistics.
+        template <typename T>
+        StorageStats componentStats() const;
+
+        /// @brief Gets memory usage statistics summed over the storages of all component types.
+        /// @return Storage statistics.
+        StorageStats componentStats() const;
+
         /// @brief Returns an iterator which points to the first entity of the world.
         /// @return Iterator.
         Iterator begin() const;
@@ -133,9 +175,19 @@ namespace cubos::core::ecs
         friend struct impl::QueryFetcher;
         friend class CommandBuffer;
 
+        /// @brief Entity handles found by @ref stage() inside a component of an entity.
+        struct StagedHandles
+        {
+            Entity entity;                    ///< Entity which owns the component.
+            std::size_t componentId;          ///< Identifier of the component.
+            std::vector<std::size_t> offsets; ///< Offsets of the handles inside the component.
+        };
+
         ResourceManager mResourceManager;
         EntityManager mEntityManager;
         ComponentManager mComponentManager;
+        std::vector<StagedHandles> mStagedHandles; ///< Handles found by the last call to @ref stage().
+        bool mStaged{false};                       ///< Whether @ref stage() was called since the last merge.
     };
 
     // Implementation.
@@ -260,4 +312,10 @@ namespace cubos::core::ecs
         std::size_t componentId = mComponentManager.getID<T>();
         return mEntityManager.getMask(entity).test(componentId);
     }
+
+    template <typename T>
+    StorageStats World::componentStats() const
+    {
+        return mComponentManager.stats(mComponentManager.getID<T>());
+    }
 } // namespace cubos::core::ecs
@@ -17,6 +17,10 @@ namespace cubos::core::geom
     {
         glm::vec3 halfSize{0.5F}; ///< Half size of the box.
 
+        /// @brief Compares two boxes for equality.
+        /// @return Whether both shapes are equal.
+        bool operator==(const Box&) const = default;
+
         /// @brief Computes two opposite corners of the box on the major diagonal.
         /// @param corners Array to store the two corners in.
         void diag(glm::vec3 corners[2]) const
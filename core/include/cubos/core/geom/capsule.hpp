@@ -17,6 +17,10 @@ namespace cubos::core::geom
         float radius = 1.0F; ///< Radius of the capsule.
         float length = 0.0F; ///< Length of the capsule.
 
+        /// @brief Compares two capsules for equality.
+        /// @return Whether both shapes are equal.
+        bool operator==(const Capsule&) const = default;
+
         /// @brief Constructs a sphere.
         /// @param radius Sphere radius.
         /// @return Sphere shape.
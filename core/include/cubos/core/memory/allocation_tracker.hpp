@@ -0,0 +1,145 @@
+/// @file
+/// @brief Class @ref cubos::core::memory::AllocationTracker and related types.
+/// @ingroup core-memory
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cubos::core::memory
+{
+    /// @brief Allocation statistics of a single scope during a frame.
+    /// @ingroup core-memory
+    struct AllocationScopeStats
+    {
+        std::string name;              ///< Name the scope was registered with.
+        std::size_t allocations = 0;   ///< Number of allocations made while the scope was active.
+        std::size_t bytes = 0;         ///< Total bytes allocated while the scope was active.
+        std::size_t peakLiveBytes = 0; ///< Highest amount of live heap memory seen while the scope was active.
+    };
+
+    /// @brief Allocation statistics of a whole frame, broken down by scope.
+    /// @ingroup core-memory
+    struct AllocationFrameStats
+    {
+        std::vector<AllocationScopeStats> scopes; ///< Statistics of each scope which allocated during the frame.
+        std::size_t allocations = 0;              ///< Number of allocations made during the frame.
+        std::size_t bytes = 0;                    ///< Total bytes allocated during the frame.
+        std::size_t peakLiveBytes = 0;            ///< Highest amount of live heap memory during the frame.
+    };
+
+    /// @brief Attributes global heap allocations to named scopes, such as the system currently
+    /// being run.
+    ///
+    /// Only active when the engine is built with the `CUBOS_CORE_TRACK_ALLOCATIONS` CMake option,
+    /// which replaces the global `operator new` and `operator delete`. Otherwise, every function
+    /// here is an empty inline stub and @ref Enabled is false.
+    ///
+    /// Scopes are tracked per thread: allocations made on a thread are attributed to the scope
+    /// last entered on that same thread. Allocations made outside of any scope are attributed to
+    /// the scope with identifier 0, named `<untracked>`.
+    ///
+    /// @ingroup core-memory
+    class AllocationTracker final
+    {
+    public:
+        /// @brief Whether allocation tracking was enabled at build time.
+#ifdef CUBOS_CORE_TRACK_ALLOCATIONS
+        static constexpr bool Enabled = true;
+#else
+        static constexpr bool Enabled = false;
+#endif
+
+        /// @brief Maximum number of scopes which can be registered. Further scopes share the
+        /// untracked scope.
+        static constexpr std::uint32_t MaxScopes = 256;
+
+        AllocationTracker() = delete;
+
+        /// @brief Gets the identifier of the scope with the given name, registering it if needed.
+        /// @param name Scope name.
+        /// @return Scope identifier.
+        static std::uint32_t scope(std::string_view name);
+
+        /// @brief Makes the given scope the current one on this thread.
+        /// @param scope Scope identifier.
+        /// @return Identifier of the previously current scope, to be passed to @ref leave().
+        static std::uint32_t enter(std::uint32_t scope);
+
+        /// @brief Restores the scope which was current before the matching @ref enter() call.
+        /// @param previous Value returned by @ref enter().
+        static void leave(std::uint32_t previous);
+
+        /// @brief Gets the number of bytes currently allocated through the global heap.
+        /// @return Live bytes.
+        static std::size_t liveBytes();
+
+        /// @brief Collects the statistics of the frame which just ended and starts a new one.
+        /// @return Statistics of the frame which just ended.
+        static AllocationFrameStats endFrame();
+    };
+
+    /// @brief Guard which enters an allocation tracking scope on construction and leaves it on
+    /// destruction.
+    /// @ingroup core-memory
+    class AllocationScope final
+    {
+    public:
+        /// @brief Enters the given scope.
+        /// @param scope Scope identifier, obtained through @ref AllocationTracker::scope().
+        explicit AllocationScope(std::uint32_t scope)
+#ifdef CUBOS_CORE_TRACK_ALLOCATIONS
+            : mPrevious(AllocationTracker::enter(scope))
+#endif
+        {
+            (void)scope;
+        }
+
+        /// @brief Leaves the scope.
+        ~AllocationScope()
+        {
+#ifdef CUBOS_CORE_TRACK_ALLOCATIONS
+            AllocationTracker::leave(mPrevious);
+#endif
+        }
+
+        /// @brief Forbid copy construction.
+        AllocationScope(const AllocationScope&) = delete;
+
+    private:
+#ifdef CUBOS_CORE_TRACK_ALLOCATIONS
+        std::uint32_t mPrevious; ///< Scope which was current before this one.
+#endif
+    };
+
+#ifndef CUBOS_CORE_TRACK_ALLOCATIONS
+    inline std::uint32_t AllocationTracker::scope(std::string_view /*name*/)
+    {
+        return 0;
+    }
+
+    inline std::uint32_t AllocationTracker::enter(std::uint32_t /*scope*/)
+    {
+        return 0;
+    }
+
+    inline void AllocationTracker::leave(std::uint32_t /*previous*/)
+    {
+        // Do nothing.
+    }
+
+    inline std::size_t AllocationTracker::liveBytes()
+    {
+        return 0;
+    }
+
+    inline AllocationFrameStats AllocationTracker::endFrame()
+    {
+        return {};
+    }
+#endif
+} // namespace cubos::core::memory
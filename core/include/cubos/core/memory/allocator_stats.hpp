@@ -0,0 +1,20 @@
+/// @file
+/// @brief Struct @ref cubos::core::memory::AllocatorStats.
+/// @ingroup core-memory
+
+#pragma once
+
+#include <cstddef>
+
+namespace cubos::core::memory
+{
+    /// @brief Usage statistics reported by the allocators in this module.
+    /// @ingroup core-memory
+    struct AllocatorStats
+    {
+        std::size_t allocations = 0;         ///< Number of allocations served.
+        std::size_t bytesAllocated = 0;      ///< Bytes currently handed out to users.
+        std::size_t bytesReserved = 0;       ///< Bytes currently held from the upstream resource.
+        std::size_t upstreamAllocations = 0; ///< Number of allocations requested from the upstream resource.
+    };
+} // namespace cubos::core::memory
@@ -0,0 +1,75 @@
+/// @file
+/// @brief Class @ref cubos::core::memory::ArenaAllocator.
+/// @ingroup core-memory
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+#include <cubos/core/memory/allocator_stats.hpp>
+
+namespace cubos::core::memory
+{
+    /// @brief Memory resource which hands out memory by bumping a pointer through large blocks,
+    /// and which frees everything at once on @ref reset().
+    ///
+    /// Deallocation is a no-op. When the current block runs out, a new one is requested from the
+    /// upstream resource. On @ref reset(), if more than one block was used, they are merged into a
+    /// single block big enough for all of them, so that steady-state usage requires no upstream
+    /// allocations at all.
+    ///
+    /// @note Not thread-safe.
+    /// @ingroup core-memory
+    class ArenaAllocator : public std::pmr::memory_resource
+    {
+    public:
+        ~ArenaAllocator() override;
+
+        /// @brief Constructs.
+        /// @param blockSize Minimum size of the blocks requested from the upstream resource.
+        /// @param upstream Resource from which blocks are allocated.
+        ArenaAllocator(std::size_t blockSize = 64 * 1024,
+                       std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+        /// @brief Forbid copy construction.
+        ArenaAllocator(const ArenaAllocator&) = delete;
+
+        /// @brief Forbid move construction.
+        ArenaAllocator(ArenaAllocator&&) = delete;
+
+        /// @brief Releases every allocation made since the last reset.
+        ///
+        /// Any memory previously handed out by the arena must not be used after this call.
+        void reset();
+
+        /// @brief Gets usage statistics since the last reset.
+        /// @return Allocator statistics.
+        AllocatorStats stats() const;
+
+    protected:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    private:
+        /// @brief Block of memory requested from the upstream resource.
+        struct Block
+        {
+            std::byte* data;  ///< Start of the block.
+            std::size_t size; ///< Size of the block in bytes.
+        };
+
+        /// @brief Requests a new block from the upstream resource and makes it the current one.
+        /// @param size Size of the block.
+        void grow(std::size_t size);
+
+        std::pmr::memory_resource* mUpstream; ///< Resource from which blocks are allocated.
+        std::size_t mBlockSize;               ///< Minimum block size.
+        std::vector<Block> mBlocks;           ///< Blocks owned by the arena.
+        std::size_t mCurrent{0};              ///< Index of the block being bumped.
+        std::size_t mOffset{0};               ///< Offset of the next free byte in the current block.
+        AllocatorStats mStats;                ///< Statistics since the last reset.
+    };
+} // namespace cubos::core::memory
@@ -0,0 +1,40 @@
+/// @file
+/// @brief Class @ref cubos::core::memory::FrameAllocator.
+/// @ingroup core-memory
+
+#pragma once
+
+#include <cubos/core/memory/arena_allocator.hpp>
+
+namespace cubos::core::memory
+{
+    /// @brief Arena for allocations which only live until the end of the current frame.
+    ///
+    /// Meant to be used as a resource: whoever drives the main loop calls @ref endFrame() after
+    /// each iteration, which releases everything allocated during that frame.
+    ///
+    /// @note Not thread-safe.
+    /// @ingroup core-memory
+    class FrameAllocator final : public ArenaAllocator
+    {
+    public:
+        /// @brief Constructs.
+        /// @param blockSize Minimum size of the blocks requested from the upstream resource.
+        /// @param upstream Resource from which blocks are allocated.
+        FrameAllocator(std::size_t blockSize = 1024 * 1024,
+                       std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+        /// @brief Releases every allocation made during the current frame.
+        ///
+        /// The statistics of the frame which just ended become available through
+        /// @ref lastFrameStats().
+        void endFrame();
+
+        /// @brief Gets usage statistics of the last finished frame.
+        /// @return Allocator statistics.
+        const AllocatorStats& lastFrameStats() const;
+
+    private:
+        AllocatorStats mLastFrameStats; ///< Statistics of the last finished frame.
+    };
+} // namespace cubos::core::memory
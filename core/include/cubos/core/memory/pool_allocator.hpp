@@ -0,0 +1,72 @@
+/// @file
+/// @brief Class @ref cubos::core::memory::PoolAllocator.
+/// @ingroup core-memory
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+#include <cubos/core/memory/allocator_stats.hpp>
+
+namespace cubos::core::memory
+{
+    /// @brief Memory resource which serves fixed-size blocks from pages kept in a free list.
+    ///
+    /// Requests which fit in a block are served from the pool, and freed blocks are reused by the
+    /// following allocations, which makes it a good fit for node-based containers, such as
+    /// `std::pmr::unordered_map`, which are cleared and refilled often. Bigger or over-aligned
+    /// requests are forwarded to the upstream resource.
+    ///
+    /// @note Not thread-safe.
+    /// @ingroup core-memory
+    class PoolAllocator : public std::pmr::memory_resource
+    {
+    public:
+        ~PoolAllocator() override;
+
+        /// @brief Constructs.
+        /// @param blockSize Size of each block. Rounded up to a multiple of the maximum alignment.
+        /// @param blocksPerPage How many blocks are requested from the upstream resource at once.
+        /// @param upstream Resource from which pages and bigger allocations are requested.
+        PoolAllocator(std::size_t blockSize, std::size_t blocksPerPage = 256,
+                      std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+        /// @brief Forbid copy construction.
+        PoolAllocator(const PoolAllocator&) = delete;
+
+        /// @brief Forbid move construction.
+        PoolAllocator(PoolAllocator&&) = delete;
+
+        /// @brief Gets the size of the blocks served by the pool.
+        /// @return Block size in bytes.
+        std::size_t blockSize() const;
+
+        /// @brief Gets usage statistics since construction.
+        /// @return Allocator statistics.
+        AllocatorStats stats() const;
+
+    protected:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    private:
+        /// @brief Header written over unused blocks.
+        struct FreeBlock
+        {
+            FreeBlock* next; ///< Next free block, or null.
+        };
+
+        /// @brief Requests a new page from the upstream resource and adds its blocks to the free list.
+        void grow();
+
+        std::pmr::memory_resource* mUpstream; ///< Resource from which pages are allocated.
+        std::size_t mBlockSize;               ///< Size of each block.
+        std::size_t mBlocksPerPage;           ///< Number of blocks per page.
+        std::vector<std::byte*> mPages;       ///< Pages owned by the pool.
+        FreeBlock* mFree{nullptr};            ///< Head of the free list.
+        AllocatorStats mStats;                ///< Statistics since construction.
+    };
+} // namespace cubos::core::memory
@@ -0,0 +1,108 @@
+#include <chrono>
+#include <iostream>
+
+#include <cubos/core/ecs/blueprint.hpp>
+#include <cubos/core/ecs/component/registry.hpp>
+#include <cubos/core/ecs/component/vec_storage.hpp>
+#include <cubos/core/ecs/system/commands.hpp>
+#include <cubos/core/ecs/world.hpp>
+
+using namespace cubos::core;
+
+/// Number of copies of the blueprint spawned by each method.
+static constexpr std::size_t Copies = 10000;
+
+struct Position
+{
+    float x, y, z;
+};
+
+struct Parent
+{
+    ecs::Entity entity;
+};
+
+namespace cubos::core::data::old
+{
+    void serialize(Serializer& ser, const Position& position, const char* name)
+    {
+        ser.beginObject(name);
+        ser.write(position.x, "x");
+        ser.write(position.y, "y");
+        ser.write(position.z, "z");
+        ser.endObject();
+    }
+
+    void deserialize(Deserializer& des, Position& position)
+    {
+        des.beginObject();
+        des.read(position.x);
+        des.read(position.y);
+        des.read(position.z);
+        des.endObject();
+    }
+
+    void serialize(Serializer& ser, const Parent& parent, const char* name)
+    {
+        ser.write(parent.entity, name);
+    }
+
+    void deserialize(Deserializer& des, Parent& parent)
+    {
+        des.read(parent.entity);
+    }
+} // namespace cubos::core::data::old
+
+CUBOS_REGISTER_COMPONENT(Position, ecs::VecStorage<Position>, "Position")
+CUBOS_REGISTER_COMPONENT(Parent, ecs::VecStorage<Parent>, "Parent")
+
+/// Runs the given spawning function on a fresh world and prints how long it took.
+template <typename F>
+static void measure(const char* name, const ecs::Blueprint& blueprint, F spawn)
+{
+    ecs::World world{Copies * blueprint.size()};
+    world.registerComponent<Position>();
+    world.registerComponent<Parent>();
+    ecs::CommandBuffer cmds{world};
+
+    auto start = std::chrono::steady_clock::now();
+    spawn(cmds, blueprint);
+    cmds.commit();
+    auto end = std::chrono::steady_clock::now();
+
+    auto elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+    std::cout << name << ": " << elapsed << " ms (" << elapsed * 1000.0 / Copies << " us per copy)" << std::endl;
+}
+
+int main()
+{
+    initializeLogger();
+
+    // A small hierarchy, similar to what a projectile or a piece of debris would look like.
+    ecs::Blueprint blueprint;
+    auto root = blueprint.create("root", Position{0.0F, 0.0F, 0.0F});
+    blueprint.create("left", Position{-1.0F, 0.0F, 0.0F}, Parent{root});
+    blueprint.create("right", Position{1.0F, 0.0F, 0.0F}, Parent{root});
+
+    std::cout << "Spawning " << Copies << " copies of a blueprint with " << blueprint.size() << " entities"
+              << std::endl;
+
+    measure("spawn", blueprint, [](ecs::CommandBuffer& cmds, const ecs::Blueprint& blueprint) {
+        for (std::size_t i = 0; i < Copies; ++i)
+        {
+            cmds.spawn(blueprint);
+        }
+    });
+
+    blueprint.compile();
+
+    measure("spawn (compiled)", blueprint, [](ecs::CommandBuffer& cmds, const ecs::Blueprint& blueprint) {
+        for (std::size_t i = 0; i < Copies; ++i)
+        {
+            cmds.spawn(blueprint);
+        }
+    });
+
+    measure("spawnMany (compiled)", blueprint,
+            [](ecs::CommandBuffer& cmds, const ecs::Blueprint& blueprint) { cmds.spawnMany(blueprint, Copies); });
+}
@@ -64,10 +64,21 @@ void Blueprint::merge(const std::string& prefix, const Blueprint& other)
             buf = *ptr;
         }
 
+        buf->decompile();
         buf->merge(buffer.second, prefix, src, dst);
     }
 }
 
+void Blueprint::compile()
+{
+    data::old::Context context;
+    context.push(mMap);
+    for (const auto& buffer : mBuffers)
+    {
+        buffer.second->compile(context);
+    }
+}
+
 void Blueprint::clear()
 {
     mMap.clear();
@@ -36,6 +36,11 @@ std::size_t ComponentManager::getIDFromIndex(std::type_index type) const
     abort();
 }
 
+std::size_t ComponentManager::size() const
+{
+    return mEntries.size();
+}
+
 std::type_index ComponentManager::getType(std::size_t id) const
 {
     for (const auto& pair : mTypeToIds)
@@ -69,6 +74,23 @@ ComponentManager::Entry::Entry(std::unique_ptr<IStorage> storage)
     this->mutex = std::make_unique<std::shared_mutex>();
 }
 
+void ComponentManager::move(uint32_t id, std::size_t componentId, ComponentManager& source, uint32_t sourceId,
+                            std::size_t sourceComponentId)
+{
+    mEntries[componentId - 1].storage->moveFrom(id, *source.mEntries[sourceComponentId - 1].storage, sourceId);
+}
+
+bool ComponentManager::findHandles(uint32_t id, std::size_t componentId, std::vector<std::size_t>& offsets) const
+{
+    return mEntries[componentId - 1].storage->findHandles(id, offsets);
+}
+
+void ComponentManager::remap(uint32_t id, std::size_t componentId, const std::vector<std::size_t>& offsets,
+                             const std::unordered_map<Entity, Entity, EntityHash>& map)
+{
+    mEntries[componentId - 1].storage->remap(id, offsets, map);
+}
+
 data::old::Package ComponentManager::pack(uint32_t id, std::size_t componentId, data::old::Context* context) const
 {
     return mEntries[componentId - 1].storage->pack(id, context);
@@ -79,3 +101,22 @@ bool ComponentManager::unpack(uint32_t id, std::size_t componentId, const data::
 {
     return mEntries[componentId - 1].storage->unpack(id, package, context);
 }
+
+StorageStats ComponentManager::stats(std::size_t componentId) const
+{
+    std::shared_lock<std::shared_mutex> lock{*mEntries[componentId - 1].mutex};
+    return mEntries[componentId - 1].storage->stats();
+}
+
+StorageStats ComponentManager::stats() const
+{
+    StorageStats total{};
+    for (std::size_t id = 1; id <= mEntries.size(); ++id)
+    {
+        auto stats = this->stats(id);
+        total.count += stats.count;
+        total.bytesReserved += stats.bytesReserved;
+        total.bytesUsed += stats.bytesUsed;
+    }
+    return total;
+}
@@ -3,13 +3,20 @@
 #include <cubos/core/data/old/serializer.hpp>
 #include <cubos/core/ecs/entity/entity.hpp>
 #include <cubos/core/ecs/entity/hash.hpp>
+#include <cubos/core/ecs/entity/reference_recorder.hpp>
 
 using cubos::core::ecs::Entity;
 using cubos::core::ecs::EntityHash;
+using cubos::core::ecs::EntityReferenceRecorder;
 
 template <>
 void cubos::core::data::old::serialize<Entity>(Serializer& ser, const Entity& obj, const char* name)
 {
+    if (!obj.isNull() && ser.context().has<EntityReferenceRecorder*>())
+    {
+        ser.context().get<EntityReferenceRecorder*>()->record(obj);
+    }
+
     if (ser.context().has<SerializationMap<Entity, std::string, EntityHash>>())
     {
         if (obj.isNull())
@@ -47,6 +54,10 @@ void cubos::core::data::old::deserialize<Entity>(Deserializer& des, Entity& obj)
         if (map.hasId(name))
         {
             obj = map.getRef(name);
+            if (des.context().has<EntityReferenceRecorder*>())
+            {
+                des.context().get<EntityReferenceRecorder*>()->record(obj);
+            }
         }
         else
         {
@@ -50,8 +50,19 @@ BlueprintBuilder Commands::spawn(const Blueprint& blueprint)
     return mBuffer.spawn(blueprint);
 }
 
+std::vector<Entity> Commands::spawnMany(const Blueprint& blueprint, std::size_t count)
+{
+    return mBuffer.spawnMany(blueprint, count);
+}
+
 CommandBuffer::CommandBuffer(World& world)
     : mWorld(world)
+    , mPool(64)
+    , mCreated(&mPool)
+    , mDestroyed(&mPool)
+    , mAdded(&mPool)
+    , mRemoved(&mPool)
+    , mChanged(&mPool)
 {
     // Do nothing.
 }
@@ -59,6 +70,11 @@ CommandBuffer::CommandBuffer(World& world)
 CommandBuffer::~CommandBuffer()
 {
     this->abort();
+
+    for (auto& buffer : mBuffers)
+    {
+        delete buffer.second;
+    }
 }
 
 void CommandBuffer::destroy(Entity entity)
@@ -70,20 +86,64 @@ void CommandBuffer::destroy(Entity entity)
 
 BlueprintBuilder CommandBuffer::spawn(const Blueprint& blueprint)
 {
+    std::vector<Entity> entities;
+    entities.reserve(blueprint.size());
     data::old::SerializationMap<Entity, std::string, EntityHash> map;
-    for (uint32_t i = 0; i < static_cast<uint32_t>(blueprint.mMap.size()); ++i)
+    for (uint32_t i = 0; i < static_cast<uint32_t>(blueprint.size()); ++i)
     {
-        map.add(this->create().entity(), blueprint.mMap.getId(Entity(i, 0)));
+        entities.push_back(this->create().entity());
+        map.add(entities.back(), blueprint.mMap.getId(Entity(i, 0)));
     }
 
     data::old::Context context;
     context.push(map);
-    for (const auto& buf : blueprint.mBuffers)
+    this->instantiate(blueprint, entities.data(), &context);
+
+    return {std::move(map), *this};
+}
+
+std::vector<Entity> CommandBuffer::spawnMany(const Blueprint& blueprint, std::size_t count)
+{
+    std::vector<Entity> entities;
+    entities.reserve(blueprint.size() * count);
+    for (std::size_t i = 0; i < blueprint.size() * count; ++i)
     {
-        buf.second->addAll(*this, context);
+        entities.push_back(this->create().entity());
     }
 
-    return {std::move(map), *this};
+    for (std::size_t copy = 0; copy < count; ++copy)
+    {
+        this->instantiate(blueprint, entities.data() + copy * blueprint.size(), nullptr);
+    }
+
+    return entities;
+}
+
+void CommandBuffer::instantiate(const Blueprint& blueprint, const Entity* entities, data::old::Context* context)
+{
+    data::old::Context localContext;
+    for (const auto& buf : blueprint.mBuffers)
+    {
+        if (buf.second->compiled)
+        {
+            buf.second->addCompiled(*this, entities);
+            continue;
+        }
+
+        // Only build the name map if some component type actually needs to be deserialized.
+        if (context == nullptr)
+        {
+            data::old::SerializationMap<Entity, std::string, EntityHash> map;
+            for (uint32_t i = 0; i < static_cast<uint32_t>(blueprint.size()); ++i)
+            {
+                map.add(entities[i], blueprint.mMap.getId(Entity(i, 0)));
+            }
+            localContext.push(std::move(map));
+            context = &localContext;
+        }
+
+        buf.second->addAll(*this, *context);
+    }
 }
 
 void CommandBuffer::commit()
@@ -109,12 +169,12 @@ void CommandBuffer::commit()
         mWorld.mEntityManager.destroy(entity);
     }
 
-    // 3. Components are added.
+    // 3. Components are added. Only buffers used by these commands can hold any.
     for (auto& [entity, added] : mAdded)
     {
-        for (auto& buf : mBuffers)
+        for (auto* buffer : mDirty)
         {
-            buf.second->move(entity, mWorld.mComponentManager);
+            buffer->move(entity, mWorld.mComponentManager);
         }
     }
 
@@ -165,12 +225,13 @@ void CommandBuffer::abort()
 
 void CommandBuffer::clear()
 {
-    for (auto& buffer : mBuffers)
+    for (auto* buffer : mDirty)
     {
-        delete buffer.second;
+        buffer->clear();
+        buffer->dirty = false;
     }
 
-    mBuffers.clear();
+    mDirty.clear();
     mCreated.clear();
     mDestroyed.clear();
     mAdded.clear();
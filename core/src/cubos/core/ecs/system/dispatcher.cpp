@@ -1,6 +1,7 @@
 #include <algorithm>
 
 #include <cubos/core/ecs/system/dispatcher.hpp>
+#include <cubos/core/memory/allocation_tracker.hpp>
 
 using namespace cubos::core::ecs;
 
@@ -148,6 +149,22 @@ void Dispatcher::compileChain()
     // on move operations, just reverse the final list for the same effect.
     std::reverse(mSystems.begin(), mSystems.end());
 
+    if (memory::AllocationTracker::Enabled)
+    {
+        // Systems have no names, so identify them by their tags and position in the chain.
+        for (std::size_t i = 0; i < mSystems.size(); ++i)
+        {
+            std::vector<std::string> tags(mSystems[i]->tags.begin(), mSystems[i]->tags.end());
+            std::sort(tags.begin(), tags.end());
+            std::string name = "#" + std::to_string(i);
+            for (const auto& tag : tags)
+            {
+                name += " " + tag;
+            }
+            mSystems[i]->allocationScope = memory::AllocationTracker::scope(name);
+        }
+    }
+
     CUBOS_INFO("Call chain completed successfully!");
     mPendingSystems.clear();
     mCurrSystem = nullptr;
@@ -285,6 +302,7 @@ void Dispatcher::callSystems(World& world, CommandBuffer& cmds)
 
         if (canRun)
         {
+            memory::AllocationScope scope{system->allocationScope};
             system->system->call(world, cmds);
         }
 
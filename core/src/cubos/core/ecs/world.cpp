@@ -1,3 +1,5 @@
+#include <vector>
+
 #include <cubos/core/ecs/component/registry.hpp>
 #include <cubos/core/ecs/world.hpp>
 
@@ -82,6 +84,122 @@ bool World::unpack(Entity entity, const data::old::Package& package, data::old::
     return success;
 }
 
+void World::stage()
+{
+    mStagedHandles.clear();
+    std::vector<bool> warned(mComponentManager.size() + 1, false);
+    std::vector<std::size_t> offsets;
+    for (auto entity : *this)
+    {
+        const auto& mask = mEntityManager.getMask(entity);
+        for (std::size_t i = 1; i <= mComponentManager.size(); ++i)
+        {
+            if (!mask.test(i))
+            {
+                continue;
+            }
+
+            if (!mComponentManager.findHandles(entity.index, i, offsets) && !warned[i])
+            {
+                CUBOS_WARN("Components of type '{}' store entity handles outside of themselves, which won't be "
+                           "rewritten when merged into another world",
+                           mComponentManager.getType(i).name());
+                warned[i] = true;
+            }
+
+            if (!offsets.empty())
+            {
+                mStagedHandles.push_back({entity, i, std::move(offsets)});
+                offsets = {};
+            }
+        }
+    }
+
+    mStaged = true;
+}
+
+std::unordered_map<Entity, Entity, EntityHash> World::merge(World& other)
+{
+    if (!other.mStaged)
+    {
+        CUBOS_DEBUG("Staging a world while merging it, which should have been done beforehand");
+        other.stage();
+    }
+
+    // Translate the component identifiers of the other world into ours once, so that the masks
+    // can be converted with simple lookups.
+    std::vector<std::size_t> ids(other.mComponentManager.size() + 1, 0);
+    for (std::size_t i = 1; i < ids.size(); ++i)
+    {
+        auto type = other.mComponentManager.getType(i);
+        mComponentManager.registerComponent(type);
+        ids[i] = mComponentManager.getIDFromIndex(type);
+    }
+
+    // Collect the entities first, as destroying them invalidates the iterator.
+    std::vector<Entity> entities;
+    for (auto entity : other)
+    {
+        entities.push_back(entity);
+    }
+
+    std::unordered_map<Entity, Entity, EntityHash> map;
+    map.reserve(entities.size());
+
+    // Create every entity before moving any component, so that the map is complete when the
+    // references between them are rewritten below.
+    std::vector<Entity::Mask> masks;
+    masks.reserve(entities.size());
+    for (auto entity : entities)
+    {
+        const auto& otherMask = other.mEntityManager.getMask(entity);
+        Entity::Mask mask{1};
+        for (std::size_t i = 1; i < ids.size(); ++i)
+        {
+            if (otherMask.test(i))
+            {
+                mask.set(ids[i]);
+            }
+        }
+
+        masks.push_back(otherMask);
+        map.emplace(entity, mEntityManager.create(mask));
+    }
+
+    for (std::size_t e = 0; e < entities.size(); ++e)
+    {
+        auto entity = entities[e];
+        auto merged = map.at(entity);
+        for (std::size_t i = 1; i < ids.size(); ++i)
+        {
+            if (masks[e].test(i))
+            {
+                mComponentManager.move(merged.index, ids[i], other.mComponentManager, entity.index, i);
+            }
+        }
+
+        other.mEntityManager.destroy(entity);
+    }
+
+    // Entity handles stored inside the moved components still refer to the other world. Their
+    // offsets were found when it was staged, so they only have to be patched.
+    for (const auto& staged : other.mStagedHandles)
+    {
+        mComponentManager.remap(map.at(staged.entity).index, ids[staged.componentId], staged.offsets, map);
+    }
+
+    other.mStagedHandles.clear();
+    other.mStaged = false;
+
+    CUBOS_DEBUG("Merged {} entities from another world", entities.size());
+    return map;
+}
+
+StorageStats World::componentStats() const
+{
+    return mComponentManager.stats();
+}
+
 World::Iterator World::begin() const
 {
     return mEntityManager.begin();
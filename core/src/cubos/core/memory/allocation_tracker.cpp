@@ -0,0 +1,295 @@
+#ifdef CUBOS_CORE_TRACK_ALLOCATIONS
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#include <cubos/core/memory/allocation_tracker.hpp>
+
+using namespace cubos::core::memory;
+
+namespace
+{
+    /// @brief Counters of a single scope. Updated from inside the allocation hooks, and thus must
+    /// never allocate.
+    struct ScopeCounters
+    {
+        std::atomic<std::size_t> allocations{0};
+        std::atomic<std::size_t> bytes{0};
+        std::atomic<std::size_t> peakLiveBytes{0};
+    };
+
+    /// @brief Stored right before each pointer returned by the hooks.
+    struct Header
+    {
+        std::size_t size;   ///< Size requested by the user.
+        std::size_t offset; ///< Distance between the start of the underlying allocation and the user pointer.
+    };
+
+    static_assert(sizeof(Header) <= alignof(std::max_align_t));
+
+    std::array<ScopeCounters, AllocationTracker::MaxScopes> gCounters;
+    std::atomic<std::size_t> gLiveBytes{0};
+    std::atomic<std::size_t> gPeakLiveBytes{0};
+    thread_local std::uint32_t tCurrentScope = 0;
+
+    /// @brief Names of the registered scopes. Only touched outside of the hooks.
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::string> names{"<untracked>"};
+    };
+
+    Registry& registry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    void updateMax(std::atomic<std::size_t>& max, std::size_t value)
+    {
+        std::size_t current = max.load(std::memory_order_relaxed);
+        while (current < value && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void* trackedAllocate(std::size_t size, std::size_t alignment) noexcept
+    {
+        alignment = std::max(alignment, alignof(std::max_align_t));
+        auto* raw = static_cast<std::byte*>(std::malloc(size + alignment + sizeof(Header)));
+        if (raw == nullptr)
+        {
+            return nullptr;
+        }
+
+        // Leave room for the header before the first aligned address.
+        auto address = reinterpret_cast<std::uintptr_t>(raw + sizeof(Header));
+        auto padding = ((address + alignment - 1) & ~(alignment - 1)) - address;
+        auto* user = raw + sizeof(Header) + padding;
+        auto* header = reinterpret_cast<Header*>(user - sizeof(Header));
+        header->size = size;
+        header->offset = static_cast<std::size_t>(user - raw);
+
+        auto live = gLiveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        updateMax(gPeakLiveBytes, live);
+
+        auto& counters = gCounters[tCurrentScope];
+        counters.allocations.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes.fetch_add(size, std::memory_order_relaxed);
+        updateMax(counters.peakLiveBytes, live);
+
+        return user;
+    }
+
+    void trackedDeallocate(void* ptr) noexcept
+    {
+        if (ptr == nullptr)
+        {
+            return;
+        }
+
+        auto* user = static_cast<std::byte*>(ptr);
+        auto* header = reinterpret_cast<Header*>(user - sizeof(Header));
+        gLiveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+        std::free(user - header->offset);
+    }
+
+    void* throwingAllocate(std::size_t size, std::size_t alignment)
+    {
+        while (true)
+        {
+            if (void* ptr = trackedAllocate(size, alignment))
+            {
+                return ptr;
+            }
+
+            auto handler = std::get_new_handler();
+            if (handler == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+    }
+} // namespace
+
+std::uint32_t AllocationTracker::scope(std::string_view name)
+{
+    auto& reg = registry();
+    std::lock_guard lock{reg.mutex};
+    for (std::size_t i = 0; i < reg.names.size(); ++i)
+    {
+        if (reg.names[i] == name)
+        {
+            return static_cast<std::uint32_t>(i);
+        }
+    }
+
+    if (reg.names.size() == MaxScopes)
+    {
+        return 0;
+    }
+
+    reg.names.emplace_back(name);
+    return static_cast<std::uint32_t>(reg.names.size() - 1);
+}
+
+std::uint32_t AllocationTracker::enter(std::uint32_t scope)
+{
+    auto previous = tCurrentScope;
+    tCurrentScope = scope;
+    return previous;
+}
+
+void AllocationTracker::leave(std::uint32_t previous)
+{
+    tCurrentScope = previous;
+}
+
+std::size_t AllocationTracker::liveBytes()
+{
+    return gLiveBytes.load(std::memory_order_relaxed);
+}
+
+AllocationFrameStats AllocationTracker::endFrame()
+{
+    // Snapshot the counters before allocating anything, so that building the result doesn't
+    // show up in it.
+    std::array<AllocationScopeStats, MaxScopes> snapshot{};
+    auto live = gLiveBytes.load(std::memory_order_relaxed);
+    AllocationFrameStats frame;
+    frame.peakLiveBytes = gPeakLiveBytes.exchange(live, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < MaxScopes; ++i)
+    {
+        snapshot[i].allocations = gCounters[i].allocations.exchange(0, std::memory_order_relaxed);
+        snapshot[i].bytes = gCounters[i].bytes.exchange(0, std::memory_order_relaxed);
+        snapshot[i].peakLiveBytes = gCounters[i].peakLiveBytes.exchange(0, std::memory_order_relaxed);
+    }
+
+    auto& reg = registry();
+    std::lock_guard lock{reg.mutex};
+    for (std::size_t i = 0; i < reg.names.size(); ++i)
+    {
+        if (snapshot[i].allocations == 0)
+        {
+            continue;
+        }
+
+        frame.allocations += snapshot[i].allocations;
+        frame.bytes += snapshot[i].bytes;
+        snapshot[i].name = reg.names[i];
+        frame.scopes.push_back(std::move(snapshot[i]));
+    }
+
+    return frame;
+}
+
+// Replacements of the replaceable global allocation functions. All of them must be replaced, as
+// memory allocated by our versions can't be freed by the standard library ones.
+
+void* operator new(std::size_t size)
+{
+    return throwingAllocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](std::size_t size)
+{
+    return throwingAllocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return throwingAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return throwingAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t& /*unused*/) noexcept
+{
+    return trackedAllocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& /*unused*/) noexcept
+{
+    return trackedAllocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t& /*unused*/) noexcept
+{
+    return trackedAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& /*unused*/) noexcept
+{
+    return trackedAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept
+{
+    trackedDeallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    trackedDeallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /*size*/) noexcept
+{
+    trackedDeallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t /*size*/) noexcept
+{
+    trackedDeallocate(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t /*alignment*/) noexcept
+{
+    trackedDeallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t /*alignment*/) noexcept
+{
+    trackedDeallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept
+{
+    trackedDeallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept
+{
+    trackedDeallocate(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t& /*unused*/) noexcept
+{
+    trackedDeallocate(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t& /*unused*/) noexcept
+{
+    trackedDeallocate(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t /*alignment*/, const std::nothrow_t& /*unused*/) noexcept
+{
+    trackedDeallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t /*alignment*/, const std::nothrow_t& /*unused*/) noexcept
+{
+    trackedDeallocate(ptr);
+}
+
+#endif // CUBOS_CORE_TRACK_ALLOCATIONS
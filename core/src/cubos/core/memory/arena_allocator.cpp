@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cstdint>
+
+#include <cubos/core/memory/arena_allocator.hpp>
+
+using namespace cubos::core::memory;
+
+ArenaAllocator::~ArenaAllocator()
+{
+    for (const auto& block : mBlocks)
+    {
+        mUpstream->deallocate(block.data, block.size, alignof(std::max_align_t));
+    }
+}
+
+ArenaAllocator::ArenaAllocator(std::size_t blockSize, std::pmr::memory_resource* upstream)
+    : mUpstream(upstream)
+    , mBlockSize(blockSize)
+{
+    // Do nothing.
+}
+
+void ArenaAllocator::reset()
+{
+    if (mBlocks.size() > 1)
+    {
+        // Merge all blocks into a single one, so that the next usage fits without growing.
+        std::size_t total = 0;
+        for (const auto& block : mBlocks)
+        {
+            total += block.size;
+            mUpstream->deallocate(block.data, block.size, alignof(std::max_align_t));
+        }
+
+        mBlocks.clear();
+        mStats.bytesReserved = 0;
+        this->grow(total);
+    }
+
+    mCurrent = 0;
+    mOffset = 0;
+    mStats.allocations = 0;
+    mStats.bytesAllocated = 0;
+    mStats.upstreamAllocations = 0;
+}
+
+AllocatorStats ArenaAllocator::stats() const
+{
+    return mStats;
+}
+
+void* ArenaAllocator::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    mStats.allocations += 1;
+    mStats.bytesAllocated += bytes;
+
+    while (true)
+    {
+        if (mCurrent == mBlocks.size())
+        {
+            // No block left with enough space, request a new one big enough for this allocation.
+            this->grow(std::max(mBlockSize, bytes + alignment));
+        }
+
+        auto& block = mBlocks[mCurrent];
+        auto address = reinterpret_cast<std::uintptr_t>(block.data + mOffset);
+        auto padding = static_cast<std::size_t>((alignment - address % alignment) % alignment);
+
+        if (mOffset + padding + bytes <= block.size)
+        {
+            void* ptr = block.data + mOffset + padding;
+            mOffset += padding + bytes;
+            return ptr;
+        }
+
+        // Doesn't fit in the current block, move on to the next one.
+        mCurrent += 1;
+        mOffset = 0;
+    }
+}
+
+void ArenaAllocator::do_deallocate(void* /*p*/, std::size_t /*bytes*/, std::size_t /*alignment*/)
+{
+    // Memory is only released on reset.
+}
+
+bool ArenaAllocator::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+void ArenaAllocator::grow(std::size_t size)
+{
+    auto* data = static_cast<std::byte*>(mUpstream->allocate(size, alignof(std::max_align_t)));
+    mBlocks.push_back({data, size});
+    mCurrent = mBlocks.size() - 1;
+    mOffset = 0;
+    mStats.bytesReserved += size;
+    mStats.upstreamAllocations += 1;
+}
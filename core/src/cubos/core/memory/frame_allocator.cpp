@@ -0,0 +1,20 @@
+#include <cubos/core/memory/frame_allocator.hpp>
+
+using namespace cubos::core::memory;
+
+FrameAllocator::FrameAllocator(std::size_t blockSize, std::pmr::memory_resource* upstream)
+    : ArenaAllocator(blockSize, upstream)
+{
+    // Do nothing.
+}
+
+void FrameAllocator::endFrame()
+{
+    mLastFrameStats = this->stats();
+    this->reset();
+}
+
+const AllocatorStats& FrameAllocator::lastFrameStats() const
+{
+    return mLastFrameStats;
+}
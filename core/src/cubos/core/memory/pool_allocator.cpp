@@ -0,0 +1,92 @@
+#include <algorithm>
+
+#include <cubos/core/memory/pool_allocator.hpp>
+
+using namespace cubos::core::memory;
+
+PoolAllocator::~PoolAllocator()
+{
+    for (auto* page : mPages)
+    {
+        mUpstream->deallocate(page, mBlockSize * mBlocksPerPage, alignof(std::max_align_t));
+    }
+}
+
+PoolAllocator::PoolAllocator(std::size_t blockSize, std::size_t blocksPerPage, std::pmr::memory_resource* upstream)
+    : mUpstream(upstream)
+    , mBlocksPerPage(blocksPerPage > 0 ? blocksPerPage : 1)
+{
+    // Blocks must be able to hold the free list header and keep every block maximally aligned.
+    constexpr std::size_t Alignment = alignof(std::max_align_t);
+    blockSize = std::max(blockSize, sizeof(FreeBlock));
+    mBlockSize = (blockSize + Alignment - 1) / Alignment * Alignment;
+}
+
+std::size_t PoolAllocator::blockSize() const
+{
+    return mBlockSize;
+}
+
+AllocatorStats PoolAllocator::stats() const
+{
+    return mStats;
+}
+
+void* PoolAllocator::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    mStats.allocations += 1;
+    mStats.bytesAllocated += bytes;
+
+    if (bytes > mBlockSize || alignment > alignof(std::max_align_t))
+    {
+        mStats.bytesReserved += bytes;
+        mStats.upstreamAllocations += 1;
+        return mUpstream->allocate(bytes, alignment);
+    }
+
+    if (mFree == nullptr)
+    {
+        this->grow();
+    }
+
+    FreeBlock* block = mFree;
+    mFree = block->next;
+    return block;
+}
+
+void PoolAllocator::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+{
+    mStats.bytesAllocated -= bytes;
+
+    if (bytes > mBlockSize || alignment > alignof(std::max_align_t))
+    {
+        mStats.bytesReserved -= bytes;
+        mUpstream->deallocate(p, bytes, alignment);
+        return;
+    }
+
+    auto* block = static_cast<FreeBlock*>(p);
+    block->next = mFree;
+    mFree = block;
+}
+
+bool PoolAllocator::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+void PoolAllocator::grow()
+{
+    auto* page = static_cast<std::byte*>(mUpstream->allocate(mBlockSize * mBlocksPerPage, alignof(std::max_align_t)));
+    mPages.push_back(page);
+    mStats.bytesReserved += mBlockSize * mBlocksPerPage;
+    mStats.upstreamAllocations += 1;
+
+    // Push the blocks in reverse order, so that they're handed out sequentially.
+    for (std::size_t i = mBlocksPerPage; i > 0; --i)
+    {
+        auto* block = reinterpret_cast<FreeBlock*>(page + (i - 1) * mBlockSize);
+        block->next = mFree;
+        mFree = block;
+    }
+}
@@ -30,10 +30,16 @@ ThreadPool::ThreadPool(std::size_t numThreads)
                 }
 
                 task();
-                mNumTasks -= 1; // Task has finished executing.
 
-                // Signal that a thread has finished executing a task.
-                mTaskDone.notify_one();
+                {
+                    // The counter must change under the lock, or a waiting thread could check it
+                    // right before the notification and then sleep through it.
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mNumTasks -= 1; // Task has finished executing.
+                }
+
+                // Signal that a thread has finished executing a task. More than one thread may be waiting.
+                mTaskDone.notify_all();
             }
         });
     }
@@ -41,7 +47,10 @@ ThreadPool::ThreadPool(std::size_t numThreads)
 
 ThreadPool::~ThreadPool()
 {
-    mStop = true;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mStop = true;
+    }
     mNewTask.notify_all();
     for (auto& thread : mThreads)
     {
@@ -73,6 +73,44 @@ TEST_CASE("ecs::Blueprint")
         CHECK(bazPkg.field("integer").get<int>() == 2);
     }
 
+    SUBCASE("compile the blueprint and spawn many copies of it")
+    {
+        blueprint.compile();
+
+        // Spawning a compiled blueprint produces the same result.
+        auto spawned = cmds.spawn(blueprint);
+        auto spawnedBar = spawned.entity("bar");
+        auto spawnedBaz = spawned.entity("baz");
+
+        auto copies = cmds.spawnMany(blueprint, 3);
+        REQUIRE(copies.size() == 3 * blueprint.size());
+        cmdBuffer.commit();
+
+        auto bazPkg = world.pack(spawnedBaz);
+        CHECK(bazPkg.fields().size() == 2);
+        CHECK(bazPkg.field("parent").get<Entity>() == spawnedBar);
+        CHECK(bazPkg.field("integer").get<int>() == 2);
+
+        // Each copy references its own entities.
+        for (std::size_t copy = 0; copy < 3; ++copy)
+        {
+            auto copyBar = copies[copy * blueprint.size() + bar.index];
+            auto copyBaz = copies[copy * blueprint.size() + baz.index];
+            CHECK(world.pack(copyBar).fields().size() == 0);
+
+            bazPkg = world.pack(copyBaz);
+            CHECK(bazPkg.fields().size() == 2);
+            CHECK(bazPkg.field("parent").get<Entity>() == copyBar);
+            CHECK(bazPkg.field("integer").get<int>() == 2);
+        }
+
+        // Adding components to a compiled blueprint still works.
+        blueprint.add(bar, IntegerComponent{3});
+        auto barCopy = cmds.spawnMany(blueprint, 1)[bar.index];
+        cmdBuffer.commit();
+        CHECK(world.pack(barCopy).field("integer").get<int>() == 3);
+    }
+
     SUBCASE("merge one blueprint into another blueprint and then spawn it")
     {
         // Create another blueprint with one entity.
@@ -0,0 +1,164 @@
+#include <memory>
+
+#include <doctest/doctest.h>
+
+#include <cubos/core/ecs/component/map_storage.hpp>
+#include <cubos/core/ecs/component/null_storage.hpp>
+#include <cubos/core/ecs/component/shared_storage.hpp>
+#include <cubos/core/ecs/component/vec_storage.hpp>
+
+#include "utils.hpp"
+
+using cubos::core::ecs::MapStorage;
+using cubos::core::ecs::NullStorage;
+using cubos::core::ecs::SharedStorage;
+using cubos::core::ecs::VecStorage;
+
+TEST_CASE("ecs::VecStorage")
+{
+    VecStorage<int> storage{};
+    CHECK(storage.stats().count == 0);
+    CHECK(storage.stats().bytesUsed == 0);
+
+    SUBCASE("addresses are stable when the storage grows")
+    {
+        int* first = storage.insert(0, 1);
+        for (uint32_t i = 1; i < 1000; ++i)
+        {
+            storage.insert(i, static_cast<int>(i) + 1);
+        }
+
+        CHECK(storage.get(0) == first);
+        CHECK(*first == 1);
+        CHECK(*storage.get(999) == 1000);
+        CHECK(storage.stats().count == 1000);
+        CHECK(storage.stats().bytesUsed == 1000 * sizeof(int));
+        CHECK(storage.stats().bytesReserved >= storage.stats().bytesUsed);
+    }
+
+    SUBCASE("empty pages are released")
+    {
+        storage.insert(0, 1);
+        auto onePage = storage.stats().bytesReserved;
+
+        storage.insert(VecStorage<int>::PageSize * 3, 2);
+        CHECK(storage.stats().bytesReserved > onePage);
+        CHECK(storage.stats().fragmentation() > 0.0);
+
+        storage.erase(VecStorage<int>::PageSize * 3);
+        CHECK(storage.stats().count == 1);
+        CHECK(storage.stats().bytesReserved <= onePage + 3 * sizeof(void*));
+
+        storage.erase(0);
+        storage.erase(0); // Erasing twice does nothing.
+        CHECK(storage.stats().count == 0);
+        CHECK(storage.stats().bytesUsed == 0);
+    }
+
+    SUBCASE("values are destructed on erase, overwrite and storage destruction")
+    {
+        bool erased = false;
+        bool overwritten = false;
+        bool destroyed = false;
+
+        {
+            VecStorage<DetectDestructor> detectStorage{};
+            detectStorage.insert(0, DetectDestructor{&erased});
+            detectStorage.insert(1, DetectDestructor{&overwritten});
+            detectStorage.insert(2, DetectDestructor{&destroyed});
+
+            detectStorage.erase(0);
+            CHECK(erased);
+
+            detectStorage.insert(1, DetectDestructor{});
+            CHECK(overwritten);
+            CHECK_FALSE(destroyed);
+        }
+
+        CHECK(destroyed);
+    }
+}
+
+TEST_CASE("ecs::MapStorage")
+{
+    MapStorage<int> storage{};
+    storage.insert(5, 1);
+    storage.insert(5, 2);
+    storage.insert(10000, 3);
+
+    CHECK(*storage.get(5) == 2);
+    CHECK(*storage.get(10000) == 3);
+    CHECK(storage.stats().count == 2);
+    CHECK(storage.stats().bytesUsed == 2 * sizeof(int));
+    CHECK(storage.stats().bytesReserved >= storage.stats().bytesUsed);
+
+    storage.erase(5);
+    CHECK(storage.stats().count == 1);
+}
+
+TEST_CASE("ecs::NullStorage")
+{
+    NullStorage<int> storage{};
+    storage.insert(0, 1);
+    CHECK(storage.stats().count == 0);
+    CHECK(storage.stats().bytesReserved == 0);
+    CHECK(storage.stats().fragmentation() == 0.0);
+}
+
+TEST_CASE("ecs::SharedStorage")
+{
+    SharedStorage<int> storage{};
+    CHECK(storage.instance(0) == SharedStorage<int>::NoInstance);
+
+    SUBCASE("equal consecutive values share one instance")
+    {
+        for (uint32_t i = 0; i < 1000; ++i)
+        {
+            storage.insert(i, 42);
+        }
+
+        CHECK(storage.instanceCount() == 1);
+        CHECK(storage.stats().count == 1000);
+        CHECK(storage.stats().bytesUsed == 1000 * sizeof(uint32_t) + sizeof(int));
+        CHECK(storage.instance(0) == storage.instance(999));
+        CHECK(*static_cast<const SharedStorage<int>&>(storage).get(500) == 42);
+
+        storage.insert(1000, 7);
+        CHECK(storage.instanceCount() == 2);
+        CHECK(storage.instance(1000) != storage.instance(0));
+    }
+
+    SUBCASE("mutable access copies shared values")
+    {
+        storage.insert(0, 1);
+        storage.share(1, 0);
+        CHECK(storage.instance(0) == storage.instance(1));
+
+        *storage.get(1) = 2;
+        CHECK(storage.instance(0) != storage.instance(1));
+        CHECK(*storage.get(0) == 1);
+        CHECK(*storage.get(1) == 2);
+
+        // Values which aren't shared are modified in place.
+        int* value = storage.get(1);
+        CHECK(storage.get(1) == value);
+    }
+
+    SUBCASE("instances are destroyed when no longer referenced")
+    {
+        auto value = std::make_shared<int>(0);
+        SharedStorage<std::shared_ptr<int>> ptrStorage{};
+        ptrStorage.insert(0, value);
+        ptrStorage.share(1, 0);
+        CHECK(value.use_count() == 2);
+
+        ptrStorage.erase(0);
+        CHECK(value.use_count() == 2);
+        CHECK(ptrStorage.instanceCount() == 1);
+
+        ptrStorage.erase(1);
+        CHECK(value.use_count() == 1);
+        CHECK(ptrStorage.instanceCount() == 0);
+        CHECK(ptrStorage.stats().count == 0);
+    }
+}
@@ -1,3 +1,5 @@
+#include <thread>
+
 #include <doctest/doctest.h>
 
 #include <cubos/core/ecs/world.hpp>
@@ -142,6 +144,59 @@ TEST_CASE("ecs::World")
         CHECK(destroyed);
     }
 
+    SUBCASE("merge a staging world into another")
+    {
+        // Occupy some indices of the main world so that handles don't map to themselves.
+        auto existing = world.create(IntegerComponent{0});
+
+        // Fill and stage a staging world on another thread, as done when loading a scene.
+        World staging{};
+        Entity bar;
+        Entity foo;
+        Entity baz;
+        Entity qux;
+        std::thread worker{[&]() {
+            setupWorld(staging);
+            bar = staging.create(IntegerComponent{1});
+            foo = staging.create(IntegerComponent{2}, ParentComponent{bar});
+            baz = staging.create();
+
+            // Handles to entities which are no longer alive can't be mapped.
+            auto dead = staging.create();
+            staging.destroy(dead);
+            qux = staging.create(ParentComponent{dead});
+
+            staging.stage();
+        }};
+        worker.join();
+
+        auto map = world.merge(staging);
+        CHECK(map.size() == 4);
+        CHECK(staging.begin() == staging.end());
+        CHECK_FALSE(staging.isAlive(foo));
+
+        // The entities were moved along with their components.
+        CHECK(world.isAlive(existing));
+        CHECK(world.isAlive(map.at(bar)));
+        CHECK(world.isAlive(map.at(baz)));
+        CHECK(world.has<IntegerComponent>(map.at(foo)));
+        CHECK(world.has<ParentComponent>(map.at(foo)));
+        CHECK_FALSE(world.has<IntegerComponent>(map.at(baz)));
+        CHECK(world.pack(map.at(bar)).field("integer").get<int>() == 1);
+        CHECK(world.pack(map.at(foo)).field("integer").get<int>() == 2);
+
+        // Handles stored inside components now refer to the merged entities.
+        CHECK(world.pack(map.at(foo)).field("parent").get<Entity>() == map.at(bar));
+        CHECK(world.pack(map.at(qux)).field("parent").get<Entity>().isNull());
+
+        // Worlds which weren't staged are staged by the merge itself.
+        auto parent = staging.create(IntegerComponent{3});
+        auto child = staging.create();
+        staging.add(child, ParentComponent{parent});
+        map = world.merge(staging);
+        CHECK(world.pack(map.at(child)).field("parent").get<Entity>() == map.at(parent));
+    }
+
     SUBCASE("read and write resources")
     {
         // Register some resources.
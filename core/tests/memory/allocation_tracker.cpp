@@ -0,0 +1,52 @@
+#include <memory>
+
+#include <doctest/doctest.h>
+
+#include <cubos/core/memory/allocation_tracker.hpp>
+
+using cubos::core::memory::AllocationScope;
+using cubos::core::memory::AllocationTracker;
+
+TEST_CASE("memory::AllocationTracker")
+{
+    auto scope = AllocationTracker::scope("test");
+    CHECK(AllocationTracker::scope("test") == scope);
+    AllocationTracker::endFrame();
+
+    {
+        AllocationScope guard{scope};
+        auto value = std::make_unique<int>(42);
+        auto array = std::make_unique<char[]>(100);
+    }
+
+    auto frame = AllocationTracker::endFrame();
+    if (AllocationTracker::Enabled)
+    {
+        REQUIRE_FALSE(frame.scopes.empty());
+        bool found = false;
+        for (const auto& stats : frame.scopes)
+        {
+            if (stats.name == "test")
+            {
+                found = true;
+                CHECK(stats.allocations == 2);
+                CHECK(stats.bytes == sizeof(int) + 100);
+                CHECK(stats.peakLiveBytes >= stats.bytes);
+            }
+        }
+        CHECK(found);
+        CHECK(frame.allocations >= 2);
+        CHECK(frame.peakLiveBytes >= sizeof(int) + 100);
+
+        // The counters are reset at the end of each frame.
+        for (const auto& stats : AllocationTracker::endFrame().scopes)
+        {
+            CHECK(stats.name != "test");
+        }
+    }
+    else
+    {
+        CHECK(frame.scopes.empty());
+        CHECK(frame.allocations == 0);
+    }
+}
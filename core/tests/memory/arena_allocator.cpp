@@ -0,0 +1,82 @@
+#include <memory_resource>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include <cubos/core/memory/arena_allocator.hpp>
+#include <cubos/core/memory/frame_allocator.hpp>
+
+using cubos::core::memory::ArenaAllocator;
+using cubos::core::memory::FrameAllocator;
+
+TEST_CASE("memory::ArenaAllocator")
+{
+    ArenaAllocator arena{256};
+    CHECK(arena.stats().bytesReserved == 0);
+
+    SUBCASE("allocations are aligned and don't overlap")
+    {
+        auto* a = static_cast<char*>(arena.allocate(3, 1));
+        auto* b = static_cast<char*>(arena.allocate(16, 16));
+        auto* c = static_cast<char*>(arena.allocate(8, 8));
+        CHECK(reinterpret_cast<std::uintptr_t>(b) % 16 == 0);
+        CHECK(reinterpret_cast<std::uintptr_t>(c) % 8 == 0);
+        CHECK(b >= a + 3);
+        CHECK(c >= b + 16);
+        CHECK(arena.stats().allocations == 3);
+        CHECK(arena.stats().bytesAllocated == 27);
+        CHECK(arena.stats().upstreamAllocations == 1);
+    }
+
+    SUBCASE("blocks are merged on reset")
+    {
+        // Force the arena to grow past its first block.
+        for (int i = 0; i < 10; ++i)
+        {
+            arena.allocate(100, 8);
+        }
+        CHECK(arena.stats().upstreamAllocations > 1);
+        auto reserved = arena.stats().bytesReserved;
+
+        // After a reset, the same allocations fit without asking the upstream resource again.
+        arena.reset();
+        CHECK(arena.stats().allocations == 0);
+        CHECK(arena.stats().bytesReserved == reserved);
+        for (int i = 0; i < 10; ++i)
+        {
+            arena.allocate(100, 8);
+        }
+        CHECK(arena.stats().upstreamAllocations == 0);
+    }
+
+    SUBCASE("allocations bigger than a block are supported")
+    {
+        auto* big = static_cast<char*>(arena.allocate(1000, 8));
+        big[999] = 42;
+        CHECK(arena.stats().bytesReserved >= 1000);
+    }
+
+    SUBCASE("can be used by pmr containers")
+    {
+        std::pmr::vector<int> vec{&arena};
+        for (int i = 0; i < 100; ++i)
+        {
+            vec.push_back(i);
+        }
+        CHECK(vec[99] == 99);
+        CHECK(arena.stats().allocations > 0);
+    }
+}
+
+TEST_CASE("memory::FrameAllocator")
+{
+    FrameAllocator frame{};
+    frame.allocate(64, 8);
+    frame.allocate(64, 8);
+    CHECK(frame.stats().allocations == 2);
+
+    frame.endFrame();
+    CHECK(frame.stats().allocations == 0);
+    CHECK(frame.lastFrameStats().allocations == 2);
+    CHECK(frame.lastFrameStats().bytesAllocated == 128);
+}
@@ -0,0 +1,65 @@
+#include <memory_resource>
+#include <unordered_map>
+
+#include <doctest/doctest.h>
+
+#include <cubos/core/memory/pool_allocator.hpp>
+
+using cubos::core::memory::PoolAllocator;
+
+TEST_CASE("memory::PoolAllocator")
+{
+    PoolAllocator pool{24, 4};
+    CHECK(pool.blockSize() >= 24);
+    CHECK(pool.blockSize() % alignof(std::max_align_t) == 0);
+
+    SUBCASE("freed blocks are reused")
+    {
+        void* a = pool.allocate(24);
+        void* b = pool.allocate(16);
+        CHECK(a != b);
+        CHECK(pool.stats().upstreamAllocations == 1);
+        CHECK(pool.stats().bytesAllocated == 40);
+
+        pool.deallocate(a, 24);
+        CHECK(pool.allocate(24) == a);
+        CHECK(pool.stats().bytesAllocated == 40);
+    }
+
+    SUBCASE("new pages are requested when the pool is exhausted")
+    {
+        for (int i = 0; i < 5; ++i)
+        {
+            pool.allocate(8);
+        }
+        CHECK(pool.stats().upstreamAllocations == 2);
+        CHECK(pool.stats().bytesReserved == 8 * pool.blockSize());
+    }
+
+    SUBCASE("big allocations are forwarded upstream")
+    {
+        void* big = pool.allocate(1024);
+        CHECK(pool.stats().upstreamAllocations == 1);
+        CHECK(pool.stats().bytesReserved == 1024);
+        pool.deallocate(big, 1024);
+        CHECK(pool.stats().bytesReserved == 0);
+    }
+
+    SUBCASE("refilling a cleared container doesn't allocate pages again")
+    {
+        PoolAllocator nodes{64};
+        std::pmr::unordered_map<int, int> map{&nodes};
+        for (int i = 0; i < 100; ++i)
+        {
+            map[i] = i;
+        }
+
+        auto upstream = nodes.stats().upstreamAllocations;
+        map.clear();
+        for (int i = 0; i < 100; ++i)
+        {
+            map[i] = i;
+        }
+        CHECK(nodes.stats().upstreamAllocations == upstream);
+    }
+}
@@ -4,12 +4,24 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <latch>
+#include <memory>
+#include <memory_resource>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <cubos/core/ecs/entity/hash.hpp>
 #include <cubos/core/ecs/entity/manager.hpp>
+#include <cubos/core/geom/aabb.hpp>
+#include <cubos/core/memory/pool_allocator.hpp>
+#include <cubos/core/thread_pool.hpp>
+
+#include <cubos/engine/collisions/dynamic_aabb_tree.hpp>
+#include <cubos/engine/collisions/spatial_hash_broad_phase.hpp>
 
 namespace cubos::engine
 {
@@ -17,15 +29,37 @@ namespace cubos::engine
     /// @ingroup collisions-plugin
     struct BroadPhaseCollisions
     {
+        /// @brief Constructs.
+        BroadPhaseCollisions();
+
+        /// @brief Algorithm used to find the collision candidates.
+        enum class Method
+        {
+            SweepAndPrune, ///< Incremental sweep and prune over the three axes.
+            AABBTree,      ///< Dynamic AABB tree, better suited for colliders clustered on an axis.
+            SpatialHash,   ///< Uniform grids, for many similarly sized colliders.
+        };
+
         /// @brief Pair of entities that may collide.
         using Candidate = std::pair<core::ecs::Entity, core::ecs::Entity>;
 
         /// @brief Hash function to allow Candidates to be used as keys in an unordered_set.
+        ///
+        /// Doesn't depend on the order of the entities in the pair. XORing their hashes wouldn't
+        /// either, but would send every pair of entities with close hashes to the same few buckets,
+        /// so the smaller hash is mixed into the larger one instead.
         struct CandidateHash
         {
             std::size_t operator()(const Candidate& candidate) const
             {
-                return core::ecs::EntityHash()(candidate.first) ^ core::ecs::EntityHash()(candidate.second);
+                auto low = core::ecs::EntityHash()(candidate.first);
+                auto high = core::ecs::EntityHash()(candidate.second);
+                if (low > high)
+                {
+                    std::swap(low, high);
+                }
+
+                return high ^ (low + static_cast<std::size_t>(0x9E3779B97F4A7C15ULL) + (high << 6) + (high >> 2));
             }
         };
 
@@ -35,6 +69,7 @@ namespace cubos::engine
             BoxBox = 0,
             BoxCapsule,
             CapsuleCapsule,
+            BoxVoxel,
 
             Count ///< Number of collision types.
         };
@@ -44,47 +79,284 @@ namespace cubos::engine
         {
             core::ecs::Entity entity; ///< Entity referenced by the marker.
             bool isMin;               ///< Whether the marker is a min or max marker.
+            float position;           ///< Coordinate of the marker on its axis, cached from the collider's AABB.
+
+            /// @brief Checks if the marker must come before another one on its axis.
+            ///
+            /// On ties, min markers come first, so that touching AABBs are considered overlapping.
+            ///
+            /// @param other Other marker.
+            /// @return Whether this marker comes first.
+            bool before(const SweepMarker& other) const
+            {
+                return position < other.position || (position == other.position && isMin && !other.isMin);
+            }
         };
 
-        /// @brief List of ordered sweep markers for each axis. Stores the index of the marker in mMarkers.
+        /// @brief Set of collision candidates.
+        using CandidateSet = std::pmr::unordered_set<Candidate, CandidateHash>;
+
+        /// @brief List of collision candidates, each appearing only once.
+        using CandidateList = std::vector<Candidate>;
+
+        /// @brief Maps entities tracked by the AABB tree to their proxies in it.
+        using ProxyMap = std::unordered_map<core::ecs::Entity, int, core::ecs::EntityHash>;
+
+        /// @brief Algorithm in use. Set by the plugin from the `collisions.broadPhase` setting, which
+        /// can be `sweepAndPrune`, `aabbTree` or `spatialHash`, and must not change after entities
+        /// are added.
+        Method method = Method::SweepAndPrune;
+
+        /// @brief Number of frames a collider's transform must stay the same for it to fall asleep.
+        /// Set by the plugin from the `collisions.sleepFrames` setting.
+        int sleepFrames = 30;
+
+        /// @brief Pool from which the containers below allocate their nodes. Must be declared
+        /// before them, as it must outlive them.
+        core::memory::PoolAllocator pool{64};
+
+        /// @brief Entities whose colliders are awake, which are the only ones checked for movement
+        /// every frame. Sleeping and static colliders stay in the broad phase structures untouched.
+        std::vector<core::ecs::Entity> awakeEntities;
+
+        /// @brief Entities whose world AABBs changed this frame. Only their markers, proxies or
+        /// cells are updated.
+        std::vector<core::ecs::Entity> movedEntities;
+
+        /// @brief Entities to wake up on the next AABB update, see @ref wake().
+        std::vector<core::ecs::Entity> wakeRequests;
+
+        /// @brief Whether the collider of each tracked entity is static, indexed by entity index.
+        std::vector<bool> staticEntities;
+
+        /// @brief Whether a collider fell asleep, woke up or was removed this frame.
+        bool restingChanged = false;
+
+        /// @brief List of sweep markers for each axis, kept sorted by their position.
         std::vector<SweepMarker> markersPerAxis[3];
 
-        /// @brief Maps of overlapping entities for each axis calculated by sweep and prune.
+        /// @brief Index of each marker in @ref markersPerAxis, indexed by @ref markerSlot(), so that
+        /// the markers of the entities which moved can be found without searching.
+        std::vector<std::size_t> markerIndicesPerAxis[3];
+
+        /// @brief AABB of each entity tracked by sweep and prune, indexed by entity index.
+        /// Refreshed for the entities which moved, before their markers.
+        std::vector<core::geom::AABB> bounds;
+
+        /// @brief Number of entities added since the last sweep.
+        std::size_t pendingEntities = 0;
+
+        /// @brief Pairs of entities whose AABBs overlap, found by sweep and prune.
+        ///
+        /// Updated incrementally while the markers are sorted: a swap of a min and a max marker of
+        /// two entities is exactly when they start or stop overlapping on that axis. Only pairs
+        /// overlapping on all three axes are stored, in the order returned by @ref makeCandidate().
+        CandidateSet sweepPairs;
+
+        /// @brief Changes to @ref sweepPairs found while sorting each axis. Kept here to reuse
+        /// their memory.
+        CandidateList addedPerAxis[3];
+
+        /// @copydoc addedPerAxis
+        CandidateList removedPerAxis[3];
+
+        /// @brief Tree with the fat AABBs of all tracked entities, used by the AABB tree method.
         ///
-        /// For each each map, the key is an entity and the value is a list of entities that
-        /// overlap with the key. Symmetrical pairs are not stored.
-        std::unordered_map<core::ecs::Entity, std::vector<core::ecs::Entity>, core::ecs::EntityHash>
-            sweepOverlapMaps[3];
+        /// Can also be used to query which colliders may be in a region or hit by a ray.
+        DynamicAABBTree tree;
+
+        /// @brief Proxy of each entity tracked by the AABB tree method, or @ref DynamicAABBTree::Null
+        /// if it wasn't inserted yet.
+        ProxyMap proxies;
+
+        /// @brief Pairs of entities whose fat AABBs overlap, used by the AABB tree method.
+        ///
+        /// As fat AABBs only change when a proxy is reinserted, only reinserted proxies have to be
+        /// queried for new pairs each frame.
+        CandidateSet treePairs;
+
+        /// @brief Proxies reinserted in the tree this frame. Kept here to reuse its memory.
+        std::vector<int> movedProxies;
+
+        /// @brief Grid with the awake colliders, rebuilt every frame by the spatial hash method. Its
+        /// cell size is set by the plugin from the `collisions.spatialHash.cellSize` setting.
+        SpatialHashBroadPhase spatialHash;
+
+        /// @brief Grid with the sleeping colliders, only rebuilt when @ref restingChanged is set.
+        /// Queried by the awake colliders every frame. Uses the same cell size as @ref spatialHash.
+        SpatialHashBroadPhase restingHash;
+
+        /// @brief Entities tracked by the spatial hash method.
+        std::vector<core::ecs::Entity> hashedEntities;
+
+        /// @brief Pairs of entities whose AABBs overlap, found by the spatial hash method this frame.
+        std::vector<SpatialHashBroadPhase::Pair> hashPairs;
 
-        /// @brief Set of active entities during sweep for each axis.
-        std::unordered_set<core::ecs::Entity, core::ecs::EntityHash> activePerAxis[3];
+        /// @brief Pairs of sleeping colliders found in @ref restingHash when it was last rebuilt.
+        std::vector<SpatialHashBroadPhase::Pair> restingHashPairs;
 
-        /// @brief Sets of collision candidates for each collision type. The index of the array is
+        /// @brief Entities found by a query to @ref restingHash. Kept here to reuse its memory.
+        std::vector<core::ecs::Entity> restingQuery;
+
+        /// @brief Pairs found by the broad phase in use this frame, which are validated in batches
+        /// to produce the candidates. Kept here to reuse its memory.
+        CandidateList pairs;
+
+        /// @brief Lists of collision candidates for each collision type. The index of the array is
         /// the collision type.
-        std::unordered_set<Candidate, CandidateHash> candidatesPerType[static_cast<std::size_t>(CollisionType::Count)];
+        CandidateList candidatesPerType[static_cast<std::size_t>(CollisionType::Count)];
+
+        /// @brief Pairs of sleeping colliders whose AABBs overlap. They aren't candidates, as
+        /// neither collider moved since they were last tested.
+        CandidateList restingPairs;
+
+        /// @brief Candidates found by a single batch, merged into @ref candidatesPerType after all
+        /// batches finish, so that batches never write to shared containers.
+        struct Batch
+        {
+            CandidateList candidatesPerType[static_cast<std::size_t>(CollisionType::Count)];
+            CandidateList restingPairs;
+        };
+
+        /// @brief Buffers of each batch. Kept here to reuse their memory.
+        std::vector<Batch> batches;
+
+        /// @brief Pool on which the axes and batches of candidates are processed, or null if the
+        /// broad phase runs on a single thread.
+        std::unique_ptr<core::ThreadPool> threadPool;
+
+        /// @brief Number of threads in @ref threadPool, or 1 if there's none.
+        std::size_t threadCount = 1;
 
-        /// @brief Adds an entity to the list of entities tracked by sweep and prune.
+        /// @brief Makes a candidate out of two entities, ordered so that the same pair always
+        /// results in the same candidate.
+        /// @param a Entity.
+        /// @param b Entity.
+        /// @return Candidate.
+        static Candidate makeCandidate(core::ecs::Entity a, core::ecs::Entity b);
+
+        /// @brief Gets the index of the entry of a marker in @ref markerIndicesPerAxis.
+        /// @param entity Entity of the marker.
+        /// @param isMin Whether it's a min marker.
+        /// @return Index.
+        static std::size_t markerSlot(core::ecs::Entity entity, bool isMin)
+        {
+            return static_cast<std::size_t>(entity.index) * 2 + (isMin ? 0 : 1);
+        }
+
+        /// @brief Adds an entity to the list of entities tracked by the broad phase.
+        ///
+        /// With sweep and prune, its markers are placed at the end of each axis, and are moved into
+        /// place, finding the entity's overlaps, on the next sweep. With the AABB tree, it is
+        /// inserted on the next tree update. With the spatial hash, it is put in the grid of awake
+        /// colliders on the next update. Either way, it starts awake.
+        ///
         /// @param entity Entity to add.
-        void addEntity(core::ecs::Entity entity);
+        /// @param isStatic Whether the entity's collider is static, in which case it is never paired
+        /// with other static colliders.
+        void addEntity(core::ecs::Entity entity, bool isStatic = false);
+
+        /// @brief Wakes up the collider of an entity on the next AABB update.
+        ///
+        /// Sleeping colliders aren't checked for movement, so this must be called after moving
+        /// the transform of a collider which may be asleep, or changing its shape.
+        ///
+        /// @param entity Entity.
+        void wake(core::ecs::Entity entity);
+
+        /// @brief Checks whether both entities have static colliders, and thus are never a pair.
+        /// @param a Entity.
+        /// @param b Entity.
+        /// @return Whether both are static.
+        bool bothStatic(core::ecs::Entity a, core::ecs::Entity b) const;
 
-        /// @brief Removes an entity from the list of entities tracked by sweep and prune.
+        /// @brief Removes an entity from the list of entities tracked by the broad phase.
         /// @param entity Entity to remove.
         void removeEntity(core::ecs::Entity entity);
 
-        /// @brief Clears the list of entities tracked by sweep and prune.
+        /// @brief Clears the list of entities tracked by the broad phase.
         void clearEntities();
 
+        /// @brief Sets the number of threads used by the broad phase.
+        /// @param count Number of threads. With 1 or less, everything runs on the calling thread.
+        void useThreads(std::size_t count);
+
+        /// @brief Calls a function over a range split into one batch per thread, on the thread
+        /// pool, blocking until all batches finish.
+        ///
+        /// Waits only for its own batches, not for every task on the pool.
+        /// @tparam F Function type, taking the batch index and the beginning and end of its range.
+        /// @param count Size of the range.
+        /// @param function Function.
+        /// @return Number of batches.
+        template <typename F>
+        std::size_t parallelFor(std::size_t count, F function)
+        {
+            if (threadPool == nullptr || count <= 1)
+            {
+                function(std::size_t{0}, std::size_t{0}, count);
+                return 1;
+            }
+
+            auto batchCount = std::min(threadCount, count);
+            std::latch done{static_cast<std::ptrdiff_t>(batchCount)};
+            for (std::size_t batch = 0; batch < batchCount; ++batch)
+            {
+                threadPool->addTask([&function, &done, batch, batchCount, count]() {
+                    function(batch, count * batch / batchCount, count * (batch + 1) / batchCount);
+                    done.count_down();
+                });
+            }
+
+            done.wait();
+            return batchCount;
+        }
+
+        /// @brief Sorts the markers of an axis by their position, recording how @ref sweepPairs must
+        /// change.
+        ///
+        /// Only the markers of @ref movedEntities can be out of place, so only they are moved, one
+        /// swap with a neighbour at a time, which takes close to linear time in the number of
+        /// moved entities, as they usually move little between frames. Expects @ref bounds to be up
+        /// to date. Doesn't modify anything shared between axes, so the three axes can be sorted
+        /// concurrently.
+        ///
+        /// A pair is only ever added when its AABBs overlap and only ever removed when they don't,
+        /// so the changes found on different axes never conflict and can be applied in any order.
+        ///
+        /// @param axis Axis.
+        /// @param added Pairs which started overlapping.
+        /// @param removed Pairs which stopped overlapping.
+        void sortMarkers(int axis, CandidateList& added, CandidateList& removed);
+
+        /// @brief Sorts the markers of every axis from scratch and finds all pairs with a single
+        /// sweep.
+        ///
+        /// Used instead of @ref sortMarkers() when many entities were added at once, as moving
+        /// their markers into place one swap at a time would take quadratic time.
+        void rebuildMarkers();
+
+        /// @brief Refreshes the entries of @ref markerIndicesPerAxis of the markers of an axis, from
+        /// the given index to the end.
+        /// @param axis Axis.
+        /// @param first Index of the first marker whose entry is refreshed.
+        void indexMarkers(int axis, std::size_t first = 0);
+
+        /// @brief Drops pairs whose fat AABBs stopped overlapping and queries the tree for new pairs
+        /// of every proxy in @ref movedProxies, except pairs of static colliders.
+        void findTreePairs();
+
         /// @brief Adds a collision candidate to the list of candidates for a specific collision type.
         /// @param type Collision type.
-        /// @param candidate Collision candidate.
+        /// @param candidate Collision candidate, which must not be in the list yet.
         void addCandidate(CollisionType type, Candidate candidate);
 
         /// @brief Gets the collision candidates for a specific collision type.
         /// @param type Collision type.
         /// @return Collision candidates.
-        const std::unordered_set<Candidate, CandidateHash>& candidates(CollisionType type) const;
+        const CandidateList& candidates(CollisionType type) const;
 
-        /// @brief Clears the list of collision candidates.
+        /// @brief Clears the list of collision candidates and @ref restingPairs.
         void clearCandidates();
     };
 } // namespace cubos::engine
@@ -25,6 +25,26 @@ namespace cubos::engine
         /// The plugin will set it based on the shape associated with the collider.
         float margin;
 
+        /// @brief Whether the collider never moves, such as for terrain.
+        ///
+        /// Its world AABB is computed only once, so changes to its transform are ignored, and it is
+        /// never tested against other static colliders.
+        bool isStatic = false;
+
+        /// @brief Whether the collider is asleep, which happens when it is static or its transform
+        /// hasn't changed for a while. Set by the plugin.
+        ///
+        /// Sleeping colliders aren't checked for movement: they must be woken up with
+        /// @ref BroadPhaseCollisions::wake() after being moved. Their world AABBs aren't updated, and
+        /// pairs of sleeping colliders keep their state from the last time they were tested.
+        [[cubos::ignore]] bool sleeping = false;
+
+        [[cubos::ignore]] int idleFrames = 0; ///< Number of frames since the collider last moved.
+
+        /// @brief Transform from the collider's space to world space with which @ref worldAABB was
+        /// last computed.
+        [[cubos::ignore]] glm::mat4 worldTransform{0.0F};
+
         bool fresh = true; ///< Whether the collider is fresh. This is an hack and should be done in ECS.
     };
 } // namespace cubos::engine
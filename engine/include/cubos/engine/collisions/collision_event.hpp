@@ -0,0 +1,59 @@
+/// @file
+/// @brief Events @ref cubos::engine::CollisionEvent, @ref cubos::engine::CollisionStartedEvent and
+/// @ref cubos::engine::CollisionEndedEvent.
+/// @ingroup collisions-plugin
+
+#pragma once
+
+#include <cstddef>
+
+#include <glm/vec3.hpp>
+
+#include <cubos/core/ecs/entity/entity.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Event sent by the narrow phase for each pair of colliders which are touching, every
+    /// frame they are touching, except while both are asleep.
+    ///
+    /// Holds the contact manifold of the pair: the direction in which they must be pushed apart,
+    /// by how much, and up to @ref MaxPoints points where they touch. For pairs of a box and a
+    /// capsule or a voxel grid, @ref entity is always the box.
+    ///
+    /// @ingroup collisions-plugin
+    struct CollisionEvent
+    {
+        /// @brief Maximum number of contact points in a manifold.
+        static constexpr std::size_t MaxPoints = 4;
+
+        core::ecs::Entity entity;    ///< First entity of the pair.
+        core::ecs::Entity other;     ///< Second entity of the pair.
+        glm::vec3 normal;            ///< Contact normal, in world space, pointing from @ref entity to @ref other.
+        float depth;                 ///< Distance along @ref normal which @ref other must move to stop penetrating.
+        std::size_t pointCount;      ///< Number of contact points.
+        glm::vec3 points[MaxPoints]; ///< Contact points, in world space.
+    };
+
+    /// @brief Event sent by the narrow phase on the first frame two colliders touch.
+    ///
+    /// The entities of the pair are in no particular order.
+    ///
+    /// @ingroup collisions-plugin
+    struct CollisionStartedEvent
+    {
+        core::ecs::Entity entity; ///< First entity of the pair.
+        core::ecs::Entity other;  ///< Second entity of the pair.
+    };
+
+    /// @brief Event sent by the narrow phase on the first frame two colliders which were touching
+    /// stop touching, which includes when either of them stops being a collider.
+    ///
+    /// The entities of the pair are in no particular order.
+    ///
+    /// @ingroup collisions-plugin
+    struct CollisionEndedEvent
+    {
+        core::ecs::Entity entity; ///< First entity of the pair.
+        core::ecs::Entity other;  ///< Second entity of the pair.
+    };
+} // namespace cubos::engine
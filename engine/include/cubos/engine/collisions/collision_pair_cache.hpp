@@ -0,0 +1,112 @@
+/// @file
+/// @brief Resource @ref cubos::engine::CollisionPairCache.
+/// @ingroup collisions-plugin
+
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+
+#include <cubos/core/ecs/entity/entity.hpp>
+
+#include <cubos/engine/collisions/broad_phase_collisions.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Resource which keeps data about each pair of colliders found by the broad phase
+    /// across frames.
+    ///
+    /// A pair enters the cache on the first frame the broad phase reports it, and leaves it on the
+    /// first frame it doesn't. Meanwhile, the narrow phase uses it to remember whether the pair
+    /// was touching, which is how it knows when to send @ref CollisionStartedEvent's and
+    /// @ref CollisionEndedEvent's, and to warm start its tests.
+    ///
+    /// Pairs are keyed by both entities, in any order.
+    ///
+    /// @ingroup collisions-plugin
+    class CollisionPairCache final
+    {
+    public:
+        /// @brief Data kept for each pair.
+        struct Entry
+        {
+            bool touching = false;    ///< Whether the pair is touching on the current frame.
+            bool wasTouching = false; ///< Whether the pair was touching on the previous frame.
+
+            /// @brief For pairs of boxes, the axis which separated them, or along which they
+            /// penetrated the least, the last time they were tested, or -1 if they never were.
+            ///
+            /// An axis which separates two boxes usually keeps doing so on the next frames, so it
+            /// is checked before running the full test.
+            int axis = -1;
+
+            std::size_t frame = 0; ///< Last frame on which the pair was reported.
+        };
+
+        /// @brief Starts a new frame.
+        void beginFrame();
+
+        /// @brief Reports that a pair was found on the current frame, adding it if it's new.
+        ///
+        /// On the first call for a pair on each frame, @ref Entry::touching is moved to
+        /// @ref Entry::wasTouching and cleared.
+        ///
+        /// @param entity First entity of the pair.
+        /// @param other Second entity of the pair.
+        /// @return Data of the pair.
+        Entry& update(core::ecs::Entity entity, core::ecs::Entity other);
+
+        /// @brief Gets the data of a pair, if it's in the cache.
+        /// @param entity First entity of the pair.
+        /// @param other Second entity of the pair.
+        /// @return Data of the pair, or null if it isn't in the cache.
+        const Entry* find(core::ecs::Entity entity, core::ecs::Entity other) const;
+
+        /// @brief Gets the number of pairs in the cache.
+        /// @return Number of pairs.
+        std::size_t size() const;
+
+        /// @brief Ends the current frame, removing the pairs which weren't reported on it and
+        /// calling a function for each pair which started or stopped touching.
+        /// @tparam S Function type, taking the two entities of a pair.
+        /// @tparam E Function type, taking the two entities of a pair.
+        /// @param started Called for each pair which started touching on this frame.
+        /// @param ended Called for each pair which stopped touching on this frame, including
+        /// removed pairs which were touching before.
+        template <typename S, typename E>
+        void endFrame(S started, E ended)
+        {
+            for (auto it = mEntries.begin(); it != mEntries.end();)
+            {
+                const auto& [pair, entry] = *it;
+                if (entry.frame != mFrame)
+                {
+                    if (entry.touching)
+                    {
+                        ended(pair.first, pair.second);
+                    }
+
+                    it = mEntries.erase(it);
+                    continue;
+                }
+
+                if (entry.touching && !entry.wasTouching)
+                {
+                    started(pair.first, pair.second);
+                }
+                else if (!entry.touching && entry.wasTouching)
+                {
+                    ended(pair.first, pair.second);
+                }
+
+                ++it;
+            }
+        }
+
+    private:
+        /// @brief Data of each pair, keyed by the pair ordered by @ref BroadPhaseCollisions::makeCandidate().
+        std::unordered_map<BroadPhaseCollisions::Candidate, Entry, BroadPhaseCollisions::CandidateHash> mEntries;
+
+        std::size_t mFrame = 0; ///< Current frame.
+    };
+} // namespace cubos::engine
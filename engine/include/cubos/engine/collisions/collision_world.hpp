@@ -0,0 +1,185 @@
+/// @file
+/// @brief Resource @ref cubos::engine::CollisionWorld.
+/// @ingroup collisions-plugin
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cubos/core/ecs/entity/entity.hpp>
+#include <cubos/core/ecs/entity/hash.hpp>
+#include <cubos/core/geom/aabb.hpp>
+#include <cubos/core/geom/box.hpp>
+#include <cubos/core/geom/capsule.hpp>
+#include <cubos/core/thread_pool.hpp>
+
+#include <cubos/engine/collisions/dynamic_aabb_tree.hpp>
+#include <cubos/engine/collisions/voxel_occupancy.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Resource which answers spatial queries, such as ray casts, against the colliders.
+    ///
+    /// Keeps the world AABBs of all colliders in a @ref DynamicAABBTree, refreshed every frame by
+    /// the plugin, so that queries only test the shapes of the colliders near them.
+    ///
+    /// Queries don't modify the resource, and can thus run concurrently.
+    ///
+    /// @ingroup collisions-plugin
+    class CollisionWorld final
+    {
+    public:
+        /// @brief Ray, for batched ray casts.
+        struct Ray
+        {
+            glm::vec3 origin;    ///< Origin of the ray.
+            glm::vec3 direction; ///< Direction of the ray. Doesn't have to be normalized.
+
+            /// @brief Maximum distance, in world units, at which hits count.
+            float maxDistance = std::numeric_limits<float>::infinity();
+        };
+
+        /// @brief Closest point where a ray hits a collider.
+        struct RayHit
+        {
+            core::ecs::Entity entity; ///< Entity of the collider.
+            float distance;           ///< Distance from the origin of the ray, in world units.
+            glm::vec3 point;          ///< Point on the surface of the collider.
+            glm::vec3 normal;         ///< Normal of the surface of the collider at @ref point.
+        };
+
+        /// @brief Collider closest to a point.
+        struct NearestHit
+        {
+            core::ecs::Entity entity; ///< Entity of the collider.
+            float distance;           ///< Distance from the point, which is zero if it's inside the collider.
+            glm::vec3 point;          ///< Point of the collider closest to the point.
+        };
+
+        /// @brief Starts a new update of the colliders.
+        void beginFrame();
+
+        /// @brief Adds or updates a collider with a box shape.
+        /// @param entity Entity of the collider.
+        /// @param transform Transform from the collider's space to world space.
+        /// @param aabb World space AABB of the collider.
+        /// @param box Box shape.
+        void update(core::ecs::Entity entity, const glm::mat4& transform, const core::geom::AABB& aabb,
+                    const core::geom::Box& box);
+
+        /// @brief Adds or updates a collider with a capsule shape.
+        /// @param entity Entity of the collider.
+        /// @param transform Transform from the collider's space to world space.
+        /// @param aabb World space AABB of the collider.
+        /// @param capsule Capsule shape.
+        void update(core::ecs::Entity entity, const glm::mat4& transform, const core::geom::AABB& aabb,
+                    const core::geom::Capsule& capsule);
+
+        /// @brief Adds or updates a collider with a voxel grid shape.
+        /// @param entity Entity of the collider.
+        /// @param transform Transform from the grid's space, in voxels, to world space.
+        /// @param aabb World space AABB of the collider.
+        /// @param occupancy Occupancy of the grid.
+        void update(core::ecs::Entity entity, const glm::mat4& transform, const core::geom::AABB& aabb,
+                    std::shared_ptr<const VoxelOccupancy> occupancy);
+
+        /// @brief Keeps a collider which didn't move as is, if it was already added.
+        /// @param entity Entity of the collider.
+        /// @return Whether the collider was already added.
+        bool keep(core::ecs::Entity entity);
+
+        /// @brief Ends an update of the colliders, removing those which weren't updated or kept since
+        /// @ref beginFrame() was called.
+        void endFrame();
+
+        /// @brief Gets the number of colliders.
+        /// @return Number of colliders.
+        std::size_t size() const;
+
+        /// @brief Sets the thread pool used by batched queries.
+        /// @param pool Thread pool, or null to run them on the calling thread.
+        /// @param threadCount Number of threads in the pool.
+        void useThreadPool(core::ThreadPool* pool, std::size_t threadCount);
+
+        /// @brief Finds the first collider hit by a ray.
+        /// @param origin Origin of the ray.
+        /// @param direction Direction of the ray. Doesn't have to be normalized.
+        /// @param maxDistance Maximum distance, in world units, at which hits count.
+        /// @return Closest hit, if any. A ray starting inside a collider hits it at its origin.
+        std::optional<RayHit> raycast(glm::vec3 origin, glm::vec3 direction,
+                                      float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+        /// @brief Finds the first collider hit by each of many rays, such as for line of sight
+        /// checks, split across the thread pool.
+        /// @param rays Rays.
+        /// @param[out] hits Closest hit of each ray, if any.
+        void raycast(const std::vector<Ray>& rays, std::vector<std::optional<RayHit>>& hits) const;
+
+        /// @brief Finds the colliders which overlap a box.
+        /// @param transform Transform from the box's space to world space.
+        /// @param box Box shape.
+        /// @param[out] entities Vector to which the entities of the colliders are appended.
+        void overlapBox(const glm::mat4& transform, const core::geom::Box& box,
+                        std::vector<core::ecs::Entity>& entities) const;
+
+        /// @brief Finds the colliders which overlap a sphere.
+        /// @param center Center of the sphere.
+        /// @param radius Radius of the sphere.
+        /// @param[out] entities Vector to which the entities of the colliders are appended.
+        void overlapSphere(glm::vec3 center, float radius, std::vector<core::ecs::Entity>& entities) const;
+
+        /// @brief Finds the collider closest to a point.
+        /// @param point Point.
+        /// @param maxDistance Maximum distance at which colliders count.
+        /// @return Closest collider, if any.
+        std::optional<NearestHit> nearest(glm::vec3 point,
+                                          float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    private:
+        /// @brief Type of the shape of a collider.
+        enum class Shape
+        {
+            Box,
+            Capsule,
+            Voxels,
+        };
+
+        /// @brief Collider known to the world.
+        struct Body
+        {
+            int proxy;           ///< Proxy of the collider in the tree.
+            glm::mat4 transform; ///< Transform from the collider's space, or its grid's, to world space.
+            Shape shape;         ///< Type of the shape of the collider.
+
+            core::geom::Box box;                             ///< Box shape, if @ref shape is a box.
+            core::geom::Capsule capsule;                     ///< Capsule shape, if @ref shape is a capsule.
+            std::shared_ptr<const VoxelOccupancy> occupancy; ///< Occupancy, if @ref shape is a voxel grid.
+
+            std::size_t frame; ///< Last frame on which the collider was updated or kept.
+        };
+
+        /// @brief Adds or updates a body, except for its shape.
+        /// @param entity Entity of the collider.
+        /// @param transform Transform from the collider's space to world space.
+        /// @param aabb World space AABB of the collider.
+        /// @return Body.
+        Body& body(core::ecs::Entity entity, const glm::mat4& transform, const core::geom::AABB& aabb);
+
+        DynamicAABBTree mTree; ///< Tree with the world AABBs of all colliders.
+
+        /// @brief Bodies of the colliders, by entity.
+        std::unordered_map<core::ecs::Entity, Body, core::ecs::EntityHash> mBodies;
+
+        std::size_t mFrame = 0;                  ///< Current frame.
+        core::ThreadPool* mThreadPool = nullptr; ///< Pool used by batched queries.
+        std::size_t mThreadCount = 1;            ///< Number of threads in @ref mThreadPool.
+    };
+} // namespace cubos::engine
@@ -0,0 +1,246 @@
+/// @file
+/// @brief Class @ref cubos::engine::DynamicAABBTree.
+/// @ingroup collisions-plugin
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include <cubos/core/ecs/entity/entity.hpp>
+#include <cubos/core/geom/aabb.hpp>
+#include <cubos/core/log.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Bounding volume hierarchy of AABBs which can be updated incrementally.
+    ///
+    /// Each leaf, called a proxy, stores a fat AABB: the AABB it was inserted with, enlarged by
+    /// @ref Margin. Moving a proxy whose new AABB is still inside its fat AABB does nothing, which
+    /// means slow moving objects rarely touch the tree. When a proxy does leave its fat AABB, it
+    /// is removed and reinserted, and the tree is rebalanced with rotations on the way up, which
+    /// keeps its height logarithmic on the number of proxies.
+    ///
+    /// Inner nodes are chosen with the surface area heuristic, so that queries visit few nodes.
+    ///
+    /// @ingroup collisions-plugin
+    class DynamicAABBTree final
+    {
+    public:
+        /// @brief Identifier of no node.
+        static constexpr int Null = -1;
+
+        /// @brief Distance by which the AABBs of proxies are enlarged.
+        static constexpr float Margin = 0.1F;
+
+        /// @brief Inserts a new proxy.
+        /// @param aabb AABB of the proxy.
+        /// @param entity Entity associated with the proxy.
+        /// @return Proxy identifier.
+        int insert(const core::geom::AABB& aabb, core::ecs::Entity entity);
+
+        /// @brief Removes a proxy.
+        /// @param proxy Proxy identifier.
+        void remove(int proxy);
+
+        /// @brief Updates the AABB of a proxy.
+        /// @param proxy Proxy identifier.
+        /// @param aabb New AABB of the proxy.
+        /// @return Whether the proxy left its fat AABB and was thus reinserted.
+        bool move(int proxy, const core::geom::AABB& aabb);
+
+        /// @brief Removes all proxies.
+        void clear();
+
+        /// @brief Gets the fat AABB of a proxy.
+        /// @param proxy Proxy identifier.
+        /// @return Fat AABB.
+        const core::geom::AABB& fatAABB(int proxy) const;
+
+        /// @brief Gets the entity associated with a proxy.
+        /// @param proxy Proxy identifier.
+        /// @return Entity.
+        core::ecs::Entity entity(int proxy) const;
+
+        /// @brief Gets the number of proxies in the tree.
+        /// @return Number of proxies.
+        std::size_t size() const;
+
+        /// @brief Gets the height of the tree, where a tree with a single proxy has height zero.
+        /// @return Height of the tree.
+        int height() const;
+
+        /// @brief Calls a function for every proxy whose fat AABB overlaps the given region.
+        /// @tparam F Function type, taking the proxy identifier and returning whether to continue.
+        /// @param aabb Region.
+        /// @param callback Function.
+        template <typename F>
+        void query(const core::geom::AABB& aabb, F callback) const
+        {
+            this->traverse([&](const Node& node) { return node.aabb.overlaps(aabb); }, callback);
+        }
+
+        /// @brief Calls a function for every proxy whose fat AABB is hit by the given ray.
+        /// @tparam F Function type, taking the proxy identifier and returning whether to continue.
+        /// @param origin Origin of the ray.
+        /// @param direction Direction of the ray. Doesn't have to be normalized.
+        /// @param maxDistance Maximum distance, in multiples of @p direction, at which hits count.
+        /// @param callback Function.
+        template <typename F>
+        void raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, F callback) const
+        {
+            this->traverse([&](const Node& node) { return hits(node.aabb, origin, direction, maxDistance); },
+                           callback);
+        }
+
+        /// @brief Calls a function for every proxy whose fat AABB is hit by the given ray, before a
+        /// maximum distance which the function may shorten, such as to find the closest hit.
+        /// @tparam F Function type, taking the proxy identifier and returning the new maximum distance.
+        /// @param origin Origin of the ray.
+        /// @param direction Direction of the ray. Doesn't have to be normalized.
+        /// @param maxDistance Initial maximum distance, in multiples of @p direction.
+        /// @param callback Function.
+        template <typename F>
+        void raycastClosest(glm::vec3 origin, glm::vec3 direction, float maxDistance, F callback) const
+        {
+            this->traverse([&](const Node& node) { return hits(node.aabb, origin, direction, maxDistance); },
+                           [&](int proxy) {
+                               maxDistance = std::min(maxDistance, callback(proxy));
+                               return true;
+                           });
+        }
+
+        /// @brief Calls a function for every proxy whose fat AABB is within a maximum distance of a
+        /// point, which the function may shorten, such as to find the closest proxy.
+        /// @tparam F Function type, taking the proxy identifier and returning the new maximum distance.
+        /// @param point Point.
+        /// @param maxDistance Initial maximum distance.
+        /// @param callback Function.
+        template <typename F>
+        void nearest(glm::vec3 point, float maxDistance, F callback) const
+        {
+            this->traverse([&](const Node& node) { return distance(node.aabb, point) <= maxDistance; },
+                           [&](int proxy) {
+                               maxDistance = std::min(maxDistance, callback(proxy));
+                               return true;
+                           });
+        }
+
+    private:
+        /// @brief Maximum depth of the traversal stack. A balanced tree never gets close to it.
+        static constexpr std::size_t MaxStack = 128;
+
+        /// @brief Node of the tree, which is either a proxy or the parent of two other nodes.
+        struct Node
+        {
+            core::geom::AABB aabb;    ///< Fat AABB of the proxy, or union of the children's AABBs.
+            core::ecs::Entity entity; ///< Entity associated with the proxy. Unused in inner nodes.
+            int parent = Null;        ///< Parent node, or next free node if this node is free.
+            int left = Null;          ///< Left child, or @ref Null for proxies.
+            int right = Null;         ///< Right child, or @ref Null for proxies.
+            int height = 0;           ///< Height of the node, zero for proxies and -1 for free nodes.
+
+            /// @brief Checks if the node is a proxy.
+            /// @return Whether the node is a proxy.
+            bool isLeaf() const
+            {
+                return left == Null;
+            }
+        };
+
+        /// @brief Checks if a ray hits an AABB with the slab test.
+        /// @param aabb AABB.
+        /// @param origin Origin of the ray.
+        /// @param direction Direction of the ray. Components may be zero.
+        /// @param maxDistance Maximum distance.
+        /// @return Whether the ray hits the AABB.
+        static bool hits(const core::geom::AABB& aabb, glm::vec3 origin, glm::vec3 direction, float maxDistance);
+
+        /// @brief Gets the distance from a point to an AABB, which is zero if the point is inside it.
+        /// @param aabb AABB.
+        /// @param point Point.
+        /// @return Distance.
+        static float distance(const core::geom::AABB& aabb, glm::vec3 point);
+
+        /// @brief Visits the tree depth-first, skipping subtrees whose root doesn't pass a test.
+        /// @param test Test applied to each node.
+        /// @param callback Called for every proxy which passes the test, returns whether to continue.
+        template <typename T, typename F>
+        void traverse(T test, F callback) const
+        {
+            if (mRoot == Null)
+            {
+                return;
+            }
+
+            std::array<int, MaxStack> stack;
+            std::size_t count = 0;
+            stack[count++] = mRoot;
+            while (count > 0)
+            {
+                int index = stack[--count];
+                const auto& node = mNodes[static_cast<std::size_t>(index)];
+                if (!test(node))
+                {
+                    continue;
+                }
+
+                if (node.isLeaf())
+                {
+                    if (!callback(index))
+                    {
+                        return;
+                    }
+                }
+                else
+                {
+                    CUBOS_ASSERT(count + 2 <= MaxStack, "Dynamic AABB tree is too unbalanced");
+                    stack[count++] = node.left;
+                    stack[count++] = node.right;
+                }
+            }
+        }
+
+        /// @brief Gets a free node, growing the node pool if needed.
+        /// @return Node identifier.
+        int allocate();
+
+        /// @brief Returns a node to the free list.
+        /// @param node Node identifier.
+        void release(int node);
+
+        /// @brief Inserts a leaf which is not in the tree yet.
+        /// @param leaf Leaf identifier.
+        void insertLeaf(int leaf);
+
+        /// @brief Detaches a leaf from the tree, without freeing it.
+        /// @param leaf Leaf identifier.
+        void removeLeaf(int leaf);
+
+        /// @brief Recomputes the AABBs and heights of the ancestors of a node, rebalancing them.
+        /// @param node Node identifier.
+        void refit(int node);
+
+        /// @brief Performs a rotation on a node if its children's heights differ by more than one.
+        /// @param node Node identifier.
+        /// @return Identifier of the node which took the place of @p node.
+        int balance(int node);
+
+        /// @brief Gets a node by identifier.
+        /// @param node Node identifier.
+        /// @return Node.
+        Node& at(int node)
+        {
+            return mNodes[static_cast<std::size_t>(node)];
+        }
+
+        std::vector<Node> mNodes; ///< All nodes, including free ones.
+        int mRoot = Null;         ///< Root node.
+        int mFree = Null;         ///< First node of the free list.
+        std::size_t mSize = 0;    ///< Number of proxies.
+    };
+} // namespace cubos::engine
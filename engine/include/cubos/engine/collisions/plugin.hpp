@@ -18,27 +18,50 @@ namespace cubos::engine
     /// @ingroup engine
     /// @brief Adds collision detection to @b CUBOS.
     ///
+    /// ## Settings
+    /// - `collisions.broadPhase` - broad phase algorithm, `sweepAndPrune`, `aabbTree` or `spatialHash` (default:
+    ///   `sweepAndPrune`).
+    /// - `collisions.spatialHash.cellSize` - cell size of the spatial hash broad phase (default: `4.0`).
+    /// - `collisions.sleepFrames` - number of frames a collider must stay still to fall asleep (default: `30`).
+    /// - `collisions.threads` - number of threads used by the broad phase (default: number of hardware threads).
+    ///
     /// ## Components
     /// - @ref BoxCollider - holds the box collider data.
     /// - @ref CapsuleCollider - holds the capsule collider data.
+    /// - @ref VoxelCollisionShape - adds a voxel grid shape, which only collides with boxes.
     ///
     /// ## Events
-    /// - @ref CollisionEvent - (TODO) emitted when a collision occurs.
+    /// - @ref CollisionEvent - sent every frame for each pair of colliders which are touching, unless
+    ///   both are asleep.
+    /// - @ref CollisionStartedEvent - sent on the first frame two colliders touch.
+    /// - @ref CollisionEndedEvent - sent on the first frame two colliders stop touching.
     /// - @ref TriggerEvent - (TODO) emitted when a trigger is entered or exited.
     ///
     /// ## Resources
     /// - @ref BroadPhaseCollisions - stores broad phase collision data.
+    /// - @ref CollisionPairCache - stores data about each pair of colliders across frames.
+    /// - @ref CollisionWorld - answers ray casts and other spatial queries against the colliders.
+    /// - @ref VoxelOccupancyCache - shares the occupancy of each voxel grid asset between shapes.
+    ///
+    /// ## Startup tags
+    /// - `cubos.collisions.init` - chooses the broad phase algorithm (after `cubos.settings`).
     ///
     /// ## Tags
     /// - `cubos.collisions.aabb.missing` - missing aabb colliders are added.
     /// - `cubos.collisions.aabb` - collider aabbs are updated.
     /// - `cubos.collisions.broad.markers` - sweep markers are updated.
     /// - `cubos.collisions.broad.sweep` - sweep is performed.
+    /// - `cubos.collisions.broad.tree` - AABB tree is refit, if it's the broad phase in use.
+    /// - `cubos.collisions.broad.hash` - spatial hash grid is rebuilt, if it's the broad phase in use.
     /// - `cubos.collisions.broad` - broad phase collision detection.
+    /// - `cubos.collisions.world` - colliders are updated in the @ref CollisionWorld.
+    /// - `cubos.collisions.narrow` - narrow phase collision detection, sending the collision events.
     /// - `cubos.collisions` - collisions are resolved.
     ///
     /// ## Dependencies
+    /// - @ref settings-plugin
     /// - @ref transform-plugin
+    /// - @ref assets-plugin
 
     /// @brief Plugin entry function.
     /// @param cubos @b CUBOS. main class.
@@ -10,8 +10,20 @@ namespace cubos::engine
 {
     /// @brief Component which adds a box collision shape to an entity, used with a @ref Collider component.
     /// @ingroup collisions-plugin
-    struct [[cubos::component("cubos/box_collision_shape", VecStorage)]] BoxCollisionShape
+    struct [[cubos::component("cubos/box_collision_shape", SharedStorage)]] BoxCollisionShape
     {
         cubos::core::geom::Box box; ///< Box shape.
     };
+
+    /// @brief Compares two box collision shapes for equality.
+    ///
+    /// Lets identical shapes, such as the ones of entities spawned from the same blueprint, be
+    /// stored only once.
+    ///
+    /// @return Whether both shapes are equal.
+    /// @ingroup collisions-plugin
+    inline bool operator==(const BoxCollisionShape& lhs, const BoxCollisionShape& rhs)
+    {
+        return lhs.box == rhs.box;
+    }
 } // namespace cubos::engine
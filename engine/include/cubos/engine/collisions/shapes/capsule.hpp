@@ -10,8 +10,20 @@ namespace cubos::engine
 {
     /// @brief Component which adds a capsule collision shape to an entity, used with a @ref Collider component.
     /// @ingroup collisions-plugin
-    struct [[cubos::component("cubos/capsule_collision_shape", VecStorage)]] CapsuleCollisionShape
+    struct [[cubos::component("cubos/capsule_collision_shape", SharedStorage)]] CapsuleCollisionShape
     {
         cubos::core::geom::Capsule capsule; ///< Capsule shape.
     };
+
+    /// @brief Compares two capsule collision shapes for equality.
+    ///
+    /// Lets identical shapes, such as the ones of entities spawned from the same blueprint, be
+    /// stored only once.
+    ///
+    /// @return Whether both shapes are equal.
+    /// @ingroup collisions-plugin
+    inline bool operator==(const CapsuleCollisionShape& lhs, const CapsuleCollisionShape& rhs)
+    {
+        return lhs.capsule == rhs.capsule;
+    }
 } // namespace cubos::engine
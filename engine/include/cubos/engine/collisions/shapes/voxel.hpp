@@ -0,0 +1,34 @@
+/// @file
+/// @brief Component @ref cubos::engine::VoxelCollisionShape.
+/// @ingroup collisions-plugin
+
+#pragma once
+
+#include <memory>
+
+#include <glm/vec3.hpp>
+
+#include <cubos/engine/assets/asset.hpp>
+#include <cubos/engine/collisions/voxel_occupancy.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Component which adds a voxel grid collision shape to an entity, used with a
+    /// @ref Collider component.
+    ///
+    /// Every solid voxel of the grid is a unit cube in the collider's space, starting at
+    /// @ref offset, as with @ref RenderableGrid. Only boxes are tested against voxel shapes by the
+    /// narrow phase, but all spatial queries of the @ref CollisionWorld support them.
+    ///
+    /// @ingroup collisions-plugin
+    struct [[cubos::component("cubos/voxel_collision_shape", VecStorage)]] VoxelCollisionShape
+    {
+        Asset<VoxelGrid> grid;                 ///< Handle to the grid asset whose voxels collide.
+        glm::vec3 offset = {0.0F, 0.0F, 0.0F}; ///< Translation applied to the voxel grid before any other.
+
+        /// @brief Occupancy of the grid, shared with every other shape using the same asset - set
+        /// automatically.
+        [[cubos::ignore]] std::shared_ptr<const VoxelOccupancy> occupancy = nullptr;
+    };
+} // namespace cubos::engine
@@ -0,0 +1,132 @@
+/// @file
+/// @brief Class @ref cubos::engine::SpatialHashBroadPhase.
+/// @ingroup collisions-plugin
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include <cubos/core/ecs/entity/entity.hpp>
+#include <cubos/core/geom/aabb.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Finds overlapping AABBs by bucketing them into a uniform grid of cubic cells.
+    ///
+    /// Meant for worlds with many similarly sized objects spread over a large area, where the
+    /// cost of finding pairs grows close to linearly with the number of objects. The grid is
+    /// rebuilt from scratch every frame, which makes moving objects free to update.
+    ///
+    /// Each AABB is inserted into every cell it touches. A pair found in more than one cell is
+    /// only reported by the cell containing the minimum corner of the intersection of the two
+    /// AABBs, which removes duplicates without keeping a set of reported pairs.
+    ///
+    /// AABBs touching more than @ref MaxCellsPerEntry cells, such as the floor of a level, or
+    /// reaching cells over @ref MaxCell cells away from the origin, are kept out of the grid and
+    /// tested against every other AABB instead.
+    ///
+    /// A grid which isn't rebuilt can also be queried for the AABBs overlapping another one, which
+    /// is how objects which stopped moving are kept in a grid of their own.
+    ///
+    /// @ingroup collisions-plugin
+    class SpatialHashBroadPhase final
+    {
+    public:
+        /// @brief Pair of entities whose AABBs overlap.
+        using Pair = std::pair<core::ecs::Entity, core::ecs::Entity>;
+
+        /// @brief Maximum number of cells an AABB may be inserted into.
+        static constexpr std::size_t MaxCellsPerEntry = 64;
+
+        /// @brief Cells in the grid have coordinates from -MaxCell up to, but excluding, MaxCell.
+        static constexpr int MaxCell = 1 << 20;
+
+        /// @brief Constructs.
+        /// @param cellSize Length of the edges of each cell.
+        explicit SpatialHashBroadPhase(float cellSize = 4.0F);
+
+        /// @brief Sets the length of the edges of each cell. Ideally, a bit larger than most
+        /// objects. Only takes effect on the next @ref clear().
+        /// @param cellSize Cell size.
+        void cellSize(float cellSize);
+
+        /// @brief Gets the length of the edges of each cell.
+        /// @return Cell size.
+        float cellSize() const;
+
+        /// @brief Removes every AABB from the grid, keeping the memory for the next frame.
+        void clear();
+
+        /// @brief Inserts an AABB into the grid.
+        /// @param entity Entity associated with the AABB.
+        /// @param aabb AABB.
+        void insert(core::ecs::Entity entity, const core::geom::AABB& aabb);
+
+        /// @brief Finds every pair of inserted AABBs which overlap.
+        ///
+        /// Each pair is reported once, in no particular order.
+        ///
+        /// @param pairs Vector to which the pairs are appended.
+        void findPairs(std::vector<Pair>& pairs);
+
+        /// @brief Finds every inserted AABB which overlaps another AABB.
+        ///
+        /// Each entity is reported once, in no particular order. Must only be called after
+        /// @ref findPairs(), which sorts the cells, and before any other insertion.
+        ///
+        /// @param aabb AABB, which doesn't have to be inserted.
+        /// @param entities Vector to which the entities of the overlapping AABBs are appended.
+        void query(const core::geom::AABB& aabb, std::vector<core::ecs::Entity>& entities) const;
+
+        /// @brief Gets the number of AABBs inserted since the last @ref clear().
+        /// @return Number of AABBs.
+        std::size_t size() const;
+
+    private:
+        /// @brief AABB inserted into the grid.
+        struct Entry
+        {
+            core::ecs::Entity entity; ///< Entity associated with the AABB.
+            core::geom::AABB aabb;    ///< AABB.
+            bool oversized;           ///< Whether the AABB was kept out of the grid.
+        };
+
+        /// @brief Reference from a cell to an entry which touches it.
+        struct CellEntry
+        {
+            std::uint64_t cell;  ///< Packed coordinates of the cell.
+            std::uint32_t entry; ///< Index of the entry.
+        };
+
+        /// @brief Gets the coordinates of the cell which contains a point.
+        /// @param point Point.
+        /// @return Cell coordinates.
+        glm::ivec3 cellOf(glm::vec3 point) const;
+
+        /// @brief Checks whether an AABB is small and close enough to the origin to be put in cells.
+        /// @param aabb AABB.
+        /// @return Whether the AABB fits in the grid.
+        bool fits(const core::geom::AABB& aabb) const;
+
+        /// @brief Packs the coordinates of a cell into a single integer.
+        ///
+        /// Each coordinate keeps 21 bits, which is why they must be within the bounds given by
+        /// @ref MaxCell, as cells outside of them would alias with others.
+        ///
+        /// @param cell Cell coordinates.
+        /// @return Packed coordinates.
+        static std::uint64_t pack(glm::ivec3 cell);
+
+        float mCellSize;                   ///< Length of the edges of each cell.
+        float mInverseCellSize;            ///< Inverse of the cell size in use.
+        std::vector<Entry> mEntries;       ///< Every inserted AABB.
+        std::vector<CellEntry> mCells;     ///< Cells touched by each AABB in the grid.
+        std::vector<std::uint32_t> mLarge; ///< Indices of the entries kept out of the grid.
+        bool mSorted{true};                ///< Whether the cells were sorted since the last insertion.
+    };
+} // namespace cubos::engine
@@ -0,0 +1,146 @@
+/// @file
+/// @brief Class @ref cubos::engine::VoxelOccupancy.
+/// @ingroup collisions-plugin
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+namespace cubos::engine
+{
+    class VoxelGrid;
+
+    /// @brief Bit-packed volume which stores whether each voxel of a @ref VoxelGrid is solid.
+    ///
+    /// Uses one bit per voxel, in rows of 64-bit words along the X axis, so that a whole run of up
+    /// to 64 voxels can be tested with a single AND. A range of voxels is tested by masking only
+    /// the words it overlaps, which for a small box against a large grid is a handful of words.
+    ///
+    /// Voxel `(x, y, z)` occupies the unit cube from `(x, y, z)` to `(x + 1, y + 1, z + 1)` in grid
+    /// space, which is the space used by every method.
+    ///
+    /// @ingroup collisions-plugin
+    class VoxelOccupancy final
+    {
+    public:
+        /// @brief Constructs an empty volume with no voxels.
+        VoxelOccupancy() = default;
+
+        /// @brief Constructs a volume from a grid, where every voxel with a material other than
+        /// the empty material 0 is solid.
+        /// @param grid Grid.
+        explicit VoxelOccupancy(const VoxelGrid& grid);
+
+        /// @brief Gets the size of the volume, in voxels.
+        /// @return Size.
+        const glm::uvec3& size() const;
+
+        /// @brief Checks whether a voxel is solid.
+        /// @param position Voxel coordinates. Voxels outside the volume are empty.
+        /// @return Whether the voxel is solid.
+        bool get(const glm::ivec3& position) const;
+
+        /// @brief Checks whether a voxel is solid and has at least one empty neighbour, through
+        /// which it could be touched.
+        /// @param position Voxel coordinates.
+        /// @return Whether the voxel is on the surface.
+        bool surface(const glm::ivec3& position) const;
+
+        /// @brief Checks whether any voxel in a range is solid.
+        /// @param min Minimum voxel coordinates of the range, inclusive.
+        /// @param max Maximum voxel coordinates of the range, inclusive.
+        /// @return Whether any voxel is solid. False if the range doesn't overlap the volume.
+        bool overlaps(glm::ivec3 min, glm::ivec3 max) const;
+
+        /// @brief Calls a function for every solid voxel in a range.
+        /// @tparam F Function type, taking the voxel coordinates.
+        /// @param min Minimum voxel coordinates of the range, inclusive.
+        /// @param max Maximum voxel coordinates of the range, inclusive.
+        /// @param callback Function.
+        template <typename F>
+        void forEach(glm::ivec3 min, glm::ivec3 max, F callback) const
+        {
+            if (!this->clamp(min, max))
+            {
+                return;
+            }
+
+            for (int z = min.z; z <= max.z; ++z)
+            {
+                for (int y = min.y; y <= max.y; ++y)
+                {
+                    auto row = this->row(y, z);
+                    for (int w = min.x / 64; w <= max.x / 64; ++w)
+                    {
+                        auto word = mWords[row + static_cast<std::size_t>(w)] & mask(w, min.x, max.x);
+                        while (word != 0)
+                        {
+                            callback(glm::ivec3{w * 64 + std::countr_zero(word), y, z});
+                            word &= word - 1;
+                        }
+                    }
+                }
+            }
+        }
+
+        /// @brief Finds the first solid voxel hit by a ray, by walking the voxels it crosses with
+        /// a 3D DDA.
+        /// @param origin Origin of the ray.
+        /// @param direction Direction of the ray. Doesn't have to be normalized.
+        /// @param maxDistance Maximum distance, in multiples of @p direction, at which hits count.
+        /// @param[out] voxel Voxel hit.
+        /// @param[out] distance Distance to the hit, in multiples of @p direction.
+        /// @param[out] normal Normal of the face hit, or zero if the ray starts inside the voxel.
+        /// @return Whether the ray hits a solid voxel.
+        bool raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, glm::ivec3& voxel, float& distance,
+                     glm::vec3& normal) const;
+
+        /// @brief Gets the memory used by the bits, in bytes.
+        /// @return Memory used.
+        std::size_t memory() const;
+
+    private:
+        /// @brief Gets the index of the first word of a row.
+        /// @param y Y coordinate of the row.
+        /// @param z Z coordinate of the row.
+        /// @return Index of the word.
+        std::size_t row(int y, int z) const
+        {
+            return (static_cast<std::size_t>(y) + static_cast<std::size_t>(z) * mSize.y) * mWordsPerRow;
+        }
+
+        /// @brief Gets the bits of a word which are within a range of X coordinates.
+        /// @param word Index of the word in its row.
+        /// @param min Minimum X coordinate, inclusive.
+        /// @param max Maximum X coordinate, inclusive.
+        /// @return Mask.
+        static uint64_t mask(int word, int min, int max)
+        {
+            uint64_t bits = ~uint64_t{0};
+            if (word == min / 64)
+            {
+                bits &= ~uint64_t{0} << (min % 64);
+            }
+            if (word == max / 64)
+            {
+                bits &= ~uint64_t{0} >> (63 - max % 64);
+            }
+            return bits;
+        }
+
+        /// @brief Clamps a range of voxels to the volume.
+        /// @param[in,out] min Minimum voxel coordinates of the range, inclusive.
+        /// @param[in,out] max Maximum voxel coordinates of the range, inclusive.
+        /// @return Whether the range overlaps the volume.
+        bool clamp(glm::ivec3& min, glm::ivec3& max) const;
+
+        glm::uvec3 mSize{0};            ///< Size of the volume.
+        std::size_t mWordsPerRow{0};    ///< Number of words in each row along the X axis.
+        std::vector<uint64_t> mWords{}; ///< Occupancy bits, row by row, with Y varying faster than Z.
+    };
+} // namespace cubos::engine
@@ -0,0 +1,52 @@
+/// @file
+/// @brief Resource @ref cubos::engine::VoxelOccupancyCache.
+/// @ingroup collisions-plugin
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+
+#include <uuid.h>
+
+#include <cubos/engine/assets/assets.hpp>
+#include <cubos/engine/collisions/voxel_occupancy.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Resource which shares the @ref VoxelOccupancy of each grid asset between every
+    /// @ref VoxelCollisionShape using it.
+    ///
+    /// Volumes are only kept alive by the shapes holding them, and are rebuilt when the version
+    /// of their asset changes.
+    ///
+    /// @ingroup collisions-plugin
+    class VoxelOccupancyCache final
+    {
+    public:
+        /// @brief Gets the volume of a grid asset, building it if it isn't cached or is stale.
+        /// @param assets Assets manager.
+        /// @param grid Handle to the grid asset, already updated to its latest version.
+        /// @return Volume.
+        std::shared_ptr<const VoxelOccupancy> get(const Assets& assets, const Asset<VoxelGrid>& grid);
+
+        /// @brief Forgets volumes which are no longer used by any shape.
+        void prune();
+
+        /// @brief Gets the number of volumes in the cache, including unused ones not yet pruned.
+        /// @return Number of volumes.
+        std::size_t size() const;
+
+    private:
+        /// @brief Volume of a grid asset.
+        struct Entry
+        {
+            int version;                                   ///< Version of the asset it was built from.
+            std::weak_ptr<const VoxelOccupancy> occupancy; ///< Volume, if still used by any shape.
+        };
+
+        std::unordered_map<uuids::uuid, Entry> mEntries; ///< Volumes by grid asset.
+    };
+} // namespace cubos::engine
@@ -11,6 +11,8 @@
 #include <cubos/core/ecs/system/event/pipe.hpp>
 #include <cubos/core/ecs/system/system.hpp>
 #include <cubos/core/ecs/world.hpp>
+#include <cubos/core/memory/allocation_tracker.hpp>
+#include <cubos/core/memory/frame_allocator.hpp>
 
 namespace cubos::engine
 {
@@ -50,6 +52,26 @@ namespace cubos::engine
         const std::vector<std::string> value; ///< Command-line arguments.
     };
 
+    /// @brief Resource which allocates memory which is released at the end of each iteration of
+    /// the main loop.
+    ///
+    /// This resource is added and reset by the @ref Cubos class.
+    ///
+    /// @ingroup engine
+    using FrameAllocator = core::memory::FrameAllocator;
+
+    /// @brief Resource which stores profiling information about the last iteration of the main
+    /// loop, broken down by system.
+    ///
+    /// This resource is added and updated by the @ref Cubos class. Allocation statistics are only
+    /// collected when the engine is built with the `CUBOS_CORE_TRACK_ALLOCATIONS` option.
+    ///
+    /// @ingroup engine
+    struct DispatcherProfile
+    {
+        core::memory::AllocationFrameStats allocations; ///< Heap allocations made by each system.
+    };
+
     /// @brief Used to chain configurations related to tags.
     /// @ingroup engine
     class TagBuilder
@@ -4,10 +4,13 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include <cubos/core/gl/render_device.hpp>
+#include <cubos/core/thread_pool.hpp>
 
+#include <cubos/engine/renderer/mesh_cache.hpp>
 #include <cubos/engine/renderer/renderer.hpp>
 #include <cubos/engine/renderer/vertex.hpp>
 #include <cubos/engine/settings/settings.hpp>
@@ -21,7 +24,17 @@ namespace cubos::engine
 {
     /// @brief Renderer implementation which uses deferred rendering.
     ///
-    /// Voxel grids are first triangulated, and then the triangles are uploaded to the GPU.
+    /// Voxel grids are first triangulated, and then the triangles are uploaded to the GPU:
+    /// - Each chunk of @ref VoxelGrid::ChunkSize voxels gets its own mesh, whose vertices are
+    ///   @ref PackedVoxelVertex relative to the chunk's origin.
+    /// - When a grid is uploaded again, only the chunks which changed, and their neighbors, are
+    ///   triangulated again: right away if they are few, otherwise in the background.
+    /// - Meshes of whole grids may be kept in a @ref MeshCache at `/cache/meshes`.
+    /// - Grids are also downsampled 2x, 4x and 8x in the background, again only where they
+    ///   changed, and drawn at the coarsest level whose voxels are small enough on screen.
+    ///
+    /// The settings which control these are listed in @ref renderer-plugin.
+    ///
     /// The rendering is done in two passes:
     /// 1. Render the scene to the GBuffer textures: position, normal and material.
     /// 2. Take the GBuffer textures and calculate the color of the pixels with the lighting applied.
@@ -40,9 +53,18 @@ namespace cubos::engine
 
         // Implement interface methods.
 
-        RendererGrid upload(const VoxelGrid& grid) override;
+        RendererGrid upload(const VoxelGrid& grid, const RendererGrid& previous = nullptr) override;
         void setPalette(const VoxelPalette& palette) override;
 
+        /// @brief Gets the number of triangles drawn by the last render, which counts each
+        /// grid at the level of detail it was drawn at.
+        /// @return Number of triangles.
+        std::size_t triangleCount() const;
+
+        /// @brief Gets the statistics of the uses of the mesh cache.
+        /// @return Statistics, which are all zero if the cache is disabled.
+        MeshCache::Stats meshCacheStats() const;
+
     protected:
         // Implement interface methods.
 
@@ -54,6 +76,21 @@ namespace cubos::engine
         void createSSAOTextures();
         void generateSSAONoise();
 
+        /// @brief Creates the GPU buffers of the grids whose triangulation has finished.
+        void finishUploads();
+
+        // Background triangulation.
+
+        std::unique_ptr<MeshCache> mMeshCache;
+        std::unique_ptr<core::ThreadPool> mMeshingPool;
+        std::vector<std::weak_ptr<impl::RendererGrid>> mMeshingGrids;
+
+        // Levels of detail.
+
+        bool mLodEnabled;
+        float mLodPixels;
+        std::size_t mTriangleCount = 0;
+
         // GBuffer.
 
         glm::uvec2 mSize;
@@ -67,6 +104,7 @@ namespace cubos::engine
 
         core::gl::ShaderPipeline mGeometryPipeline;
         core::gl::ShaderBindingPoint mVpBp;
+        core::gl::ShaderBindingPoint mChunkOriginBp;
         core::gl::ConstantBuffer mVpBuffer;
         core::gl::RasterState mGeometryRasterState;
         core::gl::BlendState mGeometryBlendState;
@@ -0,0 +1,130 @@
+/// @file
+/// @brief Class @ref cubos::engine::MeshCache.
+/// @ingroup renderer-plugin
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cubos/engine/renderer/vertex.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Cache of the triangulations of voxel grids, stored as files in a directory of the
+    /// virtual file system.
+    ///
+    /// Entries are keyed by @ref VoxelGrid::hash(), so a grid which changed is never given a
+    /// stale mesh, it simply misses the cache. Entries written by a different format version, or
+    /// for a grid of a different size, are also treated as misses, and overwritten when stored.
+    ///
+    /// The number of entries is capped: once storing a new entry exceeds it, the entries stored
+    /// the longest ago are removed. Entries left by previous runs are removed first, in no
+    /// particular order, and those written by a different format version are removed right away.
+    ///
+    /// Files are written in the native byte order, as the cache is meant to be local to a
+    /// machine. Loads and stores may happen concurrently from different threads: those of the
+    /// same entry wait for each other, and entries are only evicted while no thread uses them.
+    ///
+    /// @ingroup renderer-plugin
+    class MeshCache final
+    {
+    public:
+        /// @brief Version of the format of the files, which must be bumped whenever the format or
+        /// the meshes produced for a grid change.
+        static constexpr uint32_t Version = 1;
+
+        /// @brief Triangulation of each chunk of a grid.
+        struct Mesh
+        {
+            std::vector<std::vector<PackedVoxelVertex>> vertices; ///< Vertices of each chunk.
+            std::vector<std::vector<uint32_t>> indices;           ///< Indices of each chunk.
+        };
+
+        /// @brief Statistics of the uses of the cache.
+        struct Stats
+        {
+            std::size_t hits = 0;      ///< Number of meshes found in the cache.
+            std::size_t misses = 0;    ///< Number of meshes not found, or found stale, in the cache.
+            std::size_t stores = 0;    ///< Number of meshes written to the cache.
+            std::size_t evictions = 0; ///< Number of meshes removed from the cache to make room.
+        };
+
+        /// @brief Constructs, removing the stale entries and the entries over the limit.
+        /// @param path Absolute path of the directory of the cache in the virtual file system,
+        /// which must be under a writeable archive for meshes to be stored.
+        /// @param maxEntries Maximum number of entries kept in the cache.
+        MeshCache(std::string path, std::size_t maxEntries);
+
+        /// @brief Reads the mesh of a grid from the cache.
+        /// @param hash Hash of the grid.
+        /// @param size Size of the grid.
+        /// @param[out] mesh Mesh to read into.
+        /// @return Whether the mesh was found.
+        bool load(uint64_t hash, const glm::uvec3& size, Mesh& mesh);
+
+        /// @brief Writes the mesh of a grid to the cache, replacing any previous entry.
+        /// @param hash Hash of the grid.
+        /// @param size Size of the grid.
+        /// @param mesh Mesh to write.
+        /// @return Whether the mesh was written.
+        bool store(uint64_t hash, const glm::uvec3& size, const Mesh& mesh);
+
+        /// @brief Gets the statistics of the uses of the cache so far.
+        /// @return Statistics.
+        Stats stats() const;
+
+    private:
+        /// @brief Gets the path of the file of an entry.
+        /// @param hash Hash of the grid.
+        /// @return Absolute path.
+        std::string entryPath(uint64_t hash) const;
+
+        /// @brief Waits until no other thread uses an entry, and marks it as used.
+        /// @param hash Hash of the grid.
+        void acquire(uint64_t hash);
+
+        /// @brief Marks an entry as no longer used, waking up the threads waiting for it.
+        /// @param hash Hash of the grid.
+        void release(uint64_t hash);
+
+        /// @brief Reads an entry which was acquired.
+        /// @param hash Hash of the grid.
+        /// @param size Size of the grid.
+        /// @param[out] mesh Mesh to read into.
+        /// @return Whether the mesh was found.
+        bool read(uint64_t hash, const glm::uvec3& size, Mesh& mesh);
+
+        /// @brief Writes an entry which was acquired.
+        /// @param hash Hash of the grid.
+        /// @param size Size of the grid.
+        /// @param mesh Mesh to write.
+        /// @return Whether the mesh was written.
+        bool write(uint64_t hash, const glm::uvec3& size, const Mesh& mesh);
+
+        /// @brief Removes the oldest entries until there are at most @ref mMaxEntries left,
+        /// waiting for those still in use.
+        /// @param lock Lock of @ref mMutex.
+        void evict(std::unique_lock<std::mutex>& lock);
+
+        std::string mPath;                      ///< Path of the directory of the cache.
+        std::size_t mMaxEntries;                ///< Maximum number of entries.
+        std::mutex mMutex;                      ///< Protects @ref mEntries and @ref mUsed.
+        std::condition_variable mReleased;      ///< Notified whenever an entry stops being used.
+        std::deque<uint64_t> mEntries;          ///< Hashes of the entries, from the oldest to the newest.
+        std::unordered_set<uint64_t> mUsed;     ///< Hashes of the entries being read or written.
+        std::atomic<std::size_t> mHits{0};      ///< Number of hits.
+        std::atomic<std::size_t> mMisses{0};    ///< Number of misses.
+        std::atomic<std::size_t> mStores{0};    ///< Number of stores.
+        std::atomic<std::size_t> mEvictions{0}; ///< Number of evictions.
+    };
+} // namespace cubos::engine
@@ -35,6 +35,17 @@ namespace cubos::engine
     /// ## Settings
     /// - `cubos.renderer.ssao.enabled` - whether SSAO is enabled.
     /// - `cubos.renderer.bloom.enabled` - whether bloom is enabled.
+    /// - `cubos.renderer.meshing.threads` - number of threads triangulating grids in the
+    ///   background, or 0 to triangulate them when uploaded (default 1).
+    /// - `cubos.renderer.meshing.cache.enabled` - whether meshes are cached on disk (default false).
+    /// - `cubos.renderer.meshing.cache.path` - directory of the mesh cache, created if missing
+    ///   (default `cache/meshes`).
+    /// - `cubos.renderer.meshing.cache.maxEntries` - maximum number of meshes in the cache, after
+    ///   which the oldest are removed (default 256).
+    /// - `cubos.renderer.lod.enabled` - whether grids get levels of detail, which are only built
+    ///   by background threads (default true).
+    /// - `cubos.renderer.lod.pixels` - size on screen, in pixels, below which the voxels of coarser
+    ///   levels of detail are drawn (default 2).
     ///
     /// ## Resources
     /// - @ref Renderer - handle to the renderer.
@@ -72,9 +72,16 @@ namespace cubos::engine
         BaseRenderer(const BaseRenderer&) = delete;
 
         /// @brief Uploads a grid to the GPU and returns an handle which can be used to draw it.
+        ///
+        /// Implementations may triangulate the grid in the background, in which case the handle
+        /// is returned immediately, and draws @p previous, or nothing, until the grid is ready.
+        /// If @p previous was uploaded from the same grid, implementations may reuse the parts of
+        /// it which didn't change since, as told by @ref VoxelGrid::chunkGeneration().
+        ///
         /// @param grid Grid to upload.
+        /// @param previous Handle to draw until the new one is ready, if any.
         /// @return Handle of the grid.
-        virtual RendererGrid upload(const VoxelGrid& grid) = 0;
+        virtual RendererGrid upload(const VoxelGrid& grid, const RendererGrid& previous = nullptr) = 0;
 
         /// @brief Sets the current palette of the renderer.
         /// @param palette Palette to set.
@@ -1,9 +1,14 @@
 /// @file
-/// @brief Class @ref cubos::engine::VoxelVertex and function @ref cubos::engine::triangulate.
+/// @brief Classes @ref cubos::engine::VoxelVertex and @ref cubos::engine::PackedVoxelVertex, and
+/// functions @ref cubos::engine::triangulate and @ref cubos::engine::binaryTriangulate.
 /// @ingroup renderer-plugin
 
 #pragma once
 
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
 #include <glm/glm.hpp>
 
 #include <cubos/core/data/old/deserializer.hpp>
@@ -22,12 +27,83 @@ namespace cubos::engine
         uint16_t material;   ///< Index of the material on the palette.
     };
 
+    /// @brief Voxel vertex packed into 8 bytes, with its position relative to the origin of its
+    /// mesh, which is drawn translated by that origin.
+    ///
+    /// As normals of voxel faces are always one of the six axis directions, only their index is
+    /// stored. Meshes must be at most @ref MaxPosition voxels wide, which is always the case for
+    /// the meshes of the chunks of a @ref VoxelGrid.
+    ///
+    /// @ingroup renderer-plugin
+    struct PackedVoxelVertex
+    {
+        /// @brief Number of bits of each axis of the position.
+        static constexpr int PositionBits = 10;
+
+        /// @brief Maximum value of each axis of the position.
+        static constexpr unsigned int MaxPosition = (1U << PositionBits) - 1;
+
+        uint32_t position; ///< Position of the vertex, with @ref PositionBits bits per axis, X first.
+        uint16_t normal;   ///< Index of the normal of the vertex: +X, -X, +Y, -Y, +Z or -Z.
+        uint16_t material; ///< Index of the material on the palette.
+
+        /// @brief Packs a vertex.
+        /// @param vertex Vertex to pack, whose normal must be an axis direction.
+        /// @param origin Origin of the mesh of the vertex, which the position is relative to.
+        /// @return Packed vertex.
+        static PackedVoxelVertex pack(const VoxelVertex& vertex, const glm::uvec3& origin);
+
+        /// @brief Unpacks the vertex.
+        /// @param origin Origin of the mesh of the vertex.
+        /// @return Unpacked vertex.
+        VoxelVertex unpack(const glm::uvec3& origin) const;
+    };
+
     /// @brief Triangulates a grid of voxels into an indexed mesh.
     /// @param grid Grid to triangulate.
     /// @param vertices Vertices of the mesh.
     /// @param indices Indices of the mesh.
+    /// @param scratch Resource used for temporary allocations made during triangulation. If null,
+    /// an arena owned by the calling thread and reused between calls is used instead.
+    /// @ingroup renderer-plugin
+    void triangulate(const VoxelGrid& grid, std::vector<VoxelVertex>& vertices, std::vector<uint32_t>& indices,
+                     std::pmr::memory_resource* scratch = nullptr);
+
+    /// @brief Triangulates a grid of voxels into an indexed mesh, producing exactly the same mesh
+    /// as @ref triangulate(), but much faster.
+    ///
+    /// Visible faces are found by comparing rows of 64 voxels of occupancy bits at a time, and
+    /// merged into quads by scanning for set bits, so the grid is only read once per voxel plus
+    /// once per visible face.
+    ///
+    /// @param grid Grid to triangulate.
+    /// @param vertices Vertices of the mesh.
+    /// @param indices Indices of the mesh.
+    /// @param scratch Resource used for temporary allocations made during triangulation. If null,
+    /// an arena owned by the calling thread and reused between calls is used instead.
+    /// @ingroup renderer-plugin
+    void binaryTriangulate(const VoxelGrid& grid, std::vector<VoxelVertex>& vertices, std::vector<uint32_t>& indices,
+                           std::pmr::memory_resource* scratch = nullptr);
+
+    /// @brief Triangulates a box region of a grid of voxels, such as a chunk which changed, into
+    /// an indexed mesh, appending to the given vertices and indices.
+    ///
+    /// Only the faces of the voxels inside the region are generated, still taking the voxels
+    /// around it into account, and faces are never merged across the edges of the region. Thus,
+    /// the meshes of regions which split a grid together cover the same faces as the mesh of the
+    /// whole grid. Vertex positions are in grid coordinates.
+    ///
+    /// @param grid Grid to triangulate.
+    /// @param min Inclusive minimum corner of the region.
+    /// @param max Exclusive maximum corner of the region, which must be inside the grid.
+    /// @param vertices Vertices of the mesh.
+    /// @param indices Indices of the mesh.
+    /// @param scratch Resource used for temporary allocations made during triangulation. If null,
+    /// an arena owned by the calling thread and reused between calls is used instead.
     /// @ingroup renderer-plugin
-    void triangulate(const VoxelGrid& grid, std::vector<VoxelVertex>& vertices, std::vector<uint32_t>& indices);
+    void binaryTriangulate(const VoxelGrid& grid, const glm::uvec3& min, const glm::uvec3& max,
+                           std::vector<VoxelVertex>& vertices, std::vector<uint32_t>& indices,
+                           std::pmr::memory_resource* scratch = nullptr);
 } // namespace cubos::engine
 
 namespace cubos::core::data::old
@@ -0,0 +1,243 @@
+/// @file
+/// @brief Class @ref cubos::engine::ChunkedVoxelGrid.
+/// @ingroup voxels-plugin
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cubos/core/data/old/deserializer.hpp>
+#include <cubos/core/data/old/serializer.hpp>
+
+#include <cubos/engine/voxels/grid.hpp>
+
+namespace cubos::engine
+{
+    class ChunkedVoxelGrid;
+} // namespace cubos::engine
+
+namespace cubos::core::data::old
+{
+    void serialize(Serializer& serializer, const engine::ChunkedVoxelGrid& grid, const char* name);
+    void deserialize(Deserializer& deserializer, engine::ChunkedVoxelGrid& grid);
+} // namespace cubos::core::data::old
+
+namespace cubos::engine
+{
+    /// @brief Represents a large voxel object as a sparse set of fixed size chunks.
+    ///
+    /// Offers the same interface as @ref VoxelGrid, but only stores the chunks which have any
+    /// non-empty voxel. Chunks whose voxels all have the same material only store that material,
+    /// until one of them is changed. A mostly empty 1024x256x1024 world thus takes a fraction of
+    /// the memory a dense grid would.
+    ///
+    /// Chunks can be accessed on their own, so that meshing, collisions and streaming can work on
+    /// one chunk at a time.
+    ///
+    /// @see Each voxel stores a material index to be used with a @ref VoxelPalette.
+    /// @ingroup voxels-plugin
+    class ChunkedVoxelGrid final
+    {
+    public:
+        /// @brief Number of voxels along each edge of a chunk.
+        static constexpr int ChunkSize = 16;
+
+        /// @brief Number of voxels in a chunk.
+        static constexpr std::size_t ChunkVolume = static_cast<std::size_t>(ChunkSize * ChunkSize * ChunkSize);
+
+        /// @brief Chunk of the grid.
+        struct Chunk
+        {
+            /// @brief Material of every voxel, if @ref voxels is empty.
+            uint16_t uniform = 0;
+
+            /// @brief Material of each voxel, indexed as in @ref VoxelGrid, or empty if all
+            /// voxels have the @ref uniform material.
+            std::vector<uint16_t> voxels;
+
+            /// @brief Gets the material of a voxel.
+            /// @param position Coordinates of the voxel in the chunk.
+            /// @return Material index.
+            uint16_t get(const glm::ivec3& position) const
+            {
+                return voxels.empty() ? uniform : voxels[index(position)];
+            }
+
+            /// @brief Sets the material of a voxel, expanding the chunk if needed.
+            /// @param position Coordinates of the voxel in the chunk.
+            /// @param mat Material index.
+            void set(const glm::ivec3& position, uint16_t mat);
+
+            /// @brief Collapses the chunk to a single material if all of its voxels share it.
+            /// @return Whether the chunk is uniform.
+            bool compact();
+
+            /// @brief Gets the index of a voxel in @ref voxels.
+            /// @param position Coordinates of the voxel in the chunk.
+            /// @return Index.
+            static std::size_t index(const glm::ivec3& position)
+            {
+                return static_cast<std::size_t>(position.x + position.y * ChunkSize +
+                                                 position.z * ChunkSize * ChunkSize);
+            }
+        };
+
+        ~ChunkedVoxelGrid() = default;
+
+        /// @brief Constructs an empty single-voxel grid.
+        ChunkedVoxelGrid();
+
+        /// @brief Constructs an empty grid with the given size.
+        /// @param size Size of the grid.
+        ChunkedVoxelGrid(const glm::uvec3& size);
+
+        /// @brief Constructs a grid with the same size and voxels as a dense grid.
+        /// @param grid Dense grid.
+        explicit ChunkedVoxelGrid(const VoxelGrid& grid);
+
+        /// @brief Copy constructs.
+        /// @param other Other grid.
+        ChunkedVoxelGrid(const ChunkedVoxelGrid& other) = default;
+
+        /// @brief Move constructs.
+        /// @param other Other grid.
+        ChunkedVoxelGrid(ChunkedVoxelGrid&& other) noexcept = default;
+
+        /// @brief Makes this grid a copy of another grid.
+        /// @param rhs Other grid.
+        /// @return This grid, for chaining.
+        ChunkedVoxelGrid& operator=(const ChunkedVoxelGrid& rhs) = default;
+
+        /// @brief Moves another grid into this grid.
+        /// @param rhs Other grid.
+        /// @return This grid, for chaining.
+        ChunkedVoxelGrid& operator=(ChunkedVoxelGrid&& rhs) noexcept = default;
+
+        /// @brief Resizes the grid. Voxels inside both the old and the new size are kept, and new
+        /// voxels are initialized to 0.
+        /// @param size New size of the grid.
+        void setSize(const glm::uvec3& size);
+
+        /// @brief Gets the size of the grid.
+        /// @return Size of the grid.
+        const glm::uvec3& size() const;
+
+        /// @brief Sets all voxels to 0, freeing every chunk.
+        void clear();
+
+        /// @brief Sets the material index of a voxel.
+        /// @param position Voxel coordinates.
+        /// @param mat Material index to set.
+        void set(const glm::ivec3& position, uint16_t mat);
+
+        /// @brief Gets the material index of a voxel.
+        /// @param position Voxel coordinates.
+        /// @return Material index of the voxel.
+        uint16_t get(const glm::ivec3& position) const;
+
+        /// @brief Converts the material indices of this grid from one palette to another.
+        /// @see VoxelGrid::convert()
+        /// @param src Original palette.
+        /// @param dst New palette.
+        /// @param minSimilarity Minimum similarity between two materials to consider them the same.
+        /// @return Whether the conversion was successful.
+        bool convert(const VoxelPalette& src, const VoxelPalette& dst, float minSimilarity);
+
+        /// @brief Collapses every chunk whose voxels share the same material, and frees the empty
+        /// ones. Chunks are only expanded by @ref set(), so this is worth calling after large edits.
+        void compact();
+
+        /// @brief Gets the number of chunks along each axis, including empty ones.
+        /// @return Number of chunks along each axis.
+        glm::uvec3 chunkCount() const;
+
+        /// @brief Gets a chunk.
+        /// @param position Chunk coordinates, which are the voxel coordinates divided by @ref ChunkSize.
+        /// @return Chunk, or null if it's empty.
+        const Chunk* chunk(const glm::uvec3& position) const;
+
+        /// @brief Calls a function for every chunk which isn't empty, in no particular order.
+        /// @tparam F Function type, taking the chunk coordinates and the chunk.
+        /// @param callback Function.
+        template <typename F>
+        void forEachChunk(F callback) const
+        {
+            for (const auto& [key, chunk] : mChunks)
+            {
+                callback(unpack(key), chunk);
+            }
+        }
+
+        /// @brief Calls a function for every voxel which isn't empty, chunk by chunk.
+        /// @tparam F Function type, taking the voxel coordinates and its material index.
+        /// @param callback Function.
+        template <typename F>
+        void forEach(F callback) const
+        {
+            this->forEachChunk([&](glm::uvec3 position, const Chunk& chunk) {
+                auto origin = glm::ivec3{position} * ChunkSize;
+                auto end = glm::min(origin + ChunkSize, glm::ivec3{mSize});
+                for (int z = origin.z; z < end.z; ++z)
+                {
+                    for (int y = origin.y; y < end.y; ++y)
+                    {
+                        for (int x = origin.x; x < end.x; ++x)
+                        {
+                            auto mat = chunk.get(glm::ivec3{x, y, z} - origin);
+                            if (mat != 0)
+                            {
+                                callback(glm::ivec3{x, y, z}, mat);
+                            }
+                        }
+                    }
+                }
+            });
+        }
+
+        /// @brief Copies a chunk into a dense grid, clipped to the size of the grid.
+        /// @param position Chunk coordinates.
+        /// @return Dense grid with the voxels of the chunk.
+        VoxelGrid chunkGrid(const glm::uvec3& position) const;
+
+        /// @brief Copies the whole grid into a dense grid.
+        /// @return Dense grid.
+        VoxelGrid toGrid() const;
+
+        /// @brief Gets the memory used by the chunks, in bytes.
+        /// @return Memory used.
+        std::size_t memory() const;
+
+    private:
+        friend void core::data::old::serialize(core::data::old::Serializer& /*serializer*/,
+                                               const ChunkedVoxelGrid& /*grid*/, const char* /*name*/);
+        friend void core::data::old::deserialize(core::data::old::Deserializer& /*deserializer*/,
+                                                 ChunkedVoxelGrid& /*grid*/);
+
+        /// @brief Packs chunk coordinates into a key of @ref mChunks.
+        /// @param position Chunk coordinates.
+        /// @return Key.
+        static uint64_t pack(const glm::uvec3& position)
+        {
+            return static_cast<uint64_t>(position.x) | (static_cast<uint64_t>(position.y) << 21) |
+                   (static_cast<uint64_t>(position.z) << 42);
+        }
+
+        /// @brief Unpacks chunk coordinates from a key of @ref mChunks.
+        /// @param key Key.
+        /// @return Chunk coordinates.
+        static glm::uvec3 unpack(uint64_t key)
+        {
+            constexpr uint64_t Mask = (uint64_t{1} << 21) - 1;
+            return {static_cast<unsigned int>(key & Mask), static_cast<unsigned int>((key >> 21) & Mask),
+                    static_cast<unsigned int>((key >> 42) & Mask)};
+        }
+
+        glm::uvec3 mSize;                            ///< Size of the grid.
+        std::unordered_map<uint64_t, Chunk> mChunks; ///< Chunks which aren't empty, by packed coordinates.
+    };
+} // namespace cubos::engine
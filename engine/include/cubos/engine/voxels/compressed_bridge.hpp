@@ -0,0 +1,28 @@
+/// @file
+/// @brief Class @ref cubos::engine::CompressedGridBridge.
+/// @ingroup voxels-plugin
+
+#pragma once
+
+#include <cubos/engine/assets/bridges/file.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Bridge which loads and saves @ref VoxelGrid assets stored as binary serialized
+    /// @ref CompressedVoxelGrid files.
+    ///
+    /// Grids are decoded when loaded, so the assets can be used anywhere a @ref VoxelGrid loaded
+    /// by a @ref BinaryBridge could, while taking a fraction of the space on disk.
+    ///
+    /// @ingroup voxels-plugin
+    class CompressedGridBridge : public FileBridge
+    {
+    public:
+        /// @brief Constructs a bridge.
+        CompressedGridBridge();
+
+    protected:
+        bool loadFromFile(Assets& assets, const AnyAsset& handle, core::memory::Stream& stream) override;
+        bool saveToFile(const Assets& assets, const AnyAsset& handle, core::memory::Stream& stream) override;
+    };
+} // namespace cubos::engine
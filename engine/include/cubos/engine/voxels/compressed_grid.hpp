@@ -0,0 +1,145 @@
+/// @file
+/// @brief Class @ref cubos::engine::CompressedVoxelGrid.
+/// @ingroup voxels-plugin
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cubos/core/data/old/deserializer.hpp>
+#include <cubos/core/data/old/serializer.hpp>
+
+#include <cubos/engine/voxels/grid.hpp>
+
+namespace cubos::engine
+{
+    class CompressedVoxelGrid;
+} // namespace cubos::engine
+
+namespace cubos::core::data::old
+{
+    void serialize(Serializer& serializer, const engine::CompressedVoxelGrid& grid, const char* name);
+    void deserialize(Deserializer& deserializer, engine::CompressedVoxelGrid& grid);
+} // namespace cubos::core::data::old
+
+namespace cubos::engine
+{
+    /// @brief Read-only compressed copy of a @ref VoxelGrid.
+    ///
+    /// The grid is split into chunks of 16x16x16 voxels. Each chunk has its own palette of the
+    /// material indices it uses, and stores its voxels as indices into that palette, packed with
+    /// the fewest bits possible (0, 1, 2, 4, 8 or 16). Chunks with long runs of the same material
+    /// store each run only once instead, when that takes less space.
+    ///
+    /// Voxels can still be read one by one with @ref get(), without decompressing the grid, and
+    /// the grid can be decoded one chunk at a time with @ref decodeChunk().
+    ///
+    /// @ingroup voxels-plugin
+    class CompressedVoxelGrid final
+    {
+    public:
+        /// @brief Number of voxels along each edge of a chunk.
+        static constexpr int ChunkSize = 16;
+
+        /// @brief Number of voxels in a chunk.
+        static constexpr std::size_t ChunkVolume = static_cast<std::size_t>(ChunkSize * ChunkSize * ChunkSize);
+
+        /// @brief Chunk of the grid.
+        struct Chunk
+        {
+            /// @brief Material indices used by the chunk.
+            std::vector<uint16_t> palette;
+
+            /// @brief Number of bits of each packed palette index.
+            uint8_t bits = 0;
+
+            /// @brief Exclusive end of each run of voxels with the same material, in voxel
+            /// order, or empty if the chunk isn't run-length encoded.
+            std::vector<uint16_t> runs;
+
+            /// @brief Packed palette indices, one per voxel, or one per run if the chunk is
+            /// run-length encoded.
+            std::vector<uint64_t> words;
+
+            /// @brief Gets the material of a voxel.
+            /// @param index Index of the voxel in the chunk, as in @ref VoxelGrid.
+            /// @return Material index.
+            uint16_t get(std::size_t index) const;
+
+            /// @brief Decodes every voxel of the chunk.
+            /// @param[out] voxels Array of @ref ChunkVolume voxels to write to.
+            void decode(uint16_t* voxels) const;
+
+            /// @brief Checks if the chunk is well formed.
+            /// @return Whether the chunk is valid.
+            bool valid() const;
+        };
+
+        ~CompressedVoxelGrid() = default;
+
+        /// @brief Constructs an empty single-voxel grid.
+        CompressedVoxelGrid();
+
+        /// @brief Constructs a compressed copy of a grid.
+        /// @param grid Grid to compress.
+        explicit CompressedVoxelGrid(const VoxelGrid& grid);
+
+        /// @brief Move constructs.
+        /// @param other Other grid.
+        CompressedVoxelGrid(CompressedVoxelGrid&& other) noexcept = default;
+
+        /// @brief Makes this grid a copy of another grid.
+        /// @param rhs Other grid.
+        /// @return This grid, for chaining.
+        CompressedVoxelGrid& operator=(const CompressedVoxelGrid& rhs) = default;
+
+        /// @brief Gets the size of the grid.
+        /// @return Size of the grid.
+        const glm::uvec3& size() const;
+
+        /// @brief Gets the material index of a voxel.
+        /// @param position Voxel coordinates.
+        /// @return Material index of the voxel.
+        uint16_t get(const glm::ivec3& position) const;
+
+        /// @brief Gets the number of chunks along each axis.
+        /// @return Number of chunks along each axis.
+        glm::uvec3 chunkCount() const;
+
+        /// @brief Gets a chunk.
+        /// @param position Chunk coordinates, which are the voxel coordinates divided by @ref ChunkSize.
+        /// @return Chunk.
+        const Chunk& chunk(const glm::uvec3& position) const;
+
+        /// @brief Decodes a chunk into a dense grid, clipped to the size of the grid.
+        /// @param position Chunk coordinates.
+        /// @return Dense grid with the voxels of the chunk.
+        VoxelGrid decodeChunk(const glm::uvec3& position) const;
+
+        /// @brief Decodes the whole grid into a dense grid, one chunk at a time.
+        /// @return Dense grid.
+        VoxelGrid decode() const;
+
+        /// @brief Gets the memory used by the chunks, in bytes.
+        /// @return Memory used.
+        std::size_t memory() const;
+
+    private:
+        friend void core::data::old::serialize(core::data::old::Serializer& /*serializer*/,
+                                               const CompressedVoxelGrid& /*grid*/, const char* /*name*/);
+        friend void core::data::old::deserialize(core::data::old::Deserializer& /*deserializer*/,
+                                                 CompressedVoxelGrid& /*grid*/);
+
+        /// @brief Gets the index of a chunk in @ref mChunks.
+        /// @param position Chunk coordinates.
+        /// @return Index.
+        std::size_t chunkIndex(const glm::uvec3& position) const;
+
+        glm::uvec3 mSize;           ///< Size of the grid.
+        std::vector<Chunk> mChunks; ///< Chunks, ordered as voxels are in @ref VoxelGrid.
+    };
+} // namespace cubos::engine
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -26,11 +27,22 @@ namespace cubos::core::data::old
 namespace cubos::engine
 {
     /// @brief Represents a voxel object using a 3D grid.
+    ///
+    /// Changes are tracked per chunk of @ref ChunkSize voxels along each axis: every change stamps
+    /// its chunk with a new generation, which is greater than any generation the grid had before.
+    /// Changes to the whole grid, such as resizing it or assigning to it, start a new epoch, whose
+    /// generations are greater than any taken before by any grid. Thus, anything built from a
+    /// grid, such as a mesh, only needs to be rebuilt for the chunks whose generation is greater
+    /// than the @ref generation() it was built at.
+    ///
     /// @see Each voxel stores a material index to be used with a @ref VoxelPalette.
     /// @ingroup voxels-plugin
     class VoxelGrid final
     {
     public:
+        /// @brief Number of voxels along each edge of a chunk whose changes are tracked.
+        static constexpr int ChunkSize = 32;
+
         ~VoxelGrid() = default;
 
         /// @brief Constructs an empty single-voxel grid.
@@ -51,7 +63,8 @@ namespace cubos::engine
         /// @param other Other grid.
         VoxelGrid(VoxelGrid&& other) noexcept;
 
-        /// @brief Makes this grid a copy of another grid.
+        /// @brief Makes this grid a copy of another grid. Every chunk is stamped with a new
+        /// generation, as the contents of this grid may have changed completely.
         /// @param rhs Other grid.
         /// @return This grid, for chaining.
         VoxelGrid& operator=(const VoxelGrid& rhs);
@@ -88,12 +101,104 @@ namespace cubos::engine
         /// @return Whether the conversion was successful.
         bool convert(const VoxelPalette& src, const VoxelPalette& dst, float minSimilarity);
 
+        /// @brief Replaces the material index of every voxel by its entry in a lookup table.
+        /// @param lut New index of each material index. Indices past its end are kept.
+        void remap(const std::vector<uint16_t>& lut);
+
+        /// @brief Sets the material index of every voxel in a box, clipped to the grid.
+        /// @param min Inclusive minimum corner of the box.
+        /// @param max Exclusive maximum corner of the box.
+        /// @param mat Material index to set.
+        void fill(const glm::ivec3& min, const glm::ivec3& max, uint16_t mat);
+
+        /// @brief Sets the material index of every voxel whose center is inside a sphere.
+        /// @param center Center of the sphere, in voxel coordinates.
+        /// @param radius Radius of the sphere, in voxels.
+        /// @param mat Material index to set.
+        void fillSphere(const glm::vec3& center, float radius, uint16_t mat);
+
+        /// @brief Copies every voxel, including empty ones, of a box of another grid into this
+        /// grid. Voxels which fall outside of either grid are skipped.
+        /// @param src Grid to copy from, which may be this grid.
+        /// @param srcMin Inclusive minimum corner of the box in @p src.
+        /// @param srcMax Exclusive maximum corner of the box in @p src.
+        /// @param dst Position in this grid where @p srcMin is copied to.
+        void copyRegion(const VoxelGrid& src, const glm::ivec3& srcMin, const glm::ivec3& srcMax,
+                        const glm::ivec3& dst);
+
+        /// @brief Copies every voxel, including empty ones, of another grid into this grid.
+        /// @param src Grid to copy from, which may be this grid.
+        /// @param dst Position in this grid where the origin of @p src is copied to.
+        void blit(const VoxelGrid& src, const glm::ivec3& dst);
+
+        /// @brief Adds the solid voxels of another grid to this grid, replacing the voxels below.
+        /// @param other Grid to add, which may be this grid.
+        /// @param offset Position in this grid of the origin of @p other.
+        void unite(const VoxelGrid& other, const glm::ivec3& offset);
+
+        /// @brief Clears the voxels of this grid below the solid voxels of another grid.
+        /// @param other Grid to subtract, which may be this grid.
+        /// @param offset Position in this grid of the origin of @p other.
+        void subtract(const VoxelGrid& other, const glm::ivec3& offset);
+
+        /// @brief Creates a lower resolution copy of the grid, for drawing it from afar.
+        ///
+        /// Each voxel of the copy covers a block of @p factor voxels along each axis. It is solid
+        /// if at least half of the block is, with the most common material of the block.
+        ///
+        /// @param factor Number of voxels along each axis merged into one, at least 1.
+        /// @return Downsampled grid, with size rounded up.
+        VoxelGrid downsample(unsigned int factor) const;
+
+        /// @brief Updates a box of a lower resolution copy of the grid made by @ref downsample(),
+        /// after the grid changed there. The chunks of the copy overlapping the box are stamped
+        /// with a new generation, as with any other change.
+        /// @param factor Number of voxels along each axis merged into one, which the copy was made with.
+        /// @param min Inclusive minimum corner of the box, in voxels of the copy.
+        /// @param max Exclusive maximum corner of the box, in voxels of the copy, clipped to it.
+        /// @param[in,out] result Copy to update.
+        void downsample(unsigned int factor, const glm::uvec3& min, const glm::uvec3& max, VoxelGrid& result) const;
+
+        /// @brief Computes a hash of the size and voxels of the grid, which is the same for any
+        /// two grids with the same contents.
+        /// @return Hash.
+        uint64_t hash() const;
+
+        /// @brief Gets the generation of the latest change to the grid.
+        /// @return Generation.
+        uint64_t generation() const;
+
+        /// @brief Gets the number of chunks along each axis.
+        /// @return Number of chunks along each axis.
+        glm::uvec3 chunkCount() const;
+
+        /// @brief Gets the generation of the latest change to a chunk.
+        /// @param chunk Chunk coordinates, which are the voxel coordinates divided by @ref ChunkSize.
+        /// @return Generation.
+        uint64_t chunkGeneration(const glm::uvec3& chunk) const;
+
     private:
         friend void core::data::old::serialize(core::data::old::Serializer& /*serializer*/, const VoxelGrid& /*grid*/,
                                                const char* /*name*/);
         friend void core::data::old::deserialize(core::data::old::Deserializer& /*deserializer*/, VoxelGrid& /*grid*/);
 
-        glm::uvec3 mSize;               ///< Size of the grid.
-        std::vector<uint16_t> mIndices; ///< Indices of the grid.
+        /// @brief Takes the next generation of the grid, without stamping any chunk with it.
+        /// @return Generation.
+        uint64_t advance();
+
+        /// @brief Stamps every chunk with the generation of a new epoch, after the whole grid
+        /// changed, which may also have changed the number of chunks.
+        void touch();
+
+        /// @brief Stamps the chunks overlapping a box with a new generation, after it changed.
+        /// @param min Inclusive minimum corner of the box, inside the grid.
+        /// @param max Exclusive maximum corner of the box, inside the grid.
+        void touch(const glm::ivec3& min, const glm::ivec3& max);
+
+        glm::uvec3 mSize;                        ///< Size of the grid.
+        std::vector<uint16_t> mIndices;          ///< Indices of the grid.
+        std::vector<uint64_t> mChunkGenerations; ///< Generation of the latest change to each chunk.
+        glm::uvec3 mChunkCount;                  ///< Number of chunks along each axis.
+        uint64_t mGeneration;                    ///< Generation of the latest change to the grid.
     };
 } // namespace cubos::engine
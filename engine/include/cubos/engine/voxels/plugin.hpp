@@ -17,6 +17,9 @@ namespace cubos::engine
     ///
     /// ## Bridges
     /// - @ref BinaryBridge - registered with the `.grd` extension, loads @ref VoxelGrid assets.
+    /// - @ref CompressedGridBridge - registered with the `.pgrd` extension, loads compressed
+    ///   @ref VoxelGrid assets.
+    /// - @ref BinaryBridge - registered with the `.cgrd` extension, loads @ref ChunkedVoxelGrid assets.
     /// - @ref BinaryBridge - registered with the `.pal` extension, loads @ref VoxelPalette assets.
     ///
     /// ## Dependencies
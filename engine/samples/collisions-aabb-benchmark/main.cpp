@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/random.hpp>
+
+#include <cubos/core/geom/aabb.hpp>
+#include <cubos/core/log.hpp>
+
+#include <cubos/engine/collisions/collider.hpp>
+#include <cubos/engine/collisions/plugin.hpp>
+#include <cubos/engine/collisions/shapes/box.hpp>
+#include <cubos/engine/transform/plugin.hpp>
+
+using cubos::core::ecs::Commands;
+using cubos::core::ecs::Query;
+using cubos::core::ecs::Read;
+using cubos::core::ecs::Write;
+using cubos::core::geom::AABB;
+
+using namespace cubos::engine;
+
+/// Number of colliders.
+static constexpr std::size_t ColliderCount = 100000;
+
+/// Number of frames to measure.
+static constexpr std::size_t FrameCount = 100;
+
+struct State
+{
+    std::vector<AABB> reference;
+
+    std::size_t frame = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration batched{};
+    std::chrono::steady_clock::duration scalar{};
+    float maxError = 0.0F;
+};
+
+/// Computes the world AABB of a collider by transforming its corners, as the plugin used to.
+static AABB referenceAABB(const Collider& collider)
+{
+    auto transform = collider.worldTransform;
+
+    glm::vec3 corners[4];
+    collider.localAABB.box().corners4(corners);
+    auto points = glm::mat4{glm::vec4{corners[0], 1.0F}, glm::vec4{corners[1], 1.0F}, glm::vec4{corners[2], 1.0F},
+                            glm::vec4{corners[3], 1.0F}};
+
+    auto translation = glm::vec3{transform * glm::vec4{collider.localAABB.center(), 1.0F}};
+    transform[3] = glm::vec4{0.0F, 0.0F, 0.0F, 1.0F};
+    auto rotatedCorners = glm::mat4x3{transform * points};
+
+    auto max = glm::max(glm::abs(rotatedCorners[0]), glm::abs(rotatedCorners[1]));
+    max = glm::max(max, glm::abs(rotatedCorners[2]));
+    max = glm::max(max, glm::abs(rotatedCorners[3]));
+    max += glm::vec3{collider.margin};
+
+    AABB aabb;
+    aabb.min(translation - max);
+    aabb.max(translation + max);
+    return aabb;
+}
+
+static void spawn(Commands commands, Write<ShouldQuit> quit)
+{
+    quit->value = false;
+
+    for (std::size_t i = 0; i < ColliderCount; ++i)
+    {
+        auto axis = glm::sphericalRand(1.0F);
+        commands.create()
+            .add(Collider{})
+            .add(BoxCollisionShape{{glm::linearRand(glm::vec3{0.1F}, glm::vec3{2.0F})}})
+            .add(LocalToWorld{})
+            .add(Position{glm::linearRand(glm::vec3{-500.0F}, glm::vec3{500.0F})})
+            .add(Rotation{glm::angleAxis(glm::linearRand(0.0F, 6.28F), axis)})
+            .add(Scale{glm::linearRand(0.5F, 2.0F)});
+    }
+}
+
+static void spin(Query<Write<Rotation>> query)
+{
+    auto step = glm::angleAxis(0.01F, glm::normalize(glm::vec3{1.0F, 2.0F, 3.0F}));
+    for (auto [entity, rotation] : query)
+    {
+        rotation->quat = step * rotation->quat;
+    }
+}
+
+static void startTimer(Write<State> state)
+{
+    state->start = std::chrono::steady_clock::now();
+}
+
+static void stopTimer(Write<State> state, Query<Read<Collider>> query, Write<ShouldQuit> quit)
+{
+    auto end = std::chrono::steady_clock::now();
+
+    // The first frame sets up every collider, and thus isn't representative of the steady state.
+    if (state->frame > 0)
+    {
+        state->batched += end - state->start;
+
+        // Compute the same AABBs the old way, one collider at a time, and compare them.
+        state->reference.clear();
+        auto scalarStart = std::chrono::steady_clock::now();
+        for (auto [entity, collider] : query)
+        {
+            state->reference.push_back(referenceAABB(*collider));
+        }
+        state->scalar += std::chrono::steady_clock::now() - scalarStart;
+
+        std::size_t i = 0;
+        for (auto [entity, collider] : query)
+        {
+            auto error = glm::max(glm::abs(collider->worldAABB.min() - state->reference[i].min()),
+                                  glm::abs(collider->worldAABB.max() - state->reference[i].max()));
+            state->maxError = std::max({state->maxError, error.x, error.y, error.z});
+            i += 1;
+        }
+    }
+
+    state->frame += 1;
+    if (state->frame > FrameCount)
+    {
+        auto batched = std::chrono::duration<double, std::milli>(state->batched).count() / FrameCount;
+        auto scalar = std::chrono::duration<double, std::milli>(state->scalar).count() / FrameCount;
+        CUBOS_INFO("{} colliders: batched {:.3f} ms per frame, corner transform {:.3f} ms per frame, max error {}",
+                   ColliderCount, batched, scalar, state->maxError);
+        quit->value = true;
+    }
+}
+
+int main()
+{
+    auto cubos = Cubos();
+
+    cubos.addPlugin(collisionsPlugin);
+    cubos.addResource<State>();
+
+    cubos.startupSystem(spawn);
+
+    cubos.system(spin).before("cubos.transform.update");
+    cubos.system(startTimer)
+        .after("cubos.transform.update")
+        .after("cubos.collisions.setup")
+        .before("cubos.collisions.aabb");
+    cubos.system(stopTimer).after("cubos.collisions.aabb").before("cubos.collisions.broad.markers");
+
+    cubos.run();
+    return 0;
+}
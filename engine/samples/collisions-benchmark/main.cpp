@@ -0,0 +1,143 @@
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/random.hpp>
+
+#include <cubos/core/log.hpp>
+
+#include <cubos/engine/collisions/broad_phase_collisions.hpp>
+#include <cubos/engine/collisions/collider.hpp>
+#include <cubos/engine/collisions/plugin.hpp>
+#include <cubos/engine/collisions/shapes/box.hpp>
+#include <cubos/engine/settings/settings.hpp>
+#include <cubos/engine/transform/plugin.hpp>
+
+using cubos::core::ecs::Commands;
+using cubos::core::ecs::Entity;
+using cubos::core::ecs::Query;
+using cubos::core::ecs::Read;
+using cubos::core::ecs::Write;
+
+using namespace cubos::engine;
+
+/// Number of frames to measure.
+static constexpr std::size_t FrameCount = 100;
+
+/// Number of colliders per cubic unit, kept constant as the number of colliders grows.
+static constexpr float Density = 0.00125F;
+
+struct State
+{
+    std::string method;
+    std::size_t colliderCount = 0;
+    float worldExtent = 0.0F; ///< Half the size of the cube the colliders move in.
+
+    std::vector<Entity> entities;
+    std::vector<glm::vec3> velocities;
+
+    std::size_t frame = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration total{};
+    std::size_t candidates = 0;
+};
+
+static void settings(Write<Settings> settings, Read<State> state)
+{
+    settings->setString("collisions.broadPhase", state->method);
+}
+
+static void spawn(Commands commands, Write<State> state, Write<ShouldQuit> quit)
+{
+    quit->value = false;
+
+    auto extent = glm::vec3{state->worldExtent};
+    for (std::size_t i = 0; i < state->colliderCount; ++i)
+    {
+        state->entities.push_back(commands.create()
+                                      .add(Collider{})
+                                      .add(BoxCollisionShape{})
+                                      .add(LocalToWorld{})
+                                      .add(Position{glm::linearRand(-extent, extent)})
+                                      .entity());
+        state->velocities.push_back(glm::sphericalRand(0.1F));
+    }
+}
+
+static void move(Write<State> state, Query<Write<Position>> query)
+{
+    for (std::size_t i = 0; i < state->entities.size(); ++i)
+    {
+        auto [position] = query[state->entities[i]].value();
+        position->vec += state->velocities[i];
+
+        // Bounce off the walls of the world.
+        for (glm::length_t axis = 0; axis < 3; ++axis)
+        {
+            if (glm::abs(position->vec[axis]) > state->worldExtent)
+            {
+                state->velocities[i][axis] = -state->velocities[i][axis];
+            }
+        }
+    }
+}
+
+static void startTimer(Write<State> state)
+{
+    state->start = std::chrono::steady_clock::now();
+}
+
+static void stopTimer(Write<State> state, Read<BroadPhaseCollisions> collisions, Write<ShouldQuit> quit)
+{
+    // The first frame inserts every collider, and thus isn't representative of the steady state.
+    if (state->frame > 0)
+    {
+        state->total += std::chrono::steady_clock::now() - state->start;
+        state->candidates += collisions->candidates(BroadPhaseCollisions::CollisionType::BoxBox).size();
+    }
+
+    state->frame += 1;
+    if (state->frame > FrameCount)
+    {
+        auto milliseconds = std::chrono::duration<double, std::milli>(state->total).count();
+        CUBOS_INFO("{} with {} colliders: {:.3f} ms per frame on average, {} candidates per frame", state->method,
+                   state->colliderCount, milliseconds / FrameCount, state->candidates / FrameCount);
+        quit->value = true;
+    }
+}
+
+static void run(const std::string& method, std::size_t colliderCount)
+{
+    State state;
+    state.method = method;
+    state.colliderCount = colliderCount;
+    state.worldExtent = 0.5F * std::cbrt(static_cast<float>(colliderCount) / Density);
+
+    auto cubos = Cubos();
+
+    cubos.addPlugin(collisionsPlugin);
+    cubos.addResource<State>(state);
+
+    cubos.startupSystem(settings).tagged("cubos.settings");
+    cubos.startupSystem(spawn);
+
+    cubos.system(move).before("cubos.transform.update");
+    cubos.system(startTimer).after("cubos.transform.update").before("cubos.collisions.setup");
+    cubos.system(stopTimer).after("cubos.collisions.broad");
+
+    cubos.run();
+}
+
+int main()
+{
+    for (std::size_t colliderCount : {1000, 10000, 100000})
+    {
+        for (const char* method : {"sweepAndPrune", "aabbTree", "spatialHash"})
+        {
+            run(method, colliderCount);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/gtc/random.hpp>
+
+#include <cubos/core/log.hpp>
+
+#include <cubos/engine/voxels/grid.hpp>
+
+using namespace cubos::engine;
+
+/// Size of the grids edited.
+static constexpr int Size = 256;
+
+/// Number of times each operation is run.
+static constexpr int RunCount = 5;
+
+using Clock = std::chrono::steady_clock;
+
+/// Terrain with a random material on each voxel, so that remapping can't be skipped.
+static VoxelGrid terrain()
+{
+    VoxelGrid grid{{Size, Size, Size}};
+    for (int z = 0; z < Size; ++z)
+    {
+        for (int y = 0; y < Size / 2; ++y)
+        {
+            for (int x = 0; x < Size; ++x)
+            {
+                grid.set({x, y, z}, static_cast<uint16_t>(glm::linearRand(1, 200)));
+            }
+        }
+    }
+    return grid;
+}
+
+/// Gets the average time, in seconds, taken by an operation on a copy of a grid. Copying the grid
+/// isn't measured.
+template <typename F>
+static double measure(const VoxelGrid& source, VoxelGrid& grid, F operation)
+{
+    double total = 0.0;
+    for (int i = 0; i < RunCount; ++i)
+    {
+        grid = source;
+        auto start = Clock::now();
+        operation(grid);
+        total += std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    return total / RunCount;
+}
+
+static bool same(const VoxelGrid& a, const VoxelGrid& b)
+{
+    for (int z = 0; z < Size; ++z)
+    {
+        for (int y = 0; y < Size; ++y)
+        {
+            for (int x = 0; x < Size; ++x)
+            {
+                if (a.get({x, y, z}) != b.get({x, y, z}))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/// Compares a bulk operation with the equivalent loop of get() and set() calls.
+template <typename F, typename G>
+static void compare(const std::string& name, const VoxelGrid& source, double volume, F bulk, G baseline)
+{
+    VoxelGrid expected;
+    auto slow = measure(source, expected, baseline);
+    VoxelGrid grid;
+    auto fast = measure(source, grid, bulk);
+
+    CUBOS_INFO("{}: baseline {:.2f} ms ({:.0f} Mvoxels/s), bulk {:.2f} ms ({:.0f} Mvoxels/s), {:.1f}x faster{}", name,
+               slow * 1000.0, volume / slow / 1e6, fast * 1000.0, volume / fast / 1e6, slow / fast,
+               same(grid, expected) ? "" : ", grids don't match!");
+}
+
+/// Measures a bulk operation alone.
+template <typename F>
+static void report(const std::string& name, const VoxelGrid& source, double volume, F bulk)
+{
+    VoxelGrid grid;
+    auto time = measure(source, grid, bulk);
+    CUBOS_INFO("{}: {:.2f} ms ({:.0f} Mvoxels/s)", name, time * 1000.0, volume / time / 1e6);
+}
+
+/// Compares the bulk operations of grids with editing them voxel by voxel.
+int main()
+{
+    cubos::core::initializeLogger();
+
+    auto source = terrain();
+    auto volume = static_cast<double>(Size) * Size * Size;
+
+    // Palette conversions used to look up a hash map for each voxel.
+    std::vector<uint16_t> lut(256);
+    std::unordered_map<uint16_t, uint16_t> map;
+    for (std::size_t i = 0; i < lut.size(); ++i)
+    {
+        lut[i] = static_cast<uint16_t>(lut.size() - i);
+        map[static_cast<uint16_t>(i)] = lut[i];
+    }
+    compare(
+        "remap", source, volume, [&](VoxelGrid& grid) { grid.remap(lut); },
+        [&](VoxelGrid& grid) {
+            for (int z = 0; z < Size; ++z)
+            {
+                for (int y = 0; y < Size; ++y)
+                {
+                    for (int x = 0; x < Size; ++x)
+                    {
+                        grid.set({x, y, z}, map.at(grid.get({x, y, z})));
+                    }
+                }
+            }
+        });
+
+    report("clear", source, volume, [](VoxelGrid& grid) { grid.clear(); });
+
+    glm::ivec3 min{Size / 8};
+    glm::ivec3 max{Size - Size / 8};
+    auto box = static_cast<double>(max.x - min.x) * (max.y - min.y) * (max.z - min.z);
+    compare(
+        "fill", source, box, [&](VoxelGrid& grid) { grid.fill(min, max, 7); },
+        [&](VoxelGrid& grid) {
+            for (int z = min.z; z < max.z; ++z)
+            {
+                for (int y = min.y; y < max.y; ++y)
+                {
+                    for (int x = min.x; x < max.x; ++x)
+                    {
+                        grid.set({x, y, z}, 7);
+                    }
+                }
+            }
+        });
+
+    glm::vec3 center{Size / 2.0F};
+    float radius = Size / 3.0F;
+    auto ball = 4.0 / 3.0 * 3.14159265 * radius * radius * radius;
+    compare(
+        "fillSphere", source, ball, [&](VoxelGrid& grid) { grid.fillSphere(center, radius, 9); },
+        [&](VoxelGrid& grid) {
+            for (int z = 0; z < Size; ++z)
+            {
+                for (int y = 0; y < Size; ++y)
+                {
+                    for (int x = 0; x < Size; ++x)
+                    {
+                        glm::vec3 d = glm::vec3{x, y, z} + 0.5F - center;
+                        if (d.x * d.x + (d.y * d.y + d.z * d.z) <= radius * radius)
+                        {
+                            grid.set({x, y, z}, 9);
+                        }
+                    }
+                }
+            }
+        });
+
+    // Copy the bottom half of the grid onto its top half.
+    glm::ivec3 half{Size, Size / 2, Size};
+    glm::ivec3 up{0, Size / 2, 0};
+    compare(
+        "copyRegion", source, volume / 2.0,
+        [&](VoxelGrid& grid) { grid.copyRegion(source, glm::ivec3{0}, half, up); },
+        [&](VoxelGrid& grid) {
+            for (int z = 0; z < half.z; ++z)
+            {
+                for (int y = 0; y < half.y; ++y)
+                {
+                    for (int x = 0; x < half.x; ++x)
+                    {
+                        grid.set(glm::ivec3{x, y, z} + up, source.get({x, y, z}));
+                    }
+                }
+            }
+        });
+
+    // Combine the grid with a shifted copy of itself.
+    glm::ivec3 offset{Size / 4, 0, Size / 4};
+    report("unite", source, volume, [&](VoxelGrid& grid) { grid.unite(source, offset); });
+    report("subtract", source, volume, [&](VoxelGrid& grid) { grid.subtract(source, offset); });
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/random.hpp>
+
+#include <cubos/core/data/old/binary_deserializer.hpp>
+#include <cubos/core/data/old/binary_serializer.hpp>
+#include <cubos/core/log.hpp>
+#include <cubos/core/memory/buffer_stream.hpp>
+#include <cubos/core/memory/standard_stream.hpp>
+
+#include <cubos/engine/voxels/compressed_grid.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+using cubos::core::data::old::BinaryDeserializer;
+using cubos::core::data::old::BinarySerializer;
+using cubos::core::memory::BufferStream;
+using cubos::core::memory::StandardStream;
+
+using namespace cubos::engine;
+
+/// Number of times each grid is decoded.
+static constexpr int DecodeCount = 10;
+
+/// Number of voxels read at random positions.
+static constexpr std::size_t RandomReads = 1000000;
+
+using Clock = std::chrono::steady_clock;
+
+static double millis(Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+/// Gets the size of a value once binary serialized.
+template <typename T>
+static std::size_t serializedSize(const T& value)
+{
+    BufferStream stream{};
+    BinarySerializer serializer{stream};
+    serializer.write(value, nullptr);
+    return stream.tell();
+}
+
+/// Rolling hills with layers of grass, dirt and stone, and a few scattered ores.
+static VoxelGrid terrain()
+{
+    VoxelGrid grid{{256, 128, 256}};
+    for (int z = 0; z < 256; ++z)
+    {
+        for (int x = 0; x < 256; ++x)
+        {
+            auto height = static_cast<int>(64.0F + 20.0F * std::sin(static_cast<float>(x) * 0.05F) *
+                                                      std::cos(static_cast<float>(z) * 0.04F));
+            for (int y = 0; y < height; ++y)
+            {
+                auto mat = static_cast<uint16_t>(y == height - 1 ? 1 : (y > height - 5 ? 2 : 3));
+                if (mat == 3 && glm::linearRand(0.0F, 1.0F) < 0.01F)
+                {
+                    mat = 4;
+                }
+                grid.set({x, y, z}, mat);
+            }
+        }
+    }
+    return grid;
+}
+
+/// Hollow sphere painted with a few bands of colors, like a typical hand made model.
+static VoxelGrid sphere()
+{
+    VoxelGrid grid{{128, 128, 128}};
+    for (int z = 0; z < 128; ++z)
+    {
+        for (int y = 0; y < 128; ++y)
+        {
+            for (int x = 0; x < 128; ++x)
+            {
+                auto distance = glm::length(glm::vec3{x, y, z} - 63.5F);
+                if (distance < 60.0F && distance > 54.0F)
+                {
+                    grid.set({x, y, z}, static_cast<uint16_t>(1 + y / 22));
+                }
+            }
+        }
+    }
+    return grid;
+}
+
+/// Random materials, which is the worst case for compression.
+static VoxelGrid noise()
+{
+    VoxelGrid grid{{64, 64, 64}};
+    for (int z = 0; z < 64; ++z)
+    {
+        for (int y = 0; y < 64; ++y)
+        {
+            for (int x = 0; x < 64; ++x)
+            {
+                grid.set({x, y, z}, static_cast<uint16_t>(glm::linearRand(0, 200)));
+            }
+        }
+    }
+    return grid;
+}
+
+static bool load(const std::string& path, VoxelGrid& grid)
+{
+    auto* file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    auto stream = StandardStream(file, true);
+    BinaryDeserializer deserializer{stream};
+    deserializer.read(grid);
+    return !deserializer.failed();
+}
+
+static void measure(const std::string& name, const VoxelGrid& grid)
+{
+    auto size = grid.size();
+    auto volume = static_cast<std::size_t>(size.x) * size.y * size.z;
+
+    auto start = Clock::now();
+    CompressedVoxelGrid compressed{grid};
+    auto encode = Clock::now() - start;
+
+    // Check that the grid survives the round trip before measuring anything else.
+    auto decoded = compressed.decode();
+    std::size_t mismatches = 0;
+    for (int z = 0; z < static_cast<int>(size.z); ++z)
+    {
+        for (int y = 0; y < static_cast<int>(size.y); ++y)
+        {
+            for (int x = 0; x < static_cast<int>(size.x); ++x)
+            {
+                mismatches += decoded.get({x, y, z}) != grid.get({x, y, z}) ? 1 : 0;
+            }
+        }
+    }
+
+    start = Clock::now();
+    for (int i = 0; i < DecodeCount; ++i)
+    {
+        decoded = compressed.decode();
+    }
+    auto decode = (Clock::now() - start) / DecodeCount;
+
+    // Read the same random voxels from both grids. The sums keep the reads from being optimized
+    // away, and should match.
+    std::vector<glm::ivec3> positions(RandomReads);
+    for (auto& position : positions)
+    {
+        position = glm::linearRand(glm::ivec3{0}, glm::ivec3{size} - 1);
+    }
+
+    std::size_t compressedSum = 0;
+    start = Clock::now();
+    for (const auto& position : positions)
+    {
+        compressedSum += compressed.get(position);
+    }
+    auto compressedReads = Clock::now() - start;
+
+    std::size_t denseSum = 0;
+    start = Clock::now();
+    for (const auto& position : positions)
+    {
+        denseSum += grid.get(position);
+    }
+    auto denseReads = Clock::now() - start;
+
+    auto dense = serializedSize(grid);
+    auto packed = serializedSize(compressed);
+    CUBOS_INFO("{} ({}x{}x{}): {} bytes dense, {} bytes compressed ({:.1f}x), {} bytes in memory", name, size.x, size.y,
+               size.z, dense, packed, static_cast<double>(dense) / static_cast<double>(packed), compressed.memory());
+    CUBOS_INFO("  encode {:.2f} ms, decode {:.2f} ms ({:.0f} Mvoxels/s)", millis(encode), millis(decode),
+               static_cast<double>(volume) / millis(decode) / 1000.0);
+    CUBOS_INFO("  random get {:.1f} ns compressed, {:.1f} ns dense{}",
+               millis(compressedReads) * 1e6 / static_cast<double>(RandomReads),
+               millis(denseReads) * 1e6 / static_cast<double>(RandomReads),
+               compressedSum == denseSum ? "" : ", reads don't match!");
+    if (mismatches != 0)
+    {
+        CUBOS_ERROR("  {} voxels changed after decoding!", mismatches);
+    }
+}
+
+/// Measures the compression ratio, encode and decode times of the given .grd files, or of a few
+/// generated grids if none is given.
+int main(int argc, char** argv)
+{
+    cubos::core::initializeLogger();
+
+    if (argc < 2)
+    {
+        measure("terrain", terrain());
+        measure("sphere", sphere());
+        measure("noise", noise());
+        return 0;
+    }
+
+    for (int i = 1; i < argc; ++i)
+    {
+        VoxelGrid grid;
+        if (!load(argv[i], grid))
+        {
+            CUBOS_ERROR("Could not load grid {}", argv[i]);
+            return 1;
+        }
+
+        measure(argv[i], grid);
+    }
+
+    return 0;
+}
@@ -0,0 +1,273 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/gtc/random.hpp>
+
+#include <cubos/core/data/old/binary_deserializer.hpp>
+#include <cubos/core/log.hpp>
+#include <cubos/core/memory/arena_allocator.hpp>
+#include <cubos/core/memory/standard_stream.hpp>
+
+#include <cubos/engine/renderer/vertex.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+using cubos::core::data::old::BinaryDeserializer;
+using cubos::core::memory::ArenaAllocator;
+using cubos::core::memory::StandardStream;
+
+using namespace cubos::engine;
+
+/// Number of times each grid is triangulated by each function.
+static constexpr int RunCount = 5;
+
+using Clock = std::chrono::steady_clock;
+
+/// Rolling hills with layers of grass, dirt and stone.
+static VoxelGrid terrain()
+{
+    VoxelGrid grid{{256, 128, 256}};
+    for (int z = 0; z < 256; ++z)
+    {
+        for (int x = 0; x < 256; ++x)
+        {
+            auto height = static_cast<int>(64.0F + 20.0F * std::sin(static_cast<float>(x) * 0.05F) *
+                                                      std::cos(static_cast<float>(z) * 0.04F));
+            for (int y = 0; y < height; ++y)
+            {
+                grid.set({x, y, z}, static_cast<uint16_t>(y == height - 1 ? 1 : (y > height - 5 ? 2 : 3)));
+            }
+        }
+    }
+    return grid;
+}
+
+/// Hollow sphere painted with a few bands of colors, like a typical hand made model.
+static VoxelGrid sphere()
+{
+    VoxelGrid grid{{128, 128, 128}};
+    for (int z = 0; z < 128; ++z)
+    {
+        for (int y = 0; y < 128; ++y)
+        {
+            for (int x = 0; x < 128; ++x)
+            {
+                auto distance = glm::length(glm::vec3{x, y, z} - 63.5F);
+                if (distance < 60.0F && distance > 54.0F)
+                {
+                    grid.set({x, y, z}, static_cast<uint16_t>(1 + y / 22));
+                }
+            }
+        }
+    }
+    return grid;
+}
+
+/// Randomly filled voxels, which is the worst case for meshing.
+static VoxelGrid noise()
+{
+    VoxelGrid grid{{64, 64, 64}};
+    for (int z = 0; z < 64; ++z)
+    {
+        for (int y = 0; y < 64; ++y)
+        {
+            for (int x = 0; x < 64; ++x)
+            {
+                if (glm::linearRand(0.0F, 1.0F) < 0.5F)
+                {
+                    grid.set({x, y, z}, static_cast<uint16_t>(glm::linearRand(1, 4)));
+                }
+            }
+        }
+    }
+    return grid;
+}
+
+static bool load(const std::string& path, VoxelGrid& grid)
+{
+    auto* file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    auto stream = StandardStream(file, true);
+    BinaryDeserializer deserializer{stream};
+    deserializer.read(grid);
+    return !deserializer.failed();
+}
+
+/// Gets the average time, in seconds, taken by a triangulation function on a grid.
+template <typename F>
+static double measure(F function, const VoxelGrid& grid, std::vector<VoxelVertex>& vertices,
+                      std::vector<uint32_t>& indices)
+{
+    auto start = Clock::now();
+    for (int i = 0; i < RunCount; ++i)
+    {
+        vertices.clear();
+        indices.clear();
+        function(grid, vertices, indices);
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count() / RunCount;
+}
+
+/// Memory resource which counts the allocations it forwards to the heap.
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    std::size_t allocations = 0;
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        allocations += 1;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+/// Gets the average number of heap allocations made for scratch memory by each triangulation of
+/// every chunk of a grid, as done by the renderer, with the scratch memory taken either straight
+/// from the heap or from an arena reused between triangulations.
+static std::pair<double, double> scratchAllocations(const VoxelGrid& grid)
+{
+    std::vector<VoxelVertex> vertices;
+    std::vector<uint32_t> indices;
+    CountingResource heap;
+    CountingResource upstream;
+    ArenaAllocator arena{64 * 1024, &upstream};
+
+    auto size = grid.size();
+    auto chunkSize = static_cast<unsigned int>(VoxelGrid::ChunkSize);
+    auto triangulateChunks = [&](std::pmr::memory_resource* scratch) {
+        vertices.clear();
+        indices.clear();
+        for (unsigned int z = 0; z < size.z; z += chunkSize)
+        {
+            for (unsigned int y = 0; y < size.y; y += chunkSize)
+            {
+                for (unsigned int x = 0; x < size.x; x += chunkSize)
+                {
+                    glm::uvec3 min{x, y, z};
+                    arena.reset();
+                    binaryTriangulate(grid, min, glm::min(min + chunkSize, size), vertices, indices, scratch);
+                }
+            }
+        }
+    };
+
+    for (int i = 0; i < RunCount; ++i)
+    {
+        triangulateChunks(&heap);
+        triangulateChunks(&arena);
+    }
+
+    return {static_cast<double>(heap.allocations) / RunCount, static_cast<double>(upstream.allocations) / RunCount};
+}
+
+/// Gets the number of vertices of the meshes of each chunk of a grid, as drawn by the renderer.
+static std::size_t chunkedVertexCount(const VoxelGrid& grid)
+{
+    std::vector<VoxelVertex> vertices;
+    std::vector<uint32_t> indices;
+    auto size = grid.size();
+    auto chunkSize = static_cast<unsigned int>(VoxelGrid::ChunkSize);
+    for (unsigned int z = 0; z < size.z; z += chunkSize)
+    {
+        for (unsigned int y = 0; y < size.y; y += chunkSize)
+        {
+            for (unsigned int x = 0; x < size.x; x += chunkSize)
+            {
+                glm::uvec3 min{x, y, z};
+                binaryTriangulate(grid, min, glm::min(min + chunkSize, size), vertices, indices);
+            }
+        }
+    }
+    return vertices.size();
+}
+
+static void compare(const std::string& name, const VoxelGrid& grid)
+{
+    auto size = grid.size();
+    auto volume = static_cast<double>(size.x) * size.y * size.z;
+
+    std::vector<VoxelVertex> expectedVertices;
+    std::vector<uint32_t> expectedIndices;
+    auto scalar = measure([](const VoxelGrid& g, auto& v, auto& i) { triangulate(g, v, i); }, grid, expectedVertices,
+                          expectedIndices);
+
+    std::vector<VoxelVertex> vertices;
+    std::vector<uint32_t> indices;
+    auto binary =
+        measure([](const VoxelGrid& g, auto& v, auto& i) { binaryTriangulate(g, v, i); }, grid, vertices, indices);
+
+    bool same = vertices.size() == expectedVertices.size() && indices == expectedIndices;
+    for (std::size_t i = 0; same && i < vertices.size(); ++i)
+    {
+        same = vertices[i].position == expectedVertices[i].position &&
+               vertices[i].normal == expectedVertices[i].normal &&
+               vertices[i].material == expectedVertices[i].material;
+    }
+
+    CUBOS_INFO("{} ({}x{}x{}, {} quads): triangulate {:.2f} ms ({:.0f} Mvoxels/s), binaryTriangulate {:.2f} ms "
+               "({:.0f} Mvoxels/s), {:.1f}x faster{}",
+               name, size.x, size.y, size.z, indices.size() / 6, scalar * 1000.0, volume / scalar / 1e6,
+               binary * 1000.0, volume / binary / 1e6, scalar / binary, same ? "" : ", meshes don't match!");
+
+    // Meshing each chunk separately adds some vertices along the chunk edges, which is more than
+    // compensated by packing them.
+    auto chunked = chunkedVertexCount(grid);
+    auto unpackedBytes = vertices.size() * sizeof(VoxelVertex);
+    auto packedBytes = chunked * sizeof(PackedVoxelVertex);
+    CUBOS_INFO("  vertex memory: {} KiB as VoxelVertex ({} vertices), {} KiB as PackedVoxelVertex in chunks ({} "
+               "vertices), {:.1f}x smaller",
+               unpackedBytes / 1024, vertices.size(), packedBytes / 1024, chunked,
+               static_cast<double>(unpackedBytes) / static_cast<double>(packedBytes));
+
+    auto [heapAllocations, arenaAllocations] = scratchAllocations(grid);
+    CUBOS_INFO("  scratch allocations per chunked triangulation: {:.1f} from the heap, {:.1f} through an arena",
+               heapAllocations, arenaAllocations);
+}
+
+/// Compares the speed of both triangulation functions on the given .grd files, or on a few
+/// generated grids if none is given.
+int main(int argc, char** argv)
+{
+    cubos::core::initializeLogger();
+
+    if (argc < 2)
+    {
+        compare("terrain", terrain());
+        compare("sphere", sphere());
+        compare("noise", noise());
+        return 0;
+    }
+
+    for (int i = 1; i < argc; ++i)
+    {
+        VoxelGrid grid;
+        if (!load(argv[i], grid))
+        {
+            CUBOS_ERROR("Could not load grid {}", argv[i]);
+            return 1;
+        }
+
+        compare(argv[i], grid);
+    }
+
+    return 0;
+}
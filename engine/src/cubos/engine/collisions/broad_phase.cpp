@@ -1,6 +1,98 @@
+#include <cmath>
+
 #include "broad_phase.hpp"
 
 using CollisionType = BroadPhaseCollisions::CollisionType;
+using Method = BroadPhaseCollisions::Method;
+
+/// @brief Number of colliders whose AABBs are computed together.
+static constexpr std::size_t Width = 8;
+
+namespace
+{
+    /// @brief Batch of colliders whose world AABBs are computed together, laid out as structures of arrays.
+    ///
+    /// The world AABB of a box is centered on its transformed center, and its half size along each world axis is the
+    /// sum of the half sizes of the box scaled by the absolute values of the matching row of the rotation and scale
+    /// matrix. That's the same result as transforming its corners and taking their maximum, but it's a loop over the
+    /// lanes which neither branches nor reads from other lanes, so the compiler can turn it into SIMD instructions.
+    struct AABBBatch
+    {
+        float matrix[3][3][Width];   ///< Rotation and scale of each collider's transform, by column and row.
+        float translation[3][Width]; ///< Translation of each collider's transform.
+        float center[3][Width];      ///< Center of each collider's local AABB.
+        float halfSize[3][Width];    ///< Half size of each collider's local AABB.
+        float margin[Width];         ///< Margin of each collider.
+        float min[3][Width];         ///< Minimum corner of each collider's world AABB.
+        float max[3][Width];         ///< Maximum corner of each collider's world AABB.
+        Collider* colliders[Width];  ///< Collider of each lane.
+
+        /// @brief Sets the collider of a lane, whose world transform must be up to date.
+        /// @param lane Lane.
+        /// @param collider Collider.
+        void set(std::size_t lane, Collider* collider)
+        {
+            const auto& transform = collider->worldTransform;
+            auto center = collider->localAABB.center();
+            auto halfSize = collider->localAABB.max() - center;
+            for (glm::length_t row = 0; row < 3; ++row)
+            {
+                for (glm::length_t column = 0; column < 3; ++column)
+                {
+                    matrix[column][row][lane] = transform[column][row];
+                }
+
+                translation[row][lane] = transform[3][row];
+                this->center[row][lane] = center[row];
+                this->halfSize[row][lane] = halfSize[row];
+            }
+
+            margin[lane] = collider->margin;
+            colliders[lane] = collider;
+        }
+
+        /// @brief Computes the world AABBs of every lane.
+        void compute()
+        {
+            for (std::size_t row = 0; row < 3; ++row)
+            {
+                float position[Width];
+                float extent[Width];
+                for (std::size_t l = 0; l < Width; ++l)
+                {
+                    position[l] = translation[row][l];
+                    extent[l] = margin[l];
+                }
+
+                for (std::size_t column = 0; column < 3; ++column)
+                {
+                    for (std::size_t l = 0; l < Width; ++l)
+                    {
+                        position[l] += matrix[column][row][l] * center[column][l];
+                        extent[l] += std::abs(matrix[column][row][l]) * halfSize[column][l];
+                    }
+                }
+
+                for (std::size_t l = 0; l < Width; ++l)
+                {
+                    min[row][l] = position[l] - extent[l];
+                    max[row][l] = position[l] + extent[l];
+                }
+            }
+        }
+
+        /// @brief Stores the computed world AABBs in the colliders of the first lanes.
+        /// @param count Number of lanes in use.
+        void store(std::size_t count) const
+        {
+            for (std::size_t l = 0; l < count; ++l)
+            {
+                colliders[l]->worldAABB.min({min[0][l], min[1][l], min[2][l]});
+                colliders[l]->worldAABB.max({max[0][l], max[1][l], max[2][l]});
+            }
+        }
+    };
+} // namespace
 
 void setupNewBoxes(Query<Read<BoxCollisionShape>, Write<Collider>> query, Write<BroadPhaseCollisions> collisions)
 {
@@ -8,7 +100,7 @@ void setupNewBoxes(Query<Read<BoxCollisionShape>, Write<Collider>> query, Write<
     {
         if (collider->fresh)
         {
-            collisions->addEntity(entity);
+            collisions->addEntity(entity, collider->isStatic);
 
             shape->box.diag(collider->localAABB.diag);
 
@@ -21,94 +113,306 @@ void setupNewBoxes(Query<Read<BoxCollisionShape>, Write<Collider>> query, Write<
 
 void setupNewCapsules(Query<Read<CapsuleCollisionShape>, Write<Collider>> query, Write<BroadPhaseCollisions> collisions)
 {
-    (void)query;
-    (void)collisions;
+    for (auto [entity, shape, collider] : query)
+    {
+        if (collider->fresh)
+        {
+            collisions->addEntity(entity, collider->isStatic);
+
+            collider->localAABB = shape->capsule.aabb();
+
+            // Capsules have no sharp edges.
+            collider->margin = 0.0F;
+
+            collider->fresh = false;
+        }
+    }
+}
+
+void setupVoxels(Query<Write<VoxelCollisionShape>, Write<Collider>> query, Read<Assets> assets,
+                 Write<VoxelOccupancyCache> cache, Write<BroadPhaseCollisions> collisions)
+{
+    bool changed = false;
+    for (auto [entity, shape, collider] : query)
+    {
+        if (assets->update(shape->grid) || shape->occupancy == nullptr)
+        {
+            shape->occupancy = cache->get(*assets, shape->grid);
+            changed = true;
+
+            // The grid spans from the offset to the offset plus its size, in voxels.
+            collider->localAABB.min(shape->offset);
+            collider->localAABB.max(shape->offset + glm::vec3{shape->occupancy->size()});
+
+            // Wake the collider up and make sure its world AABB is recomputed, even if it's static.
+            collider->worldTransform = glm::mat4{0.0F};
+            collisions->wake(entity);
+        }
+
+        if (collider->fresh)
+        {
+            collisions->addEntity(entity, collider->isStatic);
+
+            collider->margin = 0.04F;
+
+            collider->fresh = false;
+        }
+    }
+
+    if (changed)
+    {
+        cache->prune();
+    }
 }
 
-void updateAABBs(Query<Read<LocalToWorld>, Write<Collider>> query)
+void updateAABBs(Query<OptRead<LocalToWorld>, Write<Collider>> query, Write<BroadPhaseCollisions> collisions)
 {
-    for (auto [entity, localToWorld, collider] : query)
+    auto& state = *collisions;
+    state.movedEntities.clear();
+    state.restingChanged = false;
+
+    for (auto entity : state.wakeRequests)
     {
-        // Get the 4 points of the collider.
-        glm::vec3 corners[4];
-        collider->localAABB.box().corners4(corners);
+        if (auto components = query[entity])
+        {
+            auto [localToWorld, collider] = *components;
+            collider->idleFrames = 0;
+            if (collider->sleeping)
+            {
+                collider->sleeping = false;
+                state.awakeEntities.push_back(entity);
+                state.restingChanged = true;
+            }
+        }
+    }
+
+    state.wakeRequests.clear();
 
-        // Pack the 3 points of the collider into a matrix.
-        auto points = glm::mat4{glm::vec4{corners[0], 1.0F}, glm::vec4{corners[1], 1.0F}, glm::vec4{corners[2], 1.0F},
-                                glm::vec4{corners[3], 1.0F}};
+    // Only awake colliders are visited, so sleeping and static ones cost nothing until woken up. The
+    // colliders which moved are gathered into batches, whose AABBs are computed together.
+    AABBBatch batch{};
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < state.awakeEntities.size();)
+    {
+        auto entity = state.awakeEntities[i];
+        auto components = query[entity];
+        if (!components)
+        {
+            // The collider was removed.
+            state.awakeEntities[i] = state.awakeEntities.back();
+            state.awakeEntities.pop_back();
+            continue;
+        }
+
+        auto [localToWorld, collider] = *components;
+        if (!localToWorld)
+        {
+            i += 1;
+            continue;
+        }
 
         // Transforms collider space to world space.
         auto transform = localToWorld->mat * collider->transform;
 
-        // Only want scale and rotation, extract translation and remove it.
-        auto translation = glm::vec3{transform[3]};
-        transform[3] = glm::vec4{0.0F, 0.0F, 0.0F, 1.0F};
+        // If the collider didn't move, neither did its AABB. Static colliders fall asleep right
+        // after their AABB is first computed.
+        if (transform == collider->worldTransform)
+        {
+            collider->idleFrames += 1;
+            if (collider->isStatic || collider->idleFrames >= state.sleepFrames)
+            {
+                collider->sleeping = true;
+                state.restingChanged = true;
+                state.awakeEntities[i] = state.awakeEntities.back();
+                state.awakeEntities.pop_back();
+                continue;
+            }
 
-        // Rotate and scale corners.
-        auto rotatedCorners = glm::mat4x3{transform * points};
+            i += 1;
+            continue;
+        }
 
-        // Get the max of the rotated corners.
-        auto max = glm::max(glm::abs(rotatedCorners[0]), glm::abs(rotatedCorners[1]));
-        max = glm::max(max, glm::abs(rotatedCorners[2]));
-        max = glm::max(max, glm::abs(rotatedCorners[3]));
+        collider->idleFrames = 0;
+        collider->worldTransform = transform;
+        state.movedEntities.push_back(entity);
+        i += 1;
 
-        // Add the collider's margin.
-        max += glm::vec3{collider->margin};
+        batch.set(count, &*collider);
+        count += 1;
+        if (count == Width)
+        {
+            batch.compute();
+            batch.store(count);
+            count = 0;
+        }
+    }
 
-        // Set the AABB.
-        collider->worldAABB.min(translation - max);
-        collider->worldAABB.max(translation + max);
-    };
+    if (count > 0)
+    {
+        batch.compute();
+        batch.store(count);
+    }
 }
 
 void updateMarkers(Query<Read<Collider>> query, Write<BroadPhaseCollisions> collisions)
 {
-    // TODO: This is parallelizable.
-    for (glm::length_t axis = 0; axis < 3; axis++)
-    {
-        // TODO: Should use insert sort to leverage spatial coherence.
-        std::sort(
-            collisions->markersPerAxis[axis].begin(), collisions->markersPerAxis[axis].end(),
-            [axis, &query](const BroadPhaseCollisions::SweepMarker& a, const BroadPhaseCollisions::SweepMarker& b) {
-                auto [aCollider] = query[a.entity].value();
-                auto [bCollider] = query[b.entity].value();
-                auto aPos = a.isMin ? aCollider->worldAABB.min() : aCollider->worldAABB.max();
-                auto bPos = b.isMin ? bCollider->worldAABB.min() : bCollider->worldAABB.max();
-                return aPos[axis] < bPos[axis];
-            });
+    if (collisions->method != Method::SweepAndPrune)
+    {
+        return;
+    }
+
+    // Cache the AABBs of the colliders which moved, so that the sort doesn't have to look up
+    // colliders. The markers of every other collider are still in place.
+    auto& state = *collisions;
+    for (auto entity : state.movedEntities)
+    {
+        auto [collider] = query[entity].value();
+        const auto& aabb = collider->worldAABB;
+        state.bounds[entity.index] = aabb;
+        for (glm::length_t axis = 0; axis < 3; ++axis)
+        {
+            auto& markers = state.markersPerAxis[axis];
+            const auto& indices = state.markerIndicesPerAxis[axis];
+            markers[indices[BroadPhaseCollisions::markerSlot(entity, true)]].position = aabb.min()[axis];
+            markers[indices[BroadPhaseCollisions::markerSlot(entity, false)]].position = aabb.max()[axis];
+        }
     }
 }
 
 void sweep(Write<BroadPhaseCollisions> collisions)
 {
-    // TODO: This is parallelizable.
-    for (glm::length_t axis = 0; axis < 3; axis++)
+    if (collisions->method != Method::SweepAndPrune)
     {
-        CUBOS_ASSERT(collisions->activePerAxis[axis].empty(), "Last sweep entered an entity but never exited");
+        return;
+    }
 
-        collisions->sweepOverlapMaps[axis].clear();
+    // Moving many new markers into place one swap at a time would take quadratic time.
+    auto entities = collisions->markersPerAxis[0].size() / 2;
+    if (collisions->pendingEntities * 8 >= entities)
+    {
+        collisions->rebuildMarkers();
+    }
+    else
+    {
+        auto& state = *collisions;
+        state.parallelFor(3, [&state](std::size_t /*batch*/, std::size_t begin, std::size_t end) {
+            for (auto axis = begin; axis < end; axis++)
+            {
+                state.addedPerAxis[axis].clear();
+                state.removedPerAxis[axis].clear();
+                state.sortMarkers(static_cast<int>(axis), state.addedPerAxis[axis], state.removedPerAxis[axis]);
+            }
+        });
 
-        for (auto& marker : collisions->markersPerAxis[axis])
+        for (int axis = 0; axis < 3; axis++)
         {
-            if (marker.isMin)
+            for (const auto& pair : state.removedPerAxis[axis])
             {
-                for (const auto& other : collisions->activePerAxis[axis])
-                {
-                    collisions->sweepOverlapMaps[axis][marker.entity].push_back(other);
-                }
+                state.sweepPairs.erase(pair);
+            }
 
-                collisions->activePerAxis[axis].insert(marker.entity);
+            for (const auto& pair : state.addedPerAxis[axis])
+            {
+                state.sweepPairs.insert(pair);
             }
-            else
+        }
+    }
+
+    collisions->pendingEntities = 0;
+}
+
+void updateTree(Query<Read<Collider>> query, Write<BroadPhaseCollisions> collisions)
+{
+    if (collisions->method != Method::AABBTree)
+    {
+        return;
+    }
+
+    // Sleeping colliders keep their proxies, and only those of colliders which moved are refit.
+    auto& tree = collisions->tree;
+    collisions->movedProxies.clear();
+    for (auto entity : collisions->movedEntities)
+    {
+        auto [collider] = query[entity].value();
+        auto& proxy = collisions->proxies.at(entity);
+        if (proxy == DynamicAABBTree::Null)
+        {
+            proxy = tree.insert(collider->worldAABB, entity);
+            collisions->movedProxies.push_back(proxy);
+        }
+        else if (tree.move(proxy, collider->worldAABB))
+        {
+            collisions->movedProxies.push_back(proxy);
+        }
+    }
+
+    collisions->findTreePairs();
+}
+
+void updateSpatialHash(Query<Read<Collider>> query, Write<BroadPhaseCollisions> collisions)
+{
+    if (collisions->method != Method::SpatialHash)
+    {
+        return;
+    }
+
+    auto& state = *collisions;
+    auto isStaticPair = [&state](const auto& pair) { return state.bothStatic(pair.first, pair.second); };
+
+    // Sleeping colliders are kept in a grid of their own, which along with the pairs among them is
+    // only found again when a collider falls asleep or wakes up.
+    if (state.restingChanged)
+    {
+        state.restingHash.clear();
+        for (auto entity : state.hashedEntities)
+        {
+            auto [collider] = query[entity].value();
+            if (collider->sleeping)
             {
-                collisions->activePerAxis[axis].erase(marker.entity);
+                state.restingHash.insert(entity, collider->worldAABB);
             }
         }
+
+        state.restingHashPairs.clear();
+        state.restingHash.findPairs(state.restingHashPairs);
+        std::erase_if(state.restingHashPairs, isStaticPair);
+    }
+
+    // Only the awake colliders are put in the grid rebuilt every frame, and then looked up in the
+    // grid of sleeping colliders.
+    auto& grid = state.spatialHash;
+    grid.clear();
+    for (auto entity : state.awakeEntities)
+    {
+        auto [collider] = query[entity].value();
+        grid.insert(entity, collider->worldAABB);
     }
+
+    state.hashPairs.clear();
+    grid.findPairs(state.hashPairs);
+    for (auto entity : state.awakeEntities)
+    {
+        auto [collider] = query[entity].value();
+        state.restingQuery.clear();
+        state.restingHash.query(collider->worldAABB, state.restingQuery);
+        for (auto other : state.restingQuery)
+        {
+            state.hashPairs.emplace_back(entity, other);
+        }
+    }
+
+    std::erase_if(state.hashPairs, isStaticPair);
+    state.hashPairs.insert(state.hashPairs.end(), state.restingHashPairs.begin(), state.restingHashPairs.end());
 }
 
-CollisionType getCollisionType(bool box, bool capsule)
+CollisionType getCollisionType(bool box, bool capsule, bool voxel)
 {
+    // Voxel grids are only tested against boxes.
+    if (voxel)
+    {
+        return box && !capsule ? CollisionType::BoxVoxel : CollisionType::Count;
+    }
+
     if (box && capsule)
     {
         return CollisionType::BoxCapsule;
@@ -122,48 +426,83 @@ CollisionType getCollisionType(bool box, bool capsule)
     return CollisionType::CapsuleCapsule;
 }
 
-void findPairs(Query<OptRead<BoxCollisionShape>, OptRead<CapsuleCollisionShape>, Read<Collider>> query,
+void findPairs(Query<OptRead<BoxCollisionShape>, OptRead<CapsuleCollisionShape>, OptRead<VoxelCollisionShape>,
+                     Read<Collider>>
+                   query,
                Write<BroadPhaseCollisions> collisions)
 {
-    collisions->clearCandidates();
+    auto& state = *collisions;
+    state.clearCandidates();
 
-    for (glm::length_t axis = 0; axis < 3; axis++)
+    // Gather the pairs found by the broad phase in use into a single list, which can be split.
+    state.pairs.clear();
+    if (state.method == Method::SweepAndPrune)
+    {
+        state.pairs.assign(state.sweepPairs.begin(), state.sweepPairs.end());
+    }
+    else if (state.method == Method::AABBTree)
     {
-        for (auto& [entity, overlaps] : collisions->sweepOverlapMaps[axis])
+        state.pairs.assign(state.treePairs.begin(), state.treePairs.end());
+    }
+    else
+    {
+        for (const auto& [entity, other] : state.hashPairs)
         {
-            auto [box, capsule, collider] = query[entity].value();
-            for (auto& other : overlaps)
+            state.pairs.push_back(BroadPhaseCollisions::makeCandidate(entity, other));
+        }
+    }
+
+    // Pairs in the tree are only known to have overlapping fat AABBs.
+    bool checkAABBs = state.method == Method::AABBTree;
+
+    // Validate the pairs in batches, each writing to its own buffers.
+    state.batches.resize(state.threadCount);
+    auto batchCount =
+        state.parallelFor(state.pairs.size(), [&](std::size_t batch, std::size_t begin, std::size_t end) {
+            auto& buffers = state.batches[batch];
+            for (auto& candidates : buffers.candidatesPerType)
             {
-                auto [otherBox, otherCapsule, otherCollider] = query[other].value();
+                candidates.clear();
+            }
 
-                // TODO: Should this be inside the if statement?
-                auto type = getCollisionType(box || otherBox, capsule || otherCapsule);
+            buffers.restingPairs.clear();
 
-                switch (axis)
+            for (auto i = begin; i < end; ++i)
+            {
+                const auto& pair = state.pairs[i];
+                auto [box, capsule, voxel, collider] = query[pair.first].value();
+                auto [otherBox, otherCapsule, otherVoxel, otherCollider] = query[pair.second].value();
+                if (checkAABBs && !collider->worldAABB.overlaps(otherCollider->worldAABB))
                 {
-                case 0: // X
-                    if (collider->worldAABB.overlapsY(otherCollider->worldAABB) &&
-                        collider->worldAABB.overlapsZ(otherCollider->worldAABB))
-                    {
-                        collisions->addCandidate(type, {entity, other});
-                    }
-                    break;
-                case 1: // Y
-                    if (collider->worldAABB.overlapsX(otherCollider->worldAABB) &&
-                        collider->worldAABB.overlapsZ(otherCollider->worldAABB))
-                    {
-                        collisions->addCandidate(type, {entity, other});
-                    }
-                    break;
-                case 2: // Z
-                    if (collider->worldAABB.overlapsX(otherCollider->worldAABB) &&
-                        collider->worldAABB.overlapsY(otherCollider->worldAABB))
-                    {
-                        collisions->addCandidate(type, {entity, other});
-                    }
-                    break;
+                    continue;
                 }
+
+                if (collider->sleeping && otherCollider->sleeping)
+                {
+                    buffers.restingPairs.push_back(pair);
+                    continue;
+                }
+
+                auto type = getCollisionType(box || otherBox, capsule || otherCapsule, voxel || otherVoxel);
+                if (type == CollisionType::Count)
+                {
+                    continue;
+                }
+
+                buffers.candidatesPerType[static_cast<std::size_t>(type)].push_back(pair);
             }
+        });
+
+    for (std::size_t batch = 0; batch < batchCount; ++batch)
+    {
+        for (std::size_t type = 0; type < static_cast<std::size_t>(CollisionType::Count); ++type)
+        {
+            const auto& candidates = state.batches[batch].candidatesPerType[type];
+            state.candidatesPerType[type].insert(state.candidatesPerType[type].end(), candidates.begin(),
+                                                 candidates.end());
         }
+
+        const auto& resting = state.batches[batch].restingPairs;
+        state.restingPairs.insert(state.restingPairs.end(), resting.begin(), resting.end());
     }
-}
\ No newline at end of file
+}
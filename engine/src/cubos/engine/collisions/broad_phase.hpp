@@ -9,6 +9,8 @@
 #include <cubos/engine/collisions/collider.hpp>
 #include <cubos/engine/collisions/shapes/box.hpp>
 #include <cubos/engine/collisions/shapes/capsule.hpp>
+#include <cubos/engine/collisions/shapes/voxel.hpp>
+#include <cubos/engine/collisions/voxel_occupancy_cache.hpp>
 #include <cubos/engine/transform/plugin.hpp>
 
 using cubos::core::ecs::Commands;
@@ -17,11 +19,15 @@ using cubos::core::ecs::Query;
 using cubos::core::ecs::Read;
 using cubos::core::ecs::Write;
 
+using cubos::engine::Assets;
 using cubos::engine::BoxCollisionShape;
 using cubos::engine::BroadPhaseCollisions;
 using cubos::engine::CapsuleCollisionShape;
 using cubos::engine::Collider;
+using cubos::engine::DynamicAABBTree;
 using cubos::engine::LocalToWorld;
+using cubos::engine::VoxelCollisionShape;
+using cubos::engine::VoxelOccupancyCache;
 
 /// @brief Setups new box colliders.
 void setupNewBoxes(Query<Read<BoxCollisionShape>, Write<Collider>> query, Write<BroadPhaseCollisions> collisions);
@@ -30,19 +36,33 @@ void setupNewBoxes(Query<Read<BoxCollisionShape>, Write<Collider>> query, Write<
 void setupNewCapsules(Query<Read<CapsuleCollisionShape>, Write<Collider>> query,
                       Write<BroadPhaseCollisions> collisions);
 
-/// @brief Updates the AABBs of all colliders.
-void updateAABBs(Query<Read<LocalToWorld>, Write<Collider>> query);
+/// @brief Setups new voxel colliders, and refreshes the occupancy of those whose grid asset changed.
+void setupVoxels(Query<Write<VoxelCollisionShape>, Write<Collider>> query, Read<Assets> assets,
+                 Write<VoxelOccupancyCache> cache, Write<BroadPhaseCollisions> collisions);
 
-/// @brief Updates the sweep markers of all colliders.
+/// @brief Wakes up the colliders which were asked to, updates the AABBs of the awake colliders which moved, and puts
+/// to sleep those which didn't for a while.
+void updateAABBs(Query<OptRead<LocalToWorld>, Write<Collider>> query, Write<BroadPhaseCollisions> collisions);
+
+/// @brief Refreshes the positions cached in the sweep markers of the colliders which moved.
 void updateMarkers(Query<Read<Collider>> query, Write<BroadPhaseCollisions> collisions);
 
-/// @brief Performs a sweep of all colliders.
+/// @brief Moves the markers of the colliders which moved into place, updating the pairs of colliders which overlap.
 void sweep(Write<BroadPhaseCollisions> collisions);
 
+/// @brief Refits the AABB tree to the colliders which moved and finds the pairs whose fat AABBs overlap.
+void updateTree(Query<Read<Collider>> query, Write<BroadPhaseCollisions> collisions);
+
+/// @brief Rebuilds the spatial hash grid of the awake colliders and finds the overlapping pairs, including those with
+/// the sleeping colliders, whose grid is only rebuilt when one falls asleep or wakes up.
+void updateSpatialHash(Query<Read<Collider>> query, Write<BroadPhaseCollisions> collisions);
+
 /// @brief Finds all pairs of colliders which may be colliding.
 ///
 /// @details
 /// TODO: This query is disgusting. We need a way to find if a component is present without reading it.
 /// Maybe something like Commands but for reads?
-void findPairs(Query<OptRead<BoxCollisionShape>, OptRead<CapsuleCollisionShape>, Read<Collider>> query,
+void findPairs(Query<OptRead<BoxCollisionShape>, OptRead<CapsuleCollisionShape>, OptRead<VoxelCollisionShape>,
+                     Read<Collider>>
+                   query,
                Write<BroadPhaseCollisions> collisions);
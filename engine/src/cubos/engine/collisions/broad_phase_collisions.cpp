@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <limits>
+
 #include <cubos/core/log.hpp>
 
 #include <cubos/engine/collisions/broad_phase_collisions.hpp>
@@ -6,23 +9,107 @@ using cubos::core::ecs::Entity;
 
 using cubos::engine::BroadPhaseCollisions;
 
-void BroadPhaseCollisions::addEntity(Entity entity)
+BroadPhaseCollisions::BroadPhaseCollisions()
+    : sweepPairs(&pool)
+    , treePairs(&pool)
 {
-    for (auto& markers : markersPerAxis)
+    // Do nothing.
+}
+
+auto BroadPhaseCollisions::makeCandidate(Entity a, Entity b) -> Candidate
+{
+    if (a.index < b.index || (a.index == b.index && a.generation < b.generation))
+    {
+        return {a, b};
+    }
+
+    return {b, a};
+}
+
+void BroadPhaseCollisions::addEntity(Entity entity, bool isStatic)
+{
+    awakeEntities.push_back(entity);
+    if (staticEntities.size() <= entity.index)
+    {
+        staticEntities.resize(entity.index + 1);
+    }
+
+    staticEntities[entity.index] = isStatic;
+
+    if (method == Method::AABBTree)
+    {
+        proxies.emplace(entity, DynamicAABBTree::Null);
+        return;
+    }
+
+    if (method == Method::SpatialHash)
+    {
+        hashedEntities.push_back(entity);
+        return;
+    }
+
+    // Placing the markers after every other marker means the entity starts without overlaps,
+    // which keeps the pairs consistent with the marker order.
+    constexpr float End = std::numeric_limits<float>::infinity();
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        auto& markers = markersPerAxis[axis];
+        auto& indices = markerIndicesPerAxis[axis];
+        if (indices.size() <= markerSlot(entity, false))
+        {
+            indices.resize(markerSlot(entity, false) + 1);
+        }
+
+        indices[markerSlot(entity, true)] = markers.size();
+        markers.push_back({entity, true, End});
+        indices[markerSlot(entity, false)] = markers.size();
+        markers.push_back({entity, false, End});
+    }
+
+    if (bounds.size() <= entity.index)
     {
-        markers.push_back({entity, true});
-        markers.push_back({entity, false});
+        bounds.resize(entity.index + 1);
     }
+
+    pendingEntities += 1;
 }
 
 void BroadPhaseCollisions::removeEntity(Entity entity)
 {
-    for (auto& markers : markersPerAxis)
+    std::erase(awakeEntities, entity);
+    std::erase(movedEntities, entity);
+    std::erase(hashedEntities, entity);
+    restingChanged = true;
+
+    if (auto it = proxies.find(entity); it != proxies.end())
     {
-        markers.erase(std::remove_if(markers.begin(), markers.end(),
-                                     [entity](const SweepMarker& m) { return m.entity == entity; }),
-                      markers.end());
+        if (it->second != DynamicAABBTree::Null)
+        {
+            tree.remove(it->second);
+        }
+
+        proxies.erase(it);
+        std::erase_if(treePairs, [entity](const Candidate& pair) {
+            return pair.first == entity || pair.second == entity;
+        });
     }
+
+    // Only the markers after the entity's first marker change places.
+    auto isEntity = [entity](const SweepMarker& m) { return m.entity == entity; };
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        auto& markers = markersPerAxis[axis];
+        auto first = std::find_if(markers.begin(), markers.end(), isEntity);
+        if (first != markers.end())
+        {
+            auto index = static_cast<std::size_t>(first - markers.begin());
+            markers.erase(std::remove_if(first, markers.end(), isEntity), markers.end());
+            this->indexMarkers(axis, index);
+        }
+    }
+
+    std::erase_if(sweepPairs,
+                  [entity](const Candidate& pair) { return pair.first == entity || pair.second == entity; });
 }
 
 void BroadPhaseCollisions::clearEntities()
@@ -31,14 +118,176 @@ void BroadPhaseCollisions::clearEntities()
     {
         markers.clear();
     }
+
+    sweepPairs.clear();
+    pendingEntities = 0;
+    tree.clear();
+    proxies.clear();
+    treePairs.clear();
+    hashedEntities.clear();
+    awakeEntities.clear();
+    movedEntities.clear();
+    wakeRequests.clear();
+    restingChanged = true;
+}
+
+void BroadPhaseCollisions::wake(Entity entity)
+{
+    wakeRequests.push_back(entity);
+}
+
+bool BroadPhaseCollisions::bothStatic(Entity a, Entity b) const
+{
+    return a.index < staticEntities.size() && b.index < staticEntities.size() && staticEntities[a.index] &&
+           staticEntities[b.index];
+}
+
+void BroadPhaseCollisions::useThreads(std::size_t count)
+{
+    threadPool.reset();
+    threadCount = 1;
+    if (count > 1)
+    {
+        threadPool = std::make_unique<core::ThreadPool>(count);
+        threadCount = count;
+    }
+}
+
+void BroadPhaseCollisions::sortMarkers(int axis, CandidateList& added, CandidateList& removed)
+{
+    auto& markers = markersPerAxis[axis];
+    auto& indices = markerIndicesPerAxis[axis];
+
+    // Swaps the marker at the given index, which must come first, with the one before it.
+    auto swapBack = [&](std::size_t i) {
+        const auto& marker = markers[i];
+        const auto& other = markers[i - 1];
+        if (marker.isMin && !other.isMin)
+        {
+            // The marker's entity now starts before the other entity ends: they may have started
+            // overlapping, if they also overlap on the other axes.
+            if (bounds[marker.entity.index].overlaps(bounds[other.entity.index]) &&
+                !this->bothStatic(marker.entity, other.entity))
+            {
+                added.push_back(makeCandidate(marker.entity, other.entity));
+            }
+        }
+        else if (!marker.isMin && other.isMin)
+        {
+            // The marker's entity now ends before the other entity starts.
+            removed.push_back(makeCandidate(marker.entity, other.entity));
+        }
+
+        std::swap(markers[i], markers[i - 1]);
+        indices[markerSlot(markers[i].entity, markers[i].isMin)] = i;
+        indices[markerSlot(markers[i - 1].entity, markers[i - 1].isMin)] = i - 1;
+    };
+
+    // The markers which didn't move are still in order between themselves, so the whole axis is
+    // sorted once every moved marker is in order with its neighbours. A moved marker may stop next
+    // to another moved marker which isn't in place yet, so keep going until nothing moves.
+    bool swapped = true;
+    while (swapped)
+    {
+        swapped = false;
+        for (auto entity : movedEntities)
+        {
+            for (bool isMin : {true, false})
+            {
+                auto i = indices[markerSlot(entity, isMin)];
+                for (; i > 0 && markers[i].before(markers[i - 1]); --i)
+                {
+                    swapBack(i);
+                    swapped = true;
+                }
+
+                for (; i + 1 < markers.size() && markers[i + 1].before(markers[i]); ++i)
+                {
+                    swapBack(i + 1);
+                    swapped = true;
+                }
+            }
+        }
+    }
+}
+
+void BroadPhaseCollisions::rebuildMarkers()
+{
+    this->parallelFor(3, [this](std::size_t /*batch*/, std::size_t begin, std::size_t end) {
+        for (auto axis = begin; axis < end; ++axis)
+        {
+            std::sort(markersPerAxis[axis].begin(), markersPerAxis[axis].end(),
+                      [](const SweepMarker& a, const SweepMarker& b) { return a.before(b); });
+            this->indexMarkers(static_cast<int>(axis));
+        }
+    });
+
+    // Every pair overlaps on the X axis, so sweeping it alone is enough to find all of them.
+    sweepPairs.clear();
+    std::vector<core::ecs::Entity> active;
+    for (const auto& marker : markersPerAxis[0])
+    {
+        if (marker.isMin)
+        {
+            for (auto other : active)
+            {
+                if (bounds[marker.entity.index].overlaps(bounds[other.index]) &&
+                    !this->bothStatic(marker.entity, other))
+                {
+                    sweepPairs.insert(makeCandidate(marker.entity, other));
+                }
+            }
+
+            active.push_back(marker.entity);
+        }
+        else
+        {
+            active.erase(std::find(active.begin(), active.end(), marker.entity));
+        }
+    }
+}
+
+void BroadPhaseCollisions::indexMarkers(int axis, std::size_t first)
+{
+    const auto& markers = markersPerAxis[axis];
+    for (auto i = first; i < markers.size(); ++i)
+    {
+        markerIndicesPerAxis[axis][markerSlot(markers[i].entity, markers[i].isMin)] = i;
+    }
+}
+
+void BroadPhaseCollisions::findTreePairs()
+{
+    if (movedProxies.empty())
+    {
+        return;
+    }
+
+    // Fat AABBs only change when proxies are reinserted, so pairs may only have stopped
+    // overlapping if something moved.
+    std::erase_if(treePairs, [this](const Candidate& pair) {
+        return !tree.fatAABB(proxies.at(pair.first)).overlaps(tree.fatAABB(proxies.at(pair.second)));
+    });
+
+    for (int proxy : movedProxies)
+    {
+        auto entity = tree.entity(proxy);
+        tree.query(tree.fatAABB(proxy), [&](int other) {
+            if (other != proxy && !this->bothStatic(entity, tree.entity(other)))
+            {
+                treePairs.insert(makeCandidate(entity, tree.entity(other)));
+            }
+            return true;
+        });
+    }
 }
 
 void BroadPhaseCollisions::addCandidate(CollisionType type, Candidate candidate)
 {
-    candidatesPerType[static_cast<std::size_t>(type)].insert(candidate);
+    candidatesPerType[static_cast<std::size_t>(type)].push_back(candidate);
 }
 
-auto BroadPhaseCollisions::candidates(CollisionType type) const -> const std::unordered_set<Candidate, CandidateHash>&
+auto BroadPhaseCollisions::candidates(CollisionType type) const -> const CandidateList&
 {
     return candidatesPerType[static_cast<std::size_t>(type)];
 }
@@ -49,4 +298,6 @@ void BroadPhaseCollisions::clearCandidates()
     {
         candidates.clear();
     }
+
+    restingPairs.clear();
 }
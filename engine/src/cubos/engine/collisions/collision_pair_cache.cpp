@@ -0,0 +1,35 @@
+#include <cubos/engine/collisions/collision_pair_cache.hpp>
+
+using cubos::core::ecs::Entity;
+
+using cubos::engine::BroadPhaseCollisions;
+using cubos::engine::CollisionPairCache;
+
+void CollisionPairCache::beginFrame()
+{
+    mFrame += 1;
+}
+
+CollisionPairCache::Entry& CollisionPairCache::update(Entity entity, Entity other)
+{
+    auto& entry = mEntries[BroadPhaseCollisions::makeCandidate(entity, other)];
+    if (entry.frame != mFrame)
+    {
+        entry.wasTouching = entry.touching;
+        entry.touching = false;
+        entry.frame = mFrame;
+    }
+
+    return entry;
+}
+
+const CollisionPairCache::Entry* CollisionPairCache::find(Entity entity, Entity other) const
+{
+    auto it = mEntries.find(BroadPhaseCollisions::makeCandidate(entity, other));
+    return it == mEntries.end() ? nullptr : &it->second;
+}
+
+std::size_t CollisionPairCache::size() const
+{
+    return mEntries.size();
+}
@@ -0,0 +1,652 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <latch>
+#include <limits>
+#include <utility>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#include <cubos/engine/collisions/collision_world.hpp>
+
+#include "narrow_phase.hpp"
+
+using cubos::core::ecs::Entity;
+using cubos::core::geom::AABB;
+using cubos::core::geom::Box;
+using cubos::core::geom::Capsule;
+
+using cubos::engine::CollisionWorld;
+using cubos::engine::VoxelOccupancy;
+
+/// @brief Value below which a ray is considered parallel to an axis.
+static constexpr float Epsilon = 1e-6F;
+
+/// @brief Gets the point of a segment closest to a point.
+static glm::vec3 closestOnSegment(glm::vec3 start, glm::vec3 end, glm::vec3 point)
+{
+    auto segment = end - start;
+    float lengthSquared = glm::dot(segment, segment);
+    if (lengthSquared <= 0.0F)
+    {
+        return start;
+    }
+
+    return start + segment * glm::clamp(glm::dot(point - start, segment) / lengthSquared, 0.0F, 1.0F);
+}
+
+/// @brief Gets the point of a box closest to a point, which is the point itself if it's inside the box.
+static glm::vec3 closestOnBox(const OrientedBox& box, glm::vec3 point)
+{
+    auto closest = box.center;
+    for (int k = 0; k < 3; ++k)
+    {
+        float offset = glm::dot(point - box.center, box.axes[k]);
+        closest += box.axes[k] * glm::clamp(offset, -box.halfSize[k], box.halfSize[k]);
+    }
+    return closest;
+}
+
+/// @brief Intersects a ray with a box, using the slab test in the box's space.
+/// @param box Box.
+/// @param origin Origin of the ray.
+/// @param direction Normalized direction of the ray.
+/// @param maxDistance Maximum distance at which hits count.
+/// @param[out] distance Distance to the hit.
+/// @param[out] normal Normal of the box at the hit.
+/// @return Whether the ray hits the box.
+static bool raycastBox(const OrientedBox& box, glm::vec3 origin, glm::vec3 direction, float maxDistance,
+                       float& distance, glm::vec3& normal)
+{
+    float enter = 0.0F;
+    float exit = maxDistance;
+    int enterAxis = -1;
+    float enterSign = 0.0F;
+    for (int k = 0; k < 3; ++k)
+    {
+        float offset = glm::dot(origin - box.center, box.axes[k]);
+        float speed = glm::dot(direction, box.axes[k]);
+        if (std::abs(speed) < Epsilon)
+        {
+            // Parallel to the slab, so the ray is either always or never between its planes.
+            if (std::abs(offset) > box.halfSize[k])
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        // The ray enters through the negative face when moving forward along the axis.
+        float near = (-box.halfSize[k] - offset) / speed;
+        float far = (box.halfSize[k] - offset) / speed;
+        float sign = -1.0F;
+        if (near > far)
+        {
+            std::swap(near, far);
+            sign = 1.0F;
+        }
+
+        if (near > enter)
+        {
+            enter = near;
+            enterAxis = k;
+            enterSign = sign;
+        }
+
+        exit = std::min(exit, far);
+        if (enter > exit)
+        {
+            return false;
+        }
+    }
+
+    distance = enter;
+    normal = enterAxis < 0 ? -direction : box.axes[enterAxis] * enterSign;
+    return true;
+}
+
+/// @brief Intersects a ray with a capsule, as the union of a cylinder and two spheres.
+/// @param capsule Capsule.
+/// @param origin Origin of the ray.
+/// @param direction Normalized direction of the ray.
+/// @param maxDistance Maximum distance at which hits count.
+/// @param[out] distance Distance to the hit.
+/// @param[out] normal Normal of the capsule at the hit.
+/// @return Whether the ray hits the capsule.
+static bool raycastCapsule(const CapsuleSegment& capsule, glm::vec3 origin, glm::vec3 direction, float maxDistance,
+                           float& distance, glm::vec3& normal)
+{
+    float radiusSquared = capsule.radius * capsule.radius;
+    auto inside = origin - closestOnSegment(capsule.start, capsule.end, origin);
+    if (glm::dot(inside, inside) <= radiusSquared)
+    {
+        distance = 0.0F;
+        normal = -direction;
+        return true;
+    }
+
+    // The ray starts outside, so it first enters the capsule where it first enters any of its parts.
+    float best = std::numeric_limits<float>::infinity();
+
+    // Side of the cylinder, with every term scaled by the squared length of the axis to avoid normalizing it.
+    auto axis = capsule.end - capsule.start;
+    auto offset = origin - capsule.start;
+    float axisSquared = glm::dot(axis, axis);
+    float axisSpeed = glm::dot(axis, direction);
+    float axisOffset = glm::dot(axis, offset);
+    float a = axisSquared - axisSpeed * axisSpeed;
+    if (a > Epsilon * axisSquared)
+    {
+        float b = axisSquared * glm::dot(offset, direction) - axisOffset * axisSpeed;
+        float c = axisSquared * glm::dot(offset, offset) - axisOffset * axisOffset - radiusSquared * axisSquared;
+        float h = b * b - a * c;
+        if (h >= 0.0F)
+        {
+            float t = (-b - std::sqrt(h)) / a;
+            float along = axisOffset + t * axisSpeed;
+            if (t >= 0.0F && along > 0.0F && along < axisSquared)
+            {
+                best = t;
+            }
+        }
+    }
+
+    // Hemispheres.
+    for (auto center : {capsule.start, capsule.end})
+    {
+        auto toOrigin = origin - center;
+        float b = glm::dot(direction, toOrigin);
+        float h = b * b - (glm::dot(toOrigin, toOrigin) - radiusSquared);
+        if (h >= 0.0F && -b - std::sqrt(h) >= 0.0F)
+        {
+            best = std::min(best, -b - std::sqrt(h));
+        }
+    }
+
+    if (best == std::numeric_limits<float>::infinity() || best > maxDistance)
+    {
+        return false;
+    }
+
+    auto point = origin + direction * best;
+    distance = best;
+    normal = glm::normalize(point - closestOnSegment(capsule.start, capsule.end, point));
+    return true;
+}
+
+/// @brief Gets the range of voxels of a grid under the bounds of a box.
+/// @param inverse Transform from world space to the grid's space.
+/// @param box Box.
+/// @param[out] min Minimum voxel coordinates of the range, inclusive.
+/// @param[out] max Maximum voxel coordinates of the range, inclusive.
+static void voxelRange(const glm::mat4& inverse, const OrientedBox& box, glm::ivec3& min, glm::ivec3& max)
+{
+    auto center = glm::vec3{inverse * glm::vec4{box.center, 1.0F}};
+    auto extent = glm::vec3{0.0F};
+    for (int k = 0; k < 3; ++k)
+    {
+        extent += glm::abs(glm::vec3{inverse * glm::vec4{box.axes[k], 0.0F}}) * box.halfSize[k];
+    }
+
+    min = glm::ivec3{glm::floor(center - extent)};
+    max = glm::ivec3{glm::floor(center + extent)};
+}
+
+/// @brief Gets the axis-aligned box around a point which contains every point within a distance of it.
+/// @param point Point.
+/// @param distance Distance.
+/// @return Box.
+static OrientedBox aroundPoint(glm::vec3 point, float distance)
+{
+    return {point, {{1.0F, 0.0F, 0.0F}, {0.0F, 1.0F, 0.0F}, {0.0F, 0.0F, 1.0F}}, glm::vec3{distance}};
+}
+
+/// @brief Gets the box of a voxel of a grid in world space.
+/// @param transform Transform from the grid's space to world space.
+/// @param voxel Voxel coordinates.
+/// @return Box.
+static OrientedBox voxelBox(const glm::mat4& transform, glm::ivec3 voxel)
+{
+    auto voxelToWorld = transform;
+    voxelToWorld[3] = transform * glm::vec4{glm::vec3{voxel} + 0.5F, 1.0F};
+    return orientedBox(voxelToWorld, BoxCollisionShape{});
+}
+
+/// @brief Intersects a ray with a voxel grid, by walking its voxels in the grid's space. Affine transforms keep
+/// distances along the ray proportional, so they stay in world units.
+/// @param occupancy Occupancy of the grid.
+/// @param transform Transform from the grid's space to world space.
+/// @param origin Origin of the ray.
+/// @param direction Normalized direction of the ray.
+/// @param maxDistance Maximum distance at which hits count.
+/// @param[out] distance Distance to the hit.
+/// @param[out] normal Normal of the voxel at the hit.
+/// @return Whether the ray hits a solid voxel.
+static bool raycastVoxels(const VoxelOccupancy& occupancy, const glm::mat4& transform, glm::vec3 origin,
+                          glm::vec3 direction, float maxDistance, float& distance, glm::vec3& normal)
+{
+    auto inverse = glm::inverse(transform);
+    glm::ivec3 voxel;
+    glm::vec3 gridNormal;
+    auto gridOrigin = glm::vec3{inverse * glm::vec4{origin, 1.0F}};
+    auto gridDirection = glm::vec3{inverse * glm::vec4{direction, 0.0F}};
+    if (!occupancy.raycast(gridOrigin, gridDirection, maxDistance, voxel, distance, gridNormal))
+    {
+        return false;
+    }
+
+    // Normals are transformed by the inverse transpose, so that they stay perpendicular to the faces.
+    normal = gridNormal == glm::vec3{0.0F} ? -direction
+                                           : glm::normalize(glm::transpose(glm::mat3{inverse}) * gridNormal);
+    return true;
+}
+
+/// @brief Checks whether a sphere overlaps any solid voxel of a grid.
+/// @param occupancy Occupancy of the grid.
+/// @param transform Transform from the grid's space to world space.
+/// @param center Center of the sphere.
+/// @param radius Radius of the sphere.
+/// @return Whether they overlap.
+static bool overlapsVoxels(const VoxelOccupancy& occupancy, const glm::mat4& transform, glm::vec3 center,
+                           float radius)
+{
+    glm::ivec3 min;
+    glm::ivec3 max;
+    voxelRange(glm::inverse(transform), aroundPoint(center, radius), min, max);
+    if (!occupancy.overlaps(min, max))
+    {
+        return false;
+    }
+
+    bool overlaps = false;
+    occupancy.forEach(min, max, [&](glm::ivec3 voxel) {
+        auto closest = closestOnBox(voxelBox(transform, voxel), center);
+        overlaps = overlaps || glm::dot(center - closest, center - closest) <= radius * radius;
+    });
+    return overlaps;
+}
+
+/// @brief Finds the point of a voxel grid closest to a point, among the surface voxels within a maximum distance.
+/// @param occupancy Occupancy of the grid.
+/// @param transform Transform from the grid's space to world space.
+/// @param point Point.
+/// @param maxDistance Maximum distance at which voxels count.
+/// @param[out] closest Closest point.
+/// @param[out] distance Distance to the closest point.
+/// @return Whether any voxel was found.
+static bool closestOnVoxels(const VoxelOccupancy& occupancy, const glm::mat4& transform, glm::vec3 point,
+                            float maxDistance, glm::vec3& closest, float& distance)
+{
+    auto inverse = glm::inverse(transform);
+    if (occupancy.get(glm::ivec3{glm::floor(glm::vec3{inverse * glm::vec4{point, 1.0F}})}))
+    {
+        closest = point;
+        distance = 0.0F;
+        return true;
+    }
+
+    // No voxel is closer than the box around the whole grid.
+    auto size = glm::vec3{occupancy.size()};
+    auto gridToWorld = transform;
+    for (glm::length_t k = 0; k < 3; ++k)
+    {
+        gridToWorld[k] *= size[k];
+    }
+    gridToWorld[3] = transform * glm::vec4{size * 0.5F, 1.0F};
+    float radius = glm::length(point - closestOnBox(orientedBox(gridToWorld, BoxCollisionShape{}), point));
+    if (radius > maxDistance)
+    {
+        return false;
+    }
+
+    // Search the voxels around the point, doubling the radius until a voxel within it is found, as every voxel
+    // left out is further away than the radius. The point is outside, and buried voxels are never closer to it
+    // than the surface voxels around them.
+    auto last = glm::ivec3{occupancy.size()} - 1;
+    float voxelSize = glm::length(glm::vec3{transform * glm::vec4{1.0F, 1.0F, 1.0F, 0.0F}});
+    radius = std::min(radius + voxelSize, maxDistance);
+    while (true)
+    {
+        glm::ivec3 min;
+        glm::ivec3 max;
+        voxelRange(inverse, aroundPoint(point, radius), min, max);
+        min = glm::max(min, glm::ivec3{0});
+        max = glm::min(max, last);
+
+        // Once the whole grid is searched, voxels up to the maximum distance count.
+        bool whole = min == glm::ivec3{0} && max == last;
+        bool found = false;
+        distance = whole ? maxDistance : radius;
+        occupancy.forEach(min, max, [&](glm::ivec3 voxel) {
+            if (!occupancy.surface(voxel))
+            {
+                return;
+            }
+
+            auto onVoxel = closestOnBox(voxelBox(transform, voxel), point);
+            float length = glm::length(point - onVoxel);
+            if (length <= distance)
+            {
+                found = true;
+                distance = length;
+                closest = onVoxel;
+            }
+        });
+
+        if (found || whole || radius >= maxDistance)
+        {
+            return found;
+        }
+
+        radius = std::min(radius * 2.0F, maxDistance);
+    }
+}
+
+void CollisionWorld::beginFrame()
+{
+    mFrame += 1;
+}
+
+auto CollisionWorld::body(Entity entity, const glm::mat4& transform, const AABB& aabb) -> Body&
+{
+    auto [it, inserted] = mBodies.try_emplace(entity);
+    auto& body = it->second;
+    if (inserted)
+    {
+        body.proxy = mTree.insert(aabb, entity);
+    }
+    else
+    {
+        mTree.move(body.proxy, aabb);
+    }
+
+    body.transform = transform;
+    body.frame = mFrame;
+    return body;
+}
+
+void CollisionWorld::update(Entity entity, const glm::mat4& transform, const AABB& aabb, const Box& box)
+{
+    auto& body = this->body(entity, transform, aabb);
+    body.shape = Shape::Box;
+    body.box = box;
+    body.occupancy = nullptr;
+}
+
+void CollisionWorld::update(Entity entity, const glm::mat4& transform, const AABB& aabb, const Capsule& capsule)
+{
+    auto& body = this->body(entity, transform, aabb);
+    body.shape = Shape::Capsule;
+    body.capsule = capsule;
+    body.occupancy = nullptr;
+}
+
+void CollisionWorld::update(Entity entity, const glm::mat4& transform, const AABB& aabb,
+                            std::shared_ptr<const VoxelOccupancy> occupancy)
+{
+    auto& body = this->body(entity, transform, aabb);
+    body.shape = Shape::Voxels;
+    body.occupancy = std::move(occupancy);
+}
+
+bool CollisionWorld::keep(Entity entity)
+{
+    auto it = mBodies.find(entity);
+    if (it == mBodies.end())
+    {
+        return false;
+    }
+
+    it->second.frame = mFrame;
+    return true;
+}
+
+void CollisionWorld::endFrame()
+{
+    for (auto it = mBodies.begin(); it != mBodies.end();)
+    {
+        if (it->second.frame != mFrame)
+        {
+            mTree.remove(it->second.proxy);
+            it = mBodies.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+std::size_t CollisionWorld::size() const
+{
+    return mBodies.size();
+}
+
+void CollisionWorld::useThreadPool(core::ThreadPool* pool, std::size_t threadCount)
+{
+    mThreadPool = pool;
+    mThreadCount = pool == nullptr ? 1 : std::max(threadCount, std::size_t{1});
+}
+
+auto CollisionWorld::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance) const -> std::optional<RayHit>
+{
+    // With a normalized direction, distances along the ray are in world units.
+    direction = glm::normalize(direction);
+
+    std::optional<RayHit> result;
+    mTree.raycastClosest(origin, direction, maxDistance, [&](int proxy) {
+        auto entity = mTree.entity(proxy);
+        const auto& body = mBodies.at(entity);
+        float limit = result ? result->distance : maxDistance;
+        float distance = 0.0F;
+        glm::vec3 normal{0.0F};
+        bool hit = false;
+        switch (body.shape)
+        {
+        case Shape::Box:
+            hit = raycastBox(orientedBox(body.transform, {body.box}), origin, direction, limit, distance, normal);
+            break;
+        case Shape::Capsule:
+            hit = raycastCapsule(capsuleSegment(body.transform, {body.capsule}), origin, direction, limit, distance,
+                                 normal);
+            break;
+        case Shape::Voxels:
+            hit = raycastVoxels(*body.occupancy, body.transform, origin, direction, limit, distance, normal);
+            break;
+        }
+        if (hit && (!result || distance < result->distance))
+        {
+            result = RayHit{entity, distance, origin + direction * distance, normal};
+        }
+
+        return result ? result->distance : maxDistance;
+    });
+
+    return result;
+}
+
+void CollisionWorld::raycast(const std::vector<Ray>& rays, std::vector<std::optional<RayHit>>& hits) const
+{
+    hits.resize(rays.size());
+
+    auto work = [&](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            hits[i] = this->raycast(rays[i].origin, rays[i].direction, rays[i].maxDistance);
+        }
+    };
+
+    if (mThreadPool == nullptr || rays.size() <= 1)
+    {
+        work(0, rays.size());
+        return;
+    }
+
+    // Each ray only writes to its own hit, so the batches need no synchronization. The pool is
+    // shared with the broad phase, so only this call's batches are waited for.
+    auto batchCount = std::min(mThreadCount, rays.size());
+    std::latch done{static_cast<std::ptrdiff_t>(batchCount)};
+    for (std::size_t batch = 0; batch < batchCount; ++batch)
+    {
+        mThreadPool->addTask([&work, &done, batch, batchCount, count = rays.size()]() {
+            work(count * batch / batchCount, count * (batch + 1) / batchCount);
+            done.count_down();
+        });
+    }
+
+    done.wait();
+}
+
+void CollisionWorld::overlapBox(const glm::mat4& transform, const Box& box, std::vector<Entity>& entities) const
+{
+    auto shape = orientedBox(transform, {box});
+
+    AABB aabb;
+    auto extent = glm::vec3{0.0F};
+    for (int k = 0; k < 3; ++k)
+    {
+        extent += glm::abs(shape.axes[k]) * shape.halfSize[k];
+    }
+    aabb.min(shape.center - extent);
+    aabb.max(shape.center + extent);
+
+    // Gather the colliders near the box, and test them in batches with the narrow phase, with the box first.
+    std::pmr::vector<BroadPhaseCollisions::Candidate> boxPairs;
+    std::pmr::vector<BroadPhaseCollisions::Candidate> capsulePairs;
+    std::pmr::vector<OrientedBox> queryBoxes;
+    std::pmr::vector<OrientedBox> boxes;
+    std::pmr::vector<CapsuleSegment> capsules;
+    std::pmr::vector<CollisionEvent> events;
+    BoxVoxelScratch scratch;
+    mTree.query(aabb, [&](int proxy) {
+        auto entity = mTree.entity(proxy);
+        const auto& body = mBodies.at(entity);
+        switch (body.shape)
+        {
+        case Shape::Box:
+            boxPairs.emplace_back(Entity{}, entity);
+            queryBoxes.push_back(shape);
+            boxes.push_back(orientedBox(body.transform, {body.box}));
+            break;
+        case Shape::Capsule:
+            capsulePairs.emplace_back(Entity{}, entity);
+            capsules.push_back(capsuleSegment(body.transform, {body.capsule}));
+            break;
+        case Shape::Voxels:
+            collideBoxVoxels({Entity{}, entity}, shape, body.transform, *body.occupancy, events, scratch);
+            break;
+        }
+        return true;
+    });
+
+    std::pmr::vector<int> axes;
+    collideBoxes(boxPairs, queryBoxes, boxes, events, axes);
+    queryBoxes.assign(capsules.size(), shape);
+    collideBoxCapsules(capsulePairs, queryBoxes, capsules, events);
+
+    for (const auto& event : events)
+    {
+        entities.push_back(event.other);
+    }
+}
+
+void CollisionWorld::overlapSphere(glm::vec3 center, float radius, std::vector<Entity>& entities) const
+{
+    CapsuleSegment sphere{center, center, radius};
+
+    AABB aabb;
+    aabb.min(center - glm::vec3{radius});
+    aabb.max(center + glm::vec3{radius});
+
+    // Gather the colliders near the sphere, and test them in batches with the narrow phase, as a capsule with no
+    // length. Boxes must come first in their pairs, and capsules come second to match.
+    std::pmr::vector<BroadPhaseCollisions::Candidate> boxPairs;
+    std::pmr::vector<BroadPhaseCollisions::Candidate> capsulePairs;
+    std::pmr::vector<OrientedBox> boxes;
+    std::pmr::vector<CapsuleSegment> capsules;
+    mTree.query(aabb, [&](int proxy) {
+        auto entity = mTree.entity(proxy);
+        const auto& body = mBodies.at(entity);
+        switch (body.shape)
+        {
+        case Shape::Box:
+            boxPairs.emplace_back(entity, Entity{});
+            boxes.push_back(orientedBox(body.transform, {body.box}));
+            break;
+        case Shape::Capsule:
+            capsulePairs.emplace_back(Entity{}, entity);
+            capsules.push_back(capsuleSegment(body.transform, {body.capsule}));
+            break;
+        case Shape::Voxels:
+            if (overlapsVoxels(*body.occupancy, body.transform, center, radius))
+            {
+                entities.push_back(entity);
+            }
+            break;
+        }
+        return true;
+    });
+
+    std::pmr::vector<CollisionEvent> boxEvents;
+    std::pmr::vector<CapsuleSegment> spheres(boxes.size(), sphere);
+    collideBoxCapsules(boxPairs, boxes, spheres, boxEvents);
+    for (const auto& event : boxEvents)
+    {
+        entities.push_back(event.entity);
+    }
+
+    std::pmr::vector<CollisionEvent> capsuleEvents;
+    spheres.assign(capsules.size(), sphere);
+    collideCapsules(capsulePairs, spheres, capsules, capsuleEvents);
+    for (const auto& event : capsuleEvents)
+    {
+        entities.push_back(event.other);
+    }
+}
+
+auto CollisionWorld::nearest(glm::vec3 point, float maxDistance) const -> std::optional<NearestHit>
+{
+    std::optional<NearestHit> result;
+    mTree.nearest(point, maxDistance, [&](int proxy) {
+        auto entity = mTree.entity(proxy);
+        const auto& body = mBodies.at(entity);
+
+        float limit = result ? result->distance : maxDistance;
+        glm::vec3 closest{0.0F};
+        float distance = limit;
+        switch (body.shape)
+        {
+        case Shape::Box:
+            closest = closestOnBox(orientedBox(body.transform, {body.box}), point);
+            distance = glm::length(point - closest);
+            break;
+        case Shape::Capsule: {
+            auto capsule = capsuleSegment(body.transform, {body.capsule});
+            auto onSegment = closestOnSegment(capsule.start, capsule.end, point);
+            auto offset = point - onSegment;
+            float length = glm::length(offset);
+            distance = std::max(length - capsule.radius, 0.0F);
+            closest = length > capsule.radius ? onSegment + offset * (capsule.radius / length) : point;
+            break;
+        }
+        case Shape::Voxels:
+            if (!closestOnVoxels(*body.occupancy, body.transform, point, limit, closest, distance))
+            {
+                return limit;
+            }
+            break;
+        }
+
+        if (distance <= limit)
+        {
+            result = NearestHit{entity, distance, closest};
+        }
+
+        return result ? result->distance : maxDistance;
+    });
+
+    return result;
+}
@@ -0,0 +1,338 @@
+#include <algorithm>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <cubos/engine/collisions/dynamic_aabb_tree.hpp>
+
+using cubos::core::ecs::Entity;
+using cubos::core::geom::AABB;
+
+using cubos::engine::DynamicAABBTree;
+
+/// @brief Gets the smallest AABB which contains both of the given AABBs.
+static AABB merge(const AABB& a, const AABB& b)
+{
+    AABB result;
+    result.min(glm::min(a.min(), b.min()));
+    result.max(glm::max(a.max(), b.max()));
+    return result;
+}
+
+/// @brief Gets the surface area of an AABB, used as the cost of a node in the tree.
+static float area(const AABB& aabb)
+{
+    auto size = aabb.max() - aabb.min();
+    return 2.0F * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+/// @brief Checks if an AABB fully contains another.
+static bool contains(const AABB& outer, const AABB& inner)
+{
+    return glm::all(glm::lessThanEqual(outer.min(), inner.min())) &&
+           glm::all(glm::greaterThanEqual(outer.max(), inner.max()));
+}
+
+int DynamicAABBTree::insert(const AABB& aabb, Entity entity)
+{
+    int proxy = this->allocate();
+    auto& node = this->at(proxy);
+    node.aabb.min(aabb.min() - glm::vec3{Margin});
+    node.aabb.max(aabb.max() + glm::vec3{Margin});
+    node.entity = entity;
+    node.height = 0;
+
+    this->insertLeaf(proxy);
+    mSize += 1;
+    return proxy;
+}
+
+void DynamicAABBTree::remove(int proxy)
+{
+    CUBOS_ASSERT(this->at(proxy).isLeaf(), "Node is not a proxy");
+    this->removeLeaf(proxy);
+    this->release(proxy);
+    mSize -= 1;
+}
+
+bool DynamicAABBTree::move(int proxy, const AABB& aabb)
+{
+    auto& node = this->at(proxy);
+    if (contains(node.aabb, aabb))
+    {
+        return false;
+    }
+
+    this->removeLeaf(proxy);
+    node.aabb.min(aabb.min() - glm::vec3{Margin});
+    node.aabb.max(aabb.max() + glm::vec3{Margin});
+    this->insertLeaf(proxy);
+    return true;
+}
+
+void DynamicAABBTree::clear()
+{
+    mNodes.clear();
+    mRoot = Null;
+    mFree = Null;
+    mSize = 0;
+}
+
+const AABB& DynamicAABBTree::fatAABB(int proxy) const
+{
+    return mNodes[static_cast<std::size_t>(proxy)].aabb;
+}
+
+Entity DynamicAABBTree::entity(int proxy) const
+{
+    return mNodes[static_cast<std::size_t>(proxy)].entity;
+}
+
+std::size_t DynamicAABBTree::size() const
+{
+    return mSize;
+}
+
+int DynamicAABBTree::height() const
+{
+    return mRoot == Null ? 0 : mNodes[static_cast<std::size_t>(mRoot)].height;
+}
+
+bool DynamicAABBTree::hits(const AABB& aabb, glm::vec3 origin, glm::vec3 direction, float maxDistance)
+{
+    float enter = 0.0F;
+    float exit = maxDistance;
+    for (glm::length_t k = 0; k < 3; ++k)
+    {
+        if (direction[k] == 0.0F)
+        {
+            // Parallel to the slab: dividing would give NaN when the origin lies on one of its planes.
+            if (origin[k] < aabb.min()[k] || origin[k] > aabb.max()[k])
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        float inverse = 1.0F / direction[k];
+        float near = (aabb.min()[k] - origin[k]) * inverse;
+        float far = (aabb.max()[k] - origin[k]) * inverse;
+        enter = std::max(enter, std::min(near, far));
+        exit = std::min(exit, std::max(near, far));
+    }
+
+    return enter <= exit;
+}
+
+float DynamicAABBTree::distance(const AABB& aabb, glm::vec3 point)
+{
+    return glm::length(point - glm::clamp(point, aabb.min(), aabb.max()));
+}
+
+int DynamicAABBTree::allocate()
+{
+    if (mFree == Null)
+    {
+        mNodes.emplace_back();
+        return static_cast<int>(mNodes.size() - 1);
+    }
+
+    int node = mFree;
+    mFree = this->at(node).parent;
+    this->at(node) = Node{};
+    return node;
+}
+
+void DynamicAABBTree::release(int node)
+{
+    this->at(node).parent = mFree;
+    this->at(node).height = -1;
+    mFree = node;
+}
+
+void DynamicAABBTree::insertLeaf(int leaf)
+{
+    if (mRoot == Null)
+    {
+        mRoot = leaf;
+        this->at(leaf).parent = Null;
+        return;
+    }
+
+    // Walk down the tree looking for the best sibling, using the surface area heuristic: the
+    // cost of a node is its area, and every ancestor of the new node grows to contain it.
+    auto leafAABB = this->at(leaf).aabb;
+    int index = mRoot;
+    while (!this->at(index).isLeaf())
+    {
+        const auto& node = this->at(index);
+        float combinedArea = area(merge(node.aabb, leafAABB));
+
+        // Cost of making the leaf a sibling of this node, and the minimum cost pushed down to
+        // any of its children.
+        float cost = 2.0F * combinedArea;
+        float inheritance = 2.0F * (combinedArea - area(node.aabb));
+
+        auto childCost = [&](int child) {
+            const auto& childNode = this->at(child);
+            float grown = area(merge(childNode.aabb, leafAABB));
+            return childNode.isLeaf() ? grown + inheritance : grown - area(childNode.aabb) + inheritance;
+        };
+
+        float leftCost = childCost(node.left);
+        float rightCost = childCost(node.right);
+        if (cost < leftCost && cost < rightCost)
+        {
+            break;
+        }
+
+        index = leftCost < rightCost ? node.left : node.right;
+    }
+
+    // Create a new parent for the leaf and its sibling.
+    int sibling = index;
+    int oldParent = this->at(sibling).parent;
+    int newParent = this->allocate();
+    auto& parent = this->at(newParent);
+    parent.parent = oldParent;
+    parent.aabb = merge(leafAABB, this->at(sibling).aabb);
+    parent.height = this->at(sibling).height + 1;
+    parent.left = sibling;
+    parent.right = leaf;
+    this->at(sibling).parent = newParent;
+    this->at(leaf).parent = newParent;
+
+    if (oldParent == Null)
+    {
+        mRoot = newParent;
+    }
+    else if (this->at(oldParent).left == sibling)
+    {
+        this->at(oldParent).left = newParent;
+    }
+    else
+    {
+        this->at(oldParent).right = newParent;
+    }
+
+    this->refit(oldParent);
+}
+
+void DynamicAABBTree::removeLeaf(int leaf)
+{
+    if (leaf == mRoot)
+    {
+        mRoot = Null;
+        return;
+    }
+
+    // Replace the leaf's parent with its sibling.
+    int parent = this->at(leaf).parent;
+    int grandParent = this->at(parent).parent;
+    int sibling = this->at(parent).left == leaf ? this->at(parent).right : this->at(parent).left;
+
+    if (grandParent == Null)
+    {
+        mRoot = sibling;
+        this->at(sibling).parent = Null;
+        this->release(parent);
+        return;
+    }
+
+    if (this->at(grandParent).left == parent)
+    {
+        this->at(grandParent).left = sibling;
+    }
+    else
+    {
+        this->at(grandParent).right = sibling;
+    }
+
+    this->at(sibling).parent = grandParent;
+    this->release(parent);
+    this->refit(grandParent);
+}
+
+void DynamicAABBTree::refit(int node)
+{
+    while (node != Null)
+    {
+        node = this->balance(node);
+
+        auto& current = this->at(node);
+        const auto& left = this->at(current.left);
+        const auto& right = this->at(current.right);
+        current.height = 1 + std::max(left.height, right.height);
+        current.aabb = merge(left.aabb, right.aabb);
+
+        node = current.parent;
+    }
+}
+
+int DynamicAABBTree::balance(int a)
+{
+    auto& nodeA = this->at(a);
+    if (nodeA.isLeaf() || nodeA.height < 2)
+    {
+        return a;
+    }
+
+    int b = nodeA.left;
+    int c = nodeA.right;
+    auto& nodeB = this->at(b);
+    auto& nodeC = this->at(c);
+    int difference = nodeC.height - nodeB.height;
+    if (difference >= -1 && difference <= 1)
+    {
+        return a;
+    }
+
+    // Rotate the taller child up, making A its child and giving A one of its grandchildren.
+    bool rotateRight = difference > 1;
+    int up = rotateRight ? c : b;
+    int down = rotateRight ? b : c;
+    auto& nodeUp = this->at(up);
+    const auto& nodeDown = this->at(down);
+
+    nodeUp.parent = nodeA.parent;
+    nodeA.parent = up;
+    if (nodeUp.parent == Null)
+    {
+        mRoot = up;
+    }
+    else if (this->at(nodeUp.parent).left == a)
+    {
+        this->at(nodeUp.parent).left = up;
+    }
+    else
+    {
+        this->at(nodeUp.parent).right = up;
+    }
+
+    // The taller grandchild stays with the node which went up, the other one goes to A.
+    int f = nodeUp.left;
+    int g = nodeUp.right;
+    bool keepF = this->at(f).height > this->at(g).height;
+    int kept = keepF ? f : g;
+    int given = keepF ? g : f;
+
+    nodeUp.left = a;
+    nodeUp.right = kept;
+    if (rotateRight)
+    {
+        nodeA.right = given;
+    }
+    else
+    {
+        nodeA.left = given;
+    }
+    this->at(given).parent = a;
+
+    nodeA.aabb = merge(nodeDown.aabb, this->at(given).aabb);
+    nodeA.height = 1 + std::max(nodeDown.height, this->at(given).height);
+    nodeUp.aabb = merge(nodeA.aabb, this->at(kept).aabb);
+    nodeUp.height = 1 + std::max(nodeA.height, this->at(kept).height);
+
+    return up;
+}
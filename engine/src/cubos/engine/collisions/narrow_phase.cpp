@@ -0,0 +1,971 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#include "narrow_phase.hpp"
+
+using Candidate = BroadPhaseCollisions::Candidate;
+using CollisionType = BroadPhaseCollisions::CollisionType;
+
+/// @brief Number of pairs tested together.
+///
+/// Batches are laid out as structures of arrays with this many lanes. Each test is a loop over the lanes which
+/// neither branches nor reads from other lanes, so that the compiler can turn it into SIMD instructions.
+static constexpr std::size_t Width = 8;
+
+/// @brief Tolerance used to avoid divisions by zero and to detect parallel edges.
+static constexpr float Epsilon = 1e-6F;
+
+/// @brief Factor applied to the penetration along edge axes when choosing the axis of least penetration. Face axes
+/// give better manifolds, so edge axes are only chosen when they are noticeably better.
+static constexpr float EdgeBias = 1.05F;
+
+/// @brief Sine of the angle between two edges under which they are considered parallel.
+static constexpr float ParallelSine = 1e-3F;
+
+/// @brief Cosine of the angle under which the contacts of a box with different voxels are merged into the same
+/// manifold.
+static constexpr float VoxelNormalCosine = 0.9F;
+
+/// @brief Number of bisection steps used to find the point of a segment closest to a box.
+static constexpr int BisectionSteps = 16;
+
+namespace
+{
+    /// @brief Vectors of a batch, one per lane.
+    struct Vec3Lanes
+    {
+        float x[Width]; ///< X coordinates.
+        float y[Width]; ///< Y coordinates.
+        float z[Width]; ///< Z coordinates.
+
+        /// @brief Sets the vector of a lane.
+        /// @param lane Lane.
+        /// @param vector Vector.
+        void set(std::size_t lane, glm::vec3 vector)
+        {
+            x[lane] = vector.x;
+            y[lane] = vector.y;
+            z[lane] = vector.z;
+        }
+
+        /// @brief Gets the vector of a lane.
+        /// @param lane Lane.
+        /// @return Vector.
+        glm::vec3 get(std::size_t lane) const
+        {
+            return {x[lane], y[lane], z[lane]};
+        }
+    };
+
+    /// @brief Batch of pairs of boxes.
+    struct BoxBatch
+    {
+        Vec3Lanes centerA;  ///< Center of the first box.
+        Vec3Lanes axesA[3]; ///< Axes of the first box.
+        Vec3Lanes halfA;    ///< Half size of the first box.
+        Vec3Lanes centerB;  ///< Center of the second box.
+        Vec3Lanes axesB[3]; ///< Axes of the second box.
+        Vec3Lanes halfB;    ///< Half size of the second box.
+
+        /// @brief Axis of least penetration: 0 to 2 are the faces of the first box, 3 to 5 the faces of the second
+        /// box, and 6 to 14 the cross products of their edges.
+        int axis[Width];
+        float depth[Width];   ///< Penetration along the axis of least penetration.
+        float score[Width];   ///< Penetration along the axis of least penetration, after applying @ref EdgeBias.
+        float overlap[Width]; ///< Least penetration along any axis, negative if some axis separates the boxes.
+    };
+
+    /// @brief Batch of pairs of a box and a capsule.
+    struct BoxCapsuleBatch
+    {
+        Vec3Lanes center;      ///< Center of the box.
+        Vec3Lanes axes[3];     ///< Axes of the box.
+        Vec3Lanes half;        ///< Half size of the box.
+        Vec3Lanes start;       ///< Start of the capsule's segment.
+        Vec3Lanes end;         ///< End of the capsule's segment.
+        Vec3Lanes onSegment;   ///< Point of the segment closest to the box, in the box's local space.
+        Vec3Lanes onBox;       ///< Point of the box closest to the segment, in the box's local space.
+        float distance[Width]; ///< Distance between the segment and the box.
+    };
+
+    /// @brief Batch of pairs of capsules.
+    struct CapsuleBatch
+    {
+        Vec3Lanes startA;      ///< Start of the first segment.
+        Vec3Lanes endA;        ///< End of the first segment.
+        Vec3Lanes startB;      ///< Start of the second segment.
+        Vec3Lanes endB;        ///< End of the second segment.
+        float s[Width];        ///< Position of the closest point on the first segment, from 0 to 1.
+        float t[Width];        ///< Position of the closest point on the second segment, from 0 to 1.
+        float distance[Width]; ///< Distance between the segments.
+    };
+} // namespace
+
+/// @brief Computes the dot product of two vectors of a lane.
+static float dot(const Vec3Lanes& a, const Vec3Lanes& b, std::size_t lane)
+{
+    return a.x[lane] * b.x[lane] + a.y[lane] * b.y[lane] + a.z[lane] * b.z[lane];
+}
+
+/// @brief Clamps a value to the range from 0 to 1.
+static float saturate(float value)
+{
+    return std::min(std::max(value, 0.0F), 1.0F);
+}
+
+/// @brief Gets by how much a coordinate is outside of the range from `-half` to `half`, with sign.
+static float excess(float value, float half)
+{
+    return value - std::min(std::max(value, -half), half);
+}
+
+/// @brief Updates the axis of least penetration of each lane of a batch of boxes with the penetration along another
+/// axis.
+static void consider(BoxBatch& batch, const float* penetration, int axis, float bias)
+{
+    for (std::size_t l = 0; l < Width; ++l)
+    {
+        float score = penetration[l] * bias;
+        bool better = score < batch.score[l];
+        batch.overlap[l] = std::min(batch.overlap[l], penetration[l]);
+        batch.score[l] = better ? score : batch.score[l];
+        batch.depth[l] = better ? penetration[l] : batch.depth[l];
+        batch.axis[l] = better ? axis : batch.axis[l];
+    }
+}
+
+/// @brief Runs the separating axis test on every lane of a batch of boxes.
+static void testBoxes(BoxBatch& batch)
+{
+    // Rotation from the second box's space to the first box's space. The epsilon in the absolute values prevents
+    // parallel edges from producing a null axis which would pass the test.
+    float rot[3][3][Width];
+    float absRot[3][3][Width];
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            for (std::size_t l = 0; l < Width; ++l)
+            {
+                rot[i][j][l] = dot(batch.axesA[i], batch.axesB[j], l);
+                absRot[i][j][l] = std::abs(rot[i][j][l]) + Epsilon;
+            }
+        }
+    }
+
+    // Offset between the centers, in the first box's space.
+    float t[3][Width];
+    for (int i = 0; i < 3; ++i)
+    {
+        for (std::size_t l = 0; l < Width; ++l)
+        {
+            t[i][l] = (batch.centerB.x[l] - batch.centerA.x[l]) * batch.axesA[i].x[l] +
+                      (batch.centerB.y[l] - batch.centerA.y[l]) * batch.axesA[i].y[l] +
+                      (batch.centerB.z[l] - batch.centerA.z[l]) * batch.axesA[i].z[l];
+        }
+    }
+
+    const float* ha[3] = {batch.halfA.x, batch.halfA.y, batch.halfA.z};
+    const float* hb[3] = {batch.halfB.x, batch.halfB.y, batch.halfB.z};
+
+    for (std::size_t l = 0; l < Width; ++l)
+    {
+        batch.axis[l] = 0;
+        batch.depth[l] = 0.0F;
+        batch.score[l] = std::numeric_limits<float>::infinity();
+        batch.overlap[l] = std::numeric_limits<float>::infinity();
+    }
+
+    float penetration[Width];
+
+    // Faces of the first box.
+    for (int i = 0; i < 3; ++i)
+    {
+        for (std::size_t l = 0; l < Width; ++l)
+        {
+            float rb = hb[0][l] * absRot[i][0][l] + hb[1][l] * absRot[i][1][l] + hb[2][l] * absRot[i][2][l];
+            penetration[l] = ha[i][l] + rb - std::abs(t[i][l]);
+        }
+
+        consider(batch, penetration, i, 1.0F);
+    }
+
+    // Faces of the second box.
+    for (int j = 0; j < 3; ++j)
+    {
+        for (std::size_t l = 0; l < Width; ++l)
+        {
+            float ra = ha[0][l] * absRot[0][j][l] + ha[1][l] * absRot[1][j][l] + ha[2][l] * absRot[2][j][l];
+            float tb = t[0][l] * rot[0][j][l] + t[1][l] * rot[1][j][l] + t[2][l] * rot[2][j][l];
+            penetration[l] = ra + hb[j][l] - std::abs(tb);
+        }
+
+        consider(batch, penetration, 3 + j, 1.0F);
+    }
+
+    // Cross products of the edges. Their length is the sine of the angle between the edges, which is used to
+    // normalize the penetration, and to skip them altogether when the edges are parallel.
+    for (int i = 0; i < 3; ++i)
+    {
+        int i1 = (i + 1) % 3;
+        int i2 = (i + 2) % 3;
+        for (int j = 0; j < 3; ++j)
+        {
+            int j1 = (j + 1) % 3;
+            int j2 = (j + 2) % 3;
+            for (std::size_t l = 0; l < Width; ++l)
+            {
+                float ra = ha[i1][l] * absRot[i2][j][l] + ha[i2][l] * absRot[i1][j][l];
+                float rb = hb[j1][l] * absRot[i][j2][l] + hb[j2][l] * absRot[i][j1][l];
+                float distance = std::abs(t[i2][l] * rot[i1][j][l] - t[i1][l] * rot[i2][j][l]);
+                float sine = std::sqrt(std::max(1.0F - rot[i][j][l] * rot[i][j][l], 0.0F));
+
+                // Selecting between constants instead of between the penetration and infinity keeps the division out
+                // of a branch, which would stop the loop from being vectorized.
+                float parallel = sine > ParallelSine ? 0.0F : std::numeric_limits<float>::infinity();
+                penetration[l] = (ra + rb - distance) / std::max(sine, ParallelSine) + parallel;
+            }
+
+            consider(batch, penetration, 6 + 3 * i + j, EdgeBias);
+        }
+    }
+}
+
+/// @brief Finds the closest points between the segments of every lane of a batch of capsules.
+static void testCapsules(CapsuleBatch& batch)
+{
+    for (std::size_t l = 0; l < Width; ++l)
+    {
+        float d1x = batch.endA.x[l] - batch.startA.x[l];
+        float d1y = batch.endA.y[l] - batch.startA.y[l];
+        float d1z = batch.endA.z[l] - batch.startA.z[l];
+        float d2x = batch.endB.x[l] - batch.startB.x[l];
+        float d2y = batch.endB.y[l] - batch.startB.y[l];
+        float d2z = batch.endB.z[l] - batch.startB.z[l];
+        float rx = batch.startA.x[l] - batch.startB.x[l];
+        float ry = batch.startA.y[l] - batch.startB.y[l];
+        float rz = batch.startA.z[l] - batch.startB.z[l];
+
+        float a = d1x * d1x + d1y * d1y + d1z * d1z;
+        float b = d1x * d2x + d1y * d2y + d1z * d2z;
+        float c = d1x * rx + d1y * ry + d1z * rz;
+        float e = d2x * d2x + d2y * d2y + d2z * d2z;
+        float f = d2x * rx + d2y * ry + d2z * rz;
+
+        // Closest points of the infinite lines, clamped to the segments. Recomputing the first parameter from the
+        // clamped second one fixes it when the second is clamped, and also covers parallel segments, for which the
+        // first guess is arbitrary, and segments which degenerate into points.
+        float denominator = a * e - b * b;
+        float s = saturate((b * f - c * e) / std::max(denominator, Epsilon));
+        float t = saturate((b * s + f) / std::max(e, Epsilon));
+        s = saturate((b * t - c) / std::max(a, Epsilon));
+
+        float dx = rx + d1x * s - d2x * t;
+        float dy = ry + d1y * s - d2y * t;
+        float dz = rz + d1z * s - d2z * t;
+
+        batch.s[l] = s;
+        batch.t[l] = t;
+        batch.distance[l] = std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+}
+
+/// @brief Finds the closest points between the segment and the box of every lane of a batch.
+static void testBoxCapsules(BoxCapsuleBatch& batch)
+{
+    // Move the segments to the boxes' local space, where they are centered and axis aligned.
+    Vec3Lanes start;
+    Vec3Lanes direction;
+    float* starts[3] = {start.x, start.y, start.z};
+    float* directions[3] = {direction.x, direction.y, direction.z};
+    for (int k = 0; k < 3; ++k)
+    {
+        for (std::size_t l = 0; l < Width; ++l)
+        {
+            float sx = batch.start.x[l] - batch.center.x[l];
+            float sy = batch.start.y[l] - batch.center.y[l];
+            float sz = batch.start.z[l] - batch.center.z[l];
+            float ex = batch.end.x[l] - batch.center.x[l];
+            float ey = batch.end.y[l] - batch.center.y[l];
+            float ez = batch.end.z[l] - batch.center.z[l];
+            starts[k][l] = sx * batch.axes[k].x[l] + sy * batch.axes[k].y[l] + sz * batch.axes[k].z[l];
+            directions[k][l] =
+                ex * batch.axes[k].x[l] + ey * batch.axes[k].y[l] + ez * batch.axes[k].z[l] - starts[k][l];
+        }
+    }
+
+    // The squared distance to the box is convex along the segment, so its minimum is found by bisecting on the sign
+    // of its derivative, moving towards it by half as much on each step.
+    float bisected[Width];
+    for (std::size_t l = 0; l < Width; ++l)
+    {
+        bisected[l] = 0.5F;
+    }
+
+    float step = 0.25F;
+    for (int i = 0; i < BisectionSteps; ++i, step *= 0.5F)
+    {
+        for (std::size_t l = 0; l < Width; ++l)
+        {
+            float t = bisected[l];
+            float slope = direction.x[l] * excess(start.x[l] + direction.x[l] * t, batch.half.x[l]) +
+                          direction.y[l] * excess(start.y[l] + direction.y[l] * t, batch.half.y[l]) +
+                          direction.z[l] * excess(start.z[l] + direction.z[l] * t, batch.half.z[l]);
+            bisected[l] = t + (slope > 0.0F ? -step : step);
+        }
+    }
+
+    for (std::size_t l = 0; l < Width; ++l)
+    {
+        // Bisection stops anywhere along the part of the segment inside the box, so the point closest to the box's
+        // center is tried too, as when it is inside the box it is usually the deepest point.
+        float length = direction.x[l] * direction.x[l] + direction.y[l] * direction.y[l] +
+                       direction.z[l] * direction.z[l];
+        float centered = saturate(
+            -(start.x[l] * direction.x[l] + start.y[l] * direction.y[l] + start.z[l] * direction.z[l]) /
+            std::max(length, Epsilon));
+
+        float cx = excess(start.x[l] + direction.x[l] * centered, batch.half.x[l]);
+        float cy = excess(start.y[l] + direction.y[l] * centered, batch.half.y[l]);
+        float cz = excess(start.z[l] + direction.z[l] * centered, batch.half.z[l]);
+        float bx = excess(start.x[l] + direction.x[l] * bisected[l], batch.half.x[l]);
+        float by = excess(start.y[l] + direction.y[l] * bisected[l], batch.half.y[l]);
+        float bz = excess(start.z[l] + direction.z[l] * bisected[l], batch.half.z[l]);
+        bool useCentered = cx * cx + cy * cy + cz * cz <= bx * bx + by * by + bz * bz;
+        float t = useCentered ? centered : bisected[l];
+        float dx = useCentered ? cx : bx;
+        float dy = useCentered ? cy : by;
+        float dz = useCentered ? cz : bz;
+
+        batch.onSegment.x[l] = start.x[l] + direction.x[l] * t;
+        batch.onSegment.y[l] = start.y[l] + direction.y[l] * t;
+        batch.onSegment.z[l] = start.z[l] + direction.z[l] * t;
+        batch.onBox.x[l] = batch.onSegment.x[l] - dx;
+        batch.onBox.y[l] = batch.onSegment.y[l] - dy;
+        batch.onBox.z[l] = batch.onSegment.z[l] - dz;
+        batch.distance[l] = std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+}
+
+/// @brief Clips a convex polygon against the half-space where `dot(point, normal) <= offset`.
+/// @param polygon Vertices of the polygon, replaced by the vertices of the clipped polygon.
+/// @param count Number of vertices.
+/// @return Number of vertices of the clipped polygon.
+static std::size_t clip(glm::vec3* polygon, std::size_t count, glm::vec3 normal, float offset)
+{
+    glm::vec3 clipped[8];
+    std::size_t clippedCount = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto current = polygon[i];
+        auto next = polygon[(i + 1) % count];
+        float currentDistance = glm::dot(current, normal) - offset;
+        float nextDistance = glm::dot(next, normal) - offset;
+
+        if (currentDistance <= 0.0F)
+        {
+            clipped[clippedCount++] = current;
+        }
+
+        if ((currentDistance <= 0.0F) != (nextDistance <= 0.0F) && clippedCount < 8)
+        {
+            clipped[clippedCount++] = current + (next - current) * (currentDistance / (currentDistance - nextDistance));
+        }
+    }
+
+    std::copy(clipped, clipped + clippedCount, polygon);
+    return clippedCount;
+}
+
+/// @brief Gets the edge of a box along one of its axes which is furthest in a direction.
+static void supportEdge(const OrientedBox& box, int axis, glm::vec3 direction, glm::vec3& start, glm::vec3& end)
+{
+    auto middle = box.center;
+    for (int k = 0; k < 3; ++k)
+    {
+        if (k != axis)
+        {
+            middle += box.axes[k] * (glm::dot(box.axes[k], direction) >= 0.0F ? box.halfSize[k] : -box.halfSize[k]);
+        }
+    }
+
+    start = middle - box.axes[axis] * box.halfSize[axis];
+    end = middle + box.axes[axis] * box.halfSize[axis];
+}
+
+/// @brief Finds the closest points between two segments.
+static void closestPoints(glm::vec3 startA, glm::vec3 endA, glm::vec3 startB, glm::vec3 endB, glm::vec3& onA,
+                          glm::vec3& onB)
+{
+    CapsuleBatch batch{};
+    batch.startA.set(0, startA);
+    batch.endA.set(0, endA);
+    batch.startB.set(0, startB);
+    batch.endB.set(0, endB);
+    testCapsules(batch);
+    onA = startA + (endA - startA) * batch.s[0];
+    onB = startB + (endB - startB) * batch.t[0];
+}
+
+/// @brief Gets the direction of one of the axes tested by @ref testBoxes, which is not normalized for edge axes.
+static glm::vec3 axisDirection(const OrientedBox& a, const OrientedBox& b, int axis)
+{
+    if (axis < 3)
+    {
+        return a.axes[axis];
+    }
+
+    if (axis < 6)
+    {
+        return b.axes[axis - 3];
+    }
+
+    return glm::cross(a.axes[(axis - 6) / 3], b.axes[(axis - 6) % 3]);
+}
+
+/// @brief Checks whether a single axis separates two boxes.
+static bool separates(const OrientedBox& a, const OrientedBox& b, int axis)
+{
+    auto direction = axisDirection(a, b, axis);
+    if (glm::length(direction) <= ParallelSine)
+    {
+        // The edges are parallel, so the axis is meaningless.
+        return false;
+    }
+
+    float ra = 0.0F;
+    float rb = 0.0F;
+    for (int k = 0; k < 3; ++k)
+    {
+        ra += a.halfSize[k] * std::abs(glm::dot(a.axes[k], direction));
+        rb += b.halfSize[k] * std::abs(glm::dot(b.axes[k], direction));
+    }
+
+    return std::abs(glm::dot(b.center - a.center, direction)) > ra + rb;
+}
+
+/// @brief Builds the manifold of two colliding boxes from their axis of least penetration.
+static void boxManifold(const OrientedBox& a, const OrientedBox& b, int axis, float depth, CollisionEvent& event)
+{
+    auto normal = axisDirection(a, b, axis);
+    if (axis >= 6)
+    {
+        normal = glm::normalize(normal);
+    }
+
+    if (glm::dot(normal, b.center - a.center) < 0.0F)
+    {
+        normal = -normal;
+    }
+
+    event.normal = normal;
+    event.depth = depth;
+
+    if (axis >= 6)
+    {
+        // Edge against edge: touching at a single point, between the closest points of the two edges.
+        glm::vec3 startA;
+        glm::vec3 endA;
+        glm::vec3 startB;
+        glm::vec3 endB;
+        supportEdge(a, (axis - 6) / 3, normal, startA, endA);
+        supportEdge(b, (axis - 6) % 3, -normal, startB, endB);
+
+        glm::vec3 onA;
+        glm::vec3 onB;
+        closestPoints(startA, endA, startB, endB, onA, onB);
+        event.points[0] = (onA + onB) * 0.5F;
+        event.pointCount = 1;
+        return;
+    }
+
+    // Face against anything: the face of the other box which faces the reference face the most is clipped against
+    // the sides of the reference face, and the vertices which end up below it are the contact points.
+    bool flipped = axis >= 3;
+    const auto& reference = flipped ? b : a;
+    const auto& incident = flipped ? a : b;
+    int face = flipped ? axis - 3 : axis;
+    auto faceNormal = flipped ? -normal : normal;
+    auto faceCenter = reference.center + faceNormal * reference.halfSize[face];
+
+    int incidentFace = 0;
+    for (int k = 1; k < 3; ++k)
+    {
+        if (std::abs(glm::dot(incident.axes[k], faceNormal)) >
+            std::abs(glm::dot(incident.axes[incidentFace], faceNormal)))
+        {
+            incidentFace = k;
+        }
+    }
+
+    float side = glm::dot(incident.axes[incidentFace], faceNormal) > 0.0F ? -1.0F : 1.0F;
+    auto center = incident.center + incident.axes[incidentFace] * (side * incident.halfSize[incidentFace]);
+    auto u = incident.axes[(incidentFace + 1) % 3] * incident.halfSize[(incidentFace + 1) % 3];
+    auto v = incident.axes[(incidentFace + 2) % 3] * incident.halfSize[(incidentFace + 2) % 3];
+
+    glm::vec3 polygon[8] = {center + u + v, center - u + v, center - u - v, center + u - v};
+    std::size_t count = 4;
+    for (int k = 1; k < 3; ++k)
+    {
+        int sideAxis = (face + k) % 3;
+        auto sideNormal = reference.axes[sideAxis];
+        float offset = glm::dot(reference.center, sideNormal);
+        count = clip(polygon, count, sideNormal, offset + reference.halfSize[sideAxis]);
+        count = clip(polygon, count, -sideNormal, reference.halfSize[sideAxis] - offset);
+    }
+
+    // Keep the points below the reference face, moved halfway towards it.
+    glm::vec3 contacts[8];
+    std::size_t contactCount = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        float separation = glm::dot(polygon[i] - faceCenter, faceNormal);
+        if (separation <= 0.0F)
+        {
+            contacts[contactCount++] = polygon[i] - faceNormal * (separation * 0.5F);
+        }
+    }
+
+    if (contactCount == 0)
+    {
+        // Only reachable through rounding errors, as the test said the boxes overlap.
+        event.points[0] = faceCenter;
+        event.pointCount = 1;
+        return;
+    }
+
+    if (contactCount <= CollisionEvent::MaxPoints)
+    {
+        std::copy(contacts, contacts + contactCount, event.points);
+        event.pointCount = contactCount;
+        return;
+    }
+
+    // Too many points: keep the ones furthest along each direction of the reference face.
+    glm::vec3 directions[4] = {reference.axes[(face + 1) % 3], -reference.axes[(face + 1) % 3],
+                               reference.axes[(face + 2) % 3], -reference.axes[(face + 2) % 3]};
+    bool taken[8] = {};
+    for (std::size_t d = 0; d < CollisionEvent::MaxPoints; ++d)
+    {
+        std::size_t best = 0;
+        float bestDistance = -std::numeric_limits<float>::infinity();
+        for (std::size_t i = 0; i < contactCount; ++i)
+        {
+            float distance = glm::dot(contacts[i], directions[d]);
+            if (!taken[i] && distance > bestDistance)
+            {
+                best = i;
+                bestDistance = distance;
+            }
+        }
+
+        taken[best] = true;
+        event.points[d] = contacts[best];
+    }
+
+    event.pointCount = CollisionEvent::MaxPoints;
+}
+
+void collideBoxes(const std::pmr::vector<Candidate>& pairs, const std::pmr::vector<OrientedBox>& a,
+                  const std::pmr::vector<OrientedBox>& b, std::pmr::vector<CollisionEvent>& events,
+                  std::pmr::vector<int>& axes)
+{
+    axes.resize(pairs.size());
+
+    BoxBatch batch{};
+    for (std::size_t begin = 0; begin < pairs.size(); begin += Width)
+    {
+        auto count = std::min(Width, pairs.size() - begin);
+        for (std::size_t l = 0; l < count; ++l)
+        {
+            const auto& boxA = a[begin + l];
+            const auto& boxB = b[begin + l];
+            batch.centerA.set(l, boxA.center);
+            batch.halfA.set(l, boxA.halfSize);
+            batch.centerB.set(l, boxB.center);
+            batch.halfB.set(l, boxB.halfSize);
+            for (int k = 0; k < 3; ++k)
+            {
+                batch.axesA[k].set(l, boxA.axes[k]);
+                batch.axesB[k].set(l, boxB.axes[k]);
+            }
+        }
+
+        testBoxes(batch);
+
+        for (std::size_t l = 0; l < count; ++l)
+        {
+            axes[begin + l] = batch.axis[l];
+            if (batch.overlap[l] >= 0.0F)
+            {
+                auto& event = events.emplace_back();
+                event.entity = pairs[begin + l].first;
+                event.other = pairs[begin + l].second;
+                boxManifold(a[begin + l], b[begin + l], batch.axis[l], batch.depth[l], event);
+            }
+        }
+    }
+}
+
+void collideBoxCapsules(const std::pmr::vector<Candidate>& pairs, const std::pmr::vector<OrientedBox>& boxes,
+                        const std::pmr::vector<CapsuleSegment>& capsules, std::pmr::vector<CollisionEvent>& events)
+{
+    BoxCapsuleBatch batch{};
+    for (std::size_t begin = 0; begin < pairs.size(); begin += Width)
+    {
+        auto count = std::min(Width, pairs.size() - begin);
+        for (std::size_t l = 0; l < count; ++l)
+        {
+            const auto& box = boxes[begin + l];
+            const auto& capsule = capsules[begin + l];
+            batch.center.set(l, box.center);
+            batch.half.set(l, box.halfSize);
+            batch.start.set(l, capsule.start);
+            batch.end.set(l, capsule.end);
+            for (int k = 0; k < 3; ++k)
+            {
+                batch.axes[k].set(l, box.axes[k]);
+            }
+        }
+
+        testBoxCapsules(batch);
+
+        for (std::size_t l = 0; l < count; ++l)
+        {
+            const auto& box = boxes[begin + l];
+            const auto& capsule = capsules[begin + l];
+            if (batch.distance[l] >= capsule.radius)
+            {
+                continue;
+            }
+
+            auto toLocal = [&](glm::vec3 world) {
+                auto offset = world - box.center;
+                return glm::vec3{glm::dot(offset, box.axes[0]), glm::dot(offset, box.axes[1]),
+                                 glm::dot(offset, box.axes[2])};
+            };
+
+            auto toWorld = [&](glm::vec3 local) {
+                return box.center + box.axes[0] * local.x + box.axes[1] * local.y + box.axes[2] * local.z;
+            };
+
+            auto& event = events.emplace_back();
+            event.entity = pairs[begin + l].first;
+            event.other = pairs[begin + l].second;
+
+            auto start = toLocal(capsule.start);
+            auto end = toLocal(capsule.end);
+            auto onSegment = batch.onSegment.get(l);
+            auto onBox = batch.onBox.get(l);
+            glm::vec3 normal{0.0F};
+            if (batch.distance[l] > Epsilon)
+            {
+                normal = (onSegment - onBox) / batch.distance[l];
+                event.depth = capsule.radius - batch.distance[l];
+            }
+            else
+            {
+                // The segment goes through the box: push it out through the nearest face.
+                int face = 0;
+                for (int k = 1; k < 3; ++k)
+                {
+                    if (box.halfSize[k] - std::abs(onSegment[k]) < box.halfSize[face] - std::abs(onSegment[face]))
+                    {
+                        face = k;
+                    }
+                }
+
+                normal[face] = onSegment[face] < 0.0F ? -1.0F : 1.0F;
+                event.depth = capsule.radius + box.halfSize[face] - std::abs(onSegment[face]);
+                onBox = onSegment;
+                onBox[face] = normal[face] * box.halfSize[face];
+            }
+
+            event.normal = box.axes[0] * normal.x + box.axes[1] * normal.y + box.axes[2] * normal.z;
+            event.points[0] = toWorld(onBox);
+            event.pointCount = 1;
+
+            // A capsule lying on a box touches it along a line, so also add its ends if they are touching too.
+            for (auto tip : {start, end})
+            {
+                auto closest = glm::clamp(tip, -box.halfSize, box.halfSize);
+                if (glm::length(tip - closest) < capsule.radius && glm::length(closest - onBox) > capsule.radius * 0.1F)
+                {
+                    event.points[event.pointCount++] = toWorld(closest);
+                }
+            }
+        }
+    }
+}
+
+void collideCapsules(const std::pmr::vector<Candidate>& pairs, const std::pmr::vector<CapsuleSegment>& a,
+                     const std::pmr::vector<CapsuleSegment>& b, std::pmr::vector<CollisionEvent>& events)
+{
+    CapsuleBatch batch{};
+    for (std::size_t begin = 0; begin < pairs.size(); begin += Width)
+    {
+        auto count = std::min(Width, pairs.size() - begin);
+        for (std::size_t l = 0; l < count; ++l)
+        {
+            batch.startA.set(l, a[begin + l].start);
+            batch.endA.set(l, a[begin + l].end);
+            batch.startB.set(l, b[begin + l].start);
+            batch.endB.set(l, b[begin + l].end);
+        }
+
+        testCapsules(batch);
+
+        for (std::size_t l = 0; l < count; ++l)
+        {
+            const auto& capsuleA = a[begin + l];
+            const auto& capsuleB = b[begin + l];
+            float radii = capsuleA.radius + capsuleB.radius;
+            if (batch.distance[l] >= radii)
+            {
+                continue;
+            }
+
+            auto onA = capsuleA.start + (capsuleA.end - capsuleA.start) * batch.s[l];
+            auto onB = capsuleB.start + (capsuleB.end - capsuleB.start) * batch.t[l];
+
+            auto& event = events.emplace_back();
+            event.entity = pairs[begin + l].first;
+            event.other = pairs[begin + l].second;
+            event.normal = batch.distance[l] > Epsilon ? (onB - onA) / batch.distance[l] : glm::vec3{0.0F, 1.0F, 0.0F};
+            event.depth = radii - batch.distance[l];
+            event.points[0] = onA + event.normal * (capsuleA.radius - event.depth * 0.5F);
+            event.pointCount = 1;
+        }
+    }
+}
+
+OrientedBox orientedBox(const glm::mat4& transform, const BoxCollisionShape& shape)
+{
+    OrientedBox box;
+    box.center = glm::vec3{transform[3]};
+    for (int k = 0; k < 3; ++k)
+    {
+        auto axis = glm::vec3{transform[k]};
+        float scale = glm::length(axis);
+        box.axes[k] = axis / scale;
+        box.halfSize[k] = shape.box.halfSize[k] * scale;
+    }
+    return box;
+}
+
+CapsuleSegment capsuleSegment(const glm::mat4& transform, const CapsuleCollisionShape& shape)
+{
+    CapsuleSegment capsule;
+    capsule.start = glm::vec3{transform * glm::vec4{0.0F, 0.0F, 0.0F, 1.0F}};
+    capsule.end = glm::vec3{transform * glm::vec4{0.0F, shape.capsule.length, 0.0F, 1.0F}};
+    capsule.radius =
+        shape.capsule.radius * std::max(glm::length(glm::vec3{transform[0]}), glm::length(glm::vec3{transform[2]}));
+    return capsule;
+}
+
+glm::mat4 voxelTransform(const glm::mat4& transform, const VoxelCollisionShape& shape)
+{
+    auto result = transform;
+    result[3] = transform * glm::vec4{shape.offset, 1.0F};
+    return result;
+}
+
+void collideBoxVoxels(const Candidate& pair, const OrientedBox& box, const glm::mat4& transform,
+                      const VoxelOccupancy& occupancy, std::pmr::vector<CollisionEvent>& events,
+                      BoxVoxelScratch& scratch)
+{
+    // Find the range of voxels under the bounds of the box in the grid's space.
+    auto inverse = glm::inverse(transform);
+    auto center = glm::vec3{inverse * glm::vec4{box.center, 1.0F}};
+    auto extent = glm::vec3{0.0F};
+    for (int k = 0; k < 3; ++k)
+    {
+        extent += glm::abs(glm::vec3{inverse * glm::vec4{box.axes[k], 0.0F}}) * box.halfSize[k];
+    }
+
+    auto min = glm::ivec3{glm::floor(center - extent)};
+    auto max = glm::ivec3{glm::floor(center + extent)};
+
+    // Most boxes near a grid don't touch any of its voxels, which a few word tests are enough to tell.
+    if (!occupancy.overlaps(min, max))
+    {
+        return;
+    }
+
+    // Test the box against every voxel in range which can be touched. Buried voxels are skipped, as they would give
+    // normals pointing out of the sides of the voxels above them.
+    scratch.pairs.clear();
+    scratch.boxes.clear();
+    scratch.voxels.clear();
+    scratch.contacts.clear();
+    occupancy.forEach(min, max, [&](glm::ivec3 voxel) {
+        if (occupancy.surface(voxel))
+        {
+            auto voxelToWorld = transform;
+            voxelToWorld[3] = transform * glm::vec4{glm::vec3{voxel} + 0.5F, 1.0F};
+            scratch.pairs.push_back(pair);
+            scratch.boxes.push_back(box);
+            scratch.voxels.push_back(orientedBox(voxelToWorld, BoxCollisionShape{}));
+        }
+    });
+
+    collideBoxes(scratch.pairs, scratch.boxes, scratch.voxels, scratch.contacts, scratch.axes);
+    const auto& contacts = scratch.contacts;
+    if (contacts.empty())
+    {
+        return;
+    }
+
+    // Merge the contacts into a single manifold, with the normal of the deepest one, adding the points of the others
+    // which push in roughly the same direction.
+    auto deepest = std::max_element(contacts.begin(), contacts.end(), [](const auto& a, const auto& b) {
+        return a.depth < b.depth;
+    });
+    auto& event = events.emplace_back(*deepest);
+    for (const auto& contact : contacts)
+    {
+        if (&contact == &*deepest || glm::dot(contact.normal, event.normal) < VoxelNormalCosine)
+        {
+            continue;
+        }
+
+        for (std::size_t i = 0; i < contact.pointCount && event.pointCount < CollisionEvent::MaxPoints; ++i)
+        {
+            event.points[event.pointCount++] = contact.points[i];
+        }
+    }
+}
+
+void narrowPhase(Query<Read<LocalToWorld>, Read<Collider>, OptRead<BoxCollisionShape>, OptRead<CapsuleCollisionShape>,
+                       OptRead<VoxelCollisionShape>>
+                     query,
+                 Read<BroadPhaseCollisions> collisions, Write<CollisionPairCache> cache, Write<NarrowPhaseArena> arena,
+                 EventWriter<CollisionEvent> writer, EventWriter<CollisionStartedEvent> startedWriter,
+                 EventWriter<CollisionEndedEvent> endedWriter)
+{
+    // The arrays below are rebuilt every frame, so they're allocated from the narrow phase's arena,
+    // which is reset at the start of each frame.
+    arena->memory.reset();
+    auto* memory = &arena->memory;
+    std::pmr::vector<Candidate> pairs{memory};
+    std::pmr::vector<CollisionPairCache::Entry*> entries{memory};
+    std::pmr::vector<int> axes{memory};
+    std::pmr::vector<OrientedBox> boxes{memory};
+    std::pmr::vector<OrientedBox> otherBoxes{memory};
+    std::pmr::vector<CapsuleSegment> capsules{memory};
+    std::pmr::vector<CapsuleSegment> otherCapsules{memory};
+    std::pmr::vector<CollisionEvent> events{memory};
+    BoxVoxelScratch scratch{memory};
+
+    cache->beginFrame();
+
+    // Gather the shapes of each type of pair into contiguous arrays, so that the tests can run in batches.
+    for (const auto& pair : collisions->candidates(CollisionType::BoxBox))
+    {
+        auto [localToWorld, collider, box, capsule, voxel] = query[pair.first].value();
+        auto [otherLocalToWorld, otherCollider, otherBox, otherCapsule, otherVoxel] = query[pair.second].value();
+        auto shape = orientedBox(localToWorld->mat * collider->transform, *box);
+        auto otherShape = orientedBox(otherLocalToWorld->mat * otherCollider->transform, *otherBox);
+
+        // Skip the full test if the axis found on the last test still separates the boxes.
+        auto& entry = cache->update(pair.first, pair.second);
+        if (entry.axis >= 0 && separates(shape, otherShape, entry.axis))
+        {
+            continue;
+        }
+
+        pairs.push_back(pair);
+        entries.push_back(&entry);
+        boxes.push_back(shape);
+        otherBoxes.push_back(otherShape);
+    }
+
+    collideBoxes(pairs, boxes, otherBoxes, events, axes);
+
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        entries[i]->axis = axes[i];
+    }
+
+    pairs.clear();
+    boxes.clear();
+    for (const auto& pair : collisions->candidates(CollisionType::BoxCapsule))
+    {
+        auto [localToWorld, collider, box, capsule, voxel] = query[pair.first].value();
+        auto [otherLocalToWorld, otherCollider, otherBox, otherCapsule, otherVoxel] = query[pair.second].value();
+        cache->update(pair.first, pair.second);
+
+        // Order the pair so that the box comes first.
+        if (box)
+        {
+            pairs.push_back(pair);
+            boxes.push_back(orientedBox(localToWorld->mat * collider->transform, *box));
+            capsules.push_back(capsuleSegment(otherLocalToWorld->mat * otherCollider->transform, *otherCapsule));
+        }
+        else
+        {
+            pairs.emplace_back(pair.second, pair.first);
+            boxes.push_back(orientedBox(otherLocalToWorld->mat * otherCollider->transform, *otherBox));
+            capsules.push_back(capsuleSegment(localToWorld->mat * collider->transform, *capsule));
+        }
+    }
+
+    collideBoxCapsules(pairs, boxes, capsules, events);
+
+    pairs.clear();
+    capsules.clear();
+    for (const auto& pair : collisions->candidates(CollisionType::CapsuleCapsule))
+    {
+        auto [localToWorld, collider, box, capsule, voxel] = query[pair.first].value();
+        auto [otherLocalToWorld, otherCollider, otherBox, otherCapsule, otherVoxel] = query[pair.second].value();
+        cache->update(pair.first, pair.second);
+        pairs.push_back(pair);
+        capsules.push_back(capsuleSegment(localToWorld->mat * collider->transform, *capsule));
+        otherCapsules.push_back(capsuleSegment(otherLocalToWorld->mat * otherCollider->transform, *otherCapsule));
+    }
+
+    collideCapsules(pairs, capsules, otherCapsules, events);
+
+    for (const auto& pair : collisions->candidates(CollisionType::BoxVoxel))
+    {
+        auto [localToWorld, collider, box, capsule, voxel] = query[pair.first].value();
+        auto [otherLocalToWorld, otherCollider, otherBox, otherCapsule, otherVoxel] = query[pair.second].value();
+        cache->update(pair.first, pair.second);
+
+        // Order the pair so that the box comes first.
+        if (box)
+        {
+            collideBoxVoxels(pair, orientedBox(localToWorld->mat * collider->transform, *box),
+                             voxelTransform(otherLocalToWorld->mat * otherCollider->transform, *otherVoxel),
+                             *otherVoxel->occupancy, events, scratch);
+        }
+        else
+        {
+            collideBoxVoxels({pair.second, pair.first},
+                             orientedBox(otherLocalToWorld->mat * otherCollider->transform, *otherBox),
+                             voxelTransform(localToWorld->mat * collider->transform, *voxel), *voxel->occupancy,
+                             events, scratch);
+        }
+    }
+
+    // Pairs of sleeping colliders aren't tested, as nothing changed since the last time they were.
+    for (const auto& pair : collisions->restingPairs)
+    {
+        auto& entry = cache->update(pair.first, pair.second);
+        entry.touching = entry.wasTouching;
+    }
+
+    for (const auto& event : events)
+    {
+        cache->update(event.entity, event.other).touching = true;
+        writer.push(event);
+    }
+
+    cache->endFrame([&](Entity entity, Entity other) { startedWriter.push(CollisionStartedEvent{entity, other}); },
+                    [&](Entity entity, Entity other) { endedWriter.push(CollisionEndedEvent{entity, other}); });
+}
@@ -0,0 +1,158 @@
+/// @file
+/// @brief Narrow phase collision detection systems.
+
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cubos/core/ecs/system/event/writer.hpp>
+#include <cubos/core/ecs/system/query.hpp>
+#include <cubos/core/memory/arena_allocator.hpp>
+
+#include <cubos/engine/collisions/broad_phase_collisions.hpp>
+#include <cubos/engine/collisions/collider.hpp>
+#include <cubos/engine/collisions/collision_event.hpp>
+#include <cubos/engine/collisions/collision_pair_cache.hpp>
+#include <cubos/engine/collisions/shapes/box.hpp>
+#include <cubos/engine/collisions/shapes/capsule.hpp>
+#include <cubos/engine/collisions/shapes/voxel.hpp>
+#include <cubos/engine/collisions/voxel_occupancy.hpp>
+#include <cubos/engine/cubos.hpp>
+#include <cubos/engine/transform/plugin.hpp>
+
+using cubos::core::ecs::Entity;
+using cubos::core::ecs::EventWriter;
+using cubos::core::ecs::OptRead;
+using cubos::core::ecs::Query;
+using cubos::core::ecs::Read;
+using cubos::core::ecs::Write;
+
+using cubos::engine::BoxCollisionShape;
+using cubos::engine::BroadPhaseCollisions;
+using cubos::engine::CapsuleCollisionShape;
+using cubos::engine::Collider;
+using cubos::engine::CollisionEndedEvent;
+using cubos::engine::CollisionEvent;
+using cubos::engine::CollisionPairCache;
+using cubos::engine::CollisionStartedEvent;
+using cubos::engine::LocalToWorld;
+using cubos::engine::VoxelCollisionShape;
+using cubos::engine::VoxelOccupancy;
+
+/// @brief Arena from which the narrow phase allocates the arrays it rebuilds every frame.
+///
+/// Only the narrow phase writes to it, so, unlike the shared frame allocator, it doesn't make the
+/// narrow phase wait for other systems which need scratch memory.
+struct NarrowPhaseArena
+{
+    cubos::core::memory::ArenaAllocator memory{256 * 1024}; ///< Reset at the start of each run.
+};
+
+/// @brief Box collision shape in world space.
+struct OrientedBox
+{
+    glm::vec3 center;   ///< Center of the box.
+    glm::vec3 axes[3];  ///< Unit vectors along each of the box's local axes.
+    glm::vec3 halfSize; ///< Half of the size of the box along each of its axes.
+};
+
+/// @brief Capsule collision shape in world space.
+struct CapsuleSegment
+{
+    glm::vec3 start; ///< Center of one of the capsule's hemispheres.
+    glm::vec3 end;   ///< Center of the other hemisphere.
+    float radius;    ///< Radius of the capsule.
+};
+
+/// @brief Arrays used by @ref collideBoxVoxels, kept between calls so that their memory is reused.
+struct BoxVoxelScratch
+{
+    /// @brief Constructs.
+    /// @param memory Memory resource used by the arrays.
+    explicit BoxVoxelScratch(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : pairs(memory)
+        , boxes(memory)
+        , voxels(memory)
+        , contacts(memory)
+        , axes(memory)
+    {
+    }
+
+    std::pmr::vector<BroadPhaseCollisions::Candidate> pairs; ///< Pair repeated for each voxel.
+    std::pmr::vector<OrientedBox> boxes;                     ///< Box repeated for each voxel.
+    std::pmr::vector<OrientedBox> voxels;                    ///< Box of each voxel.
+    std::pmr::vector<CollisionEvent> contacts;               ///< Contacts with each voxel.
+    std::pmr::vector<int> axes;                              ///< Axes found by the box test.
+};
+
+/// @brief Gets the box of a collider in world space.
+/// @param transform Transform from the collider's space to world space.
+/// @param shape Shape of the collider.
+/// @return Box in world space.
+OrientedBox orientedBox(const glm::mat4& transform, const BoxCollisionShape& shape);
+
+/// @brief Gets the capsule of a collider in world space.
+/// @param transform Transform from the collider's space to world space.
+/// @param shape Shape of the collider.
+/// @return Capsule in world space.
+CapsuleSegment capsuleSegment(const glm::mat4& transform, const CapsuleCollisionShape& shape);
+
+/// @brief Gets the transform from the space of a voxel collider's grid, in voxels, to world space.
+/// @param transform Transform from the collider's space to world space.
+/// @param shape Shape of the collider.
+/// @return Transform from grid space to world space.
+glm::mat4 voxelTransform(const glm::mat4& transform, const VoxelCollisionShape& shape);
+
+/// @brief Finds the contacts between pairs of boxes, using the separating axis theorem.
+/// @param pairs Pairs of entities.
+/// @param a Shape of the first entity of each pair.
+/// @param b Shape of the second entity of each pair.
+/// @param events Vector to which an event is appended for each pair which collides.
+/// @param[out] axes Axis which separates each pair, or along which it penetrates the least.
+void collideBoxes(const std::pmr::vector<BroadPhaseCollisions::Candidate>& pairs,
+                  const std::pmr::vector<OrientedBox>& a, const std::pmr::vector<OrientedBox>& b,
+                  std::pmr::vector<CollisionEvent>& events, std::pmr::vector<int>& axes);
+
+/// @brief Finds the contacts between pairs of a box and a capsule.
+/// @param pairs Pairs of entities, where the first is the box.
+/// @param boxes Shape of the first entity of each pair.
+/// @param capsules Shape of the second entity of each pair.
+/// @param events Vector to which an event is appended for each pair which collides.
+void collideBoxCapsules(const std::pmr::vector<BroadPhaseCollisions::Candidate>& pairs,
+                        const std::pmr::vector<OrientedBox>& boxes,
+                        const std::pmr::vector<CapsuleSegment>& capsules, std::pmr::vector<CollisionEvent>& events);
+
+/// @brief Finds the contacts between pairs of capsules.
+/// @param pairs Pairs of entities.
+/// @param a Shape of the first entity of each pair.
+/// @param b Shape of the second entity of each pair.
+/// @param events Vector to which an event is appended for each pair which collides.
+void collideCapsules(const std::pmr::vector<BroadPhaseCollisions::Candidate>& pairs,
+                     const std::pmr::vector<CapsuleSegment>& a, const std::pmr::vector<CapsuleSegment>& b,
+                     std::pmr::vector<CollisionEvent>& events);
+
+/// @brief Finds the contact between a box and a voxel grid, by testing the box against each solid voxel on the
+/// surface of the grid within its bounds, and merging the contacts into a single manifold.
+/// @param pair Pair of entities, where the first is the box.
+/// @param box Shape of the box.
+/// @param transform Transform from the grid's space, in voxels, to world space.
+/// @param occupancy Occupancy of the grid.
+/// @param events Vector to which an event is appended if the pair collides.
+/// @param scratch Arrays reused between calls.
+void collideBoxVoxels(const BroadPhaseCollisions::Candidate& pair, const OrientedBox& box, const glm::mat4& transform,
+                      const VoxelOccupancy& occupancy, std::pmr::vector<CollisionEvent>& events,
+                      BoxVoxelScratch& scratch);
+
+/// @brief Tests the collision candidates of each type, sending a @ref CollisionEvent for each pair
+/// which is actually colliding, and a @ref CollisionStartedEvent or @ref CollisionEndedEvent for
+/// each pair which started or stopped colliding, as tracked by the @ref CollisionPairCache.
+void narrowPhase(Query<Read<LocalToWorld>, Read<Collider>, OptRead<BoxCollisionShape>, OptRead<CapsuleCollisionShape>,
+                       OptRead<VoxelCollisionShape>>
+                     query,
+                 Read<BroadPhaseCollisions> collisions, Write<CollisionPairCache> cache, Write<NarrowPhaseArena> arena,
+                 EventWriter<CollisionEvent> writer, EventWriter<CollisionStartedEvent> startedWriter,
+                 EventWriter<CollisionEndedEvent> endedWriter);
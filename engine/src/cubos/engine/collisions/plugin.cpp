@@ -1,26 +1,129 @@
+#include <algorithm>
+#include <thread>
+
+#include <cubos/core/log.hpp>
+
+#include <cubos/engine/assets/plugin.hpp>
 #include <cubos/engine/collisions/broad_phase_collisions.hpp>
+#include <cubos/engine/collisions/collision_pair_cache.hpp>
+#include <cubos/engine/collisions/collision_world.hpp>
 #include <cubos/engine/collisions/plugin.hpp>
+#include <cubos/engine/collisions/voxel_occupancy_cache.hpp>
+#include <cubos/engine/settings/plugin.hpp>
 
 #include "broad_phase.hpp"
+#include "narrow_phase.hpp"
+
+using cubos::engine::CollisionWorld;
+using cubos::engine::Settings;
+
+static void init(Write<Settings> settings, Write<BroadPhaseCollisions> collisions, Write<CollisionWorld> world)
+{
+    auto method = settings->getString("collisions.broadPhase", "sweepAndPrune");
+    if (method == "aabbTree")
+    {
+        collisions->method = BroadPhaseCollisions::Method::AABBTree;
+    }
+    else if (method == "spatialHash")
+    {
+        collisions->method = BroadPhaseCollisions::Method::SpatialHash;
+    }
+    else if (method == "sweepAndPrune")
+    {
+        collisions->method = BroadPhaseCollisions::Method::SweepAndPrune;
+    }
+    else
+    {
+        CUBOS_WARN("Unknown broad phase method '{}', using sweep and prune", method);
+        collisions->method = BroadPhaseCollisions::Method::SweepAndPrune;
+    }
+
+    auto cellSize = settings->getDouble("collisions.spatialHash.cellSize", 4.0);
+    collisions->spatialHash.cellSize(static_cast<float>(cellSize));
+    collisions->restingHash.cellSize(static_cast<float>(cellSize));
+
+    collisions->sleepFrames = settings->getInteger("collisions.sleepFrames", 30);
+
+    auto threads = settings->getInteger("collisions.threads", static_cast<int>(std::thread::hardware_concurrency()));
+    collisions->useThreads(static_cast<std::size_t>(std::max(threads, 1)));
+    world->useThreadPool(collisions->threadPool.get(), collisions->threadCount);
+}
+
+static void updateWorld(
+    Query<Read<Collider>, OptRead<BoxCollisionShape>, OptRead<CapsuleCollisionShape>, OptRead<VoxelCollisionShape>>
+        query,
+    Write<CollisionWorld> world)
+{
+    world->beginFrame();
+    for (auto [entity, collider, box, capsule, voxel] : query)
+    {
+        // Sleeping colliders haven't moved since they were last updated.
+        if (collider->sleeping && world->keep(entity))
+        {
+            continue;
+        }
+
+        if (box)
+        {
+            world->update(entity, collider->worldTransform, collider->worldAABB, box->box);
+        }
+        else if (capsule)
+        {
+            world->update(entity, collider->worldTransform, collider->worldAABB, capsule->capsule);
+        }
+        else if (voxel && voxel->occupancy)
+        {
+            world->update(entity, voxelTransform(collider->worldTransform, *voxel), collider->worldAABB,
+                          voxel->occupancy);
+        }
+    }
+    world->endFrame();
+}
 
 void cubos::engine::collisionsPlugin(Cubos& cubos)
 {
+    cubos.addPlugin(settingsPlugin);
     cubos.addPlugin(transformPlugin);
+    cubos.addPlugin(assetsPlugin);
 
     cubos.addResource<BroadPhaseCollisions>();
+    cubos.addResource<CollisionPairCache>();
+    cubos.addResource<CollisionWorld>();
+    cubos.addResource<NarrowPhaseArena>();
+    cubos.addResource<VoxelOccupancyCache>();
+
+    cubos.addEvent<CollisionEvent>();
+    cubos.addEvent<CollisionStartedEvent>();
+    cubos.addEvent<CollisionEndedEvent>();
 
     cubos.addComponent<Collider>();
     cubos.addComponent<BoxCollisionShape>();
     cubos.addComponent<CapsuleCollisionShape>();
+    cubos.addComponent<VoxelCollisionShape>();
+
+    cubos.startupTag("cubos.collisions.init").after("cubos.settings");
+    cubos.startupSystem(init).tagged("cubos.collisions.init");
 
     cubos.system(setupNewBoxes).tagged("cubos.collisions.setup");
     cubos.system(setupNewCapsules).tagged("cubos.collisions.setup");
+    cubos.system(setupVoxels).tagged("cubos.collisions.setup");
     cubos.system(updateAABBs)
+        .tagged("cubos.collisions.aabb")
         .after("cubos.collisions.setup")
         .after("cubos.transform.update")
         .before("cubos.collisions.broad.markers");
 
     cubos.system(updateMarkers).tagged("cubos.collisions.broad.markers");
     cubos.system(sweep).tagged("cubos.collisions.broad.sweep").after("cubos.collisions.broad.markers");
-    cubos.system(findPairs).tagged("cubos.collisions.broad").after("cubos.collisions.broad.sweep");
+    cubos.system(updateTree).tagged("cubos.collisions.broad.tree").after("cubos.collisions.broad.markers");
+    cubos.system(updateSpatialHash).tagged("cubos.collisions.broad.hash").after("cubos.collisions.broad.markers");
+    cubos.system(findPairs)
+        .tagged("cubos.collisions.broad")
+        .after("cubos.collisions.broad.sweep")
+        .after("cubos.collisions.broad.tree")
+        .after("cubos.collisions.broad.hash");
+
+    cubos.system(updateWorld).tagged("cubos.collisions.world").after("cubos.collisions.broad.markers");
+
+    cubos.system(narrowPhase).tagged("cubos.collisions.narrow").after("cubos.collisions.broad");
 }
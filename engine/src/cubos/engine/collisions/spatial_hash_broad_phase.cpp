@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cmath>
+
+#include <glm/common.hpp>
+#include <glm/vector_relational.hpp>
+
+#include <cubos/core/log.hpp>
+
+#include <cubos/engine/collisions/spatial_hash_broad_phase.hpp>
+
+using cubos::core::ecs::Entity;
+using cubos::core::geom::AABB;
+
+using cubos::engine::SpatialHashBroadPhase;
+
+SpatialHashBroadPhase::SpatialHashBroadPhase(float cellSize)
+    : mCellSize(cellSize)
+    , mInverseCellSize(1.0F / cellSize)
+{
+    // Do nothing.
+}
+
+void SpatialHashBroadPhase::cellSize(float cellSize)
+{
+    mCellSize = cellSize;
+}
+
+float SpatialHashBroadPhase::cellSize() const
+{
+    return mCellSize;
+}
+
+void SpatialHashBroadPhase::clear()
+{
+    mEntries.clear();
+    mCells.clear();
+    mLarge.clear();
+    mSorted = true;
+    mInverseCellSize = 1.0F / mCellSize;
+}
+
+void SpatialHashBroadPhase::insert(Entity entity, const AABB& aabb)
+{
+    auto index = static_cast<std::uint32_t>(mEntries.size());
+    mSorted = false;
+
+    if (!this->fits(aabb))
+    {
+        mEntries.push_back({entity, aabb, true});
+        mLarge.push_back(index);
+        return;
+    }
+
+    mEntries.push_back({entity, aabb, false});
+    auto min = this->cellOf(aabb.min());
+    auto max = this->cellOf(aabb.max());
+    for (int x = min.x; x <= max.x; ++x)
+    {
+        for (int y = min.y; y <= max.y; ++y)
+        {
+            for (int z = min.z; z <= max.z; ++z)
+            {
+                mCells.push_back({pack({x, y, z}), index});
+            }
+        }
+    }
+}
+
+void SpatialHashBroadPhase::findPairs(std::vector<Pair>& pairs)
+{
+    // Group the references by cell, so that each cell's entries are contiguous.
+    std::sort(mCells.begin(), mCells.end(), [](const CellEntry& a, const CellEntry& b) {
+        return a.cell < b.cell || (a.cell == b.cell && a.entry < b.entry);
+    });
+    mSorted = true;
+
+    for (std::size_t begin = 0; begin < mCells.size();)
+    {
+        auto cell = mCells[begin].cell;
+        auto end = begin + 1;
+        while (end < mCells.size() && mCells[end].cell == cell)
+        {
+            ++end;
+        }
+
+        for (auto i = begin; i < end; ++i)
+        {
+            const auto& a = mEntries[mCells[i].entry];
+            for (auto j = i + 1; j < end; ++j)
+            {
+                const auto& b = mEntries[mCells[j].entry];
+                if (!a.aabb.overlaps(b.aabb))
+                {
+                    continue;
+                }
+
+                // Both AABBs touch the cell containing the intersection's minimum corner, so
+                // reporting the pair only there reports it exactly once.
+                if (pack(this->cellOf(glm::max(a.aabb.min(), b.aabb.min()))) == cell)
+                {
+                    pairs.emplace_back(a.entity, b.entity);
+                }
+            }
+        }
+
+        begin = end;
+    }
+
+    for (auto large : mLarge)
+    {
+        const auto& a = mEntries[large];
+        for (std::uint32_t other = 0; other < mEntries.size(); ++other)
+        {
+            // Pairs of two large entries are reported by the one which was inserted first.
+            const auto& b = mEntries[other];
+            if (other == large || (b.oversized && other < large))
+            {
+                continue;
+            }
+
+            if (a.aabb.overlaps(b.aabb))
+            {
+                pairs.emplace_back(a.entity, b.entity);
+            }
+        }
+    }
+}
+
+void SpatialHashBroadPhase::query(const AABB& aabb, std::vector<Entity>& entities) const
+{
+    CUBOS_DEBUG_ASSERT(mSorted, "The grid must be sorted by findPairs() before being queried");
+
+    // An AABB which doesn't fit in the grid is tested against every entry.
+    if (!this->fits(aabb))
+    {
+        for (const auto& entry : mEntries)
+        {
+            if (entry.aabb.overlaps(aabb))
+            {
+                entities.push_back(entry.entity);
+            }
+        }
+        return;
+    }
+
+    auto min = this->cellOf(aabb.min());
+    auto max = this->cellOf(aabb.max());
+    for (int x = min.x; x <= max.x; ++x)
+    {
+        for (int y = min.y; y <= max.y; ++y)
+        {
+            for (int z = min.z; z <= max.z; ++z)
+            {
+                auto cell = pack({x, y, z});
+                auto it = std::lower_bound(mCells.begin(), mCells.end(), cell,
+                                           [](const CellEntry& entry, std::uint64_t key) { return entry.cell < key; });
+                for (; it != mCells.end() && it->cell == cell; ++it)
+                {
+                    // Just like in findPairs(), entries touching several of the cells are only
+                    // reported by the one containing the intersection's minimum corner.
+                    const auto& entry = mEntries[it->entry];
+                    if (entry.aabb.overlaps(aabb) &&
+                        pack(this->cellOf(glm::max(entry.aabb.min(), aabb.min()))) == cell)
+                    {
+                        entities.push_back(entry.entity);
+                    }
+                }
+            }
+        }
+    }
+
+    for (auto large : mLarge)
+    {
+        if (mEntries[large].aabb.overlaps(aabb))
+        {
+            entities.push_back(mEntries[large].entity);
+        }
+    }
+}
+
+std::size_t SpatialHashBroadPhase::size() const
+{
+    return mEntries.size();
+}
+
+glm::ivec3 SpatialHashBroadPhase::cellOf(glm::vec3 point) const
+{
+    return glm::ivec3{glm::floor(point * mInverseCellSize)};
+}
+
+bool SpatialHashBroadPhase::fits(const AABB& aabb) const
+{
+    // Count the cells in floating point first, as infinite or huge AABBs would overflow integers.
+    // AABBs outside the range of packed coordinates are also kept out, as their cells would alias.
+    auto first = glm::floor(aabb.min() * mInverseCellSize);
+    auto last = glm::floor(aabb.max() * mInverseCellSize);
+    auto extent = last - first + glm::vec3{1.0F};
+    float cellCount = extent.x * extent.y * extent.z;
+    return std::isfinite(cellCount) && cellCount <= static_cast<float>(MaxCellsPerEntry) &&
+           glm::all(glm::greaterThanEqual(first, glm::vec3{static_cast<float>(-MaxCell)})) &&
+           glm::all(glm::lessThan(last, glm::vec3{static_cast<float>(MaxCell)}));
+}
+
+std::uint64_t SpatialHashBroadPhase::pack(glm::ivec3 cell)
+{
+    CUBOS_DEBUG_ASSERT(glm::all(glm::greaterThanEqual(cell, glm::ivec3{-MaxCell})) &&
+                           glm::all(glm::lessThan(cell, glm::ivec3{MaxCell})),
+                       "Cell coordinates out of the packable range");
+
+    constexpr std::uint64_t Mask = (1U << 21) - 1;
+    return (static_cast<std::uint64_t>(cell.x) & Mask) | ((static_cast<std::uint64_t>(cell.y) & Mask) << 21) |
+           ((static_cast<std::uint64_t>(cell.z) & Mask) << 42);
+}
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/common.hpp>
+#include <glm/vector_relational.hpp>
+
+#include <cubos/engine/collisions/voxel_occupancy.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+using cubos::engine::VoxelGrid;
+using cubos::engine::VoxelOccupancy;
+
+VoxelOccupancy::VoxelOccupancy(const VoxelGrid& grid)
+    : mSize(grid.size())
+    , mWordsPerRow((static_cast<std::size_t>(grid.size().x) + 63) / 64)
+{
+    mWords.resize(mWordsPerRow * mSize.y * mSize.z, 0);
+    for (int z = 0; z < static_cast<int>(mSize.z); ++z)
+    {
+        for (int y = 0; y < static_cast<int>(mSize.y); ++y)
+        {
+            auto row = this->row(y, z);
+            for (int x = 0; x < static_cast<int>(mSize.x); ++x)
+            {
+                if (grid.get({x, y, z}) != 0)
+                {
+                    mWords[row + static_cast<std::size_t>(x / 64)] |= uint64_t{1} << (x % 64);
+                }
+            }
+        }
+    }
+}
+
+const glm::uvec3& VoxelOccupancy::size() const
+{
+    return mSize;
+}
+
+bool VoxelOccupancy::get(const glm::ivec3& position) const
+{
+    if (glm::any(glm::lessThan(position, glm::ivec3{0})) ||
+        glm::any(glm::greaterThanEqual(position, glm::ivec3{mSize})))
+    {
+        return false;
+    }
+
+    auto word = mWords[this->row(position.y, position.z) + static_cast<std::size_t>(position.x / 64)];
+    return ((word >> (position.x % 64)) & 1) != 0;
+}
+
+bool VoxelOccupancy::surface(const glm::ivec3& position) const
+{
+    if (!this->get(position))
+    {
+        return false;
+    }
+
+    for (int k = 0; k < 3; ++k)
+    {
+        auto offset = glm::ivec3{0};
+        offset[k] = 1;
+        if (!this->get(position + offset) || !this->get(position - offset))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VoxelOccupancy::clamp(glm::ivec3& min, glm::ivec3& max) const
+{
+    min = glm::max(min, glm::ivec3{0});
+    max = glm::min(max, glm::ivec3{mSize} - 1);
+    return glm::all(glm::lessThanEqual(min, max));
+}
+
+bool VoxelOccupancy::overlaps(glm::ivec3 min, glm::ivec3 max) const
+{
+    if (!this->clamp(min, max))
+    {
+        return false;
+    }
+
+    for (int z = min.z; z <= max.z; ++z)
+    {
+        for (int y = min.y; y <= max.y; ++y)
+        {
+            auto row = this->row(y, z);
+            for (int w = min.x / 64; w <= max.x / 64; ++w)
+            {
+                if ((mWords[row + static_cast<std::size_t>(w)] & mask(w, min.x, max.x)) != 0)
+                {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+bool VoxelOccupancy::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, glm::ivec3& voxel,
+                             float& distance, glm::vec3& normal) const
+{
+    constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+    // Clip the ray to the bounds of the volume, remembering the axis through which it enters.
+    float enter = 0.0F;
+    float exit = maxDistance;
+    int enterAxis = -1;
+    for (int k = 0; k < 3; ++k)
+    {
+        if (direction[k] == 0.0F)
+        {
+            if (origin[k] < 0.0F || origin[k] > static_cast<float>(mSize[k]))
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        float near = -origin[k] / direction[k];
+        float far = (static_cast<float>(mSize[k]) - origin[k]) / direction[k];
+        if (near > far)
+        {
+            std::swap(near, far);
+        }
+
+        if (near > enter)
+        {
+            enter = near;
+            enterAxis = k;
+        }
+
+        exit = std::min(exit, far);
+    }
+
+    if (enter > exit)
+    {
+        return false;
+    }
+
+    // Walk from the voxel where the ray enters the volume, always crossing the nearest boundary.
+    auto start = origin + direction * enter;
+    voxel = glm::clamp(glm::ivec3{glm::floor(start)}, glm::ivec3{0}, glm::ivec3{mSize} - 1);
+    normal = glm::vec3{0.0F};
+    if (enterAxis >= 0)
+    {
+        normal[enterAxis] = direction[enterAxis] > 0.0F ? -1.0F : 1.0F;
+    }
+
+    glm::ivec3 step;
+    glm::vec3 next;
+    glm::vec3 delta;
+    for (int k = 0; k < 3; ++k)
+    {
+        if (direction[k] > 0.0F)
+        {
+            step[k] = 1;
+            delta[k] = 1.0F / direction[k];
+            next[k] = (static_cast<float>(voxel[k] + 1) - origin[k]) / direction[k];
+        }
+        else if (direction[k] < 0.0F)
+        {
+            step[k] = -1;
+            delta[k] = -1.0F / direction[k];
+            next[k] = (static_cast<float>(voxel[k]) - origin[k]) / direction[k];
+        }
+        else
+        {
+            step[k] = 0;
+            delta[k] = Infinity;
+            next[k] = Infinity;
+        }
+    }
+
+    distance = enter;
+    while (true)
+    {
+        if (this->get(voxel))
+        {
+            return true;
+        }
+
+        int axis = next.x < next.y ? (next.x < next.z ? 0 : 2) : (next.y < next.z ? 1 : 2);
+        if (next[axis] > exit)
+        {
+            return false;
+        }
+
+        distance = next[axis];
+        voxel[axis] += step[axis];
+        if (voxel[axis] < 0 || voxel[axis] >= static_cast<int>(mSize[axis]))
+        {
+            return false;
+        }
+
+        next[axis] += delta[axis];
+        normal = glm::vec3{0.0F};
+        normal[axis] = static_cast<float>(-step[axis]);
+    }
+}
+
+std::size_t VoxelOccupancy::memory() const
+{
+    return mWords.size() * sizeof(uint64_t);
+}
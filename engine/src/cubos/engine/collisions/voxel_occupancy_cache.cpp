@@ -0,0 +1,32 @@
+#include <cubos/engine/collisions/voxel_occupancy_cache.hpp>
+
+using cubos::engine::Asset;
+using cubos::engine::Assets;
+using cubos::engine::VoxelGrid;
+using cubos::engine::VoxelOccupancy;
+using cubos::engine::VoxelOccupancyCache;
+
+std::shared_ptr<const VoxelOccupancy> VoxelOccupancyCache::get(const Assets& assets, const Asset<VoxelGrid>& grid)
+{
+    auto& entry = mEntries[grid.getId()];
+    if (auto occupancy = entry.occupancy.lock(); occupancy != nullptr && entry.version == grid.getVersion())
+    {
+        return occupancy;
+    }
+
+    auto read = assets.read(grid);
+    auto occupancy = std::make_shared<const VoxelOccupancy>(read.get());
+    entry.version = grid.getVersion();
+    entry.occupancy = occupancy;
+    return occupancy;
+}
+
+void VoxelOccupancyCache::prune()
+{
+    std::erase_if(mEntries, [](const auto& pair) { return pair.second.occupancy.expired(); });
+}
+
+std::size_t VoxelOccupancyCache::size() const
+{
+    return mEntries.size();
+}
@@ -125,6 +125,8 @@ Cubos::Cubos(int argc, char** argv)
     this->addResource<DeltaTime>(0.0F);
     this->addResource<ShouldQuit>(true);
     this->addResource<Arguments>(arguments);
+    this->addResource<FrameAllocator>();
+    this->addResource<DispatcherProfile>();
 }
 
 void Cubos::run()
@@ -140,12 +142,15 @@ void Cubos::run()
     cubos::core::ecs::CommandBuffer cmds(mWorld);
 
     mStartupDispatcher.callSystems(mWorld, cmds);
+    core::memory::AllocationTracker::endFrame();
 
     auto currentTime = std::chrono::steady_clock::now();
     auto previousTime = std::chrono::steady_clock::now();
     do
     {
         mMainDispatcher.callSystems(mWorld, cmds);
+        mWorld.write<FrameAllocator>().get().endFrame();
+        mWorld.write<DispatcherProfile>().get().allocations = core::memory::AllocationTracker::endFrame();
         currentTime = std::chrono::steady_clock::now();
         mWorld.write<DeltaTime>().get().value = std::chrono::duration<float>(currentTime - previousTime).count();
         previousTime = currentTime;
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <atomic>
+#include <numeric>
 #include <random>
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -16,12 +19,98 @@
 using namespace cubos::core::gl;
 using cubos::engine::DeferredRenderer;
 
-/// Deferred renderer grid implementation.
-struct DeferredGrid : public cubos::engine::impl::RendererGrid
+/// Levels of detail are only built for grids at least this many times their downsampling factor.
+static constexpr unsigned int MinLodSize = 8;
+
+/// Ratio between the voxel sizes on screen at which levels of detail switch in each direction.
+static constexpr float LodHysteresis = 1.25F;
+
+/// Edits which change at most this many chunks, enough for a single chunk and its neighbors, are
+/// triangulated on the render thread. Larger ones are left to the background threads.
+static constexpr std::size_t MaxSyncChunks = 8;
+
+/// GPU buffers of the triangulation of a chunk of a grid.
+struct DeferredMesh
 {
+    /// Origin of the chunk, which the positions of its vertices are relative to.
+    glm::uvec3 origin;
+
     VertexArray va;
     IndexBuffer ib;
-    std::size_t indexCount;
+    std::size_t indexCount = 0;
+};
+
+/// Triangulation of some chunks of a grid running in the background.
+struct MeshingJob
+{
+    std::shared_ptr<const cubos::engine::VoxelGrid> grid;
+    std::vector<std::size_t> chunks;
+    cubos::engine::MeshCache::Mesh mesh;
+    std::atomic<bool> done{false};
+};
+
+/// Downsampling and triangulation of the levels of detail of a grid running in the background.
+/// When the levels of a previous version of the grid are given, only the chunks of the grid which
+/// changed since then are downsampled again, and only the affected chunks of each level are
+/// triangulated again.
+struct LodJob
+{
+    std::shared_ptr<const cubos::engine::VoxelGrid> grid;
+    uint64_t generation;
+    std::vector<unsigned int> factors;
+    std::vector<std::shared_ptr<const cubos::engine::VoxelGrid>> previousLevels;
+    std::vector<glm::uvec3> changed;
+    std::vector<std::shared_ptr<const cubos::engine::VoxelGrid>> levels;
+    std::vector<std::vector<std::size_t>> chunks;
+    std::vector<cubos::engine::MeshCache::Mesh> meshes;
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> done{false};
+};
+
+/// Meshes of each chunk of a grid downsampled by some factor.
+struct DeferredLod
+{
+    unsigned int factor = 1;
+    std::vector<std::shared_ptr<DeferredMesh>> chunks;
+
+    /// Downsampled grid the meshes were built from, which is updated when the grid changes.
+    std::shared_ptr<const cubos::engine::VoxelGrid> grid;
+};
+
+/// Deferred renderer grid implementation.
+struct DeferredGrid : public cubos::engine::impl::RendererGrid
+{
+    /// Grid which was uploaded, only used to recognize it when it is uploaded again.
+    const void* source = nullptr;
+
+    /// Size of the grid which was uploaded.
+    glm::uvec3 size;
+
+    /// Generation of the grid when it was uploaded.
+    uint64_t generation = 0;
+
+    /// Meshes of each chunk of the grid, which are null for empty chunks. Meshes of chunks which
+    /// didn't change are shared with the previous uploads of the same grid.
+    std::vector<std::shared_ptr<DeferredMesh>> chunks;
+
+    /// Triangulation still running, if the grid isn't ready yet.
+    std::shared_ptr<MeshingJob> job;
+
+    /// Levels of detail, by increasing downsampling factor. While new ones are being built, those
+    /// of the previous upload of the same grid are kept.
+    std::vector<DeferredLod> lods;
+
+    /// Generation of the grid when the levels of detail were built.
+    uint64_t lodGeneration = 0;
+
+    /// Building of the levels of detail still running, if any.
+    std::shared_ptr<LodJob> lodJob;
+
+    /// Level of detail drawn last, as an index into the levels plus one, or 0 for the full grid.
+    std::size_t lod = 0;
+
+    /// Grid drawn in its place while it isn't ready.
+    std::shared_ptr<DeferredGrid> previous;
 };
 
 /// Holds the model view matrix sent to the GPU.
@@ -79,8 +168,8 @@ struct LightsData
 static const char* geometryPassVs = R"glsl(
 #version 330 core
 
-in uvec3 position;
-in vec3 normal;
+in uint position;
+in uint normal;
 in uint material;
 
 out vec3 fragPosition;
@@ -94,14 +183,23 @@ uniform MVP
     mat4 P;
 };
 
+// Origin of the chunk being drawn, which the vertex positions are relative to.
+uniform uvec3 chunkOrigin;
+
+// Normals indexed by PackedVoxelVertex::normal.
+const vec3 normals[6] = vec3[6](vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0),
+                                vec3(0.0, -1.0, 0.0), vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0));
+
 void main()
 {
-    vec4 worldPosition = M * vec4(position, 1.0);
+    // Positions are packed with PackedVoxelVertex::PositionBits bits per axis.
+    uvec3 unpacked = uvec3(position, position >> 10u, position >> 20u) & uvec3(0x3FFu);
+    vec4 worldPosition = M * vec4(unpacked + chunkOrigin, 1.0);
     vec4 viewPosition = V * worldPosition;
     fragPosition = vec3(worldPosition);
 
     mat3 N = transpose(inverse(mat3(M)));
-    fragNormal = N * normal;
+    fragNormal = N * normals[normal];
 
     gl_Position = P * viewPosition;
 
@@ -418,6 +516,7 @@ DeferredRenderer::DeferredRenderer(RenderDevice& renderDevice, glm::uvec2 size,
     auto geometryPS = mRenderDevice.createShaderStage(Stage::Pixel, geometryPassPs);
     mGeometryPipeline = mRenderDevice.createShaderPipeline(geometryVS, geometryPS);
     mVpBp = mGeometryPipeline->getBindingPoint("MVP");
+    mChunkOriginBp = mGeometryPipeline->getBindingPoint("chunkOrigin");
 
     // Create the MVP constant buffer.
     mVpBuffer = renderDevice.createConstantBuffer(sizeof(MVP), nullptr, Usage::Dynamic);
@@ -486,6 +585,24 @@ DeferredRenderer::DeferredRenderer(RenderDevice& renderDevice, glm::uvec2 size,
     mSize = glm::uvec2(0, 0);
     DeferredRenderer::onResize(size);
 
+    // Read meshes from the cache, if enabled, before triangulating grids.
+    if (settings.getBool("cubos.renderer.meshing.cache.enabled", false))
+    {
+        int maxEntries = settings.getInteger("cubos.renderer.meshing.cache.maxEntries", 256);
+        mMeshCache = std::make_unique<MeshCache>("/cache/meshes", static_cast<std::size_t>(std::max(maxEntries, 1)));
+    }
+
+    // Levels of detail are only built when there are background threads to build them.
+    mLodEnabled = settings.getBool("cubos.renderer.lod.enabled", true);
+    mLodPixels = static_cast<float>(settings.getDouble("cubos.renderer.lod.pixels", 2.0));
+
+    // Start the threads which triangulate uploaded grids.
+    int meshingThreads = settings.getInteger("cubos.renderer.meshing.threads", 1);
+    if (meshingThreads > 0)
+    {
+        mMeshingPool = std::make_unique<core::ThreadPool>(static_cast<std::size_t>(meshingThreads));
+    }
+
     // Check whether SSAO is enabled.
     mSsaoEnabled = settings.getBool("renderer.ssao.enabled", false);
     if (mSsaoEnabled)
@@ -500,53 +617,412 @@ DeferredRenderer::DeferredRenderer(RenderDevice& renderDevice, glm::uvec2 size,
 
 DeferredRenderer::~DeferredRenderer()
 {
+    // Wait for the background triangulations, which may still be using the cache.
+    mMeshingPool.reset();
+    if (mMeshCache != nullptr)
+    {
+        auto stats = mMeshCache->stats();
+        CUBOS_INFO("Mesh cache: {} hits, {} misses, {} meshes stored, {} evicted", stats.hits, stats.misses,
+                   stats.stores, stats.evictions);
+    }
+
     /// FIXME: This should not be on production code.
     core::gl::Debug::terminate();
 }
 
-cubos::engine::RendererGrid DeferredRenderer::upload(const VoxelGrid& grid)
+/// Creates the GPU buffers of a chunk from its triangulation, or returns null if it is empty.
+static std::shared_ptr<DeferredMesh> createMesh(RenderDevice& renderDevice, ShaderPipeline pipeline,
+                                                const glm::uvec3& origin,
+                                                const std::vector<cubos::engine::PackedVoxelVertex>& vertices,
+                                                const std::vector<uint32_t>& indices)
 {
-    auto deferredGrid = std::make_shared<DeferredGrid>();
+    using cubos::engine::PackedVoxelVertex;
+
+    if (indices.empty())
+    {
+        return nullptr;
+    }
 
-    // First, triangulate the grid.
-    // This may be improved in the future by doing it in a separate thread and only blocking on it when the grid needs
-    // to be drawn.
-    std::vector<VoxelVertex> vertices;
-    std::vector<uint32_t> indices;
-    triangulate(grid, vertices, indices);
+    auto mesh = std::make_shared<DeferredMesh>();
+    mesh->origin = origin;
 
     // Create the vertex array, vertex buffer and index buffer.
     VertexArrayDesc vaDesc;
     vaDesc.elementCount = 3;
     vaDesc.elements[0].name = "position";
     vaDesc.elements[0].type = Type::UInt;
-    vaDesc.elements[0].size = 3;
+    vaDesc.elements[0].size = 1;
     vaDesc.elements[0].buffer.index = 0;
-    vaDesc.elements[0].buffer.offset = offsetof(VoxelVertex, position);
-    vaDesc.elements[0].buffer.stride = sizeof(VoxelVertex);
+    vaDesc.elements[0].buffer.offset = offsetof(PackedVoxelVertex, position);
+    vaDesc.elements[0].buffer.stride = sizeof(PackedVoxelVertex);
     vaDesc.elements[1].name = "normal";
-    vaDesc.elements[1].type = Type::Float;
-    vaDesc.elements[1].size = 3;
+    vaDesc.elements[1].type = Type::UShort;
+    vaDesc.elements[1].size = 1;
     vaDesc.elements[1].buffer.index = 0;
-    vaDesc.elements[1].buffer.offset = offsetof(VoxelVertex, normal);
-    vaDesc.elements[1].buffer.stride = sizeof(VoxelVertex);
+    vaDesc.elements[1].buffer.offset = offsetof(PackedVoxelVertex, normal);
+    vaDesc.elements[1].buffer.stride = sizeof(PackedVoxelVertex);
     vaDesc.elements[2].name = "material";
     vaDesc.elements[2].type = Type::UShort;
     vaDesc.elements[2].size = 1;
     vaDesc.elements[2].buffer.index = 0;
-    vaDesc.elements[2].buffer.offset = offsetof(VoxelVertex, material);
-    vaDesc.elements[2].buffer.stride = sizeof(VoxelVertex);
+    vaDesc.elements[2].buffer.offset = offsetof(PackedVoxelVertex, material);
+    vaDesc.elements[2].buffer.stride = sizeof(PackedVoxelVertex);
     vaDesc.buffers[0] =
-        mRenderDevice.createVertexBuffer(vertices.size() * sizeof(VoxelVertex), vertices.data(), Usage::Static);
-    vaDesc.shaderPipeline = mGeometryPipeline;
-    deferredGrid->va = mRenderDevice.createVertexArray(vaDesc);
-    deferredGrid->ib = mRenderDevice.createIndexBuffer(indices.size() * sizeof(uint32_t), indices.data(),
-                                                       IndexFormat::UInt, Usage::Static);
-    deferredGrid->indexCount = indices.size();
+        renderDevice.createVertexBuffer(vertices.size() * sizeof(PackedVoxelVertex), vertices.data(), Usage::Static);
+    vaDesc.shaderPipeline = std::move(pipeline);
+    mesh->va = renderDevice.createVertexArray(vaDesc);
+    mesh->ib = renderDevice.createIndexBuffer(indices.size() * sizeof(uint32_t), indices.data(), IndexFormat::UInt,
+                                              Usage::Static);
+    mesh->indexCount = indices.size();
+    return mesh;
+}
+
+/// Gets the origin of a chunk of a grid, given the number of chunks of the grid and its index.
+static glm::uvec3 chunkOrigin(const glm::uvec3& count, std::size_t chunk)
+{
+    auto index = static_cast<unsigned int>(chunk);
+    glm::uvec3 position{index % count.x, (index / count.x) % count.y, index / (count.x * count.y)};
+    return position * static_cast<unsigned int>(cubos::engine::VoxelGrid::ChunkSize);
+}
+
+/// Triangulates a chunk of a grid, given its index, into packed vertices relative to its origin.
+static void triangulateChunk(const cubos::engine::VoxelGrid& grid, std::size_t chunk,
+                             std::vector<cubos::engine::VoxelVertex>& scratch,
+                             std::vector<cubos::engine::PackedVoxelVertex>& vertices, std::vector<uint32_t>& indices)
+{
+    using cubos::engine::PackedVoxelVertex;
+    using cubos::engine::VoxelGrid;
+
+    auto min = chunkOrigin(grid.chunkCount(), chunk);
+    auto max = glm::min(min + static_cast<unsigned int>(VoxelGrid::ChunkSize), grid.size());
+    scratch.clear();
+    binaryTriangulate(grid, min, max, scratch, indices);
+
+    vertices.resize(scratch.size());
+    for (std::size_t i = 0; i < scratch.size(); ++i)
+    {
+        vertices[i] = PackedVoxelVertex::pack(scratch[i], min);
+    }
+}
+
+/// Triangulates the given chunks of a grid. When they are all of the chunks, in order, the mesh is
+/// read from the cache instead, if it is there, or written to it otherwise.
+static void triangulateChunks(const cubos::engine::VoxelGrid& grid, const std::vector<std::size_t>& chunks,
+                              cubos::engine::MeshCache::Mesh& mesh, cubos::engine::MeshCache* cache)
+{
+    auto count = grid.chunkCount();
+    bool whole = cache != nullptr && chunks.size() == static_cast<std::size_t>(count.x) * count.y * count.z;
+    uint64_t hash = 0;
+    if (whole)
+    {
+        hash = grid.hash();
+        if (cache->load(hash, grid.size(), mesh))
+        {
+            return;
+        }
+    }
+
+    std::vector<cubos::engine::VoxelVertex> scratch;
+    mesh.vertices.assign(chunks.size(), {});
+    mesh.indices.assign(chunks.size(), {});
+    for (std::size_t i = 0; i < chunks.size(); ++i)
+    {
+        triangulateChunk(grid, chunks[i], scratch, mesh.vertices[i], mesh.indices[i]);
+    }
+
+    if (whole)
+    {
+        cache->store(hash, grid.size(), mesh);
+    }
+}
+
+/// Gets the chunks of a grid which changed after the given generation.
+static std::vector<glm::uvec3> changedChunks(const cubos::engine::VoxelGrid& grid, uint64_t generation)
+{
+    std::vector<glm::uvec3> changed;
+    auto count = grid.chunkCount();
+    glm::uvec3 c;
+    for (c.z = 0; c.z < count.z; ++c.z)
+    {
+        for (c.y = 0; c.y < count.y; ++c.y)
+        {
+            for (c.x = 0; c.x < count.x; ++c.x)
+            {
+                if (grid.chunkGeneration(c) > generation)
+                {
+                    changed.push_back(c);
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+/// Gets the indices of the chunks of a grid which must be triangulated again after the given
+/// generation: those which changed, and their neighbors, whose faces on the shared side may have
+/// been hidden or revealed.
+static std::vector<std::size_t> dirtyChunks(const cubos::engine::VoxelGrid& grid, uint64_t generation)
+{
+    auto count = glm::ivec3{grid.chunkCount()};
+    std::vector<bool> dirty(static_cast<std::size_t>(count.x * count.y * count.z), false);
+    for (auto c : changedChunks(grid, generation))
+    {
+        for (auto offset : {glm::ivec3{0, 0, 0}, glm::ivec3{-1, 0, 0}, glm::ivec3{1, 0, 0}, glm::ivec3{0, -1, 0},
+                            glm::ivec3{0, 1, 0}, glm::ivec3{0, 0, -1}, glm::ivec3{0, 0, 1}})
+        {
+            auto n = glm::ivec3{c} + offset;
+            if (glm::all(glm::greaterThanEqual(n, glm::ivec3{0})) && glm::all(glm::lessThan(n, count)))
+            {
+                dirty[static_cast<std::size_t>(n.x + n.y * count.x + n.z * count.x * count.y)] = true;
+            }
+        }
+    }
+
+    std::vector<std::size_t> chunks;
+    for (std::size_t i = 0; i < dirty.size(); ++i)
+    {
+        if (dirty[i])
+        {
+            chunks.push_back(i);
+        }
+    }
+    return chunks;
+}
+
+/// Builds the levels of detail of a grid, in the background.
+static void buildLods(LodJob& job, cubos::engine::MeshCache* cache)
+{
+    using cubos::engine::VoxelGrid;
+
+    for (std::size_t l = 0; l < job.factors.size(); ++l)
+    {
+        if (job.cancelled.load(std::memory_order_relaxed))
+        {
+            break;
+        }
+
+        auto factor = job.factors[l];
+        auto level = std::make_shared<VoxelGrid>();
+        auto& chunks = job.chunks.emplace_back();
+        if (job.previousLevels.empty())
+        {
+            *level = job.grid->downsample(factor);
+            auto count = level->chunkCount();
+            chunks.resize(static_cast<std::size_t>(count.x) * count.y * count.z);
+            std::iota(chunks.begin(), chunks.end(), std::size_t{0});
+        }
+        else
+        {
+            // The voxels of a level inside a chunk of the grid only depend on that chunk, as the
+            // chunk size is a multiple of every factor.
+            *level = *job.previousLevels[l];
+            auto generation = level->generation();
+            auto size = static_cast<unsigned int>(VoxelGrid::ChunkSize) / factor;
+            for (auto c : job.changed)
+            {
+                job.grid->downsample(factor, c * size, (c + 1U) * size, *level);
+            }
+            chunks = dirtyChunks(*level, generation);
+        }
+
+        triangulateChunks(*level, chunks, job.meshes.emplace_back(), cache);
+        job.levels.push_back(std::move(level));
+    }
+    job.done.store(true, std::memory_order_release);
+}
+
+cubos::engine::RendererGrid DeferredRenderer::upload(const VoxelGrid& grid, const RendererGrid& previous)
+{
+    auto deferredGrid = std::make_shared<DeferredGrid>();
+    deferredGrid->source = &grid;
+    deferredGrid->size = grid.size();
+    deferredGrid->generation = grid.generation();
+
+    auto count = grid.chunkCount();
+    std::size_t chunkCount = static_cast<std::size_t>(count.x) * count.y * count.z;
+    deferredGrid->chunks.resize(chunkCount);
+
+    // Compare the grid to the last version of it which was ready, if any.
+    auto previousGrid = std::static_pointer_cast<DeferredGrid>(previous);
+    if (previousGrid != nullptr && previousGrid->job != nullptr)
+    {
+        previousGrid = previousGrid->previous;
+    }
+
+    bool incremental = previousGrid != nullptr && previousGrid->source == &grid && previousGrid->size == grid.size();
+    std::vector<std::size_t> dirty;
+    if (incremental)
+    {
+        // Only the chunks affected by the changes since then must be triangulated again.
+        dirty = dirtyChunks(grid, previousGrid->generation);
+        deferredGrid->chunks = previousGrid->chunks;
+    }
+    else
+    {
+        dirty.resize(chunkCount);
+        std::iota(dirty.begin(), dirty.end(), std::size_t{0});
+    }
+
+    // The background jobs share a single copy of the grid, as the original may change or be freed
+    // in the meantime.
+    std::shared_ptr<VoxelGrid> copy;
+    auto snapshot = [&]() -> std::shared_ptr<const VoxelGrid> {
+        if (copy == nullptr)
+        {
+            copy = std::make_shared<VoxelGrid>();
+            *copy = grid;
+        }
+        return copy;
+    };
+
+    // Small edits are triangulated right away, so that they show up in the same frame. So is
+    // everything, if there are no background threads.
+    if (mMeshingPool == nullptr || (incremental && dirty.size() <= MaxSyncChunks))
+    {
+        MeshCache::Mesh mesh;
+        triangulateChunks(grid, dirty, mesh, mMeshCache.get());
+        for (std::size_t i = 0; i < dirty.size(); ++i)
+        {
+            deferredGrid->chunks[dirty[i]] = createMesh(mRenderDevice, mGeometryPipeline, chunkOrigin(count, dirty[i]),
+                                                        mesh.vertices[i], mesh.indices[i]);
+        }
+    }
+    else
+    {
+        // The buffers are only created on the render thread, in finishUploads().
+        auto job = std::make_shared<MeshingJob>();
+        job->grid = snapshot();
+        job->chunks = std::move(dirty);
+        mMeshingPool->addTask([job, cache = mMeshCache.get()]() {
+            triangulateChunks(*job->grid, job->chunks, job->mesh, cache);
+            job->done.store(true, std::memory_order_release);
+        });
+
+        // Until then, draw the last grid which was ready, if any.
+        deferredGrid->job = std::move(job);
+        deferredGrid->previous = previousGrid;
+    }
+
+    if (mMeshingPool != nullptr && mLodEnabled)
+    {
+        // Keep drawing the levels of detail of the grid before the changes until the new ones are
+        // ready, and don't bother finishing those of the handle being replaced.
+        if (incremental)
+        {
+            deferredGrid->lods = previousGrid->lods;
+            deferredGrid->lodGeneration = previousGrid->lodGeneration;
+            deferredGrid->lod = previousGrid->lod;
+        }
+
+        if (auto replaced = std::static_pointer_cast<DeferredGrid>(previous); replaced && replaced->lodJob)
+        {
+            replaced->lodJob->cancelled.store(true, std::memory_order_relaxed);
+        }
+
+        // Build each level of detail which is still a few voxels wide.
+        auto lodJob = std::make_shared<LodJob>();
+        lodJob->generation = deferredGrid->generation;
+        auto largest = std::max({grid.size().x, grid.size().y, grid.size().z});
+        for (unsigned int factor : {2U, 4U, 8U})
+        {
+            if (largest >= factor * MinLodSize)
+            {
+                lodJob->factors.push_back(factor);
+            }
+        }
+
+        // Update the levels of detail of the grid before the changes, if they are all there.
+        if (incremental && !deferredGrid->lods.empty() && deferredGrid->lods.size() == lodJob->factors.size())
+        {
+            for (const auto& lod : deferredGrid->lods)
+            {
+                lodJob->previousLevels.push_back(lod.grid);
+            }
+            lodJob->changed = changedChunks(grid, deferredGrid->lodGeneration);
+        }
+
+        if (!lodJob->factors.empty() && (lodJob->previousLevels.empty() || !lodJob->changed.empty()))
+        {
+            lodJob->grid = snapshot();
+            mMeshingPool->addTask([lodJob, cache = mMeshCache.get()]() { buildLods(*lodJob, cache); });
+            deferredGrid->lodJob = std::move(lodJob);
+        }
+    }
+
+    if (deferredGrid->job != nullptr || deferredGrid->lodJob != nullptr)
+    {
+        mMeshingGrids.push_back(deferredGrid);
+    }
 
     return deferredGrid;
 }
 
+std::size_t DeferredRenderer::triangleCount() const
+{
+    return mTriangleCount;
+}
+
+cubos::engine::MeshCache::Stats DeferredRenderer::meshCacheStats() const
+{
+    return mMeshCache == nullptr ? MeshCache::Stats{} : mMeshCache->stats();
+}
+
+void DeferredRenderer::finishUploads()
+{
+    std::erase_if(mMeshingGrids, [&](const std::weak_ptr<impl::RendererGrid>& weak) {
+        auto grid = std::static_pointer_cast<DeferredGrid>(weak.lock());
+        if (grid == nullptr)
+        {
+            // The handle was dropped before the grid was ready, the job will be freed with it.
+            return true;
+        }
+
+        if (grid->job != nullptr && grid->job->done.load(std::memory_order_acquire))
+        {
+            const auto& job = *grid->job;
+            auto count = job.grid->chunkCount();
+            for (std::size_t i = 0; i < job.chunks.size(); ++i)
+            {
+                auto origin = chunkOrigin(count, job.chunks[i]);
+                grid->chunks[job.chunks[i]] =
+                    createMesh(mRenderDevice, mGeometryPipeline, origin, job.mesh.vertices[i], job.mesh.indices[i]);
+            }
+            grid->job.reset();
+            grid->previous.reset();
+        }
+
+        if (grid->lodJob != nullptr && grid->lodJob->done.load(std::memory_order_acquire))
+        {
+            // Levels updated from the previous ones keep the meshes of the chunks which didn't change.
+            const auto& job = *grid->lodJob;
+            if (!job.cancelled.load(std::memory_order_relaxed))
+            {
+                grid->lods.resize(job.factors.size());
+                for (std::size_t l = 0; l < job.factors.size(); ++l)
+                {
+                    auto& lod = grid->lods[l];
+                    const auto& mesh = job.meshes[l];
+                    auto count = job.levels[l]->chunkCount();
+                    lod.factor = job.factors[l];
+                    lod.grid = job.levels[l];
+                    lod.chunks.resize(static_cast<std::size_t>(count.x) * count.y * count.z);
+                    for (std::size_t i = 0; i < job.chunks[l].size(); ++i)
+                    {
+                        auto chunk = job.chunks[l][i];
+                        lod.chunks[chunk] = createMesh(mRenderDevice, mGeometryPipeline, chunkOrigin(count, chunk),
+                                                       mesh.vertices[i], mesh.indices[i]);
+                    }
+                }
+                grid->lodGeneration = job.generation;
+                grid->lod = std::min(grid->lod, grid->lods.size());
+            }
+            grid->lodJob.reset();
+        }
+
+        return grid->job == nullptr && grid->lodJob == nullptr;
+    });
+}
+
 void DeferredRenderer::setPalette(const VoxelPalette& palette)
 {
     // Get the colors from the palette.
@@ -610,6 +1086,7 @@ void DeferredRenderer::onRender(const glm::mat4& view, const Viewport& viewport,
                                 const RendererFrame& frame, Framebuffer target)
 {
     // Steps:
+    // 0. Create the buffers of the grids which finished triangulating.
     // 1. Prepare the MVP matrix.
     // 2. Fill the light buffer with the light data.
     // 3. Set the renderer state.
@@ -617,12 +1094,19 @@ void DeferredRenderer::onRender(const glm::mat4& view, const Viewport& viewport,
     //   1. Set the geometry pass state.
     //   2. Clear the GBuffer.
     //   3. For each draw command:
-    //     1. Update the MVP constant buffer with the model matrix.
-    //     2. Draw the geometry.
+    //     1. Find the geometry to draw.
+    //     2. Pick its level of detail.
+    //     3. Update the MVP constant buffer with the model matrix.
+    //     For each chunk of the geometry:
+    //     4. Set the origin of the chunk.
+    //     5. Draw the geometry of the chunk.
     // 5. Lighting pass:
     //   1. Set the lighting pass state.
     //   2. Draw the screen quad.
 
+    // 0. Create the buffers of the grids which finished triangulating.
+    this->finishUploads();
+
     // 1. Prepare the MVP matrix.
     MVP mvp;
     mvp.v = view;
@@ -715,18 +1199,71 @@ void DeferredRenderer::onRender(const glm::mat4& view, const Viewport& viewport,
     mRenderDevice.clearDepth(1.0F);
 
     // 4.3. For each draw command:
+    float pixelsPerUnit = static_cast<float>(viewport.size.y) / (2.0F * glm::tan(glm::radians(camera.fovY) * 0.5F));
+    mTriangleCount = 0;
     for (const auto& drawCmd : frame.drawCmds())
     {
-        // 4.3.1. Update the MVP constant buffer with the model matrix.
-        mvp.m = drawCmd.modelMat;
+        // 4.3.1. Find the geometry, or the previous geometry if the grid isn't ready yet.
+        auto grid = std::static_pointer_cast<DeferredGrid>(drawCmd.grid);
+        if (grid->job != nullptr)
+        {
+            grid = grid->previous;
+            if (grid == nullptr)
+            {
+                continue;
+            }
+        }
+
+        // 4.3.2. Pick the level of detail, from the size of a voxel on the screen.
+        const auto* chunks = &grid->chunks;
+        float factor = 1.0F;
+        if (!grid->lods.empty())
+        {
+            auto center = drawCmd.modelMat * glm::vec4(glm::vec3(grid->size) * 0.5F, 1.0F);
+            float distance = glm::max(-(mvp.v * center).z, camera.zNear);
+            float voxelPixels = glm::length(glm::vec3(drawCmd.modelMat[0])) * pixelsPerUnit / distance;
+
+            // Switch to a coarser level only when its voxels are well below the threshold, and
+            // back only when they are well above it, so that grids near it don't keep popping.
+            auto lodFactor = [&](std::size_t lod) {
+                return lod == 0 ? 1.0F : static_cast<float>(grid->lods[lod - 1].factor);
+            };
+            while (grid->lod < grid->lods.size() && voxelPixels * lodFactor(grid->lod + 1) < mLodPixels / LodHysteresis)
+            {
+                ++grid->lod;
+            }
+            while (grid->lod > 0 && voxelPixels * lodFactor(grid->lod) > mLodPixels * LodHysteresis)
+            {
+                --grid->lod;
+            }
+
+            if (grid->lod > 0)
+            {
+                chunks = &grid->lods[grid->lod - 1].chunks;
+                factor = lodFactor(grid->lod);
+            }
+        }
+
+        // 4.3.3. Update the MVP constant buffer with the model matrix, scaled by the downsampling
+        // factor. It's shared by every chunk, as their origins are passed separately.
+        mvp.m = glm::scale(drawCmd.modelMat, glm::vec3(factor));
         memcpy(mVpBuffer->map(), &mvp, sizeof(MVP));
         mVpBuffer->unmap();
 
-        // 4.3.2. Draw the geometry.
-        auto grid = std::static_pointer_cast<DeferredGrid>(drawCmd.grid);
-        mRenderDevice.setVertexArray(grid->va);
-        mRenderDevice.setIndexBuffer(grid->ib);
-        mRenderDevice.drawTrianglesIndexed(0, grid->indexCount);
+        for (const auto& mesh : *chunks)
+        {
+            if (mesh != nullptr)
+            {
+                // 4.3.4. Set the origin of the chunk, as the vertex positions are relative to it.
+                mChunkOriginBp->setConstant(mesh->origin);
+
+                // 4.3.5. Draw the geometry of the chunk.
+                mRenderDevice.setVertexArray(mesh->va);
+                mRenderDevice.setIndexBuffer(mesh->ib);
+                mRenderDevice.drawTrianglesIndexed(0, mesh->indexCount);
+                mTriangleCount += mesh->indexCount / 3;
+            }
+        }
     }
 
     // 5. SSAO pass.
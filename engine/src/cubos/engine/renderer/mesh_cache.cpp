@@ -0,0 +1,250 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cubos/core/data/fs/file_system.hpp>
+#include <cubos/core/log.hpp>
+#include <cubos/core/memory/stream.hpp>
+
+#include <cubos/engine/renderer/mesh_cache.hpp>
+
+using cubos::core::data::File;
+using cubos::core::data::FileSystem;
+using cubos::core::memory::Stream;
+
+using namespace cubos::engine;
+
+/// @brief Identifies the files of the cache.
+static constexpr uint32_t Magic = 0x4853454D; // "MESH"
+
+/// @brief Extension of the files of the cache.
+static constexpr std::string_view Extension = ".mesh";
+
+/// @brief Header of an entry of the cache.
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hash;
+    uint32_t size[3];
+    uint32_t chunkCount;
+};
+
+/// @brief Reads a value, or an array of values, from a stream. Empty arrays, whose data may be
+/// null, aren't read at all.
+template <typename T>
+static bool readRaw(Stream& stream, T* data, std::size_t count = 1)
+{
+    return count == 0 || stream.read(data, count * sizeof(T)) == count * sizeof(T);
+}
+
+/// @brief Writes a value, or an array of values, to a stream. Empty arrays, whose data may be
+/// null, aren't written at all.
+template <typename T>
+static bool writeRaw(Stream& stream, const T* data, std::size_t count = 1)
+{
+    return count == 0 || stream.write(data, count * sizeof(T)) == count * sizeof(T);
+}
+
+MeshCache::MeshCache(std::string path, std::size_t maxEntries)
+    : mPath(std::move(path))
+    , mMaxEntries(maxEntries)
+{
+    auto directory = FileSystem::find(mPath);
+    if (directory == nullptr)
+    {
+        return;
+    }
+
+    // Collect the entries first, as destroying a file removes it from its directory.
+    std::vector<File::Handle> files;
+    for (auto file = directory->child(); file != nullptr; file = file->sibling())
+    {
+        files.push_back(file);
+    }
+
+    for (const auto& file : files)
+    {
+        auto name = file->name();
+        if (file->directory() || !name.ends_with(Extension))
+        {
+            continue;
+        }
+
+        // Keep only the entries written by this version for the grid their name refers to.
+        std::string stem{name.substr(0, name.size() - Extension.size())};
+        auto hash = static_cast<uint64_t>(std::strtoull(stem.c_str(), nullptr, 16));
+        auto stream = file->open(File::OpenMode::Read);
+        Header header;
+        if (stream != nullptr && readRaw(*stream, &header) && header.magic == Magic && header.version == Version &&
+            header.hash == hash)
+        {
+            mEntries.push_back(hash);
+            continue;
+        }
+
+        stream.reset();
+        CUBOS_DEBUG("Removing stale mesh cache entry '{}'", file->path());
+        file->destroy();
+    }
+
+    std::unique_lock lock{mMutex};
+    this->evict(lock);
+}
+
+bool MeshCache::load(uint64_t hash, const glm::uvec3& size, Mesh& mesh)
+{
+    this->acquire(hash);
+    bool found = this->read(hash, size, mesh);
+    this->release(hash);
+    return found;
+}
+
+bool MeshCache::store(uint64_t hash, const glm::uvec3& size, const Mesh& mesh)
+{
+    this->acquire(hash);
+    bool written = this->write(hash, size, mesh);
+    this->release(hash);
+    if (!written)
+    {
+        return false;
+    }
+
+    mStores.fetch_add(1, std::memory_order_relaxed);
+
+    // The entry becomes the newest, even if it was already there.
+    std::unique_lock lock{mMutex};
+    std::erase(mEntries, hash);
+    mEntries.push_back(hash);
+    this->evict(lock);
+    return true;
+}
+
+MeshCache::Stats MeshCache::stats() const
+{
+    Stats stats;
+    stats.hits = mHits.load(std::memory_order_relaxed);
+    stats.misses = mMisses.load(std::memory_order_relaxed);
+    stats.stores = mStores.load(std::memory_order_relaxed);
+    stats.evictions = mEvictions.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::string MeshCache::entryPath(uint64_t hash) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.mesh", static_cast<unsigned long long>(hash));
+    return mPath + name;
+}
+
+void MeshCache::acquire(uint64_t hash)
+{
+    std::unique_lock lock{mMutex};
+    mReleased.wait(lock, [&]() { return !mUsed.contains(hash); });
+    mUsed.insert(hash);
+}
+
+void MeshCache::release(uint64_t hash)
+{
+    {
+        std::lock_guard lock{mMutex};
+        mUsed.erase(hash);
+    }
+    mReleased.notify_all();
+}
+
+bool MeshCache::read(uint64_t hash, const glm::uvec3& size, Mesh& mesh)
+{
+    auto path = this->entryPath(hash);
+    auto stream = FileSystem::find(path) == nullptr ? nullptr : FileSystem::open(path, File::OpenMode::Read);
+    if (stream == nullptr)
+    {
+        mMisses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Header header;
+    if (!readRaw(*stream, &header) || header.magic != Magic || header.version != Version || header.hash != hash ||
+        glm::uvec3{header.size[0], header.size[1], header.size[2]} != size)
+    {
+        CUBOS_DEBUG("Ignoring stale mesh cache entry '{}'", path);
+        mMisses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    bool ok = true;
+    mesh.vertices.resize(header.chunkCount);
+    mesh.indices.resize(header.chunkCount);
+    for (uint32_t i = 0; ok && i < header.chunkCount; ++i)
+    {
+        uint32_t counts[2];
+        ok = readRaw(*stream, counts, 2);
+        if (ok)
+        {
+            mesh.vertices[i].resize(counts[0]);
+            mesh.indices[i].resize(counts[1]);
+            ok = readRaw(*stream, mesh.vertices[i].data(), counts[0]) &&
+                 readRaw(*stream, mesh.indices[i].data(), counts[1]);
+        }
+    }
+
+    if (!ok)
+    {
+        CUBOS_WARN("Mesh cache entry '{}' is truncated", path);
+        mMisses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    mHits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool MeshCache::write(uint64_t hash, const glm::uvec3& size, const Mesh& mesh)
+{
+    auto path = this->entryPath(hash);
+    auto file = FileSystem::create(path);
+    auto stream = file == nullptr ? nullptr : file->open(File::OpenMode::Write);
+    if (stream == nullptr)
+    {
+        CUBOS_ERROR("Could not open mesh cache entry '{}' for writing", path);
+        return false;
+    }
+
+    Header header{Magic, Version, hash, {size.x, size.y, size.z}, static_cast<uint32_t>(mesh.vertices.size())};
+    bool ok = writeRaw(*stream, &header);
+    for (std::size_t i = 0; ok && i < mesh.vertices.size(); ++i)
+    {
+        uint32_t counts[2] = {static_cast<uint32_t>(mesh.vertices[i].size()),
+                              static_cast<uint32_t>(mesh.indices[i].size())};
+        ok = writeRaw(*stream, counts, 2) && writeRaw(*stream, mesh.vertices[i].data(), counts[0]) &&
+             writeRaw(*stream, mesh.indices[i].data(), counts[1]);
+    }
+
+    if (!ok)
+    {
+        CUBOS_ERROR("Could not write mesh cache entry '{}'", path);
+        return false;
+    }
+
+    return true;
+}
+
+void MeshCache::evict(std::unique_lock<std::mutex>& lock)
+{
+    while (mEntries.size() > mMaxEntries)
+    {
+        // Wait for the oldest entry to stop being used. The entries may have changed meanwhile.
+        auto hash = mEntries.front();
+        if (mUsed.contains(hash))
+        {
+            mReleased.wait(lock);
+            continue;
+        }
+
+        FileSystem::destroy(this->entryPath(hash));
+        mEntries.pop_front();
+        mEvictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
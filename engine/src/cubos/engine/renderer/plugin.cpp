@@ -1,4 +1,10 @@
+#include <filesystem>
+#include <system_error>
+
+#include <cubos/core/data/fs/file_system.hpp>
+#include <cubos/core/data/fs/standard_archive.hpp>
 #include <cubos/core/ecs/system/query.hpp>
+#include <cubos/core/log.hpp>
 
 #include <cubos/engine/renderer/deferred_renderer.hpp>
 #include <cubos/engine/renderer/directional_light.hpp>
@@ -12,6 +18,8 @@
 #include <cubos/engine/transform/plugin.hpp>
 #include <cubos/engine/window/plugin.hpp>
 
+using cubos::core::data::FileSystem;
+using cubos::core::data::StandardArchive;
 using cubos::core::ecs::EventReader;
 using cubos::core::ecs::Query;
 using cubos::core::ecs::Read;
@@ -24,6 +32,24 @@ using namespace cubos::engine;
 
 static void init(Write<Renderer> renderer, Read<Window> window, Write<Settings> settings)
 {
+    // Mount the directory where the renderer caches meshes, if enabled, before creating it.
+    if (settings->getBool("cubos.renderer.meshing.cache.enabled", false))
+    {
+        std::filesystem::path path = settings->getString("cubos.renderer.meshing.cache.path", "cache/meshes");
+
+        // The archive only creates the last directory of the path, but the path may be nested.
+        std::error_code err;
+        std::filesystem::create_directories(path, err);
+        if (err)
+        {
+            CUBOS_ERROR("Could not create mesh cache directory '{}': {}", path.string(), err.message());
+        }
+        else
+        {
+            FileSystem::mount("/cache/meshes", std::make_unique<StandardArchive>(path, true, false));
+        }
+    }
+
     auto& renderDevice = (*window)->renderDevice();
     *renderer = std::make_shared<DeferredRenderer>(renderDevice, (*window)->framebufferSize(), *settings);
 
@@ -51,10 +77,11 @@ static void frameGrids(Read<Assets> assets, Write<Renderer> renderer, Write<Rend
     {
         if (grid->handle == nullptr || assets->update(grid->asset))
         {
-            // If the grid wasn't already uploaded, we need to upload it now.
+            // If the grid wasn't already uploaded, we need to upload it now. The old version, if
+            // any, keeps being drawn until the new one is ready.
             grid->asset = assets->load(grid->asset);
             auto gridRead = assets->read(grid->asset);
-            grid->handle = (*renderer)->upload(gridRead.get());
+            grid->handle = (*renderer)->upload(gridRead.get(), grid->handle);
         }
 
         frame->draw(grid->handle, localToWorld->mat * glm::translate(glm::mat4(1.0F), grid->offset));
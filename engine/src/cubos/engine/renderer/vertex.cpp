@@ -1,10 +1,34 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
 #include <vector>
 
+#include <cubos/core/memory/arena_allocator.hpp>
+
 #include <cubos/engine/renderer/vertex.hpp>
 #include <cubos/engine/voxels/grid.hpp>
 
+using cubos::core::memory::ArenaAllocator;
+
 using namespace cubos::engine;
 
+/// @brief Gets the resource for the temporary allocations of a triangulation.
+/// @param scratch Resource given by the caller, or null to use the arena of the calling thread.
+/// @return Resource to allocate from.
+static std::pmr::memory_resource* scratchResource(std::pmr::memory_resource* scratch)
+{
+    if (scratch != nullptr)
+    {
+        return scratch;
+    }
+
+    // Each thread triangulating grids, such as each meshing thread of the renderer, keeps its own
+    // arena. Once it has grown to fit the largest grid seen, triangulating doesn't touch the heap.
+    thread_local ArenaAllocator arena{};
+    arena.reset();
+    return &arena;
+}
+
 void cubos::core::data::old::serialize(Serializer& serializer, const VoxelVertex& vertex, const char* name)
 {
     serializer.beginObject(name);
@@ -23,13 +47,80 @@ void cubos::core::data::old::deserialize(Deserializer& deserializer, VoxelVertex
     deserializer.endObject();
 }
 
-void cubos::engine::triangulate(const VoxelGrid& grid, std::vector<VoxelVertex>& vertices,
-                                std::vector<uint32_t>& indices)
+PackedVoxelVertex PackedVoxelVertex::pack(const VoxelVertex& vertex, const glm::uvec3& origin)
+{
+    auto position = vertex.position - origin;
+    assert(glm::all(glm::lessThanEqual(position, glm::uvec3{MaxPosition})));
+
+    // The index is twice the axis, plus one for the negative directions.
+    int axis = vertex.normal.x != 0.0F ? 0 : (vertex.normal.y != 0.0F ? 1 : 2);
+    auto normal = static_cast<uint16_t>(axis * 2 + (vertex.normal[axis] < 0.0F ? 1 : 0));
+
+    return {position.x | (position.y << PositionBits) | (position.z << (2 * PositionBits)), normal, vertex.material};
+}
+
+VoxelVertex PackedVoxelVertex::unpack(const glm::uvec3& origin) const
+{
+    glm::uvec3 offset{position & MaxPosition, (position >> PositionBits) & MaxPosition,
+                      (position >> (2 * PositionBits)) & MaxPosition};
+    glm::vec3 direction{0.0F};
+    direction[normal / 2] = normal % 2 == 0 ? 1.0F : -1.0F;
+    return {origin + offset, direction, material};
+}
+
+/// @brief Adds a quad to a mesh.
+/// @param vertices Vertices of the mesh.
+/// @param indices Indices of the mesh.
+/// @param x Position of the first corner of the quad.
+/// @param du Offset from the first corner to the second.
+/// @param dv Offset from the second corner to the third.
+/// @param normal Normal of the quad.
+/// @param material Material of the quad.
+/// @param backFace Whether the quad faces the negative side of its axis.
+static void pushQuad(std::vector<VoxelVertex>& vertices, std::vector<uint32_t>& indices, glm::ivec3 x, glm::ivec3 du,
+                     glm::ivec3 dv, glm::ivec3 normal, uint16_t material, bool backFace)
 {
-    std::vector<uint16_t> mask;
+    auto vi = vertices.size();
+    vertices.resize(vi + 4, {{}, normal, material});
+    vertices[vi + 0].position = x;
+    vertices[vi + 1].position = x + du;
+    vertices[vi + 2].position = x + du + dv;
+    vertices[vi + 3].position = x + dv;
 
+    auto ii = indices.size();
+    indices.resize(ii + 6);
+    if (backFace)
+    {
+        indices[ii + 0] = static_cast<uint32_t>(vi) + 0;
+        indices[ii + 1] = static_cast<uint32_t>(vi) + 2;
+        indices[ii + 2] = static_cast<uint32_t>(vi) + 1;
+        indices[ii + 3] = static_cast<uint32_t>(vi) + 3;
+        indices[ii + 4] = static_cast<uint32_t>(vi) + 2;
+        indices[ii + 5] = static_cast<uint32_t>(vi) + 0;
+    }
+    else
+    {
+        indices[ii + 0] = static_cast<uint32_t>(vi) + 0;
+        indices[ii + 1] = static_cast<uint32_t>(vi) + 1;
+        indices[ii + 2] = static_cast<uint32_t>(vi) + 2;
+        indices[ii + 3] = static_cast<uint32_t>(vi) + 2;
+        indices[ii + 4] = static_cast<uint32_t>(vi) + 3;
+        indices[ii + 5] = static_cast<uint32_t>(vi) + 0;
+    }
+}
+
+void cubos::engine::triangulate(const VoxelGrid& grid, std::vector<VoxelVertex>& vertices,
+                                std::vector<uint32_t>& indices, std::pmr::memory_resource* scratch)
+{
+    scratch = scratchResource(scratch);
     const auto& sz = grid.size();
 
+    // Allocate the mask once, big enough for the largest slice of the three axes.
+    std::size_t maxSlice = std::max({static_cast<std::size_t>(sz.x) * static_cast<std::size_t>(sz.y),
+                                     static_cast<std::size_t>(sz.y) * static_cast<std::size_t>(sz.z),
+                                     static_cast<std::size_t>(sz.z) * static_cast<std::size_t>(sz.x)});
+    std::pmr::vector<uint16_t> mask(maxSlice, scratch);
+
     // For both back and front faces.
     bool backFace = true;
     do
@@ -45,7 +136,6 @@ void cubos::engine::triangulate(const VoxelGrid& grid, std::vector<VoxelVertex>&
             glm::ivec3 x = {0, 0, 0};
             glm::ivec3 q = {0, 0, 0};
             q[d] = 1;
-            mask.resize(static_cast<std::size_t>(sz[u]) * static_cast<std::size_t>(sz[v]));
 
             for (x[d] = -1; x[d] < int(sz[d]);)
             {
@@ -119,33 +209,7 @@ void cubos::engine::triangulate(const VoxelGrid& grid, std::vector<VoxelVertex>&
                                 du[u] = static_cast<int>(w);
                                 dv[v] = static_cast<int>(h);
 
-                                auto vi = vertices.size();
-                                vertices.resize(vi + 4, {{}, backFace ? -q : q, mask[n]});
-                                vertices[vi + 0].position = x;
-                                vertices[vi + 1].position = x + du;
-                                vertices[vi + 2].position = x + du + dv;
-                                vertices[vi + 3].position = x + dv;
-
-                                auto ii = indices.size();
-                                indices.resize(ii + 6);
-                                if (backFace)
-                                {
-                                    indices[ii + 0] = static_cast<uint32_t>(vi) + 0;
-                                    indices[ii + 1] = static_cast<uint32_t>(vi) + 2;
-                                    indices[ii + 2] = static_cast<uint32_t>(vi) + 1;
-                                    indices[ii + 3] = static_cast<uint32_t>(vi) + 3;
-                                    indices[ii + 4] = static_cast<uint32_t>(vi) + 2;
-                                    indices[ii + 5] = static_cast<uint32_t>(vi) + 0;
-                                }
-                                else
-                                {
-                                    indices[ii + 0] = static_cast<uint32_t>(vi) + 0;
-                                    indices[ii + 1] = static_cast<uint32_t>(vi) + 1;
-                                    indices[ii + 2] = static_cast<uint32_t>(vi) + 2;
-                                    indices[ii + 3] = static_cast<uint32_t>(vi) + 2;
-                                    indices[ii + 4] = static_cast<uint32_t>(vi) + 3;
-                                    indices[ii + 5] = static_cast<uint32_t>(vi) + 0;
-                                }
+                                pushQuad(vertices, indices, x, du, dv, backFace ? -q : q, mask[n], backFace);
                             }
 
                             for (std::size_t l = 0; l < h; ++l)
@@ -170,3 +234,232 @@ void cubos::engine::triangulate(const VoxelGrid& grid, std::vector<VoxelVertex>&
         }
     } while (!backFace);
 }
+
+/// @brief Gets a mask with the bits of a word which are in the range [begin, end).
+static uint64_t rangeMask(std::size_t word, std::size_t begin, std::size_t end)
+{
+    auto first = std::max(begin, word * 64) - word * 64;
+    auto last = std::min(end, word * 64 + 64) - word * 64;
+    auto high = last == 64 ? ~uint64_t{0} : (uint64_t{1} << last) - 1;
+    return high & ~((uint64_t{1} << first) - 1);
+}
+
+/// @brief Checks if all bits of a row in the range [begin, end) are set.
+static bool allSet(const uint64_t* row, std::size_t begin, std::size_t end)
+{
+    for (std::size_t w = begin / 64; w <= (end - 1) / 64; ++w)
+    {
+        auto mask = rangeMask(w, begin, end);
+        if ((row[w] & mask) != mask)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// @brief Clears the bits of a row in the range [begin, end).
+static void clearRange(uint64_t* row, std::size_t begin, std::size_t end)
+{
+    for (std::size_t w = begin / 64; w <= (end - 1) / 64; ++w)
+    {
+        row[w] &= ~rangeMask(w, begin, end);
+    }
+}
+
+/// @brief Counts the consecutive set bits of a row starting at the given bit.
+static std::size_t runLength(const uint64_t* row, std::size_t begin, std::size_t size)
+{
+    std::size_t length = 0;
+    for (std::size_t w = begin / 64; w * 64 < size; ++w)
+    {
+        auto offset = w == begin / 64 ? begin % 64 : 0;
+        auto ones = static_cast<std::size_t>(std::countr_one(row[w] >> offset));
+        length += std::min(ones, 64 - offset);
+        if (ones < 64 - offset)
+        {
+            break;
+        }
+    }
+
+    return std::min(length, size - begin);
+}
+
+void cubos::engine::binaryTriangulate(const VoxelGrid& grid, std::vector<VoxelVertex>& vertices,
+                                      std::vector<uint32_t>& indices, std::pmr::memory_resource* scratch)
+{
+    binaryTriangulate(grid, {0, 0, 0}, grid.size(), vertices, indices, scratch);
+}
+
+void cubos::engine::binaryTriangulate(const VoxelGrid& grid, const glm::uvec3& min, const glm::uvec3& max,
+                                      std::vector<VoxelVertex>& vertices, std::vector<uint32_t>& indices,
+                                      std::pmr::memory_resource* scratch)
+{
+    const auto& sz = grid.size();
+    assert(glm::all(glm::lessThanEqual(max, sz)));
+    if (glm::any(glm::greaterThanEqual(min, max)))
+    {
+        return;
+    }
+
+    scratch = scratchResource(scratch);
+    // Only the region plus a border of one voxel, which hides faces on the edges of the region,
+    // is read from the grid. From here on, coordinates are relative to the corner of that box.
+    auto lo = glm::max(glm::ivec3{min} - 1, glm::ivec3{0});
+    auto ext = glm::ivec3{glm::min(max + 1U, sz)} - lo;
+    auto rmin = glm::ivec3{min} - lo;
+    auto rmax = glm::ivec3{max} - lo;
+
+    // Store the occupancy of the box three times, once with rows of bits along each axis. For a
+    // face axis d, the rows along u = (d + 1) % 3 are indexed by (x[d], x[v]), with v = (d + 2) % 3,
+    // so the visible faces of a whole slice are found by comparing whole words of two slices.
+    std::size_t wordsPerRow[3];
+    std::pmr::vector<uint64_t> rows[3] = {std::pmr::vector<uint64_t>(scratch), std::pmr::vector<uint64_t>(scratch),
+                                          std::pmr::vector<uint64_t>(scratch)};
+    for (int u = 0; u < 3; ++u)
+    {
+        int d = (u + 2) % 3;
+        int v = (u + 1) % 3;
+        wordsPerRow[u] = (static_cast<std::size_t>(ext[u]) + 63) / 64;
+        rows[u].resize(static_cast<std::size_t>(ext[d]) * static_cast<std::size_t>(ext[v]) * wordsPerRow[u], 0);
+    }
+
+    glm::ivec3 x;
+    for (x.z = 0; x.z < ext.z; ++x.z)
+    {
+        for (x.y = 0; x.y < ext.y; ++x.y)
+        {
+            for (x.x = 0; x.x < ext.x; ++x.x)
+            {
+                if (grid.get(lo + x) == 0)
+                {
+                    continue;
+                }
+
+                for (int u = 0; u < 3; ++u)
+                {
+                    int d = (u + 2) % 3;
+                    int v = (u + 1) % 3;
+                    auto row = static_cast<std::size_t>(x[d] * ext[v] + x[v]);
+                    rows[u][row * wordsPerRow[u] + static_cast<std::size_t>(x[u] / 64)] |= uint64_t{1} << (x[u] % 64);
+                }
+            }
+        }
+    }
+
+    // Faces are generated in the same order as in triangulate(), so that both produce the same mesh
+    // when the region is the whole grid.
+    std::pmr::vector<uint64_t> mask(scratch);
+    for (bool backFace : {false, true})
+    {
+        for (int d = 0; d < 3; ++d)
+        {
+            int u = (d + 1) % 3;
+            int v = (d + 2) % 3;
+            auto width = static_cast<std::size_t>(ext[u]);
+            auto begin = static_cast<std::size_t>(rmin[u]);
+            auto end = static_cast<std::size_t>(rmax[u]);
+            auto words = wordsPerRow[u];
+            auto sliceWords = static_cast<std::size_t>(ext[v]) * words;
+            const auto& occupancy = rows[u];
+            mask.resize(sliceWords);
+
+            glm::ivec3 q = {0, 0, 0};
+            q[d] = 1;
+
+            for (int k = rmin[d]; k < rmax[d]; ++k)
+            {
+                // A face is visible if its voxel is solid and the voxel it faces is empty. Only the
+                // rows and bits of the region are kept, so faces outside of it are never merged.
+                const auto* slice = occupancy.data() + static_cast<std::size_t>(k) * sliceWords;
+                int neighbor = backFace ? k - 1 : k + 1;
+                const uint64_t* other = nullptr;
+                if (lo[d] + neighbor >= 0 && lo[d] + neighbor < static_cast<int>(sz[d]))
+                {
+                    other = occupancy.data() + static_cast<std::size_t>(neighbor) * sliceWords;
+                }
+
+                for (auto j = static_cast<std::size_t>(rmin[v]); j < static_cast<std::size_t>(rmax[v]); ++j)
+                {
+                    for (std::size_t w = 0; w < words; ++w)
+                    {
+                        auto index = j * words + w;
+                        if (w * 64 >= end || w * 64 + 64 <= begin)
+                        {
+                            mask[index] = 0;
+                            continue;
+                        }
+
+                        auto visible = other == nullptr ? slice[index] : slice[index] & ~other[index];
+                        mask[index] = visible & rangeMask(w, begin, end);
+                    }
+                }
+
+                // Merge the visible faces greedily, first along u and then along v.
+                glm::ivec3 voxel;
+                voxel[d] = lo[d] + k;
+                auto material = [&](std::size_t i, std::size_t j) {
+                    voxel[u] = lo[u] + static_cast<int>(i);
+                    voxel[v] = lo[v] + static_cast<int>(j);
+                    return grid.get(voxel);
+                };
+
+                for (auto j = static_cast<std::size_t>(rmin[v]); j < static_cast<std::size_t>(rmax[v]); ++j)
+                {
+                    auto* row = mask.data() + j * words;
+                    for (std::size_t w = 0; w < words; ++w)
+                    {
+                        while (row[w] != 0)
+                        {
+                            auto i = w * 64 + static_cast<std::size_t>(std::countr_zero(row[w]));
+                            auto mat = material(i, j);
+
+                            auto run = runLength(row, i, width);
+                            std::size_t qw = 1;
+                            while (qw < run && material(i + qw, j) == mat)
+                            {
+                                ++qw;
+                            }
+
+                            std::size_t qh = 1;
+                            for (; j + qh < static_cast<std::size_t>(rmax[v]); ++qh)
+                            {
+                                if (!allSet(row + qh * words, i, i + qw))
+                                {
+                                    break;
+                                }
+
+                                bool same = true;
+                                for (std::size_t l = 0; l < qw && same; ++l)
+                                {
+                                    same = material(i + l, j + qh) == mat;
+                                }
+
+                                if (!same)
+                                {
+                                    break;
+                                }
+                            }
+
+                            for (std::size_t l = 0; l < qh; ++l)
+                            {
+                                clearRange(row + l * words, i, i + qw);
+                            }
+
+                            glm::ivec3 corner = {0, 0, 0};
+                            glm::ivec3 du = {0, 0, 0};
+                            glm::ivec3 dv = {0, 0, 0};
+                            corner[d] = lo[d] + (backFace ? k : k + 1);
+                            corner[u] = lo[u] + static_cast<int>(i);
+                            corner[v] = lo[v] + static_cast<int>(j);
+                            du[u] = static_cast<int>(qw);
+                            dv[v] = static_cast<int>(qh);
+                            pushQuad(vertices, indices, corner, du, dv, backFace ? -q : q, mat, backFace);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <cassert>
+
+#include <cubos/core/log.hpp>
+
+#include <cubos/engine/voxels/chunked_grid.hpp>
+#include <cubos/engine/voxels/palette.hpp>
+
+using namespace cubos::engine;
+
+void ChunkedVoxelGrid::Chunk::set(const glm::ivec3& position, uint16_t mat)
+{
+    if (voxels.empty())
+    {
+        if (mat == uniform)
+        {
+            return;
+        }
+
+        voxels.resize(ChunkVolume, uniform);
+    }
+
+    voxels[index(position)] = mat;
+}
+
+bool ChunkedVoxelGrid::Chunk::compact()
+{
+    if (voxels.empty())
+    {
+        return true;
+    }
+
+    if (std::any_of(voxels.begin(), voxels.end(), [&](uint16_t mat) { return mat != voxels.front(); }))
+    {
+        return false;
+    }
+
+    uniform = voxels.front();
+    voxels.clear();
+    voxels.shrink_to_fit();
+    return true;
+}
+
+ChunkedVoxelGrid::ChunkedVoxelGrid()
+    : mSize{1, 1, 1}
+{
+}
+
+ChunkedVoxelGrid::ChunkedVoxelGrid(const glm::uvec3& size)
+{
+    if (size.x < 1 || size.y < 1 || size.z < 1)
+    {
+        CUBOS_WARN("Grid size must be at least 1 in each dimension: was ({}, {}, {}), defaulting to (1, 1, 1).", size.x,
+                   size.y, size.z);
+        mSize = {1, 1, 1};
+    }
+    else
+    {
+        mSize = size;
+    }
+}
+
+ChunkedVoxelGrid::ChunkedVoxelGrid(const VoxelGrid& grid)
+    : mSize(grid.size())
+{
+    // Fill each chunk in turn, so that each is compacted while still hot in the cache.
+    auto count = this->chunkCount();
+    for (unsigned int cz = 0; cz < count.z; ++cz)
+    {
+        for (unsigned int cy = 0; cy < count.y; ++cy)
+        {
+            for (unsigned int cx = 0; cx < count.x; ++cx)
+            {
+                auto origin = glm::ivec3{cx, cy, cz} * ChunkSize;
+                auto end = glm::min(origin + ChunkSize, glm::ivec3{mSize});
+
+                Chunk chunk;
+                for (int z = origin.z; z < end.z; ++z)
+                {
+                    for (int y = origin.y; y < end.y; ++y)
+                    {
+                        for (int x = origin.x; x < end.x; ++x)
+                        {
+                            chunk.set(glm::ivec3{x, y, z} - origin, grid.get({x, y, z}));
+                        }
+                    }
+                }
+
+                if (!chunk.compact() || chunk.uniform != 0)
+                {
+                    mChunks.emplace(pack({cx, cy, cz}), std::move(chunk));
+                }
+            }
+        }
+    }
+}
+
+void ChunkedVoxelGrid::setSize(const glm::uvec3& size)
+{
+    if (size == mSize)
+    {
+        return;
+    }
+    if (size.x < 1 || size.y < 1 || size.z < 1)
+    {
+        CUBOS_WARN("Grid size must be at least 1 in each dimension: preserving original dimensions (tried to set to "
+                   "({}, {}, {}))",
+                   size.x, size.y, size.z);
+        return;
+    }
+
+    mSize = size;
+
+    // Drop the chunks which are now out of bounds, and clear the voxels out of bounds in the
+    // chunks which now cross the edges, so that growing the grid again shows empty voxels.
+    auto limit = glm::ivec3{mSize};
+    for (auto it = mChunks.begin(); it != mChunks.end();)
+    {
+        auto origin = glm::ivec3{unpack(it->first)} * ChunkSize;
+        if (glm::any(glm::greaterThanEqual(origin, limit)))
+        {
+            it = mChunks.erase(it);
+            continue;
+        }
+
+        auto end = origin + ChunkSize;
+        if (glm::any(glm::greaterThan(end, limit)))
+        {
+            auto& chunk = it->second;
+            for (int z = 0; z < ChunkSize; ++z)
+            {
+                for (int y = 0; y < ChunkSize; ++y)
+                {
+                    for (int x = 0; x < ChunkSize; ++x)
+                    {
+                        if (glm::any(glm::greaterThanEqual(origin + glm::ivec3{x, y, z}, limit)))
+                        {
+                            chunk.set({x, y, z}, 0);
+                        }
+                    }
+                }
+            }
+
+            if (chunk.compact() && chunk.uniform == 0)
+            {
+                it = mChunks.erase(it);
+                continue;
+            }
+        }
+
+        ++it;
+    }
+}
+
+const glm::uvec3& ChunkedVoxelGrid::size() const
+{
+    return mSize;
+}
+
+void ChunkedVoxelGrid::clear()
+{
+    mChunks.clear();
+}
+
+void ChunkedVoxelGrid::set(const glm::ivec3& position, uint16_t mat)
+{
+    assert(position.x >= 0 && position.x < static_cast<int>(mSize.x));
+    assert(position.y >= 0 && position.y < static_cast<int>(mSize.y));
+    assert(position.z >= 0 && position.z < static_cast<int>(mSize.z));
+    auto key = pack(glm::uvec3{position / ChunkSize});
+    auto it = mChunks.find(key);
+    if (it == mChunks.end())
+    {
+        // Setting a voxel of an empty chunk to empty changes nothing.
+        if (mat == 0)
+        {
+            return;
+        }
+
+        it = mChunks.emplace(key, Chunk{}).first;
+    }
+
+    it->second.set(position % ChunkSize, mat);
+}
+
+uint16_t ChunkedVoxelGrid::get(const glm::ivec3& position) const
+{
+    assert(position.x >= 0 && position.x < static_cast<int>(mSize.x));
+    assert(position.y >= 0 && position.y < static_cast<int>(mSize.y));
+    assert(position.z >= 0 && position.z < static_cast<int>(mSize.z));
+    auto it = mChunks.find(pack(glm::uvec3{position / ChunkSize}));
+    return it == mChunks.end() ? 0 : it->second.get(position % ChunkSize);
+}
+
+bool ChunkedVoxelGrid::convert(const VoxelPalette& src, const VoxelPalette& dst, float minSimilarity)
+{
+    // Find the mappings for every material in the source palette.
+    std::unordered_map<uint16_t, uint16_t> mappings;
+    for (uint16_t i = 0; i <= src.size(); ++i)
+    {
+        uint16_t j = dst.find(src.get(i));
+        if (src.get(i).similarity(dst.get(j)) >= minSimilarity)
+        {
+            mappings[i] = j;
+        }
+    }
+
+    // Check if the mappings are complete for every material being used in the grid. Empty chunks
+    // are made of material 0, which always maps to itself.
+    auto mapped = [&](uint16_t mat) { return mappings.find(mat) != mappings.end(); };
+    for (const auto& [key, chunk] : mChunks)
+    {
+        const auto& voxels = chunk.voxels;
+        if (voxels.empty() ? !mapped(chunk.uniform) : !std::all_of(voxels.begin(), voxels.end(), mapped))
+        {
+            return false;
+        }
+    }
+
+    // Apply the mappings. Uniform chunks only have one material to map.
+    for (auto& [key, chunk] : mChunks)
+    {
+        chunk.uniform = mappings[chunk.uniform];
+        for (auto& mat : chunk.voxels)
+        {
+            mat = mappings[mat];
+        }
+    }
+
+    return true;
+}
+
+void ChunkedVoxelGrid::compact()
+{
+    // Not std::erase_if, as its predicate may only see the chunks as const.
+    for (auto it = mChunks.begin(); it != mChunks.end();)
+    {
+        if (it->second.compact() && it->second.uniform == 0)
+        {
+            it = mChunks.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+glm::uvec3 ChunkedVoxelGrid::chunkCount() const
+{
+    return (mSize + static_cast<unsigned int>(ChunkSize - 1)) / static_cast<unsigned int>(ChunkSize);
+}
+
+auto ChunkedVoxelGrid::chunk(const glm::uvec3& position) const -> const Chunk*
+{
+    auto it = mChunks.find(pack(position));
+    return it == mChunks.end() ? nullptr : &it->second;
+}
+
+VoxelGrid ChunkedVoxelGrid::chunkGrid(const glm::uvec3& position) const
+{
+    auto origin = glm::ivec3{position} * ChunkSize;
+    auto end = glm::min(origin + ChunkSize, glm::ivec3{mSize});
+    VoxelGrid grid{glm::uvec3{glm::max(end - origin, glm::ivec3{1})}};
+
+    if (const auto* chunk = this->chunk(position))
+    {
+        for (int z = origin.z; z < end.z; ++z)
+        {
+            for (int y = origin.y; y < end.y; ++y)
+            {
+                for (int x = origin.x; x < end.x; ++x)
+                {
+                    grid.set(glm::ivec3{x, y, z} - origin, chunk->get(glm::ivec3{x, y, z} - origin));
+                }
+            }
+        }
+    }
+
+    return grid;
+}
+
+VoxelGrid ChunkedVoxelGrid::toGrid() const
+{
+    VoxelGrid grid{mSize};
+    this->forEach([&](glm::ivec3 position, uint16_t mat) { grid.set(position, mat); });
+    return grid;
+}
+
+std::size_t ChunkedVoxelGrid::memory() const
+{
+    std::size_t bytes = mChunks.size() * sizeof(Chunk);
+    for (const auto& [key, chunk] : mChunks)
+    {
+        bytes += chunk.voxels.capacity() * sizeof(uint16_t);
+    }
+    return bytes;
+}
+
+void cubos::core::data::old::serialize(Serializer& serializer, const ChunkedVoxelGrid& grid, const char* name)
+{
+    serializer.beginObject(name);
+    serializer.write(grid.mSize, "size");
+    serializer.beginArray(grid.mChunks.size(), "chunks");
+    for (const auto& [key, chunk] : grid.mChunks)
+    {
+        serializer.beginObject(nullptr);
+        serializer.write(ChunkedVoxelGrid::unpack(key), "position");
+        serializer.write(chunk.uniform, "uniform");
+        serializer.write(chunk.voxels, "data");
+        serializer.endObject();
+    }
+    serializer.endArray();
+    serializer.endObject();
+}
+
+void cubos::core::data::old::deserialize(Deserializer& deserializer, ChunkedVoxelGrid& grid)
+{
+    grid.mChunks.clear();
+
+    deserializer.beginObject();
+    deserializer.read(grid.mSize);
+    std::size_t count = deserializer.beginArray();
+    auto chunkCount = grid.chunkCount();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        glm::uvec3 position;
+        ChunkedVoxelGrid::Chunk chunk;
+        deserializer.beginObject();
+        deserializer.read(position);
+        deserializer.read(chunk.uniform);
+        deserializer.read(chunk.voxels);
+        deserializer.endObject();
+
+        if (glm::any(glm::greaterThanEqual(position, chunkCount)) ||
+            (!chunk.voxels.empty() && chunk.voxels.size() != ChunkedVoxelGrid::ChunkVolume))
+        {
+            CUBOS_WARN("Skipping invalid chunk at ({}, {}, {}) with {} voxels", position.x, position.y, position.z,
+                       chunk.voxels.size());
+            continue;
+        }
+
+        grid.mChunks.emplace(ChunkedVoxelGrid::pack(position), std::move(chunk));
+    }
+    deserializer.endArray();
+    deserializer.endObject();
+
+    if (grid.mSize.x < 1 || grid.mSize.y < 1 || grid.mSize.z < 1)
+    {
+        CUBOS_WARN("Grid size must be at least 1 in each dimension: was ({}, {}, {}), defaulting to (1, 1, 1).",
+                   grid.mSize.x, grid.mSize.y, grid.mSize.z);
+        grid.mSize = {1, 1, 1};
+        grid.mChunks.clear();
+    }
+}
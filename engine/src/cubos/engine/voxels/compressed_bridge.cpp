@@ -0,0 +1,46 @@
+#include <cubos/core/data/old/binary_deserializer.hpp>
+#include <cubos/core/data/old/binary_serializer.hpp>
+#include <cubos/core/log.hpp>
+
+#include <cubos/engine/voxels/compressed_bridge.hpp>
+#include <cubos/engine/voxels/compressed_grid.hpp>
+
+using cubos::core::data::old::BinaryDeserializer;
+using cubos::core::data::old::BinarySerializer;
+using cubos::core::memory::Stream;
+
+using namespace cubos::engine;
+
+CompressedGridBridge::CompressedGridBridge()
+    : FileBridge(typeid(VoxelGrid))
+{
+}
+
+bool CompressedGridBridge::loadFromFile(Assets& assets, const AnyAsset& handle, Stream& stream)
+{
+    BinaryDeserializer deserializer{stream};
+    CompressedVoxelGrid compressed{};
+    deserializer.read(compressed);
+    if (deserializer.failed())
+    {
+        CUBOS_ERROR("Could not deserialize compressed voxel grid from binary file");
+        return false;
+    }
+
+    assets.store(handle, compressed.decode());
+    return true;
+}
+
+bool CompressedGridBridge::saveToFile(const Assets& assets, const AnyAsset& handle, Stream& stream)
+{
+    BinarySerializer serializer{stream};
+    auto grid = assets.read<VoxelGrid>(handle);
+    serializer.write(CompressedVoxelGrid{*grid}, nullptr);
+    if (serializer.failed())
+    {
+        CUBOS_ERROR("Could not serialize compressed voxel grid to binary file");
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+#include <cubos/core/log.hpp>
+
+#include <cubos/engine/voxels/compressed_grid.hpp>
+
+using namespace cubos::engine;
+
+namespace
+{
+    using Chunk = CompressedVoxelGrid::Chunk;
+
+    constexpr std::size_t ChunkVolume = CompressedVoxelGrid::ChunkVolume;
+    constexpr int ChunkSize = CompressedVoxelGrid::ChunkSize;
+
+    /// @brief Gets the number of bits needed to pack indices into a palette of the given size.
+    /// Only divisors of 64 are used, so that no index is split between two words.
+    uint8_t bitsFor(std::size_t count)
+    {
+        uint8_t bits = 0;
+        while (count > (std::size_t{1} << bits))
+        {
+            bits = bits == 0 ? uint8_t{1} : static_cast<uint8_t>(bits * 2);
+        }
+
+        return bits;
+    }
+
+    /// @brief Gets the number of words needed to pack the given number of indices.
+    std::size_t wordCount(std::size_t count, uint8_t bits)
+    {
+        return (count * bits + 63) / 64;
+    }
+
+    /// @brief Gets a packed index.
+    uint16_t unpack(const std::vector<uint64_t>& words, std::size_t i, uint8_t bits)
+    {
+        auto bit = i * bits;
+        auto mask = (uint64_t{1} << bits) - 1;
+        return static_cast<uint16_t>((words[bit / 64] >> (bit % 64)) & mask);
+    }
+
+    /// @brief Packs an index, assuming the bits it's packed into are still zero.
+    void pack(std::vector<uint64_t>& words, std::size_t i, uint8_t bits, uint16_t index)
+    {
+        auto bit = i * bits;
+        words[bit / 64] |= static_cast<uint64_t>(index) << (bit % 64);
+    }
+
+    /// @brief Gets the index of a voxel in a chunk.
+    std::size_t voxelIndex(const glm::ivec3& position)
+    {
+        return static_cast<std::size_t>(position.x + position.y * ChunkSize + position.z * ChunkSize * ChunkSize);
+    }
+
+    /// @brief Compresses the voxels of a chunk, choosing whichever of the packed and run-length
+    /// encodings takes less space.
+    Chunk encode(const uint16_t* voxels)
+    {
+        Chunk chunk;
+
+        // Replace material indices by indices into the chunk palette, and count the runs.
+        std::vector<uint16_t> indices(ChunkVolume);
+        std::unordered_map<uint16_t, uint16_t> local;
+        std::size_t runCount = 0;
+        for (std::size_t i = 0; i < ChunkVolume; ++i)
+        {
+            auto [it, inserted] = local.try_emplace(voxels[i], static_cast<uint16_t>(chunk.palette.size()));
+            if (inserted)
+            {
+                chunk.palette.push_back(voxels[i]);
+            }
+
+            indices[i] = it->second;
+            if (i == 0 || indices[i] != indices[i - 1])
+            {
+                runCount += 1;
+            }
+        }
+
+        chunk.bits = bitsFor(chunk.palette.size());
+        if (chunk.bits == 0)
+        {
+            return chunk;
+        }
+
+        auto packedBytes = wordCount(ChunkVolume, chunk.bits) * sizeof(uint64_t);
+        auto runBytes = runCount * sizeof(uint16_t) + wordCount(runCount, chunk.bits) * sizeof(uint64_t);
+        if (runBytes < packedBytes)
+        {
+            chunk.runs.reserve(runCount);
+            chunk.words.resize(wordCount(runCount, chunk.bits), 0);
+            for (std::size_t i = 0; i < ChunkVolume; ++i)
+            {
+                if (i + 1 == ChunkVolume || indices[i] != indices[i + 1])
+                {
+                    pack(chunk.words, chunk.runs.size(), chunk.bits, indices[i]);
+                    chunk.runs.push_back(static_cast<uint16_t>(i + 1));
+                }
+            }
+        }
+        else
+        {
+            chunk.words.resize(wordCount(ChunkVolume, chunk.bits), 0);
+            for (std::size_t i = 0; i < ChunkVolume; ++i)
+            {
+                pack(chunk.words, i, chunk.bits, indices[i]);
+            }
+        }
+
+        return chunk;
+    }
+} // namespace
+
+uint16_t Chunk::get(std::size_t index) const
+{
+    if (bits == 0)
+    {
+        return palette[0];
+    }
+
+    if (!runs.empty())
+    {
+        // Find the first run which ends after the voxel.
+        index = static_cast<std::size_t>(std::upper_bound(runs.begin(), runs.end(), index) - runs.begin());
+    }
+
+    return palette[unpack(words, index, bits)];
+}
+
+void Chunk::decode(uint16_t* voxels) const
+{
+    if (bits == 0)
+    {
+        std::fill_n(voxels, ChunkVolume, palette[0]);
+    }
+    else if (!runs.empty())
+    {
+        std::size_t start = 0;
+        for (std::size_t i = 0; i < runs.size(); ++i)
+        {
+            std::fill(voxels + start, voxels + runs[i], palette[unpack(words, i, bits)]);
+            start = runs[i];
+        }
+    }
+    else
+    {
+        // Extract every index from each word in turn.
+        auto perWord = static_cast<std::size_t>(64 / bits);
+        auto mask = (uint64_t{1} << bits) - 1;
+        for (std::size_t w = 0; w < words.size(); ++w)
+        {
+            auto word = words[w];
+            for (std::size_t i = w * perWord; i < std::min((w + 1) * perWord, ChunkVolume); ++i)
+            {
+                voxels[i] = palette[static_cast<std::size_t>(word & mask)];
+                word >>= bits;
+            }
+        }
+    }
+}
+
+bool Chunk::valid() const
+{
+    if (palette.empty() || (bits != 0 && bits != 1 && bits != 2 && bits != 4 && bits != 8 && bits != 16) ||
+        palette.size() > (std::size_t{1} << bits))
+    {
+        return false;
+    }
+
+    if (bits == 0)
+    {
+        return runs.empty() && words.empty();
+    }
+
+    for (std::size_t i = 0; i < runs.size(); ++i)
+    {
+        if (runs[i] <= (i == 0 ? 0 : runs[i - 1]))
+        {
+            return false;
+        }
+    }
+
+    if (!runs.empty() && static_cast<std::size_t>(runs.back()) != ChunkVolume)
+    {
+        return false;
+    }
+
+    auto count = runs.empty() ? ChunkVolume : runs.size();
+    if (words.size() != wordCount(count, bits))
+    {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (unpack(words, i, bits) >= palette.size())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+CompressedVoxelGrid::CompressedVoxelGrid()
+    : CompressedVoxelGrid(VoxelGrid{})
+{
+}
+
+CompressedVoxelGrid::CompressedVoxelGrid(const VoxelGrid& grid)
+    : mSize(grid.size())
+{
+    auto count = this->chunkCount();
+    auto last = glm::ivec3{mSize} - 1;
+    mChunks.reserve(static_cast<std::size_t>(count.x) * count.y * count.z);
+
+    uint16_t voxels[ChunkVolume];
+    for (unsigned int cz = 0; cz < count.z; ++cz)
+    {
+        for (unsigned int cy = 0; cy < count.y; ++cy)
+        {
+            for (unsigned int cx = 0; cx < count.x; ++cx)
+            {
+                // Voxels outside the grid repeat the nearest voxel inside it, so that they don't
+                // add materials or break runs.
+                auto origin = glm::ivec3{cx, cy, cz} * ChunkSize;
+                for (int z = 0; z < ChunkSize; ++z)
+                {
+                    for (int y = 0; y < ChunkSize; ++y)
+                    {
+                        for (int x = 0; x < ChunkSize; ++x)
+                        {
+                            voxels[voxelIndex({x, y, z})] = grid.get(glm::min(origin + glm::ivec3{x, y, z}, last));
+                        }
+                    }
+                }
+
+                mChunks.push_back(encode(voxels));
+            }
+        }
+    }
+}
+
+const glm::uvec3& CompressedVoxelGrid::size() const
+{
+    return mSize;
+}
+
+uint16_t CompressedVoxelGrid::get(const glm::ivec3& position) const
+{
+    assert(position.x >= 0 && position.x < static_cast<int>(mSize.x));
+    assert(position.y >= 0 && position.y < static_cast<int>(mSize.y));
+    assert(position.z >= 0 && position.z < static_cast<int>(mSize.z));
+    return mChunks[this->chunkIndex(glm::uvec3{position / ChunkSize})].get(voxelIndex(position % ChunkSize));
+}
+
+glm::uvec3 CompressedVoxelGrid::chunkCount() const
+{
+    return (mSize + static_cast<unsigned int>(ChunkSize - 1)) / static_cast<unsigned int>(ChunkSize);
+}
+
+auto CompressedVoxelGrid::chunk(const glm::uvec3& position) const -> const Chunk&
+{
+    return mChunks[this->chunkIndex(position)];
+}
+
+VoxelGrid CompressedVoxelGrid::decodeChunk(const glm::uvec3& position) const
+{
+    auto origin = glm::ivec3{position} * ChunkSize;
+    auto extent = glm::min(origin + ChunkSize, glm::ivec3{mSize}) - origin;
+
+    uint16_t voxels[ChunkVolume];
+    this->chunk(position).decode(voxels);
+
+    std::vector<uint16_t> indices;
+    indices.reserve(static_cast<std::size_t>(extent.x * extent.y * extent.z));
+    for (int z = 0; z < extent.z; ++z)
+    {
+        for (int y = 0; y < extent.y; ++y)
+        {
+            auto* row = voxels + voxelIndex({0, y, z});
+            indices.insert(indices.end(), row, row + extent.x);
+        }
+    }
+
+    return VoxelGrid{glm::uvec3{extent}, indices};
+}
+
+VoxelGrid CompressedVoxelGrid::decode() const
+{
+    auto count = this->chunkCount();
+    auto size = glm::ivec3{mSize};
+    std::vector<uint16_t> indices(static_cast<std::size_t>(mSize.x) * mSize.y * mSize.z);
+
+    uint16_t voxels[ChunkVolume];
+    for (unsigned int cz = 0; cz < count.z; ++cz)
+    {
+        for (unsigned int cy = 0; cy < count.y; ++cy)
+        {
+            for (unsigned int cx = 0; cx < count.x; ++cx)
+            {
+                this->chunk({cx, cy, cz}).decode(voxels);
+
+                // Copy each row of the chunk which is inside the grid to its place.
+                auto origin = glm::ivec3{cx, cy, cz} * ChunkSize;
+                auto extent = glm::min(origin + ChunkSize, size) - origin;
+                for (int z = 0; z < extent.z; ++z)
+                {
+                    for (int y = 0; y < extent.y; ++y)
+                    {
+                        auto dst = static_cast<std::size_t>(origin.x + (origin.y + y) * size.x +
+                                                            (origin.z + z) * size.x * size.y);
+                        std::copy_n(voxels + voxelIndex({0, y, z}), extent.x, indices.data() + dst);
+                    }
+                }
+            }
+        }
+    }
+
+    return VoxelGrid{mSize, indices};
+}
+
+std::size_t CompressedVoxelGrid::memory() const
+{
+    std::size_t bytes = mChunks.capacity() * sizeof(Chunk);
+    for (const auto& chunk : mChunks)
+    {
+        bytes += chunk.palette.capacity() * sizeof(uint16_t) + chunk.runs.capacity() * sizeof(uint16_t) +
+                 chunk.words.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+std::size_t CompressedVoxelGrid::chunkIndex(const glm::uvec3& position) const
+{
+    auto count = this->chunkCount();
+    assert(glm::all(glm::lessThan(position, count)));
+    return static_cast<std::size_t>(position.x) + static_cast<std::size_t>(position.y) * count.x +
+           static_cast<std::size_t>(position.z) * count.x * count.y;
+}
+
+void cubos::core::data::old::serialize(Serializer& serializer, const CompressedVoxelGrid& grid, const char* name)
+{
+    serializer.beginObject(name);
+    serializer.write(grid.mSize, "size");
+    serializer.beginArray(grid.mChunks.size(), "chunks");
+    for (const auto& chunk : grid.mChunks)
+    {
+        serializer.beginObject(nullptr);
+        serializer.write(chunk.palette, "palette");
+        serializer.write(chunk.bits, "bits");
+        serializer.write(chunk.runs, "runs");
+        serializer.write(chunk.words, "words");
+        serializer.endObject();
+    }
+    serializer.endArray();
+    serializer.endObject();
+}
+
+void cubos::core::data::old::deserialize(Deserializer& deserializer, CompressedVoxelGrid& grid)
+{
+    deserializer.beginObject();
+    deserializer.read(grid.mSize);
+    grid.mChunks.resize(deserializer.beginArray());
+    for (auto& chunk : grid.mChunks)
+    {
+        deserializer.beginObject();
+        deserializer.read(chunk.palette);
+        deserializer.read(chunk.bits);
+        deserializer.read(chunk.runs);
+        deserializer.read(chunk.words);
+        deserializer.endObject();
+    }
+    deserializer.endArray();
+    deserializer.endObject();
+
+    auto count = grid.chunkCount();
+    if (grid.mSize.x < 1 || grid.mSize.y < 1 || grid.mSize.z < 1 ||
+        grid.mChunks.size() != static_cast<std::size_t>(count.x) * count.y * count.z ||
+        !std::all_of(grid.mChunks.begin(), grid.mChunks.end(), [](const auto& chunk) { return chunk.valid(); }))
+    {
+        CUBOS_ERROR("Could not deserialize compressed voxel grid of size ({}, {}, {}), its chunks are invalid",
+                    grid.mSize.x, grid.mSize.y, grid.mSize.z);
+        grid = CompressedVoxelGrid{};
+        deserializer.fail();
+    }
+}
@@ -1,4 +1,9 @@
-#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <numeric>
 
 #include <cubos/core/log.hpp>
 
@@ -7,6 +12,22 @@
 
 using namespace cubos::engine;
 
+/// @brief Number of possible material indices.
+static constexpr std::size_t MaterialCount = 65536;
+
+/// @brief Number of low bits of a generation counted by each grid on its own, within an epoch.
+static constexpr int EpochShift = 32;
+
+/// @brief Source of the epochs of every grid, so that generations only ever increase.
+static std::atomic<uint64_t> nextEpoch{1};
+
+/// @brief Takes the first generation of a new epoch.
+/// @return Generation, greater than any taken before by any grid.
+static uint64_t newEpoch()
+{
+    return nextEpoch.fetch_add(1, std::memory_order_relaxed) << EpochShift;
+}
+
 VoxelGrid::VoxelGrid(const glm::uvec3& size)
 {
     if (size.x < 1 || size.y < 1 || size.z < 1)
@@ -22,6 +43,7 @@ VoxelGrid::VoxelGrid(const glm::uvec3& size)
 
     mIndices.resize(
         static_cast<std::size_t>(mSize.x) * static_cast<std::size_t>(mSize.y) * static_cast<std::size_t>(mSize.z), 0);
+    this->touch();
 }
 
 VoxelGrid::VoxelGrid(const glm::uvec3& size, const std::vector<uint16_t>& indices)
@@ -45,10 +67,14 @@ VoxelGrid::VoxelGrid(const glm::uvec3& size, const std::vector<uint16_t>& indice
     }
 
     mIndices = indices;
+    this->touch();
 }
 
 VoxelGrid::VoxelGrid(VoxelGrid&& other) noexcept
     : mSize(other.mSize)
+    , mChunkGenerations(std::move(other.mChunkGenerations))
+    , mChunkCount(other.mChunkCount)
+    , mGeneration(other.mGeneration)
 {
     new (&mIndices) std::vector<uint16_t>(std::move(other.mIndices));
 }
@@ -57,9 +83,16 @@ VoxelGrid::VoxelGrid()
 {
     mSize = {1, 1, 1};
     mIndices.resize(1, 0);
+    this->touch();
 }
 
-VoxelGrid& VoxelGrid::operator=(const VoxelGrid& rhs) = default;
+VoxelGrid& VoxelGrid::operator=(const VoxelGrid& rhs)
+{
+    mSize = rhs.mSize;
+    mIndices = rhs.mIndices;
+    this->touch();
+    return *this;
+}
 
 void VoxelGrid::setSize(const glm::uvec3& size)
 {
@@ -79,6 +112,7 @@ void VoxelGrid::setSize(const glm::uvec3& size)
     mIndices.clear();
     mIndices.resize(
         static_cast<std::size_t>(mSize.x) * static_cast<std::size_t>(mSize.y) * static_cast<std::size_t>(mSize.z), 0);
+    this->touch();
 }
 
 const glm::uvec3& VoxelGrid::size() const
@@ -88,10 +122,8 @@ const glm::uvec3& VoxelGrid::size() const
 
 void VoxelGrid::clear()
 {
-    for (auto& i : mIndices)
-    {
-        i = 0;
-    }
+    std::fill(mIndices.begin(), mIndices.end(), uint16_t{0});
+    this->touch();
 }
 
 uint16_t VoxelGrid::get(const glm::ivec3& position) const
@@ -110,39 +142,411 @@ void VoxelGrid::set(const glm::ivec3& position, uint16_t mat)
     assert(position.z >= 0 && position.z < static_cast<int>(mSize.z));
     auto index = position.x + position.y * static_cast<int>(mSize.x) + position.z * static_cast<int>(mSize.x * mSize.y);
     mIndices[static_cast<std::size_t>(index)] = mat;
+
+    auto chunk = glm::uvec3{position / ChunkSize};
+    mChunkGenerations[chunk.x + chunk.y * mChunkCount.x + chunk.z * mChunkCount.x * mChunkCount.y] = this->advance();
 }
 
 bool VoxelGrid::convert(const VoxelPalette& src, const VoxelPalette& dst, float minSimilarity)
 {
-    // Find the mappings for every material in the source palette.
-    std::unordered_map<uint16_t, uint16_t> mappings;
+    // Find the mappings for every material in the source palette. Materials without one keep their
+    // index in the table, but aren't marked as mapped.
+    std::vector<uint16_t> lut(MaterialCount);
+    std::vector<uint8_t> mapped(MaterialCount, 0);
+    std::iota(lut.begin(), lut.end(), uint16_t{0});
     for (uint16_t i = 0; i <= src.size(); ++i)
     {
         uint16_t j = dst.find(src.get(i));
         if (src.get(i).similarity(dst.get(j)) >= minSimilarity)
         {
-            mappings[i] = j;
+            lut[i] = j;
+            mapped[i] = 1;
         }
     }
 
-    // Check if the mappings are complete for every material being used in the grid.
-    for (uint32_t i = 0; i < mSize.x * mSize.y * mSize.z; ++i)
+    // Check if the mappings are complete for every material being used in the grid. Marking the
+    // used materials first keeps the loop over the voxels free of branches.
+    std::vector<uint8_t> used(MaterialCount, 0);
+    for (auto mat : mIndices)
+    {
+        used[mat] = 1;
+    }
+    for (std::size_t i = 0; i < MaterialCount; ++i)
     {
-        if (mappings.find(mIndices[i]) == mappings.end())
+        if (used[i] != 0 && mapped[i] == 0)
         {
             return false;
         }
     }
 
-    // Apply the mappings.
-    for (uint32_t i = 0; i < mSize.x * mSize.y * mSize.z; ++i)
+    this->remap(lut);
+    return true;
+}
+
+void VoxelGrid::remap(const std::vector<uint16_t>& lut)
+{
+    // Extend the table to every possible index, so that the loop below doesn't need bounds checks
+    // and can be vectorized into gathers.
+    const auto* table = lut.data();
+    std::vector<uint16_t> full;
+    if (lut.size() < MaterialCount)
+    {
+        full.resize(MaterialCount);
+        std::copy(lut.begin(), lut.end(), full.begin());
+        std::iota(full.begin() + static_cast<std::ptrdiff_t>(lut.size()), full.end(),
+                  static_cast<uint16_t>(lut.size()));
+        table = full.data();
+    }
+
+    auto* data = mIndices.data();
+    for (std::size_t i = 0, n = mIndices.size(); i < n; ++i)
+    {
+        data[i] = table[data[i]];
+    }
+
+    this->touch();
+}
+
+/// @brief Calls a function for each row of voxels of a box of a source grid which, placed at a
+/// position of a destination grid, overlaps both grids.
+/// @param dstSize Size of the destination grid.
+/// @param srcSize Size of the source grid.
+/// @param srcMin Inclusive minimum corner of the box in the source grid.
+/// @param srcMax Exclusive maximum corner of the box in the source grid.
+/// @param dst Position in the destination grid of @p srcMin.
+/// @param[out] min Inclusive minimum corner of the overlap in the destination grid.
+/// @param[out] max Exclusive maximum corner of the overlap in the destination grid.
+/// @param function Function called with the indices of the rows in both grids, and their length.
+/// @return Whether there was any overlap.
+template <typename F>
+static bool forEachRow(const glm::uvec3& dstSize, const glm::uvec3& srcSize, glm::ivec3 srcMin, glm::ivec3 srcMax,
+                       const glm::ivec3& dst, glm::ivec3& min, glm::ivec3& max, F function)
+{
+    // Clip the box to the source grid, and then to the destination grid.
+    auto offset = dst - srcMin;
+    srcMin = glm::max(srcMin, glm::ivec3{0});
+    srcMax = glm::min(srcMax, glm::ivec3{srcSize});
+    min = glm::max(srcMin + offset, glm::ivec3{0});
+    max = glm::min(srcMax + offset, glm::ivec3{dstSize});
+    if (glm::any(glm::greaterThanEqual(min, max)))
     {
-        mIndices[i] = mappings[mIndices[i]];
+        return false;
+    }
+
+    auto length = static_cast<std::size_t>(max.x - min.x);
+    for (int z = min.z; z < max.z; ++z)
+    {
+        for (int y = min.y; y < max.y; ++y)
+        {
+            auto dstRow = (static_cast<std::size_t>(z) * dstSize.y + static_cast<std::size_t>(y)) * dstSize.x;
+            auto srcZ = static_cast<std::size_t>(z - offset.z);
+            auto srcRow = (srcZ * srcSize.y + static_cast<std::size_t>(y - offset.y)) * srcSize.x;
+            function(dstRow + static_cast<std::size_t>(min.x), srcRow + static_cast<std::size_t>(min.x - offset.x),
+                     length);
+        }
     }
 
     return true;
 }
 
+void VoxelGrid::fill(const glm::ivec3& min, const glm::ivec3& max, uint16_t mat)
+{
+    // Filling is the same as copying from a grid of the same size as this one, but without reading it.
+    glm::ivec3 lo;
+    glm::ivec3 hi;
+    if (forEachRow(mSize, mSize, min, max, min, lo, hi,
+                   [&](std::size_t row, std::size_t, std::size_t length) { std::fill_n(&mIndices[row], length, mat); }))
+    {
+        this->touch(lo, hi);
+    }
+}
+
+void VoxelGrid::fillSphere(const glm::vec3& center, float radius, uint16_t mat)
+{
+    auto lo = glm::max(glm::ivec3{glm::floor(center - radius)}, glm::ivec3{0});
+    auto hi = glm::min(glm::ivec3{glm::floor(center + radius)} + 1, glm::ivec3{mSize});
+    if (radius < 0.0F || glm::any(glm::greaterThanEqual(lo, hi)))
+    {
+        return;
+    }
+
+    // Fill each row of the sphere at once, from the span of the row inside the sphere.
+    for (int z = lo.z; z < hi.z; ++z)
+    {
+        for (int y = lo.y; y < hi.y; ++y)
+        {
+            float dy = static_cast<float>(y) + 0.5F - center.y;
+            float dz = static_cast<float>(z) + 0.5F - center.z;
+            float rowDistance = dy * dy + dz * dz;
+            if (rowDistance > radius * radius)
+            {
+                continue;
+            }
+
+            // The span may be off by one voxel at either end due to rounding, so its ends are
+            // nudged until they agree with the exact test for each voxel.
+            auto inside = [&](int x) {
+                float dx = static_cast<float>(x) + 0.5F - center.x;
+                return dx * dx + rowDistance <= radius * radius;
+            };
+            float half = std::sqrt(radius * radius - rowDistance);
+            int begin = std::max(static_cast<int>(std::ceil(center.x - half - 0.5F)), lo.x);
+            int end = std::min(static_cast<int>(std::floor(center.x + half - 0.5F)) + 1, hi.x);
+            begin += begin < end && !inside(begin) ? 1 : (begin > lo.x && inside(begin - 1) ? -1 : 0);
+            end += end > begin && !inside(end - 1) ? -1 : (end < hi.x && inside(end) ? 1 : 0);
+            if (begin < end)
+            {
+                auto row = (static_cast<std::size_t>(z) * mSize.y + static_cast<std::size_t>(y)) * mSize.x;
+                std::fill_n(&mIndices[row + static_cast<std::size_t>(begin)], end - begin, mat);
+            }
+        }
+    }
+
+    this->touch(lo, hi);
+}
+
+void VoxelGrid::copyRegion(const VoxelGrid& src, const glm::ivec3& srcMin, const glm::ivec3& srcMax,
+                           const glm::ivec3& dst)
+{
+    if (&src == this)
+    {
+        // Copy from a copy, as the rows may overlap.
+        VoxelGrid copy;
+        copy = src;
+        this->copyRegion(copy, srcMin, srcMax, dst);
+        return;
+    }
+
+    glm::ivec3 lo;
+    glm::ivec3 hi;
+    if (forEachRow(mSize, src.mSize, srcMin, srcMax, dst, lo, hi, [&](auto dstRow, auto srcRow, auto length) {
+            std::copy_n(&src.mIndices[srcRow], length, &mIndices[dstRow]);
+        }))
+    {
+        this->touch(lo, hi);
+    }
+}
+
+void VoxelGrid::blit(const VoxelGrid& src, const glm::ivec3& dst)
+{
+    this->copyRegion(src, {0, 0, 0}, glm::ivec3{src.mSize}, dst);
+}
+
+void VoxelGrid::unite(const VoxelGrid& other, const glm::ivec3& offset)
+{
+    if (&other == this)
+    {
+        VoxelGrid copy;
+        copy = other;
+        this->unite(copy, offset);
+        return;
+    }
+
+    // Rows are combined without branches, so that the loops can be vectorized into blends.
+    glm::ivec3 lo;
+    glm::ivec3 hi;
+    if (forEachRow(mSize, other.mSize, {0, 0, 0}, glm::ivec3{other.mSize}, offset, lo, hi,
+                   [&](auto dstRow, auto srcRow, auto length) {
+                       auto* d = &mIndices[dstRow];
+                       const auto* s = &other.mIndices[srcRow];
+                       for (std::size_t i = 0; i < length; ++i)
+                       {
+                           d[i] = s[i] != 0 ? s[i] : d[i];
+                       }
+                   }))
+    {
+        this->touch(lo, hi);
+    }
+}
+
+void VoxelGrid::subtract(const VoxelGrid& other, const glm::ivec3& offset)
+{
+    if (&other == this)
+    {
+        VoxelGrid copy;
+        copy = other;
+        this->subtract(copy, offset);
+        return;
+    }
+
+    glm::ivec3 lo;
+    glm::ivec3 hi;
+    if (forEachRow(mSize, other.mSize, {0, 0, 0}, glm::ivec3{other.mSize}, offset, lo, hi,
+                   [&](auto dstRow, auto srcRow, auto length) {
+                       auto* d = &mIndices[dstRow];
+                       const auto* s = &other.mIndices[srcRow];
+                       for (std::size_t i = 0; i < length; ++i)
+                       {
+                           d[i] = s[i] != 0 ? uint16_t{0} : d[i];
+                       }
+                   }))
+    {
+        this->touch(lo, hi);
+    }
+}
+
+VoxelGrid VoxelGrid::downsample(unsigned int factor) const
+{
+    assert(factor >= 1);
+    VoxelGrid result{(mSize + factor - 1U) / factor};
+    this->downsample(factor, {0, 0, 0}, result.mSize, result);
+    result.touch();
+    return result;
+}
+
+void VoxelGrid::downsample(unsigned int factor, const glm::uvec3& min, const glm::uvec3& max, VoxelGrid& result) const
+{
+    assert(factor >= 1);
+    assert(result.mSize == (mSize + factor - 1U) / factor);
+    auto lo = glm::min(min, result.mSize);
+    auto hi = glm::min(max, result.mSize);
+    if (glm::any(glm::greaterThanEqual(lo, hi)))
+    {
+        return;
+    }
+
+    std::vector<uint16_t> block;
+    block.reserve(static_cast<std::size_t>(factor) * factor * factor);
+    for (unsigned int z = lo.z; z < hi.z; ++z)
+    {
+        for (unsigned int y = lo.y; y < hi.y; ++y)
+        {
+            auto out = (static_cast<std::size_t>(z) * result.mSize.y + y) * result.mSize.x + lo.x;
+            for (unsigned int x = lo.x; x < hi.x; ++x, ++out)
+            {
+                // Gather the solid voxels of the block, which may be cut short by the edges.
+                glm::uvec3 blockMin{x * factor, y * factor, z * factor};
+                auto blockMax = glm::min(blockMin + factor, mSize);
+                block.clear();
+                for (unsigned int bz = blockMin.z; bz < blockMax.z; ++bz)
+                {
+                    for (unsigned int by = blockMin.y; by < blockMax.y; ++by)
+                    {
+                        auto row = (static_cast<std::size_t>(bz) * mSize.y + by) * mSize.x;
+                        for (unsigned int bx = blockMin.x; bx < blockMax.x; ++bx)
+                        {
+                            if (mIndices[row + bx] != 0)
+                            {
+                                block.push_back(mIndices[row + bx]);
+                            }
+                        }
+                    }
+                }
+
+                auto volume = static_cast<std::size_t>(blockMax.x - blockMin.x) * (blockMax.y - blockMin.y) *
+                              (blockMax.z - blockMin.z);
+                if (block.size() * 2 < volume)
+                {
+                    result.mIndices[out] = 0;
+                    continue;
+                }
+
+                // Find the most common material, preferring the lowest index on ties.
+                std::sort(block.begin(), block.end());
+                uint16_t best = block.front();
+                std::size_t bestCount = 0;
+                for (std::size_t i = 0; i < block.size();)
+                {
+                    std::size_t j = i;
+                    while (j < block.size() && block[j] == block[i])
+                    {
+                        ++j;
+                    }
+
+                    if (j - i > bestCount)
+                    {
+                        best = block[i];
+                        bestCount = j - i;
+                    }
+                    i = j;
+                }
+
+                result.mIndices[out] = best;
+            }
+        }
+    }
+
+    result.touch(glm::ivec3{lo}, glm::ivec3{hi});
+}
+
+uint64_t VoxelGrid::hash() const
+{
+    // Mix four voxels at a time into the hash, with the multiplier and rotation of xxHash64.
+    constexpr uint64_t Prime = 0x9E3779B185EBCA87ULL;
+    auto mix = [](uint64_t hash, uint64_t value) { return std::rotl((hash ^ value) * Prime, 31); };
+
+    uint64_t hash = mix(mix(0, mSize.x), (static_cast<uint64_t>(mSize.y) << 32) | mSize.z);
+    std::size_t i = 0;
+    for (; i + 4 <= mIndices.size(); i += 4)
+    {
+        uint64_t word;
+        std::memcpy(&word, &mIndices[i], sizeof(word));
+        hash = mix(hash, word);
+    }
+    for (; i < mIndices.size(); ++i)
+    {
+        hash = mix(hash, mIndices[i]);
+    }
+
+    // Avalanche the last bits, so that similar grids get very different hashes.
+    hash ^= hash >> 33;
+    hash *= Prime;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+uint64_t VoxelGrid::generation() const
+{
+    return mGeneration;
+}
+
+glm::uvec3 VoxelGrid::chunkCount() const
+{
+    return mChunkCount;
+}
+
+uint64_t VoxelGrid::chunkGeneration(const glm::uvec3& chunk) const
+{
+    assert(chunk.x < mChunkCount.x && chunk.y < mChunkCount.y && chunk.z < mChunkCount.z);
+    return mChunkGenerations[chunk.x + chunk.y * mChunkCount.x + chunk.z * mChunkCount.x * mChunkCount.y];
+}
+
+uint64_t VoxelGrid::advance()
+{
+    // Only this grid takes generations from its epoch, so no synchronization is needed until the
+    // epoch runs out.
+    mGeneration += 1;
+    if ((mGeneration & ((uint64_t{1} << EpochShift) - 1)) == 0)
+    {
+        mGeneration = newEpoch();
+    }
+
+    return mGeneration;
+}
+
+void VoxelGrid::touch(const glm::ivec3& min, const glm::ivec3& max)
+{
+    auto first = glm::uvec3{min / ChunkSize};
+    auto last = glm::uvec3{(max - 1) / ChunkSize};
+    auto generation = this->advance();
+    for (unsigned int z = first.z; z <= last.z; ++z)
+    {
+        for (unsigned int y = first.y; y <= last.y; ++y)
+        {
+            auto row = (static_cast<std::size_t>(z) * mChunkCount.y + y) * mChunkCount.x;
+            std::fill(mChunkGenerations.begin() + static_cast<std::ptrdiff_t>(row + first.x),
+                      mChunkGenerations.begin() + static_cast<std::ptrdiff_t>(row + last.x + 1), generation);
+        }
+    }
+}
+
+void VoxelGrid::touch()
+{
+    mChunkCount = (mSize + static_cast<unsigned int>(ChunkSize - 1)) / static_cast<unsigned int>(ChunkSize);
+    mGeneration = newEpoch();
+    mChunkGenerations.assign(static_cast<std::size_t>(mChunkCount.x) * mChunkCount.y * mChunkCount.z, mGeneration);
+}
+
 void cubos::core::data::old::serialize(Serializer& serializer, const VoxelGrid& grid, const char* name)
 {
     serializer.beginObject(name);
@@ -166,4 +570,6 @@ void cubos::core::data::old::deserialize(Deserializer& deserializer, VoxelGrid&
         grid.mIndices.clear();
         grid.mIndices.resize(1, 0);
     }
+
+    grid.touch();
 }
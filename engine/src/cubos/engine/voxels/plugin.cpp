@@ -1,5 +1,7 @@
 #include <cubos/engine/assets/bridges/binary.hpp>
 #include <cubos/engine/assets/plugin.hpp>
+#include <cubos/engine/voxels/chunked_grid.hpp>
+#include <cubos/engine/voxels/compressed_bridge.hpp>
 #include <cubos/engine/voxels/grid.hpp>
 #include <cubos/engine/voxels/palette.hpp>
 #include <cubos/engine/voxels/plugin.hpp>
@@ -9,8 +11,10 @@ using namespace cubos::engine;
 
 static void bridges(Write<Assets> assets)
 {
-    // Add the bridges to load .grd and .pal files.
+    // Add the bridges to load .grd, .pgrd, .cgrd and .pal files.
     assets->registerBridge(".grd", std::make_unique<BinaryBridge<VoxelGrid>>());
+    assets->registerBridge(".pgrd", std::make_unique<CompressedGridBridge>());
+    assets->registerBridge(".cgrd", std::make_unique<BinaryBridge<ChunkedVoxelGrid>>());
     assets->registerBridge(".pal", std::make_unique<BinaryBridge<VoxelPalette>>());
 }
 
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <utility>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/core/ecs/system/system.hpp>
+#include <cubos/core/ecs/world.hpp>
+
+#include "../../src/cubos/engine/collisions/broad_phase.hpp"
+
+using cubos::core::ecs::CommandBuffer;
+using cubos::core::ecs::Entity;
+using cubos::core::ecs::SystemWrapper;
+using cubos::core::ecs::World;
+
+using Method = BroadPhaseCollisions::Method;
+using PairSet = std::set<std::pair<uint32_t, uint32_t>>;
+
+/// Runs a system once on a world.
+template <typename F>
+static void run(World& world, F function)
+{
+    CommandBuffer commands{world};
+    SystemWrapper<F> wrapper{function};
+    wrapper.prepare(world);
+    wrapper.call(world, commands);
+}
+
+/// Runs the broad phase systems for a frame, in the order set by the plugin.
+static void step(World& world)
+{
+    run(world, setupNewBoxes);
+    run(world, updateAABBs);
+    run(world, updateMarkers);
+    run(world, sweep);
+    run(world, updateTree);
+    run(world, updateSpatialHash);
+    run(world, findPairs);
+}
+
+/// Makes a transform which translates by the given position.
+static LocalToWorld translation(glm::vec3 position)
+{
+    LocalToWorld localToWorld{};
+    localToWorld.mat[3] = glm::vec4{position, 1.0F};
+    return localToWorld;
+}
+
+/// Creates an entity with a unit box collider at the given position.
+static Entity spawn(World& world, glm::vec3 position, bool isStatic = false)
+{
+    Collider collider{};
+    collider.isStatic = isStatic;
+    return world.create(BoxCollisionShape{}, collider, translation(position));
+}
+
+/// Makes a pair of entity indices which doesn't depend on the order of the entities.
+static std::pair<uint32_t, uint32_t> makePair(Entity a, Entity b)
+{
+    return {std::min(a.index, b.index), std::max(a.index, b.index)};
+}
+
+/// Gets the pairs found by the broad phase on the last frame, either the candidates or the resting pairs.
+static PairSet foundPairs(World& world, bool resting)
+{
+    PairSet pairs;
+    run(world, [&](Read<BroadPhaseCollisions> collisions) {
+        const auto& list = resting ? collisions->restingPairs
+                                   : collisions->candidates(BroadPhaseCollisions::CollisionType::BoxBox);
+        for (const auto& [a, b] : list)
+        {
+            pairs.insert(makePair(a, b));
+        }
+    });
+    return pairs;
+}
+
+/// Checks whether the collider of an entity is asleep.
+static bool asleep(World& world, Entity entity)
+{
+    bool sleeping = false;
+    run(world, [&](Query<Read<Collider>> query) {
+        auto [collider] = *query[entity];
+        sleeping = collider->sleeping;
+    });
+    return sleeping;
+}
+
+/// Runs the broad phase over a few colliders which fall asleep and are woken up.
+static void checkSleeping(Method method)
+{
+    World world{};
+    world.registerComponent<Collider>();
+    world.registerComponent<BoxCollisionShape>();
+    world.registerComponent<LocalToWorld>();
+    world.registerResource<BroadPhaseCollisions>();
+    run(world, [method](Write<BroadPhaseCollisions> collisions) {
+        collisions->method = method;
+        collisions->sleepFrames = 2;
+    });
+
+    auto a = spawn(world, {0.0F, 0.0F, 0.0F});
+    auto b = spawn(world, {0.5F, 0.0F, 0.0F});
+    auto wall = spawn(world, {10.0F, 0.0F, 0.0F}, true);
+    auto floor = spawn(world, {10.5F, 0.0F, 0.0F}, true);
+    auto far = spawn(world, {20.0F, 0.0F, 0.0F});
+
+    // Overlapping static colliders are never paired, not even as resting pairs.
+    step(world);
+    CHECK(foundPairs(world, false) == PairSet{makePair(a, b)});
+    CHECK(foundPairs(world, true).empty());
+
+    // Static colliders fall asleep on the next frame, and the others once they stay still long enough.
+    step(world);
+    CHECK(asleep(world, wall));
+    CHECK(asleep(world, floor));
+    CHECK_FALSE(asleep(world, a));
+    step(world);
+    step(world);
+    CHECK(asleep(world, a));
+    CHECK(asleep(world, far));
+    run(world, [](Read<BroadPhaseCollisions> collisions) {
+        CHECK(collisions->awakeEntities.empty());
+        CHECK(collisions->movedEntities.empty());
+    });
+
+    // Pairs of sleeping colliders aren't candidates anymore, but are still found.
+    CHECK(foundPairs(world, false).empty());
+    CHECK(foundPairs(world, true) == PairSet{makePair(a, b)});
+
+    // Moving a sleeping collider goes unnoticed until it is woken up.
+    world.add(far, translation({0.25F, 0.0F, 0.0F}));
+    step(world);
+    CHECK(asleep(world, far));
+    CHECK(foundPairs(world, false).empty());
+
+    run(world, [far](Write<BroadPhaseCollisions> collisions) { collisions->wake(far); });
+    step(world);
+    CHECK_FALSE(asleep(world, far));
+    CHECK(foundPairs(world, false) == PairSet{makePair(a, far), makePair(b, far)});
+    CHECK(foundPairs(world, true) == PairSet{makePair(a, b)});
+
+    // The awake collider moves next to the static ones, which are still never paired together.
+    world.add(far, translation({11.0F, 0.0F, 0.0F}));
+    step(world);
+    CHECK(foundPairs(world, false) == PairSet{makePair(wall, far), makePair(floor, far)});
+    CHECK(foundPairs(world, true) == PairSet{makePair(a, b)});
+
+    // Once it falls asleep too, its pairs with the static colliders become resting pairs.
+    step(world);
+    step(world);
+    step(world);
+    CHECK(asleep(world, far));
+    CHECK(foundPairs(world, false).empty());
+    CHECK(foundPairs(world, true) == PairSet{makePair(a, b), makePair(wall, far), makePair(floor, far)});
+}
+
+TEST_CASE("collisions.broad_phase")
+{
+    SUBCASE("sweep and prune")
+    {
+        checkSleeping(Method::SweepAndPrune);
+    }
+
+    SUBCASE("AABB tree")
+    {
+        checkSleeping(Method::AABBTree);
+    }
+
+    SUBCASE("spatial hash")
+    {
+        checkSleeping(Method::SpatialHash);
+    }
+}
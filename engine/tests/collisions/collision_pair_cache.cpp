@@ -0,0 +1,147 @@
+#include <utility>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include <cubos/engine/collisions/collision_pair_cache.hpp>
+
+using cubos::core::ecs::Entity;
+using cubos::engine::CollisionPairCache;
+
+/// Pairs which started and ended touching on a frame.
+struct Transitions
+{
+    std::vector<std::pair<Entity, Entity>> started;
+    std::vector<std::pair<Entity, Entity>> ended;
+};
+
+/// Ends the frame, collecting the pairs which started and stopped touching.
+static Transitions endFrame(CollisionPairCache& cache)
+{
+    Transitions transitions;
+    cache.endFrame([&](Entity a, Entity b) { transitions.started.emplace_back(a, b); },
+                   [&](Entity a, Entity b) { transitions.ended.emplace_back(a, b); });
+    return transitions;
+}
+
+/// Checks whether a list of pairs holds exactly the given pair, in any order.
+static bool only(const std::vector<std::pair<Entity, Entity>>& pairs, Entity a, Entity b)
+{
+    return pairs.size() == 1 && ((pairs[0].first == a && pairs[0].second == b) ||
+                                 (pairs[0].first == b && pairs[0].second == a));
+}
+
+TEST_CASE("collisions.collision_pair_cache")
+{
+    CollisionPairCache cache{};
+    Entity a{0, 0};
+    Entity b{1, 0};
+    Entity c{2, 0};
+
+    SUBCASE("pairs go through started, persisting and ended")
+    {
+        // Frame 1: the pair is found but isn't touching yet.
+        cache.beginFrame();
+        cache.update(a, b);
+        auto transitions = endFrame(cache);
+        CHECK(cache.size() == 1);
+        CHECK(transitions.started.empty());
+        CHECK(transitions.ended.empty());
+
+        // Frame 2: the pair starts touching, reported with the entities swapped.
+        cache.beginFrame();
+        cache.update(b, a).touching = true;
+        transitions = endFrame(cache);
+        CHECK(cache.size() == 1);
+        CHECK(only(transitions.started, a, b));
+        CHECK(transitions.ended.empty());
+
+        // Frame 3: the pair keeps touching, which isn't a transition. Updating it twice on the same
+        // frame must not forget that it was touching before.
+        cache.beginFrame();
+        cache.update(a, b);
+        auto& entry = cache.update(a, b);
+        CHECK(entry.wasTouching);
+        CHECK_FALSE(entry.touching);
+        entry.touching = true;
+        transitions = endFrame(cache);
+        CHECK(transitions.started.empty());
+        CHECK(transitions.ended.empty());
+
+        // Frame 4: the pair is still found, but stopped touching.
+        cache.beginFrame();
+        cache.update(a, b);
+        transitions = endFrame(cache);
+        CHECK(cache.size() == 1);
+        CHECK(transitions.started.empty());
+        CHECK(only(transitions.ended, a, b));
+
+        // Frame 5: the pair isn't found anymore, which removes it without any transition, as it
+        // already stopped touching.
+        cache.beginFrame();
+        transitions = endFrame(cache);
+        CHECK(cache.size() == 0);
+        CHECK(cache.find(a, b) == nullptr);
+        CHECK(transitions.started.empty());
+        CHECK(transitions.ended.empty());
+    }
+
+    SUBCASE("pairs are removed when one of their entities is destroyed")
+    {
+        cache.beginFrame();
+        cache.update(a, b).touching = true;
+        cache.update(a, c).touching = true;
+        auto transitions = endFrame(cache);
+        CHECK(cache.size() == 2);
+        CHECK(transitions.started.size() == 2);
+
+        // The broad phase stops reporting pairs with c, as it was destroyed, which ends the pair
+        // even though it never stopped touching.
+        cache.beginFrame();
+        cache.update(a, b).touching = true;
+        transitions = endFrame(cache);
+        CHECK(cache.size() == 1);
+        CHECK(cache.find(a, c) == nullptr);
+        CHECK(cache.find(c, a) == nullptr);
+        CHECK(cache.find(a, b) != nullptr);
+        CHECK(transitions.started.empty());
+        CHECK(only(transitions.ended, a, c));
+
+        // If the index of c is reused by a new entity, its pairs start from scratch.
+        Entity reused{2, 1};
+        cache.beginFrame();
+        cache.update(a, b).touching = true;
+        auto& entry = cache.update(reused, a);
+        CHECK_FALSE(entry.wasTouching);
+        CHECK(entry.axis == -1);
+        entry.touching = true;
+        transitions = endFrame(cache);
+        CHECK(only(transitions.started, a, reused));
+        CHECK(transitions.ended.empty());
+    }
+
+    SUBCASE("the separating axis is kept while the pair is found")
+    {
+        cache.beginFrame();
+        CHECK(cache.update(a, b).axis == -1);
+        cache.update(a, b).axis = 4;
+        endFrame(cache);
+
+        for (int frame = 0; frame < 3; ++frame)
+        {
+            cache.beginFrame();
+            CHECK(cache.update(b, a).axis == 4);
+            endFrame(cache);
+        }
+
+        REQUIRE(cache.find(a, b) != nullptr);
+        CHECK(cache.find(a, b)->axis == 4);
+
+        // Once the pair leaves the cache, the axis is forgotten.
+        cache.beginFrame();
+        endFrame(cache);
+        cache.beginFrame();
+        CHECK(cache.update(a, b).axis == -1);
+        endFrame(cache);
+    }
+}
@@ -0,0 +1,246 @@
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <set>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/engine/collisions/collision_world.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+using cubos::core::ecs::Entity;
+using cubos::core::geom::AABB;
+using cubos::core::geom::Box;
+using cubos::core::geom::Capsule;
+using cubos::engine::CollisionWorld;
+using cubos::engine::VoxelGrid;
+using cubos::engine::VoxelOccupancy;
+
+/// Makes a transform which translates by the given position.
+static glm::mat4 translation(glm::vec3 position)
+{
+    glm::mat4 transform{1.0F};
+    transform[3] = glm::vec4{position, 1.0F};
+    return transform;
+}
+
+/// Makes an AABB with the given corners.
+static AABB makeAABB(glm::vec3 min, glm::vec3 max)
+{
+    AABB aabb;
+    aabb.min(min);
+    aabb.max(max);
+    return aabb;
+}
+
+/// Gets the indices of a list of entities.
+static std::set<uint32_t> indices(const std::vector<Entity>& entities)
+{
+    std::set<uint32_t> result;
+    for (auto entity : entities)
+    {
+        result.insert(entity.index);
+    }
+    return result;
+}
+
+/// Checks whether two points are close enough.
+static bool near(glm::vec3 a, glm::vec3 b)
+{
+    return glm::length(a - b) < 1e-4F;
+}
+
+TEST_CASE("collisions.collision_world")
+{
+    // A unit box at the origin, a capsule standing at x = 5, and a 4x4x4 voxel grid at x = 10 with two solid voxels,
+    // whose world boxes are [11, 12]x[1, 2]x[1, 2] and [12, 13]x[1, 2]x[1, 2].
+    Entity box{0, 0};
+    Entity capsule{1, 0};
+    Entity voxels{2, 0};
+
+    VoxelGrid grid{glm::uvec3{4, 4, 4}};
+    grid.set({1, 1, 1}, 1);
+    grid.set({2, 1, 1}, 1);
+
+    CollisionWorld world;
+    world.beginFrame();
+    world.update(box, translation({0.0F, 0.0F, 0.0F}), makeAABB(glm::vec3{-0.5F}, glm::vec3{0.5F}), Box{});
+    world.update(capsule, translation({5.0F, 0.0F, 0.0F}), makeAABB({4.5F, -0.5F, -0.5F}, {5.5F, 1.5F, 0.5F}),
+                 Capsule{0.5F, 1.0F});
+    world.update(voxels, translation({10.0F, 0.0F, 0.0F}), makeAABB({10.0F, 0.0F, 0.0F}, {14.0F, 4.0F, 4.0F}),
+                 std::make_shared<const VoxelOccupancy>(grid));
+    world.endFrame();
+    REQUIRE(world.size() == 3);
+
+    SUBCASE("raycast hits the closest shape")
+    {
+        auto hit = world.raycast({-5.0F, 0.0F, 0.0F}, {2.0F, 0.0F, 0.0F});
+        REQUIRE(hit.has_value());
+        CHECK(hit->entity == box);
+        CHECK(hit->distance == doctest::Approx(4.5F));
+        CHECK(near(hit->point, {-0.5F, 0.0F, 0.0F}));
+        CHECK(near(hit->normal, {-1.0F, 0.0F, 0.0F}));
+
+        // The ray passes through the capsule too, but the box is hit first.
+        hit = world.raycast({-5.0F, 0.25F, 0.0F}, {1.0F, 0.0F, 0.0F});
+        REQUIRE(hit.has_value());
+        CHECK(hit->entity == box);
+
+        hit = world.raycast({5.0F, 0.5F, -5.0F}, {0.0F, 0.0F, 1.0F});
+        REQUIRE(hit.has_value());
+        CHECK(hit->entity == capsule);
+        CHECK(hit->distance == doctest::Approx(4.5F));
+        CHECK(near(hit->normal, {0.0F, 0.0F, -1.0F}));
+
+        hit = world.raycast({11.5F, 1.5F, -5.0F}, {0.0F, 0.0F, 1.0F});
+        REQUIRE(hit.has_value());
+        CHECK(hit->entity == voxels);
+        CHECK(hit->distance == doctest::Approx(6.0F));
+        CHECK(near(hit->point, {11.5F, 1.5F, 1.0F}));
+        CHECK(near(hit->normal, {0.0F, 0.0F, -1.0F}));
+
+        // Rays starting inside a shape hit it at their origin.
+        hit = world.raycast({0.1F, 0.1F, 0.1F}, {0.0F, 1.0F, 0.0F});
+        REQUIRE(hit.has_value());
+        CHECK(hit->entity == box);
+        CHECK(hit->distance == doctest::Approx(0.0F));
+    }
+
+    SUBCASE("raycast misses")
+    {
+        CHECK_FALSE(world.raycast({-5.0F, 3.0F, 0.0F}, {1.0F, 0.0F, 0.0F}).has_value());
+        CHECK_FALSE(world.raycast({-5.0F, 0.0F, 0.0F}, {-1.0F, 0.0F, 0.0F}).has_value());
+
+        // Passes through the bounds of the grid, but between its solid voxels.
+        CHECK_FALSE(world.raycast({10.5F, 0.5F, -5.0F}, {0.0F, 0.0F, 1.0F}).has_value());
+    }
+
+    SUBCASE("raycast is clipped at the maximum distance")
+    {
+        CHECK_FALSE(world.raycast({-5.0F, 0.0F, 0.0F}, {1.0F, 0.0F, 0.0F}, 4.0F).has_value());
+        CHECK(world.raycast({-5.0F, 0.0F, 0.0F}, {1.0F, 0.0F, 0.0F}, 5.0F).has_value());
+        CHECK_FALSE(world.raycast({11.5F, 1.5F, -5.0F}, {0.0F, 0.0F, 1.0F}, 5.9F).has_value());
+
+        // Starts past the box, at 1.5 from the capsule.
+        auto hit = world.raycast({3.0F, 0.0F, 0.0F}, {1.0F, 0.0F, 0.0F}, 1.0F);
+        CHECK_FALSE(hit.has_value());
+        hit = world.raycast({3.0F, 0.0F, 0.0F}, {1.0F, 0.0F, 0.0F}, 2.0F);
+        REQUIRE(hit.has_value());
+        CHECK(hit->entity == capsule);
+    }
+
+    SUBCASE("batched raycasts match single raycasts")
+    {
+        std::vector<CollisionWorld::Ray> rays{{{-5.0F, 0.0F, 0.0F}, {1.0F, 0.0F, 0.0F}},
+                                              {{5.0F, 0.5F, -5.0F}, {0.0F, 0.0F, 1.0F}},
+                                              {{11.5F, 1.5F, -5.0F}, {0.0F, 0.0F, 1.0F}, 2.0F},
+                                              {{-5.0F, 3.0F, 0.0F}, {1.0F, 0.0F, 0.0F}}};
+        std::vector<std::optional<CollisionWorld::RayHit>> hits;
+        world.raycast(rays, hits);
+        REQUIRE(hits.size() == rays.size());
+        for (std::size_t i = 0; i < rays.size(); ++i)
+        {
+            auto hit = world.raycast(rays[i].origin, rays[i].direction, rays[i].maxDistance);
+            REQUIRE(hits[i].has_value() == hit.has_value());
+            if (hit)
+            {
+                CHECK(hits[i]->entity == hit->entity);
+                CHECK(hits[i]->distance == doctest::Approx(hit->distance));
+            }
+        }
+        CHECK(hits[0].has_value());
+        CHECK_FALSE(hits[2].has_value());
+    }
+
+    SUBCASE("overlapBox")
+    {
+        std::vector<Entity> entities;
+        Box small{glm::vec3{0.25F}};
+        world.overlapBox(translation({5.0F, 0.0F, 0.0F}), small, entities);
+        CHECK(indices(entities) == std::set<uint32_t>{capsule.index});
+
+        entities.clear();
+        world.overlapBox(translation({11.5F, 1.5F, 1.5F}), small, entities);
+        CHECK(indices(entities) == std::set<uint32_t>{voxels.index});
+
+        // Inside the bounds of the grid, but away from its solid voxels.
+        entities.clear();
+        world.overlapBox(translation({10.5F, 0.5F, 0.5F}), small, entities);
+        CHECK(entities.empty());
+
+        entities.clear();
+        world.overlapBox(translation({5.0F, 0.0F, 0.0F}), Box{{6.0F, 0.4F, 0.4F}}, entities);
+        CHECK(indices(entities) == std::set<uint32_t>{box.index, capsule.index});
+    }
+
+    SUBCASE("overlapSphere")
+    {
+        std::vector<Entity> entities;
+        world.overlapSphere({0.0F, 0.0F, 1.0F}, 0.6F, entities);
+        CHECK(indices(entities) == std::set<uint32_t>{box.index});
+
+        entities.clear();
+        world.overlapSphere({0.0F, 0.0F, 1.0F}, 0.4F, entities);
+        CHECK(entities.empty());
+
+        entities.clear();
+        world.overlapSphere({5.0F, 2.0F, 0.0F}, 0.6F, entities);
+        CHECK(indices(entities) == std::set<uint32_t>{capsule.index});
+
+        entities.clear();
+        world.overlapSphere({11.5F, 1.5F, 0.5F}, 0.6F, entities);
+        CHECK(indices(entities) == std::set<uint32_t>{voxels.index});
+
+        entities.clear();
+        world.overlapSphere({11.5F, 1.5F, 0.5F}, 0.4F, entities);
+        CHECK(entities.empty());
+    }
+
+    SUBCASE("nearest")
+    {
+        auto hit = world.nearest({0.0F, 3.0F, 0.0F});
+        REQUIRE(hit.has_value());
+        CHECK(hit->entity == box);
+        CHECK(hit->distance == doctest::Approx(2.5F));
+        CHECK(near(hit->point, {0.0F, 0.5F, 0.0F}));
+        CHECK_FALSE(world.nearest({0.0F, 3.0F, 0.0F}, 2.0F).has_value());
+
+        hit = world.nearest({5.0F, 3.0F, 0.0F});
+        REQUIRE(hit.has_value());
+        CHECK(hit->entity == capsule);
+        CHECK(hit->distance == doctest::Approx(1.5F));
+        CHECK(near(hit->point, {5.0F, 1.5F, 0.0F}));
+
+        // Far from the grid, which must then be searched from its side closest to the point.
+        hit = world.nearest({12.5F, 1.5F, 30.0F});
+        REQUIRE(hit.has_value());
+        CHECK(hit->entity == voxels);
+        CHECK(hit->distance == doctest::Approx(28.0F));
+        CHECK(near(hit->point, {12.5F, 1.5F, 2.0F}));
+        CHECK_FALSE(world.nearest({12.5F, 1.5F, 30.0F}, 27.5F).has_value());
+
+        // Inside the bounds of the grid, but closer to the far solid voxel.
+        hit = world.nearest({13.5F, 3.5F, 3.5F});
+        REQUIRE(hit.has_value());
+        CHECK(hit->entity == voxels);
+        CHECK(near(hit->point, {13.0F, 2.0F, 2.0F}));
+
+        // Points inside a solid voxel are at distance zero.
+        hit = world.nearest({11.5F, 1.5F, 1.5F});
+        REQUIRE(hit.has_value());
+        CHECK(hit->entity == voxels);
+        CHECK(hit->distance == doctest::Approx(0.0F));
+    }
+
+    SUBCASE("colliders which aren't updated or kept are removed")
+    {
+        world.beginFrame();
+        CHECK(world.keep(box));
+        CHECK_FALSE(world.keep(Entity{7, 0}));
+        world.endFrame();
+        CHECK(world.size() == 1);
+        CHECK_FALSE(world.raycast({5.0F, 0.5F, -5.0F}, {0.0F, 0.0F, 1.0F}).has_value());
+    }
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/engine/collisions/dynamic_aabb_tree.hpp>
+
+using cubos::core::ecs::Entity;
+using cubos::core::geom::AABB;
+using cubos::engine::DynamicAABBTree;
+
+/// Makes an AABB with the given corners.
+static AABB makeAABB(glm::vec3 min, glm::vec3 max)
+{
+    AABB aabb;
+    aabb.min(min);
+    aabb.max(max);
+    return aabb;
+}
+
+/// Makes a random AABB inside a cube of the given size, with edges up to the given length.
+static AABB randomAABB(std::mt19937& rng, float worldSize, float maxEdge)
+{
+    std::uniform_real_distribution<float> position{-worldSize, worldSize};
+    std::uniform_real_distribution<float> edge{0.0F, maxEdge};
+    glm::vec3 min{position(rng), position(rng), position(rng)};
+    return makeAABB(min, min + glm::vec3{edge(rng), edge(rng), edge(rng)});
+}
+
+/// Finds the pairs of proxies with overlapping fat AABBs by querying the tree.
+static std::set<std::pair<int, int>> treePairs(const DynamicAABBTree& tree, const std::vector<int>& proxies)
+{
+    std::set<std::pair<int, int>> pairs;
+    for (int proxy : proxies)
+    {
+        tree.query(tree.fatAABB(proxy), [&](int other) {
+            if (other != proxy)
+            {
+                pairs.emplace(std::min(proxy, other), std::max(proxy, other));
+            }
+            return true;
+        });
+    }
+    return pairs;
+}
+
+/// Finds the pairs of proxies with overlapping fat AABBs by testing every pair.
+static std::set<std::pair<int, int>> bruteForcePairs(const DynamicAABBTree& tree, const std::vector<int>& proxies)
+{
+    std::set<std::pair<int, int>> pairs;
+    for (std::size_t i = 0; i < proxies.size(); ++i)
+    {
+        for (std::size_t j = i + 1; j < proxies.size(); ++j)
+        {
+            if (tree.fatAABB(proxies[i]).overlaps(tree.fatAABB(proxies[j])))
+            {
+                pairs.emplace(std::min(proxies[i], proxies[j]), std::max(proxies[i], proxies[j]));
+            }
+        }
+    }
+    return pairs;
+}
+
+TEST_CASE("collisions.dynamic_aabb_tree")
+{
+    DynamicAABBTree tree{};
+    std::mt19937 rng{42};
+
+    SUBCASE("pairs match a brute force search on random AABBs")
+    {
+        std::vector<int> proxies;
+        std::vector<AABB> aabbs;
+        for (uint32_t i = 0; i < 200; ++i)
+        {
+            aabbs.push_back(randomAABB(rng, 20.0F, 4.0F));
+            proxies.push_back(tree.insert(aabbs.back(), Entity{i, 0}));
+        }
+
+        CHECK(tree.size() == 200);
+        CHECK(treePairs(tree, proxies) == bruteForcePairs(tree, proxies));
+
+        // Move some proxies by small amounts, which mostly stay inside their fat AABBs, and
+        // others by large amounts, which force them to be reinserted.
+        std::uniform_real_distribution<float> small{-0.05F, 0.05F};
+        std::uniform_real_distribution<float> large{-10.0F, 10.0F};
+        for (std::size_t i = 0; i < proxies.size(); ++i)
+        {
+            auto& dist = i % 2 == 0 ? small : large;
+            glm::vec3 offset{dist(rng), dist(rng), dist(rng)};
+            aabbs[i] = makeAABB(aabbs[i].min() + offset, aabbs[i].max() + offset);
+            tree.move(proxies[i], aabbs[i]);
+        }
+
+        // Remove a few proxies.
+        for (std::size_t i = 0; i < 50; ++i)
+        {
+            tree.remove(proxies.back());
+            proxies.pop_back();
+            aabbs.pop_back();
+        }
+
+        CHECK(tree.size() == 150);
+        auto pairs = treePairs(tree, proxies);
+        CHECK(pairs == bruteForcePairs(tree, proxies));
+
+        // Fat AABBs contain the real ones, so no real overlap is ever missed.
+        for (std::size_t i = 0; i < proxies.size(); ++i)
+        {
+            for (std::size_t j = i + 1; j < proxies.size(); ++j)
+            {
+                if (aabbs[i].overlaps(aabbs[j]))
+                {
+                    auto pair = std::make_pair(std::min(proxies[i], proxies[j]), std::max(proxies[i], proxies[j]));
+                    CHECK(pairs.contains(pair));
+                }
+            }
+        }
+    }
+
+    SUBCASE("rays parallel to a slab plane are handled without dividing by zero")
+    {
+        int proxy = tree.insert(makeAABB({0.0F, 0.0F, 0.0F}, {1.0F, 1.0F, 1.0F}), Entity{0, 0});
+        auto fat = tree.fatAABB(proxy);
+
+        auto hits = [&](glm::vec3 origin, glm::vec3 direction) {
+            bool hit = false;
+            tree.raycast(origin, direction, 100.0F, [&](int) {
+                hit = true;
+                return true;
+            });
+            return hit;
+        };
+
+        // The origin lies exactly on the planes of the fat AABB on the axes the ray doesn't move along.
+        CHECK(hits({-5.0F, fat.min().y, fat.min().z}, {1.0F, 0.0F, 0.0F}));
+        CHECK(hits({-5.0F, fat.max().y, 0.5F}, {1.0F, 0.0F, 0.0F}));
+        CHECK(hits({0.5F, 0.5F, fat.max().z}, {0.0F, 0.0F, 0.0F}));
+
+        // Just outside of those planes.
+        CHECK_FALSE(hits({-5.0F, fat.max().y + 0.01F, 0.5F}, {1.0F, 0.0F, 0.0F}));
+        CHECK_FALSE(hits({0.5F, fat.min().y - 0.01F, -5.0F}, {0.0F, 0.0F, 1.0F}));
+
+        // Pointing away from the AABB, or stopping short of it.
+        CHECK_FALSE(hits({-5.0F, 0.5F, 0.5F}, {-1.0F, 0.0F, 0.0F}));
+        CHECK_FALSE(hits({-5.0F, 0.5F, 0.5F}, {0.01F, 0.0F, 0.0F}));
+        CHECK_FALSE(hits({-5.0F, 0.5F, 0.5F}, {1.0F, 1.0F, 0.0F}));
+        CHECK(hits({-1.0F, -1.0F, 0.5F}, {1.0F, 1.0F, 0.0F}));
+    }
+}
@@ -0,0 +1,329 @@
+#include <cmath>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/engine/voxels/grid.hpp>
+
+#include "../../src/cubos/engine/collisions/narrow_phase.hpp"
+
+using cubos::engine::VoxelGrid;
+
+/// Makes a box rotated by the given angle around the X, Y or Z axis.
+static OrientedBox makeBox(glm::vec3 center, glm::vec3 halfSize, int axis = 0, float angle = 0.0F)
+{
+    OrientedBox box{center, {{1.0F, 0.0F, 0.0F}, {0.0F, 1.0F, 0.0F}, {0.0F, 0.0F, 1.0F}}, halfSize};
+    int u = (axis + 1) % 3;
+    int v = (axis + 2) % 3;
+    glm::vec3 axisU{0.0F};
+    glm::vec3 axisV{0.0F};
+    axisU[u] = std::cos(angle);
+    axisU[v] = std::sin(angle);
+    axisV[u] = -std::sin(angle);
+    axisV[v] = std::cos(angle);
+    box.axes[u] = axisU;
+    box.axes[v] = axisV;
+    return box;
+}
+
+/// Runs the box test on a single pair.
+static std::pmr::vector<CollisionEvent> collide(const OrientedBox& a, const OrientedBox& b, int* axis = nullptr)
+{
+    std::pmr::vector<BroadPhaseCollisions::Candidate> pairs{{Entity{0, 0}, Entity{1, 0}}};
+    std::pmr::vector<OrientedBox> as{a};
+    std::pmr::vector<OrientedBox> bs{b};
+    std::pmr::vector<CollisionEvent> events;
+    std::pmr::vector<int> axes;
+    collideBoxes(pairs, as, bs, events, axes);
+    REQUIRE(axes.size() == 1);
+    if (axis != nullptr)
+    {
+        *axis = axes[0];
+    }
+    return events;
+}
+
+/// Runs the capsule test on a single pair.
+static std::pmr::vector<CollisionEvent> collide(const CapsuleSegment& a, const CapsuleSegment& b)
+{
+    std::pmr::vector<BroadPhaseCollisions::Candidate> pairs{{Entity{0, 0}, Entity{1, 0}}};
+    std::pmr::vector<CapsuleSegment> as{a};
+    std::pmr::vector<CapsuleSegment> bs{b};
+    std::pmr::vector<CollisionEvent> events;
+    collideCapsules(pairs, as, bs, events);
+    return events;
+}
+
+/// Runs the box and capsule test on a single pair.
+static std::pmr::vector<CollisionEvent> collide(const OrientedBox& a, const CapsuleSegment& b)
+{
+    std::pmr::vector<BroadPhaseCollisions::Candidate> pairs{{Entity{0, 0}, Entity{1, 0}}};
+    std::pmr::vector<OrientedBox> as{a};
+    std::pmr::vector<CapsuleSegment> bs{b};
+    std::pmr::vector<CollisionEvent> events;
+    collideBoxCapsules(pairs, as, bs, events);
+    return events;
+}
+
+/// Checks that an axis reported by the box test actually separates two boxes. Axes 0 to 2 are the faces of the first
+/// box, 3 to 5 the faces of the second, and the others the cross products of their edges.
+static bool separatesAlong(const OrientedBox& a, const OrientedBox& b, int axis)
+{
+    glm::vec3 direction = axis < 3   ? a.axes[axis]
+                          : axis < 6 ? b.axes[axis - 3]
+                                     : glm::cross(a.axes[(axis - 6) / 3], b.axes[(axis - 6) % 3]);
+    float ra = 0.0F;
+    float rb = 0.0F;
+    for (int k = 0; k < 3; ++k)
+    {
+        ra += a.halfSize[k] * std::abs(glm::dot(a.axes[k], direction));
+        rb += b.halfSize[k] * std::abs(glm::dot(b.axes[k], direction));
+    }
+    return std::abs(glm::dot(b.center - a.center, direction)) > ra + rb;
+}
+
+/// Checks that two vectors are close to each other.
+static bool near(glm::vec3 a, glm::vec3 b, float tolerance = 1e-4F)
+{
+    return glm::length(a - b) <= tolerance;
+}
+
+TEST_CASE("collisions.narrow_phase.boxes")
+{
+    auto unit = makeBox({0.0F, 0.0F, 0.0F}, {0.5F, 0.5F, 0.5F});
+
+    SUBCASE("face against face")
+    {
+        auto events = collide(unit, makeBox({0.9F, 0.2F, 0.0F}, {0.5F, 0.5F, 0.5F}));
+        REQUIRE(events.size() == 1);
+        CHECK(events[0].entity == Entity{0, 0});
+        CHECK(events[0].other == Entity{1, 0});
+        CHECK(near(events[0].normal, {1.0F, 0.0F, 0.0F}));
+        CHECK(events[0].depth == doctest::Approx(0.1F));
+
+        // The overlapping part of the faces is a rectangle, whose corners are halfway between both faces.
+        REQUIRE(events[0].pointCount == 4);
+        for (std::size_t i = 0; i < events[0].pointCount; ++i)
+        {
+            auto point = events[0].points[i];
+            CHECK(point.x == doctest::Approx(0.45F));
+            CHECK(point.y >= -0.3F - 1e-4F);
+            CHECK(point.y <= 0.5F + 1e-4F);
+            CHECK(std::abs(point.z) == doctest::Approx(0.5F));
+        }
+    }
+
+    SUBCASE("face of the second box against a vertex of the first")
+    {
+        // The first box is rotated so that one of its vertices pokes into the bottom face of the second.
+        auto rotated = makeBox({0.0F, 0.0F, 0.0F}, {0.5F, 0.5F, 0.5F}, 2, glm::radians(45.0F));
+        auto events = collide(rotated, makeBox({0.0F, 1.15F, 0.0F}, {0.5F, 0.5F, 0.5F}));
+        REQUIRE(events.size() == 1);
+        CHECK(near(events[0].normal, {0.0F, 1.0F, 0.0F}));
+        CHECK(events[0].depth == doctest::Approx(std::sqrt(0.5F) - 0.65F).epsilon(1e-3));
+
+        // The vertex is actually an edge along Z, which gives a contact at each of its ends.
+        REQUIRE(events[0].pointCount == 2);
+        for (std::size_t i = 0; i < events[0].pointCount; ++i)
+        {
+            CHECK(std::abs(events[0].points[i].x) < 1e-4F);
+            CHECK(std::abs(events[0].points[i].z) == doctest::Approx(0.5F));
+        }
+    }
+
+    SUBCASE("edge against edge")
+    {
+        // Each box is rotated so that an edge points at the other, with both edges crossing at a right angle.
+        auto a = makeBox({0.0F, 0.0F, 0.0F}, {0.5F, 0.5F, 0.5F}, 2, glm::radians(45.0F));
+        auto b = makeBox({0.0F, 1.4F, 0.0F}, {0.5F, 0.5F, 0.5F}, 0, glm::radians(45.0F));
+        int axis = -1;
+        auto events = collide(a, b, &axis);
+        REQUIRE(events.size() == 1);
+        CHECK(axis >= 6);
+        CHECK(near(events[0].normal, {0.0F, 1.0F, 0.0F}));
+        CHECK(events[0].depth == doctest::Approx(2.0F * std::sqrt(0.5F) - 1.4F).epsilon(1e-3));
+        REQUIRE(events[0].pointCount == 1);
+        CHECK(near(events[0].points[0], {0.0F, 0.7F, 0.0F}, 1e-2F));
+    }
+
+    SUBCASE("deep penetration pushes out along the axis of least penetration")
+    {
+        auto events = collide(unit, makeBox({0.1F, -0.05F, 0.0F}, {0.5F, 0.5F, 0.5F}));
+        REQUIRE(events.size() == 1);
+        CHECK(near(events[0].normal, {1.0F, 0.0F, 0.0F}));
+        CHECK(events[0].depth == doctest::Approx(0.9F));
+
+        // A small box fully inside of a larger one.
+        events = collide(unit, makeBox({0.0F, -0.2F, 0.05F}, {0.1F, 0.1F, 0.1F}));
+        REQUIRE(events.size() == 1);
+        CHECK(near(events[0].normal, {0.0F, -1.0F, 0.0F}));
+        CHECK(events[0].depth == doctest::Approx(0.4F));
+        REQUIRE(events[0].pointCount >= 1);
+        for (std::size_t i = 0; i < events[0].pointCount; ++i)
+        {
+            CHECK(glm::all(glm::lessThanEqual(glm::abs(events[0].points[i]), glm::vec3{0.5F + 1e-4F})));
+        }
+    }
+
+    SUBCASE("touching but not overlapping boxes")
+    {
+        // Exactly touching boxes may or may not be reported, but never with any depth.
+        for (const auto& event : collide(unit, makeBox({1.0F, 0.0F, 0.0F}, {0.5F, 0.5F, 0.5F})))
+        {
+            CHECK(event.depth == doctest::Approx(0.0F));
+        }
+
+        // The axis returned for separated boxes is one which separates them, so that it can be cached.
+        int axis = -1;
+        auto b = makeBox({1.001F, 0.0F, 0.0F}, {0.5F, 0.5F, 0.5F});
+        CHECK(collide(unit, b, &axis).empty());
+        CHECK(separatesAlong(unit, b, axis));
+        b = makeBox({0.0F, 0.0F, -1.001F}, {0.5F, 0.5F, 0.5F});
+        CHECK(collide(unit, b, &axis).empty());
+        CHECK(separatesAlong(unit, b, axis));
+
+        // Separated only along the edge axis, while overlapping along every face axis.
+        auto a = makeBox({0.0F, 0.0F, 0.0F}, {0.5F, 0.5F, 0.5F}, 2, glm::radians(45.0F));
+        b = makeBox({0.0F, 1.42F, 0.0F}, {0.5F, 0.5F, 0.5F}, 0, glm::radians(45.0F));
+        CHECK(collide(a, b, &axis).empty());
+        CHECK(axis >= 6);
+        CHECK(separatesAlong(a, b, axis));
+    }
+
+    SUBCASE("pairs are tested in batches")
+    {
+        // More pairs than fit in a single batch, alternating between colliding and not colliding.
+        std::pmr::vector<BroadPhaseCollisions::Candidate> pairs;
+        std::pmr::vector<OrientedBox> as;
+        std::pmr::vector<OrientedBox> bs;
+        for (uint32_t i = 0; i < 21; ++i)
+        {
+            pairs.emplace_back(Entity{i, 0}, Entity{i + 100, 0});
+            as.push_back(unit);
+            bs.push_back(makeBox({i % 2 == 0 ? 0.9F : 1.1F, 0.0F, 0.0F}, {0.5F, 0.5F, 0.5F}));
+        }
+
+        std::pmr::vector<CollisionEvent> events;
+        std::pmr::vector<int> axes;
+        collideBoxes(pairs, as, bs, events, axes);
+        CHECK(axes.size() == 21);
+        REQUIRE(events.size() == 11);
+        for (std::size_t i = 0; i < events.size(); ++i)
+        {
+            CHECK(events[i].entity == Entity{static_cast<uint32_t>(2 * i), 0});
+        }
+    }
+}
+
+TEST_CASE("collisions.narrow_phase.capsules")
+{
+    SUBCASE("parallel capsules")
+    {
+        auto events = collide(CapsuleSegment{{0.0F, 0.0F, 0.0F}, {0.0F, 1.0F, 0.0F}, 0.5F},
+                              CapsuleSegment{{0.8F, 0.0F, 0.0F}, {0.8F, 1.0F, 0.0F}, 0.5F});
+        REQUIRE(events.size() == 1);
+        CHECK(near(events[0].normal, {1.0F, 0.0F, 0.0F}));
+        CHECK(events[0].depth == doctest::Approx(0.2F));
+        REQUIRE(events[0].pointCount == 1);
+        CHECK(events[0].points[0].x == doctest::Approx(0.4F));
+        CHECK(events[0].points[0].y >= 0.0F);
+        CHECK(events[0].points[0].y <= 1.0F);
+
+        // Parallel, but too far apart, and parallel along the same line, but not reaching each other.
+        CHECK(collide(CapsuleSegment{{0.0F, 0.0F, 0.0F}, {0.0F, 1.0F, 0.0F}, 0.5F},
+                      CapsuleSegment{{1.1F, 0.0F, 0.0F}, {1.1F, 1.0F, 0.0F}, 0.5F})
+                  .empty());
+        CHECK(collide(CapsuleSegment{{0.0F, 0.0F, 0.0F}, {0.0F, 1.0F, 0.0F}, 0.5F},
+                      CapsuleSegment{{0.0F, 2.1F, 0.0F}, {0.0F, 3.0F, 0.0F}, 0.5F})
+                  .empty());
+    }
+
+    SUBCASE("crossing capsules")
+    {
+        auto events = collide(CapsuleSegment{{-1.0F, 0.0F, 0.0F}, {1.0F, 0.0F, 0.0F}, 0.3F},
+                              CapsuleSegment{{0.0F, 0.5F, -1.0F}, {0.0F, 0.5F, 1.0F}, 0.3F});
+        REQUIRE(events.size() == 1);
+        CHECK(near(events[0].normal, {0.0F, 1.0F, 0.0F}));
+        CHECK(events[0].depth == doctest::Approx(0.1F));
+        CHECK(near(events[0].points[0], {0.0F, 0.25F, 0.0F}));
+    }
+
+    SUBCASE("spheres")
+    {
+        // Capsules with no length, one of which is exactly at the center of the other.
+        auto events = collide(CapsuleSegment{{0.0F, 0.0F, 0.0F}, {0.0F, 0.0F, 0.0F}, 1.0F},
+                              CapsuleSegment{{0.0F, 0.0F, 0.0F}, {0.0F, 0.0F, 0.0F}, 0.5F});
+        REQUIRE(events.size() == 1);
+        CHECK(glm::length(events[0].normal) == doctest::Approx(1.0F));
+        CHECK(events[0].depth == doctest::Approx(1.5F));
+    }
+}
+
+TEST_CASE("collisions.narrow_phase.box_capsules")
+{
+    auto unit = makeBox({0.0F, 0.0F, 0.0F}, {0.5F, 0.5F, 0.5F});
+
+    SUBCASE("capsule standing on a box")
+    {
+        auto events = collide(unit, CapsuleSegment{{0.0F, 0.7F, 0.0F}, {0.0F, 2.0F, 0.0F}, 0.3F});
+        REQUIRE(events.size() == 1);
+        CHECK(near(events[0].normal, {0.0F, 1.0F, 0.0F}, 1e-3F));
+        CHECK(events[0].depth == doctest::Approx(0.1F).epsilon(1e-3));
+        REQUIRE(events[0].pointCount == 1);
+        CHECK(near(events[0].points[0], {0.0F, 0.5F, 0.0F}, 1e-3F));
+
+        CHECK(collide(unit, CapsuleSegment{{0.0F, 0.81F, 0.0F}, {0.0F, 2.0F, 0.0F}, 0.3F}).empty());
+    }
+
+    SUBCASE("capsule lying on a box touches it at its ends too")
+    {
+        auto events = collide(unit, CapsuleSegment{{-0.4F, 0.7F, 0.0F}, {0.4F, 0.7F, 0.0F}, 0.3F});
+        REQUIRE(events.size() == 1);
+        CHECK(near(events[0].normal, {0.0F, 1.0F, 0.0F}, 1e-3F));
+        CHECK(events[0].pointCount == 3);
+        for (std::size_t i = 0; i < events[0].pointCount; ++i)
+        {
+            CHECK(events[0].points[i].y == doctest::Approx(0.5F));
+        }
+    }
+
+    SUBCASE("capsule going through a box is pushed out through the nearest face")
+    {
+        auto events = collide(unit, CapsuleSegment{{-2.0F, 0.1F, 0.0F}, {2.0F, 0.1F, 0.0F}, 0.2F});
+        REQUIRE(events.size() == 1);
+        CHECK(near(events[0].normal, {0.0F, 1.0F, 0.0F}));
+        CHECK(events[0].depth == doctest::Approx(0.6F));
+    }
+}
+
+TEST_CASE("collisions.narrow_phase.box_voxels")
+{
+    // A floor of voxels, two voxels thick, with a single voxel sticking out of it.
+    VoxelGrid grid{glm::uvec3{8, 3, 8}};
+    grid.fill({0, 0, 0}, {8, 2, 8}, 1);
+    grid.set({6, 2, 6}, 1);
+    VoxelOccupancy occupancy{grid};
+
+    BoxVoxelScratch scratch{};
+    std::pmr::vector<CollisionEvent> events;
+    BroadPhaseCollisions::Candidate pair{Entity{0, 0}, Entity{1, 0}};
+
+    // A box resting slightly into the floor, away from the sticking out voxel, is pushed up, and the contacts with
+    // every voxel under it are merged into a single manifold.
+    auto identity = glm::mat4{1.0F};
+    collideBoxVoxels(pair, makeBox({2.0F, 2.4F, 2.0F}, {1.0F, 0.5F, 1.0F}), identity, occupancy, events, scratch);
+    REQUIRE(events.size() == 1);
+    CHECK(near(events[0].normal, {0.0F, -1.0F, 0.0F}));
+    CHECK(events[0].depth == doctest::Approx(0.1F));
+    CHECK(events[0].pointCount == CollisionEvent::MaxPoints);
+
+    // The scratch arrays are reused by the next call, and a box above the floor touches nothing.
+    collideBoxVoxels(pair, makeBox({2.0F, 3.6F, 2.0F}, {1.0F, 0.5F, 1.0F}), identity, occupancy, events, scratch);
+    CHECK(events.size() == 1);
+
+    // Only the sticking out voxel is touched here.
+    collideBoxVoxels(pair, makeBox({6.5F, 3.4F, 6.5F}, {0.25F, 0.5F, 0.25F}), identity, occupancy, events, scratch);
+    REQUIRE(events.size() == 2);
+    CHECK(near(events[1].normal, {0.0F, -1.0F, 0.0F}));
+    CHECK(events[1].depth == doctest::Approx(0.1F));
+}
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/engine/collisions/spatial_hash_broad_phase.hpp>
+
+using cubos::core::ecs::Entity;
+using cubos::core::geom::AABB;
+using cubos::engine::SpatialHashBroadPhase;
+
+/// Makes an AABB with the given corners.
+static AABB makeAABB(glm::vec3 min, glm::vec3 max)
+{
+    AABB aabb;
+    aabb.min(min);
+    aabb.max(max);
+    return aabb;
+}
+
+/// Finds the pairs in the grid, checking that each pair is reported only once.
+static std::set<std::pair<uint32_t, uint32_t>> gridPairs(SpatialHashBroadPhase& grid)
+{
+    std::vector<SpatialHashBroadPhase::Pair> pairs;
+    grid.findPairs(pairs);
+
+    std::set<std::pair<uint32_t, uint32_t>> unique;
+    for (auto [a, b] : pairs)
+    {
+        unique.emplace(std::min(a.index, b.index), std::max(a.index, b.index));
+    }
+    CHECK(unique.size() == pairs.size());
+    return unique;
+}
+
+/// Finds the overlapping pairs by testing every pair.
+static std::set<std::pair<uint32_t, uint32_t>> bruteForcePairs(const std::vector<AABB>& aabbs)
+{
+    std::set<std::pair<uint32_t, uint32_t>> pairs;
+    for (uint32_t i = 0; i < aabbs.size(); ++i)
+    {
+        for (uint32_t j = i + 1; j < aabbs.size(); ++j)
+        {
+            if (aabbs[i].overlaps(aabbs[j]))
+            {
+                pairs.emplace(i, j);
+            }
+        }
+    }
+    return pairs;
+}
+
+TEST_CASE("collisions.spatial_hash_broad_phase")
+{
+    SpatialHashBroadPhase grid{2.0F};
+    std::vector<AABB> aabbs;
+
+    SUBCASE("pairs match a brute force search on random AABBs")
+    {
+        std::mt19937 rng{42};
+        std::uniform_real_distribution<float> position{-20.0F, 20.0F};
+        std::uniform_real_distribution<float> edge{0.0F, 5.0F};
+        for (uint32_t i = 0; i < 300; ++i)
+        {
+            glm::vec3 min{position(rng), position(rng), position(rng)};
+            aabbs.push_back(makeAABB(min, min + glm::vec3{edge(rng), edge(rng), edge(rng)}));
+        }
+
+        // Some AABBs touch too many cells and must be kept out of the grid.
+        aabbs.push_back(makeAABB({-50.0F, -1.0F, -50.0F}, {50.0F, 0.0F, 50.0F}));
+        aabbs.push_back(makeAABB({-1.0F, -50.0F, -50.0F}, {0.0F, 50.0F, 50.0F}));
+
+        for (uint32_t i = 0; i < aabbs.size(); ++i)
+        {
+            grid.insert(Entity{i, 0}, aabbs[i]);
+        }
+
+        CHECK(grid.size() == aabbs.size());
+        CHECK(gridPairs(grid) == bruteForcePairs(aabbs));
+
+        // The grid can be reused after clearing it, even with a different cell size.
+        grid.cellSize(7.0F);
+        grid.clear();
+        CHECK(grid.size() == 0);
+        for (uint32_t i = 0; i < aabbs.size(); ++i)
+        {
+            grid.insert(Entity{i, 0}, aabbs[i]);
+        }
+        CHECK(gridPairs(grid) == bruteForcePairs(aabbs));
+    }
+
+    SUBCASE("queries match a brute force search")
+    {
+        std::mt19937 rng{7};
+        std::uniform_real_distribution<float> position{-20.0F, 20.0F};
+        std::uniform_real_distribution<float> edge{0.0F, 5.0F};
+        for (uint32_t i = 0; i < 200; ++i)
+        {
+            glm::vec3 min{position(rng), position(rng), position(rng)};
+            aabbs.push_back(makeAABB(min, min + glm::vec3{edge(rng), edge(rng), edge(rng)}));
+            grid.insert(Entity{i, 0}, aabbs.back());
+        }
+
+        aabbs.push_back(makeAABB({-50.0F, -1.0F, -50.0F}, {50.0F, 0.0F, 50.0F}));
+        grid.insert(Entity{200, 0}, aabbs.back());
+        gridPairs(grid);
+
+        // Small boxes, a box larger than the cell limit and an infinite one.
+        std::vector<AABB> queries{makeAABB({-40.0F, -40.0F, -40.0F}, {40.0F, 40.0F, 40.0F}),
+                                  makeAABB({-1e30F, -1.0F, -1.0F}, {1e30F, 1.0F, 1.0F})};
+        for (int i = 0; i < 50; ++i)
+        {
+            glm::vec3 min{position(rng), position(rng), position(rng)};
+            queries.push_back(makeAABB(min, min + glm::vec3{edge(rng), edge(rng), edge(rng)}));
+        }
+
+        for (const auto& query : queries)
+        {
+            std::vector<Entity> found;
+            grid.query(query, found);
+
+            std::set<uint32_t> unique;
+            for (auto entity : found)
+            {
+                unique.insert(entity.index);
+            }
+            CHECK(unique.size() == found.size());
+
+            std::set<uint32_t> expected;
+            for (uint32_t i = 0; i < aabbs.size(); ++i)
+            {
+                if (aabbs[i].overlaps(query))
+                {
+                    expected.insert(i);
+                }
+            }
+            CHECK(unique == expected);
+        }
+    }
+
+    SUBCASE("far away cells don't alias with cells near the origin")
+    {
+        // Exactly 2^21 cells apart, which would pack to the same cell if coordinates were wrapped.
+        float far = 2.0F * static_cast<float>(1 << 21);
+        aabbs.push_back(makeAABB({0.5F, 0.5F, 0.5F}, {1.5F, 1.5F, 1.5F}));
+        aabbs.push_back(makeAABB({far + 0.5F, 0.5F, 0.5F}, {far + 1.5F, 1.5F, 1.5F}));
+        aabbs.push_back(makeAABB({far + 1.0F, 1.0F, 1.0F}, {far + 3.0F, 3.0F, 3.0F}));
+        aabbs.push_back(makeAABB({-far + 1.0F, 1.0F, 1.0F}, {-far + 3.0F, 3.0F, 3.0F}));
+
+        // So far away that the cell coordinates wouldn't even fit in an integer.
+        aabbs.push_back(makeAABB({1e12F, 0.0F, 0.0F}, {1e12F, 1.0F, 1.0F}));
+        aabbs.push_back(makeAABB({1e12F, 0.5F, 0.5F}, {1e12F, 1.5F, 1.5F}));
+
+        for (uint32_t i = 0; i < aabbs.size(); ++i)
+        {
+            grid.insert(Entity{i, 0}, aabbs[i]);
+        }
+
+        auto pairs = gridPairs(grid);
+        CHECK(pairs == bruteForcePairs(aabbs));
+        CHECK(pairs.size() == 2);
+    }
+}
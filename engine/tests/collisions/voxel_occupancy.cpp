@@ -0,0 +1,179 @@
+#include <random>
+#include <set>
+#include <tuple>
+#include <utility>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/engine/collisions/voxel_occupancy.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+using cubos::engine::VoxelGrid;
+using cubos::engine::VoxelOccupancy;
+
+/// Makes a grid where each voxel is solid with the given probability.
+static VoxelGrid randomGrid(glm::uvec3 size, float density, unsigned int seed)
+{
+    std::mt19937 rng{seed};
+    std::bernoulli_distribution solid{density};
+    VoxelGrid grid{size};
+    for (int z = 0; z < static_cast<int>(size.z); ++z)
+    {
+        for (int y = 0; y < static_cast<int>(size.y); ++y)
+        {
+            for (int x = 0; x < static_cast<int>(size.x); ++x)
+            {
+                grid.set({x, y, z}, static_cast<uint16_t>(solid(rng) ? 1 : 0));
+            }
+        }
+    }
+    return grid;
+}
+
+/// Collects the voxels visited by forEach over a box.
+static std::set<std::tuple<int, int, int>> visited(const VoxelOccupancy& occupancy, glm::ivec3 min, glm::ivec3 max)
+{
+    std::set<std::tuple<int, int, int>> voxels;
+    occupancy.forEach(min, max, [&](glm::ivec3 voxel) {
+        // Each voxel must be visited only once.
+        CHECK(voxels.emplace(voxel.x, voxel.y, voxel.z).second);
+    });
+    return voxels;
+}
+
+/// Collects the solid voxels of a grid inside a box by checking every voxel.
+static std::set<std::tuple<int, int, int>> expected(const VoxelGrid& grid, glm::ivec3 min, glm::ivec3 max)
+{
+    std::set<std::tuple<int, int, int>> voxels;
+    for (int z = min.z; z <= max.z; ++z)
+    {
+        for (int y = min.y; y <= max.y; ++y)
+        {
+            for (int x = min.x; x <= max.x; ++x)
+            {
+                if (glm::all(glm::greaterThanEqual(glm::ivec3{x, y, z}, glm::ivec3{0})) &&
+                    glm::all(glm::lessThan(glm::ivec3{x, y, z}, glm::ivec3{grid.size()})) && grid.get({x, y, z}) != 0)
+                {
+                    voxels.emplace(x, y, z);
+                }
+            }
+        }
+    }
+    return voxels;
+}
+
+TEST_CASE("collisions.voxel_occupancy")
+{
+    SUBCASE("sizes which aren't a multiple of 64")
+    {
+        for (auto size : {glm::uvec3{1, 1, 1}, glm::uvec3{63, 2, 3}, glm::uvec3{65, 3, 2}, glm::uvec3{130, 2, 2}})
+        {
+            auto grid = randomGrid(size, 0.5F, size.x);
+            VoxelOccupancy occupancy{grid};
+            CHECK(occupancy.size() == size);
+
+            for (int z = -1; z <= static_cast<int>(size.z); ++z)
+            {
+                for (int y = -1; y <= static_cast<int>(size.y); ++y)
+                {
+                    for (int x = -1; x <= static_cast<int>(size.x); ++x)
+                    {
+                        bool inside = x >= 0 && y >= 0 && z >= 0 && x < static_cast<int>(size.x) &&
+                                      y < static_cast<int>(size.y) && z < static_cast<int>(size.z);
+                        CHECK(occupancy.get({x, y, z}) == (inside && grid.get({x, y, z}) != 0));
+                    }
+                }
+            }
+        }
+    }
+
+    SUBCASE("overlaps masks words at the ends of ranges")
+    {
+        VoxelGrid grid{glm::uvec3{130, 1, 1}};
+        grid.set({64, 0, 0}, 1);
+        grid.set({129, 0, 0}, 1);
+        VoxelOccupancy occupancy{grid};
+
+        CHECK_FALSE(occupancy.overlaps({0, 0, 0}, {63, 0, 0}));
+        CHECK_FALSE(occupancy.overlaps({65, 0, 0}, {128, 0, 0}));
+        CHECK(occupancy.overlaps({60, 0, 0}, {64, 0, 0}));
+        CHECK(occupancy.overlaps({64, 0, 0}, {64, 0, 0}));
+        CHECK(occupancy.overlaps({100, -5, -5}, {1000, 5, 5}));
+        CHECK_FALSE(occupancy.overlaps({130, 0, 0}, {200, 0, 0}));
+        CHECK_FALSE(occupancy.overlaps({64, 1, 0}, {64, 5, 0}));
+    }
+
+    SUBCASE("forEach visits every solid voxel in a box")
+    {
+        auto grid = randomGrid({70, 5, 4}, 0.3F, 7);
+        VoxelOccupancy occupancy{grid};
+
+        for (auto [min, max] : {std::pair{glm::ivec3{0, 0, 0}, glm::ivec3{69, 4, 3}},
+                                std::pair{glm::ivec3{3, 1, 1}, glm::ivec3{66, 3, 2}},
+                                std::pair{glm::ivec3{63, 0, 0}, glm::ivec3{64, 4, 3}},
+                                std::pair{glm::ivec3{10, 2, 2}, glm::ivec3{10, 2, 2}},
+                                std::pair{glm::ivec3{-10, -10, -10}, glm::ivec3{100, 100, 100}},
+                                std::pair{glm::ivec3{60, 3, 3}, glm::ivec3{200, 10, 10}},
+                                std::pair{glm::ivec3{70, 0, 0}, glm::ivec3{80, 4, 3}},
+                                std::pair{glm::ivec3{5, 3, 0}, glm::ivec3{4, 3, 0}}})
+        {
+            CHECK(visited(occupancy, min, max) == expected(grid, min, max));
+        }
+    }
+
+    SUBCASE("raycast")
+    {
+        VoxelGrid grid{glm::uvec3{10, 10, 10}};
+        grid.set({5, 2, 3}, 1);
+        grid.fill({8, 0, 0}, {9, 10, 10}, 1);
+        VoxelOccupancy occupancy{grid};
+
+        glm::ivec3 voxel;
+        float distance;
+        glm::vec3 normal;
+
+        // Along an axis, from outside the volume, and with a direction which isn't normalized.
+        REQUIRE(occupancy.raycast({-1.0F, 2.5F, 3.5F}, {1.0F, 0.0F, 0.0F}, 100.0F, voxel, distance, normal));
+        CHECK(voxel == glm::ivec3{5, 2, 3});
+        CHECK(distance == doctest::Approx(6.0F));
+        CHECK(normal == glm::vec3{-1.0F, 0.0F, 0.0F});
+
+        REQUIRE(occupancy.raycast({-1.0F, 2.5F, 3.5F}, {2.0F, 0.0F, 0.0F}, 100.0F, voxel, distance, normal));
+        CHECK(distance == doctest::Approx(3.0F));
+
+        REQUIRE(occupancy.raycast({5.5F, 20.0F, 3.5F}, {0.0F, -1.0F, 0.0F}, 100.0F, voxel, distance, normal));
+        CHECK(voxel == glm::ivec3{5, 2, 3});
+        CHECK(distance == doctest::Approx(17.0F));
+        CHECK(normal == glm::vec3{0.0F, 1.0F, 0.0F});
+
+        // Diagonally, hitting the wall at the end of the volume.
+        REQUIRE(occupancy.raycast({0.5F, 0.5F, 0.5F}, {1.0F, 0.5F, 0.25F}, 100.0F, voxel, distance, normal));
+        CHECK(voxel == glm::ivec3{8, 4, 2});
+        CHECK(distance == doctest::Approx(7.5F));
+        CHECK(normal == glm::vec3{-1.0F, 0.0F, 0.0F});
+
+        REQUIRE(occupancy.raycast({7.5F, 9.5F, 9.5F}, {0.5F, -1.0F, -1.0F}, 100.0F, voxel, distance, normal));
+        CHECK(voxel == glm::ivec3{8, 8, 8});
+        CHECK(distance == doctest::Approx(1.0F));
+        CHECK(normal == glm::vec3{-1.0F, 0.0F, 0.0F});
+
+        // Starting inside an empty voxel of the volume, and inside a solid voxel.
+        REQUIRE(occupancy.raycast({1.5F, 2.5F, 3.5F}, {1.0F, 0.0F, 0.0F}, 100.0F, voxel, distance, normal));
+        CHECK(voxel == glm::ivec3{5, 2, 3});
+        CHECK(distance == doctest::Approx(3.5F));
+        CHECK(normal == glm::vec3{-1.0F, 0.0F, 0.0F});
+
+        REQUIRE(occupancy.raycast({5.5F, 2.5F, 3.5F}, {0.0F, 1.0F, 0.0F}, 100.0F, voxel, distance, normal));
+        CHECK(voxel == glm::ivec3{5, 2, 3});
+        CHECK(distance == doctest::Approx(0.0F));
+        CHECK(normal == glm::vec3{0.0F});
+
+        // Misses: pointing away, passing beside the voxel, outside of the volume, and stopping short.
+        CHECK_FALSE(occupancy.raycast({4.5F, 2.5F, 3.5F}, {-1.0F, 0.0F, 0.0F}, 100.0F, voxel, distance, normal));
+        CHECK_FALSE(occupancy.raycast({5.5F, 0.0F, 4.5F}, {0.0F, 1.0F, 0.0F}, 100.0F, voxel, distance, normal));
+        CHECK_FALSE(occupancy.raycast({-1.0F, 11.0F, 3.5F}, {1.0F, 0.0F, 0.0F}, 100.0F, voxel, distance, normal));
+        CHECK_FALSE(occupancy.raycast({-1.0F, -1.0F, -1.0F}, {-1.0F, -1.0F, 0.0F}, 100.0F, voxel, distance, normal));
+        CHECK_FALSE(occupancy.raycast({-1.0F, 2.5F, 3.5F}, {1.0F, 0.0F, 0.0F}, 5.9F, voxel, distance, normal));
+    }
+}
@@ -0,0 +1,189 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+#include <doctest/doctest.h>
+
+#include <cubos/core/data/fs/file_system.hpp>
+#include <cubos/core/data/fs/standard_archive.hpp>
+
+#include <cubos/engine/renderer/mesh_cache.hpp>
+
+using cubos::core::data::File;
+using cubos::core::data::FileSystem;
+using cubos::core::data::StandardArchive;
+using cubos::engine::MeshCache;
+
+/// Path at which the cache directory is mounted.
+static constexpr const char* MountPath = "/mesh-cache";
+
+/// Makes a mesh whose contents depend on a seed.
+static MeshCache::Mesh makeMesh(uint32_t seed)
+{
+    MeshCache::Mesh mesh;
+    mesh.vertices = {{{seed, 1, 2}, {seed + 1, 3, 4}}, {}, {{seed + 2, 5, 6}}};
+    mesh.indices = {{0, 1, 0}, {}, {0, 0, 0}};
+    return mesh;
+}
+
+/// Checks whether two meshes are the same.
+static bool sameMesh(const MeshCache::Mesh& a, const MeshCache::Mesh& b)
+{
+    if (a.vertices.size() != b.vertices.size() || a.indices != b.indices)
+    {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < a.vertices.size(); ++i)
+    {
+        if (a.vertices[i].size() != b.vertices[i].size())
+        {
+            return false;
+        }
+
+        for (std::size_t j = 0; j < a.vertices[i].size(); ++j)
+        {
+            const auto& va = a.vertices[i][j];
+            const auto& vb = b.vertices[i][j];
+            if (va.position != vb.position || va.normal != vb.normal || va.material != vb.material)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/// Writes the header of an entry directly to a file on disk, as a different version of the cache would.
+static void writeHeader(const std::filesystem::path& path, uint64_t hash, uint32_t version)
+{
+    uint32_t magic = 0x4853454D;
+    uint32_t size[3] = {1, 1, 1};
+    uint32_t chunkCount = 0;
+    std::ofstream file{path, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    file.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+    file.write(reinterpret_cast<const char*>(size), sizeof(size));
+    file.write(reinterpret_cast<const char*>(&chunkCount), sizeof(chunkCount));
+}
+
+TEST_CASE("renderer.mesh_cache")
+{
+    // Start every subcase from an empty directory, as the archive doesn't notice changes made behind its back.
+    auto directory = std::filesystem::temp_directory_path() / "cubos-engine-tests-mesh-cache";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    glm::uvec3 size{40, 8, 8};
+    MeshCache::Mesh mesh;
+
+    SUBCASE("stored meshes are found, others are missed")
+    {
+        REQUIRE(FileSystem::mount(MountPath, std::make_unique<StandardArchive>(directory, true, false)));
+        {
+            MeshCache cache{MountPath, 4};
+            CHECK_FALSE(cache.load(1, size, mesh));
+            CHECK(cache.store(1, size, makeMesh(10)));
+            CHECK(cache.load(1, size, mesh));
+            CHECK(sameMesh(mesh, makeMesh(10)));
+            CHECK_FALSE(cache.load(2, size, mesh));
+
+            // Storing again replaces the entry.
+            CHECK(cache.store(1, size, makeMesh(20)));
+            CHECK(cache.load(1, size, mesh));
+            CHECK(sameMesh(mesh, makeMesh(20)));
+
+            auto stats = cache.stats();
+            CHECK(stats.hits == 2);
+            CHECK(stats.misses == 2);
+            CHECK(stats.stores == 2);
+            CHECK(stats.evictions == 0);
+        }
+
+        // Entries are kept for later runs.
+        {
+            MeshCache cache{MountPath, 4};
+            CHECK(cache.load(1, size, mesh));
+            CHECK(sameMesh(mesh, makeMesh(20)));
+        }
+        CHECK(FileSystem::unmount(MountPath));
+    }
+
+    SUBCASE("entries for a different size are missed")
+    {
+        REQUIRE(FileSystem::mount(MountPath, std::make_unique<StandardArchive>(directory, true, false)));
+        {
+            MeshCache cache{MountPath, 4};
+            CHECK(cache.store(1, size, makeMesh(10)));
+            CHECK_FALSE(cache.load(1, {8, 8, 40}, mesh));
+            CHECK(cache.stats().misses == 1);
+
+            // Storing the mesh for the new size overwrites the entry.
+            CHECK(cache.store(1, {8, 8, 40}, makeMesh(20)));
+            CHECK(cache.load(1, {8, 8, 40}, mesh));
+            CHECK_FALSE(cache.load(1, size, mesh));
+        }
+        CHECK(FileSystem::unmount(MountPath));
+    }
+
+    SUBCASE("entries of a different version are missed and removed")
+    {
+        writeHeader(directory / "0000000000000001.mesh", 1, MeshCache::Version + 1);
+        writeHeader(directory / "0000000000000002.mesh", 2, MeshCache::Version);
+        REQUIRE(FileSystem::mount(MountPath, std::make_unique<StandardArchive>(directory, true, false)));
+        {
+            MeshCache cache{MountPath, 4};
+            CHECK(FileSystem::find(std::string{MountPath} + "/0000000000000001.mesh") == nullptr);
+            CHECK_FALSE(cache.load(1, {1, 1, 1}, mesh));
+            CHECK(cache.load(2, {1, 1, 1}, mesh));
+            CHECK(mesh.vertices.empty());
+
+            // Overwrite an entry with one from another version while the cache is in use.
+            CHECK(cache.store(3, size, makeMesh(10)));
+            auto stream = FileSystem::open(std::string{MountPath} + "/0000000000000003.mesh", File::OpenMode::Write);
+            REQUIRE(stream != nullptr);
+            uint32_t header[2] = {0x4853454D, MeshCache::Version + 1};
+            stream->write(header, sizeof(header));
+            stream.reset();
+            CHECK_FALSE(cache.load(3, size, mesh));
+        }
+        CHECK(FileSystem::unmount(MountPath));
+        CHECK_FALSE(std::filesystem::exists(directory / "0000000000000001.mesh"));
+    }
+
+    SUBCASE("the oldest entries are evicted first")
+    {
+        REQUIRE(FileSystem::mount(MountPath, std::make_unique<StandardArchive>(directory, true, false)));
+        {
+            MeshCache cache{MountPath, 2};
+            CHECK(cache.store(1, size, makeMesh(1)));
+            CHECK(cache.store(2, size, makeMesh(2)));
+            CHECK(cache.store(3, size, makeMesh(3)));
+            CHECK(cache.stats().evictions == 1);
+            CHECK_FALSE(cache.load(1, size, mesh));
+            CHECK(cache.load(2, size, mesh));
+            CHECK(cache.load(3, size, mesh));
+
+            // Storing an entry again makes it the newest.
+            CHECK(cache.store(2, size, makeMesh(2)));
+            CHECK(cache.store(4, size, makeMesh(4)));
+            CHECK_FALSE(cache.load(3, size, mesh));
+            CHECK(cache.load(2, size, mesh));
+            CHECK(cache.load(4, size, mesh));
+            CHECK(cache.stats().evictions == 2);
+        }
+
+        // Entries over the limit are evicted when the cache is opened again.
+        {
+            MeshCache cache{MountPath, 1};
+            CHECK(cache.stats().evictions == 1);
+            CHECK(cache.load(2, size, mesh) != cache.load(4, size, mesh));
+        }
+        CHECK(FileSystem::unmount(MountPath));
+    }
+
+    std::filesystem::remove_all(directory);
+}
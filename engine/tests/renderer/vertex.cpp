@@ -0,0 +1,164 @@
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include <cubos/engine/renderer/vertex.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+using cubos::engine::binaryTriangulate;
+using cubos::engine::PackedVoxelVertex;
+using cubos::engine::triangulate;
+using cubos::engine::VoxelGrid;
+using cubos::engine::VoxelVertex;
+
+/// Checks that both triangulation functions produce exactly the same mesh.
+static void checkSameMesh(const VoxelGrid& grid)
+{
+    std::vector<VoxelVertex> expectedVertices;
+    std::vector<uint32_t> expectedIndices;
+    triangulate(grid, expectedVertices, expectedIndices);
+
+    std::vector<VoxelVertex> vertices;
+    std::vector<uint32_t> indices;
+    binaryTriangulate(grid, vertices, indices);
+
+    REQUIRE(vertices.size() == expectedVertices.size());
+    CHECK(indices == expectedIndices);
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+    {
+        CHECK(vertices[i].position == expectedVertices[i].position);
+        CHECK(vertices[i].normal == expectedVertices[i].normal);
+        CHECK(vertices[i].material == expectedVertices[i].material);
+    }
+}
+
+TEST_CASE("renderer::binaryTriangulate")
+{
+    SUBCASE("empty grid")
+    {
+        checkSameMesh(VoxelGrid{{5, 6, 7}});
+    }
+
+    SUBCASE("single voxel")
+    {
+        VoxelGrid grid{{1, 1, 1}};
+        grid.set({0, 0, 0}, 3);
+        checkSameMesh(grid);
+    }
+
+    SUBCASE("rows longer than a word")
+    {
+        // Layers of two materials, with sizes which don't fit a whole number of 64 bit words.
+        VoxelGrid grid{{70, 33, 129}};
+        for (int z = 0; z < 129; ++z)
+        {
+            for (int y = 0; y < 17; ++y)
+            {
+                for (int x = 0; x < 70; ++x)
+                {
+                    grid.set({x, y, z}, static_cast<uint16_t>(1 + (x / 10) % 2));
+                }
+            }
+        }
+        checkSameMesh(grid);
+    }
+
+    SUBCASE("random voxels")
+    {
+        std::mt19937 rng{42};
+        VoxelGrid grid{{65, 20, 40}};
+        for (int z = 0; z < 40; ++z)
+        {
+            for (int y = 0; y < 20; ++y)
+            {
+                for (int x = 0; x < 65; ++x)
+                {
+                    grid.set({x, y, z}, static_cast<uint16_t>(rng() % 4));
+                }
+            }
+        }
+        checkSameMesh(grid);
+    }
+}
+
+/// Gets the area covered by the faces of a mesh, for each normal and material.
+static std::map<std::tuple<float, float, float, uint16_t>, int> faceArea(const std::vector<VoxelVertex>& vertices)
+{
+    std::map<std::tuple<float, float, float, uint16_t>, int> area;
+    for (std::size_t i = 0; i < vertices.size(); i += 4)
+    {
+        auto size = glm::ivec3{vertices[i + 2].position} - glm::ivec3{vertices[i].position};
+        const auto& normal = vertices[i].normal;
+        auto key = std::make_tuple(normal.x, normal.y, normal.z, vertices[i].material);
+        area[key] += std::abs((size.x == 0 ? 1 : size.x) * (size.y == 0 ? 1 : size.y) * (size.z == 0 ? 1 : size.z));
+    }
+    return area;
+}
+
+TEST_CASE("renderer::binaryTriangulate regions")
+{
+    std::mt19937 rng{7};
+    VoxelGrid grid{{70, 40, 33}};
+    for (int z = 0; z < 33; ++z)
+    {
+        for (int y = 0; y < 40; ++y)
+        {
+            for (int x = 0; x < 70; ++x)
+            {
+                grid.set({x, y, z}, static_cast<uint16_t>(y < 20 ? 1 + (x / 10) % 2 : rng() % 3));
+            }
+        }
+    }
+
+    std::vector<VoxelVertex> expected;
+    std::vector<uint32_t> indices;
+    binaryTriangulate(grid, expected, indices);
+
+    // The meshes of the chunks of the grid must cover the same faces as the mesh of the whole grid.
+    std::vector<VoxelVertex> vertices;
+    indices.clear();
+    auto size = grid.size();
+    for (unsigned int z = 0; z < size.z; z += VoxelGrid::ChunkSize)
+    {
+        for (unsigned int y = 0; y < size.y; y += VoxelGrid::ChunkSize)
+        {
+            for (unsigned int x = 0; x < size.x; x += VoxelGrid::ChunkSize)
+            {
+                glm::uvec3 min{x, y, z};
+                binaryTriangulate(grid, min, glm::min(min + static_cast<unsigned int>(VoxelGrid::ChunkSize), size),
+                                  vertices, indices);
+            }
+        }
+    }
+
+    CHECK(faceArea(vertices) == faceArea(expected));
+    CHECK(indices.size() == vertices.size() / 4 * 6);
+}
+
+TEST_CASE("renderer::PackedVoxelVertex")
+{
+    CHECK(sizeof(PackedVoxelVertex) == 8);
+
+    VoxelGrid grid{{40, 3, 35}};
+    grid.set({0, 0, 0}, 1);
+    grid.set({39, 2, 34}, 65535);
+    grid.set({20, 1, 17}, 7);
+
+    std::vector<VoxelVertex> vertices;
+    std::vector<uint32_t> indices;
+    glm::uvec3 origin{32, 0, 32};
+    binaryTriangulate(grid, origin, grid.size(), vertices, indices);
+    REQUIRE_FALSE(vertices.empty());
+
+    for (const auto& vertex : vertices)
+    {
+        auto unpacked = PackedVoxelVertex::pack(vertex, origin).unpack(origin);
+        CHECK(unpacked.position == vertex.position);
+        CHECK(unpacked.normal == vertex.normal);
+        CHECK(unpacked.material == vertex.material);
+    }
+}
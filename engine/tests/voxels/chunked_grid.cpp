@@ -0,0 +1,185 @@
+#include <cstddef>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/core/data/old/package.hpp>
+
+#include <cubos/engine/voxels/chunked_grid.hpp>
+
+using cubos::core::data::old::Package;
+using cubos::engine::ChunkedVoxelGrid;
+using cubos::engine::VoxelGrid;
+
+/// Checks whether a chunked grid has the same size and voxels as a dense grid.
+static bool sameVoxels(const ChunkedVoxelGrid& chunked, const VoxelGrid& dense)
+{
+    if (chunked.size() != dense.size())
+    {
+        return false;
+    }
+
+    auto size = glm::ivec3{dense.size()};
+    for (int z = 0; z < size.z; ++z)
+    {
+        for (int y = 0; y < size.y; ++y)
+        {
+            for (int x = 0; x < size.x; ++x)
+            {
+                if (chunked.get({x, y, z}) != dense.get({x, y, z}))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+TEST_CASE("voxels.chunked_grid")
+{
+    ChunkedVoxelGrid grid{glm::uvec3{40, 20, 18}};
+    CHECK(grid.chunkCount() == glm::uvec3{3, 2, 2});
+    CHECK(grid.memory() == 0);
+
+    SUBCASE("get and set across chunk boundaries")
+    {
+        VoxelGrid dense{glm::uvec3{40, 20, 18}};
+        for (int i = 0; i < 3; ++i)
+        {
+            // Voxels on both sides of each boundary between chunks.
+            for (auto position : {glm::ivec3{15 + i, 15 + i, 15 + i}, glm::ivec3{31 + i, 0, 16}, glm::ivec3{39, 19, 16},
+                                  glm::ivec3{0, 16 + i, 15}})
+            {
+                auto mat = static_cast<uint16_t>(position.x + position.y + 1);
+                grid.set(position, mat);
+                dense.set(position, mat);
+            }
+        }
+
+        CHECK(sameVoxels(grid, dense));
+        CHECK(grid.get({15, 15, 15}) == 31);
+        CHECK(grid.get({16, 16, 16}) == 33);
+        CHECK(grid.get({16, 15, 15}) == 0);
+        CHECK(grid.chunk({0, 0, 0}) != nullptr);
+        CHECK(grid.chunk({1, 1, 1}) != nullptr);
+        CHECK(grid.chunk({1, 0, 0}) == nullptr);
+        CHECK(grid.toGrid().get({17, 17, 17}) == 35);
+
+        // Chunk grids are clipped at the edges of the grid.
+        auto last = grid.chunkGrid({2, 1, 1});
+        CHECK(last.size() == glm::uvec3{8, 4, 2});
+        CHECK(last.get({7, 3, 0}) == 59);
+
+        // Setting empty voxels in empty chunks doesn't allocate them.
+        grid.set({20, 2, 2}, 0);
+        CHECK(grid.chunk({1, 0, 0}) == nullptr);
+    }
+
+    SUBCASE("setSize keeps the voxels inside both sizes")
+    {
+        grid.set({5, 5, 5}, 1);
+        grid.set({20, 5, 5}, 2);
+        grid.set({35, 5, 5}, 3);
+        grid.set({10, 18, 16}, 4);
+
+        grid.setSize({21, 20, 17});
+        CHECK(grid.size() == glm::uvec3{21, 20, 17});
+        CHECK(grid.chunkCount() == glm::uvec3{2, 2, 2});
+        CHECK(grid.get({5, 5, 5}) == 1);
+        CHECK(grid.get({20, 5, 5}) == 2);
+        CHECK(grid.get({10, 18, 16}) == 4);
+
+        // Shrinking cuts through a chunk, and growing again must not bring back its old voxels.
+        grid.setSize({20, 18, 16});
+        CHECK(grid.chunk({1, 0, 0}) == nullptr);
+        CHECK(grid.chunk({0, 1, 1}) == nullptr);
+        grid.setSize({40, 20, 18});
+        CHECK(grid.get({5, 5, 5}) == 1);
+        CHECK(grid.get({20, 5, 5}) == 0);
+        CHECK(grid.get({35, 5, 5}) == 0);
+        CHECK(grid.get({10, 18, 16}) == 0);
+
+        // Invalid sizes are ignored.
+        grid.setSize({0, 4, 4});
+        CHECK(grid.size() == glm::uvec3{40, 20, 18});
+    }
+
+    SUBCASE("compact collapses uniform chunks and frees empty ones")
+    {
+        // Fill the first chunk with a single material, one voxel at a time.
+        for (int z = 0; z < ChunkedVoxelGrid::ChunkSize; ++z)
+        {
+            for (int y = 0; y < ChunkedVoxelGrid::ChunkSize; ++y)
+            {
+                for (int x = 0; x < ChunkedVoxelGrid::ChunkSize; ++x)
+                {
+                    grid.set({x, y, z}, 7);
+                }
+            }
+        }
+
+        // Set and then clear a voxel of another chunk.
+        grid.set({20, 0, 0}, 3);
+        grid.set({20, 0, 0}, 0);
+
+        REQUIRE(grid.chunk({0, 0, 0}) != nullptr);
+        REQUIRE(grid.chunk({1, 0, 0}) != nullptr);
+        CHECK(grid.chunk({0, 0, 0})->voxels.size() == ChunkedVoxelGrid::ChunkVolume);
+        auto before = grid.memory();
+
+        grid.compact();
+        REQUIRE(grid.chunk({0, 0, 0}) != nullptr);
+        CHECK(grid.chunk({0, 0, 0})->voxels.empty());
+        CHECK(grid.chunk({0, 0, 0})->uniform == 7);
+        CHECK(grid.chunk({1, 0, 0}) == nullptr);
+        CHECK(grid.memory() < before);
+        CHECK(grid.get({15, 15, 15}) == 7);
+        CHECK(grid.get({20, 0, 0}) == 0);
+
+        // Changing a voxel of a uniform chunk expands it again.
+        grid.set({1, 2, 3}, 8);
+        CHECK(grid.chunk({0, 0, 0})->voxels.size() == ChunkedVoxelGrid::ChunkVolume);
+        CHECK(grid.get({1, 2, 3}) == 8);
+        CHECK(grid.get({3, 2, 1}) == 7);
+    }
+
+    SUBCASE("converting from a dense grid and copying")
+    {
+        VoxelGrid dense{glm::uvec3{40, 20, 18}};
+        dense.set({0, 0, 0}, 1);
+        dense.set({39, 19, 16}, 2);
+        dense.set({16, 0, 0}, 3);
+
+        ChunkedVoxelGrid chunked{dense};
+        CHECK(sameVoxels(chunked, dense));
+        CHECK(chunked.chunk({0, 1, 0}) == nullptr);
+
+        ChunkedVoxelGrid copy{chunked};
+        chunked.set({0, 0, 0}, 4);
+        CHECK(copy.get({0, 0, 0}) == 1);
+        CHECK(sameVoxels(copy, dense));
+    }
+
+    SUBCASE("serialization round trip")
+    {
+        grid.set({0, 0, 0}, 1);
+        grid.set({39, 19, 16}, 2);
+        grid.set({17, 3, 4}, 3);
+        for (int x = 16; x < 32; ++x)
+        {
+            grid.set({x, 16, 0}, 4);
+        }
+
+        auto pkg = Package::from(grid);
+        ChunkedVoxelGrid result{};
+        REQUIRE(pkg.into(result));
+        CHECK(result.size() == grid.size());
+        CHECK(sameVoxels(result, grid.toGrid()));
+
+        // Only the chunks which aren't empty are stored.
+        std::size_t chunks = 0;
+        result.forEachChunk([&](glm::uvec3, const ChunkedVoxelGrid::Chunk&) { ++chunks; });
+        CHECK(chunks == 4);
+    }
+}
@@ -0,0 +1,242 @@
+#include <cstddef>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/core/data/old/binary_deserializer.hpp>
+#include <cubos/core/data/old/binary_serializer.hpp>
+#include <cubos/core/data/old/package.hpp>
+#include <cubos/core/memory/buffer_stream.hpp>
+
+#include <cubos/engine/voxels/compressed_grid.hpp>
+
+using cubos::core::data::old::BinaryDeserializer;
+using cubos::core::data::old::BinarySerializer;
+using cubos::core::data::old::Package;
+using cubos::core::memory::BufferStream;
+using cubos::core::memory::SeekOrigin;
+using cubos::engine::CompressedVoxelGrid;
+using cubos::engine::VoxelGrid;
+
+/// Makes a grid whose voxels are set by a function of their coordinates.
+template <typename F>
+static VoxelGrid makeGrid(glm::uvec3 size, F material)
+{
+    VoxelGrid grid{size};
+    for (int z = 0; z < static_cast<int>(size.z); ++z)
+    {
+        for (int y = 0; y < static_cast<int>(size.y); ++y)
+        {
+            for (int x = 0; x < static_cast<int>(size.x); ++x)
+            {
+                grid.set({x, y, z}, material(glm::ivec3{x, y, z}));
+            }
+        }
+    }
+    return grid;
+}
+
+/// Makes a single chunk grid which uses the given number of materials, where no two neighbours match.
+static VoxelGrid scatteredGrid(int materials)
+{
+    auto size = static_cast<unsigned int>(CompressedVoxelGrid::ChunkSize);
+    return makeGrid({size, size, size}, [&](glm::ivec3 p) {
+        auto index = p.x + p.y * 16 + p.z * 256;
+        return static_cast<uint16_t>((index * 7919) % materials + 100);
+    });
+}
+
+/// Checks whether two grids have the same size and voxels.
+static bool sameVoxels(const VoxelGrid& a, const VoxelGrid& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+
+    auto size = glm::ivec3{a.size()};
+    for (int z = 0; z < size.z; ++z)
+    {
+        for (int y = 0; y < size.y; ++y)
+        {
+            for (int x = 0; x < size.x; ++x)
+            {
+                if (a.get({x, y, z}) != b.get({x, y, z}))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/// Checks whether a compressed grid has the same voxels as a grid, both decoding it and reading
+/// voxels one by one.
+static bool sameVoxels(const CompressedVoxelGrid& compressed, const VoxelGrid& grid)
+{
+    if (!sameVoxels(compressed.decode(), grid))
+    {
+        return false;
+    }
+
+    auto size = glm::ivec3{grid.size()};
+    for (int z = 0; z < size.z; ++z)
+    {
+        for (int y = 0; y < size.y; ++y)
+        {
+            for (int x = 0; x < size.x; ++x)
+            {
+                if (compressed.get({x, y, z}) != grid.get({x, y, z}))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+TEST_CASE("voxels.compressed_grid")
+{
+    SUBCASE("every bit width round trips")
+    {
+        for (auto [materials, bits] : {std::pair{1, 0}, std::pair{2, 1}, std::pair{3, 2}, std::pair{4, 2},
+                                       std::pair{5, 4}, std::pair{16, 4}, std::pair{17, 8}, std::pair{256, 8},
+                                       std::pair{257, 16}, std::pair{1000, 16}})
+        {
+            auto grid = scatteredGrid(materials);
+            CompressedVoxelGrid compressed{grid};
+            REQUIRE(compressed.chunkCount() == glm::uvec3{1, 1, 1});
+
+            const auto& chunk = compressed.chunk({0, 0, 0});
+            CHECK(chunk.valid());
+            CHECK(chunk.palette.size() == static_cast<std::size_t>(materials));
+            CHECK(chunk.bits == bits);
+            CHECK(chunk.runs.empty());
+            CHECK(sameVoxels(compressed, grid));
+        }
+    }
+
+    SUBCASE("chunks with long runs are run-length encoded")
+    {
+        // A single run of one material spanning the whole chunk needs no words at all.
+        auto uniform = makeGrid({16, 16, 16}, [](glm::ivec3) { return uint16_t{9}; });
+        CompressedVoxelGrid compressed{uniform};
+        CHECK(compressed.chunk({0, 0, 0}).bits == 0);
+        CHECK(compressed.chunk({0, 0, 0}).words.empty());
+        CHECK(sameVoxels(compressed, uniform));
+
+        // Two runs, each covering half of the chunk.
+        auto halves = makeGrid({16, 16, 16}, [](glm::ivec3 p) { return static_cast<uint16_t>(p.z < 8 ? 1 : 2); });
+        compressed = CompressedVoxelGrid{halves};
+        CHECK(compressed.chunk({0, 0, 0}).valid());
+        CHECK(compressed.chunk({0, 0, 0}).runs == std::vector<uint16_t>{2048, 4096});
+        CHECK(sameVoxels(compressed, halves));
+
+        // One layer of each material, over several chunks, the last of which is clipped.
+        auto layers = makeGrid({16, 16, 40}, [](glm::ivec3 p) { return static_cast<uint16_t>(p.z * 3); });
+        compressed = CompressedVoxelGrid{layers};
+        for (unsigned int z = 0; z < 3; ++z)
+        {
+            const auto& chunk = compressed.chunk({0, 0, z});
+            CHECK(chunk.valid());
+            CHECK_FALSE(chunk.runs.empty());
+            CHECK(chunk.runs.back() == CompressedVoxelGrid::ChunkVolume);
+        }
+        CHECK(compressed.chunk({0, 0, 1}).palette.size() == 16);
+        CHECK(sameVoxels(compressed, layers));
+    }
+
+    SUBCASE("grids which aren't a multiple of the chunk size")
+    {
+        std::mt19937 rng{42};
+        std::uniform_int_distribution<int> material{0, 40};
+        auto grid = makeGrid({20, 17, 3}, [&](glm::ivec3) { return static_cast<uint16_t>(material(rng)); });
+        CompressedVoxelGrid compressed{grid};
+        CHECK(compressed.chunkCount() == glm::uvec3{2, 2, 1});
+        CHECK(sameVoxels(compressed, grid));
+
+        auto last = compressed.decodeChunk({1, 1, 0});
+        CHECK(last.size() == glm::uvec3{4, 1, 3});
+        CHECK(last.get({3, 0, 2}) == grid.get({19, 16, 2}));
+    }
+
+    SUBCASE("valid rejects corrupt chunks")
+    {
+        CompressedVoxelGrid packed{scatteredGrid(5)};
+        CompressedVoxelGrid runs{makeGrid({16, 16, 16}, [](glm::ivec3 p) { return static_cast<uint16_t>(p.z); })};
+        REQUIRE(packed.chunk({0, 0, 0}).valid());
+        REQUIRE(runs.chunk({0, 0, 0}).valid());
+
+        auto chunk = packed.chunk({0, 0, 0});
+        chunk.palette.clear();
+        CHECK_FALSE(chunk.valid());
+
+        chunk = packed.chunk({0, 0, 0});
+        chunk.bits = 3;
+        CHECK_FALSE(chunk.valid());
+
+        chunk = packed.chunk({0, 0, 0});
+        chunk.palette.resize(17);
+        CHECK_FALSE(chunk.valid());
+
+        chunk = packed.chunk({0, 0, 0});
+        chunk.words.pop_back();
+        CHECK_FALSE(chunk.valid());
+
+        // The palette only has 5 entries, so index 15 is out of bounds.
+        chunk = packed.chunk({0, 0, 0});
+        chunk.words[3] |= 0xF;
+        CHECK_FALSE(chunk.valid());
+
+        chunk = runs.chunk({0, 0, 0});
+        chunk.runs.back() = 4000;
+        CHECK_FALSE(chunk.valid());
+
+        chunk = runs.chunk({0, 0, 0});
+        std::swap(chunk.runs[3], chunk.runs[4]);
+        CHECK_FALSE(chunk.valid());
+
+        chunk = runs.chunk({0, 0, 0});
+        chunk.runs[0] = 0;
+        CHECK_FALSE(chunk.valid());
+
+        chunk = CompressedVoxelGrid{scatteredGrid(1)}.chunk({0, 0, 0});
+        REQUIRE(chunk.valid());
+        chunk.words.push_back(0);
+        CHECK_FALSE(chunk.valid());
+    }
+
+    SUBCASE("binary serialization round trip")
+    {
+        auto grid = makeGrid({33, 18, 5}, [](glm::ivec3 p) { return static_cast<uint16_t>(p.x < 10 ? 0 : p.x * p.y); });
+        CompressedVoxelGrid compressed{grid};
+
+        BufferStream stream{};
+        BinarySerializer serializer{stream};
+        serializer.write(compressed, nullptr);
+        REQUIRE_FALSE(serializer.failed());
+
+        stream.seek(0, SeekOrigin::Begin);
+        BinaryDeserializer deserializer{stream};
+        CompressedVoxelGrid result{};
+        deserializer.read(result);
+        REQUIRE_FALSE(deserializer.failed());
+        CHECK(result.size() == compressed.size());
+        CHECK(sameVoxels(result, grid));
+    }
+
+    SUBCASE("deserializing corrupt chunks fails")
+    {
+        auto pkg = Package::from(CompressedVoxelGrid{scatteredGrid(5)});
+        pkg.field("chunks").element(0).field("bits").set(uint8_t{3});
+
+        CompressedVoxelGrid result{};
+        CHECK_FALSE(pkg.into(result));
+        CHECK(result.size() == glm::uvec3{1, 1, 1});
+    }
+}
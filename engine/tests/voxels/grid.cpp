@@ -0,0 +1,425 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/engine/voxels/grid.hpp>
+
+using cubos::engine::VoxelGrid;
+
+/// Makes a grid with random materials, where about half of the voxels are empty.
+static VoxelGrid randomGrid(glm::uvec3 size, unsigned int seed)
+{
+    std::mt19937 rng{seed};
+    std::uniform_int_distribution<int> material{-3, 3};
+    VoxelGrid grid{size};
+    for (int z = 0; z < static_cast<int>(size.z); ++z)
+    {
+        for (int y = 0; y < static_cast<int>(size.y); ++y)
+        {
+            for (int x = 0; x < static_cast<int>(size.x); ++x)
+            {
+                grid.set({x, y, z}, static_cast<uint16_t>(std::max(material(rng), 0)));
+            }
+        }
+    }
+    return grid;
+}
+
+/// Makes a copy of a grid, which can only be copied by assignment.
+static VoxelGrid copyOf(const VoxelGrid& grid)
+{
+    VoxelGrid copy;
+    copy = grid;
+    return copy;
+}
+
+/// Checks whether a position is inside a grid.
+static bool inside(const VoxelGrid& grid, glm::ivec3 position)
+{
+    return glm::all(glm::greaterThanEqual(position, glm::ivec3{0})) &&
+           glm::all(glm::lessThan(position, glm::ivec3{grid.size()}));
+}
+
+/// Checks whether two grids have the same size and voxels.
+static bool sameVoxels(const VoxelGrid& a, const VoxelGrid& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+
+    auto size = glm::ivec3{a.size()};
+    for (int z = 0; z < size.z; ++z)
+    {
+        for (int y = 0; y < size.y; ++y)
+        {
+            for (int x = 0; x < size.x; ++x)
+            {
+                if (a.get({x, y, z}) != b.get({x, y, z}))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/// Calls a function for every position in a box.
+template <typename F>
+static void forEachIn(glm::ivec3 min, glm::ivec3 max, F function)
+{
+    for (int z = min.z; z < max.z; ++z)
+    {
+        for (int y = min.y; y < max.y; ++y)
+        {
+            for (int x = min.x; x < max.x; ++x)
+            {
+                function(glm::ivec3{x, y, z});
+            }
+        }
+    }
+}
+
+/// Copies a box of a grid into another one voxel at a time, reading from a copy of the source.
+static void referenceCopy(VoxelGrid& dst, const VoxelGrid& src, glm::ivec3 srcMin, glm::ivec3 srcMax,
+                          glm::ivec3 position)
+{
+    auto copy = copyOf(src);
+    forEachIn(srcMin, srcMax, [&](glm::ivec3 p) {
+        auto target = p - srcMin + position;
+        if (inside(copy, p) && inside(dst, target))
+        {
+            dst.set(target, copy.get(p));
+        }
+    });
+}
+
+/// Offsets which place a grid of the given size inside, across each edge and outside of a grid.
+static std::vector<glm::ivec3> offsets(glm::ivec3 size)
+{
+    std::vector<glm::ivec3> result;
+    for (int z : {-size.z, -1, 0, 2, 9})
+    {
+        for (int y : {-size.y - 1, -2, 0, 1, 7})
+        {
+            for (int x : {-size.x, -3, 0, 3, 8})
+            {
+                result.emplace_back(x, y, z);
+            }
+        }
+    }
+    return result;
+}
+
+TEST_CASE("voxels.grid")
+{
+    SUBCASE("generations track the chunks which changed")
+    {
+        VoxelGrid grid{glm::uvec3{70, 40, 1}};
+        CHECK(grid.chunkCount() == glm::uvec3{3, 2, 1});
+
+        auto built = grid.generation();
+        for (unsigned int y = 0; y < 2; ++y)
+        {
+            for (unsigned int x = 0; x < 3; ++x)
+            {
+                CHECK(grid.chunkGeneration({x, y, 0}) <= built);
+            }
+        }
+
+        // Setting voxels only stamps their chunks, each time with a greater generation.
+        grid.set({33, 5, 0}, 1);
+        auto first = grid.chunkGeneration({1, 0, 0});
+        CHECK(first > built);
+        grid.set({40, 6, 0}, 2);
+        CHECK(grid.chunkGeneration({1, 0, 0}) > first);
+        CHECK(grid.generation() == grid.chunkGeneration({1, 0, 0}));
+        CHECK(grid.chunkGeneration({0, 0, 0}) <= built);
+        CHECK(grid.chunkGeneration({1, 1, 0}) <= built);
+
+        // Filling a box stamps every chunk it overlaps.
+        auto filled = grid.generation();
+        grid.fill({60, 30, 0}, {70, 40, 1}, 3);
+        CHECK(grid.chunkGeneration({1, 0, 0}) > filled);
+        CHECK(grid.chunkGeneration({2, 0, 0}) > filled);
+        CHECK(grid.chunkGeneration({1, 1, 0}) > filled);
+        CHECK(grid.chunkGeneration({2, 1, 0}) > filled);
+        CHECK(grid.chunkGeneration({0, 1, 0}) <= filled);
+
+        // Changing the whole grid stamps every chunk with a generation greater than any other
+        // grid had before.
+        VoxelGrid other{glm::uvec3{8, 8, 8}};
+        other.set({1, 1, 1}, 1);
+        auto latest = std::max(grid.generation(), other.generation());
+        grid.setSize({100, 10, 10});
+        CHECK(grid.chunkCount() == glm::uvec3{4, 1, 1});
+        CHECK(grid.chunkGeneration({3, 0, 0}) > latest);
+        CHECK(grid.chunkGeneration({0, 0, 0}) > latest);
+
+        latest = grid.generation();
+        grid = other;
+        CHECK(grid.chunkCount() == glm::uvec3{1, 1, 1});
+        CHECK(grid.chunkGeneration({0, 0, 0}) > latest);
+        CHECK(grid.generation() > other.generation());
+    }
+
+    SUBCASE("equal grids hash the same, and any voxel change changes the hash")
+    {
+        // 105 voxels, so that the last voxels aren't hashed in a group of four.
+        glm::uvec3 size{3, 5, 7};
+        std::vector<uint16_t> indices(105);
+        for (std::size_t i = 0; i < indices.size(); ++i)
+        {
+            indices[i] = static_cast<uint16_t>(i % 4);
+        }
+
+        VoxelGrid grid{size, indices};
+        VoxelGrid same{size};
+        for (int z = 0; z < 7; ++z)
+        {
+            for (int y = 0; y < 5; ++y)
+            {
+                for (int x = 0; x < 3; ++x)
+                {
+                    same.set({x, y, z}, grid.get({x, y, z}));
+                }
+            }
+        }
+        CHECK(same.hash() == grid.hash());
+
+        // Every single voxel change gives a different hash, which goes back when it's undone.
+        std::set<uint64_t> hashes{grid.hash()};
+        for (int z = 0; z < 7; ++z)
+        {
+            for (int y = 0; y < 5; ++y)
+            {
+                for (int x = 0; x < 3; ++x)
+                {
+                    auto mat = same.get({x, y, z});
+                    same.set({x, y, z}, static_cast<uint16_t>(mat + 1));
+                    CHECK(hashes.insert(same.hash()).second);
+                    same.set({x, y, z}, mat);
+                    CHECK(same.hash() == grid.hash());
+                }
+            }
+        }
+
+        // The same voxels with a different shape hash differently.
+        VoxelGrid reshaped{glm::uvec3{7, 5, 3}, indices};
+        CHECK(reshaped.hash() != grid.hash());
+    }
+
+    SUBCASE("remap replaces materials, keeping those past the table")
+    {
+        auto grid = randomGrid({5, 4, 3}, 1);
+        auto expected = copyOf(grid);
+        std::vector<uint16_t> lut{0, 3, 1};
+        forEachIn({0, 0, 0}, {5, 4, 3}, [&](glm::ivec3 p) {
+            auto mat = expected.get(p);
+            expected.set(p, mat < lut.size() ? lut[mat] : mat);
+        });
+
+        grid.remap(lut);
+        CHECK(sameVoxels(grid, expected));
+    }
+
+    SUBCASE("fill is clipped at the edges of the grid")
+    {
+        for (auto [min, max] : {std::pair{glm::ivec3{1, 1, 1}, glm::ivec3{3, 4, 2}},
+                                std::pair{glm::ivec3{-4, -1, -9}, glm::ivec3{2, 10, 1}},
+                                std::pair{glm::ivec3{6, 5, 4}, glm::ivec3{100, 100, 100}},
+                                std::pair{glm::ivec3{7, 0, 0}, glm::ivec3{9, 6, 5}},
+                                std::pair{glm::ivec3{3, 3, 3}, glm::ivec3{3, 5, 5}},
+                                std::pair{glm::ivec3{4, 2, 2}, glm::ivec3{2, 4, 4}}})
+        {
+            auto grid = randomGrid({7, 6, 5}, 2);
+            auto expected = copyOf(grid);
+            forEachIn(glm::max(min, glm::ivec3{0}), glm::min(max, glm::ivec3{7, 6, 5}),
+                      [&](glm::ivec3 p) { expected.set(p, 9); });
+
+            grid.fill(min, max, 9);
+            CHECK(sameVoxels(grid, expected));
+        }
+    }
+
+    SUBCASE("fillSphere sets the voxels whose centers are inside the sphere")
+    {
+        for (auto [center, radius] : {std::pair{glm::vec3{4.5F, 4.5F, 4.5F}, 3.0F},
+                                      std::pair{glm::vec3{3.2F, 4.9F, 2.0F}, 2.7F},
+                                      std::pair{glm::vec3{0.0F, 0.0F, 0.0F}, 4.5F},
+                                      std::pair{glm::vec3{8.7F, -1.0F, 5.3F}, 3.1F},
+                                      std::pair{glm::vec3{2.5F, 2.5F, 2.5F}, 0.0F},
+                                      std::pair{glm::vec3{-5.0F, 4.0F, 4.0F}, 2.0F},
+                                      std::pair{glm::vec3{4.0F, 4.0F, 4.0F}, 50.0F}})
+        {
+            auto grid = randomGrid({9, 8, 7}, 3);
+            auto expected = copyOf(grid);
+            forEachIn({0, 0, 0}, {9, 8, 7}, [&](glm::ivec3 p) {
+                // Summed in the same order as by fillSphere, so that rounding doesn't differ.
+                auto d = glm::vec3{p} + 0.5F - center;
+                if (d.x * d.x + (d.y * d.y + d.z * d.z) <= radius * radius)
+                {
+                    expected.set(p, 9);
+                }
+            });
+
+            grid.fillSphere(center, radius, 9);
+            CHECK(sameVoxels(grid, expected));
+        }
+    }
+
+    SUBCASE("copyRegion and blit are clipped to both grids")
+    {
+        auto src = randomGrid({5, 4, 3}, 4);
+        for (auto position : offsets({5, 4, 3}))
+        {
+            auto grid = randomGrid({7, 6, 5}, 5);
+            auto expected = copyOf(grid);
+            referenceCopy(expected, src, {0, 0, 0}, {5, 4, 3}, position);
+            grid.blit(src, position);
+            CHECK(sameVoxels(grid, expected));
+
+            // Boxes which stick out of the source grid.
+            grid = randomGrid({7, 6, 5}, 5);
+            expected = copyOf(grid);
+            referenceCopy(expected, src, {-2, 1, -1}, {4, 9, 2}, position);
+            grid.copyRegion(src, {-2, 1, -1}, {4, 9, 2}, position);
+            CHECK(sameVoxels(grid, expected));
+        }
+    }
+
+    SUBCASE("copyRegion handles overlapping source and destination regions")
+    {
+        for (auto position : offsets({4, 3, 3}))
+        {
+            auto grid = randomGrid({7, 6, 5}, 6);
+            auto expected = copyOf(grid);
+            referenceCopy(expected, grid, {1, 1, 1}, {5, 4, 4}, position);
+            grid.copyRegion(grid, {1, 1, 1}, {5, 4, 4}, position);
+            CHECK(sameVoxels(grid, expected));
+        }
+
+        auto grid = randomGrid({7, 6, 5}, 7);
+        auto expected = copyOf(grid);
+        referenceCopy(expected, grid, {0, 0, 0}, {7, 6, 5}, {1, 0, 0});
+        grid.blit(grid, {1, 0, 0});
+        CHECK(sameVoxels(grid, expected));
+    }
+
+    SUBCASE("unite and subtract only change the voxels below solid ones")
+    {
+        auto other = randomGrid({5, 4, 3}, 8);
+        for (auto position : offsets({5, 4, 3}))
+        {
+            auto united = randomGrid({7, 6, 5}, 9);
+            auto subtracted = copyOf(united);
+            auto expectedUnited = copyOf(united);
+            auto expectedSubtracted = copyOf(united);
+            forEachIn({0, 0, 0}, {5, 4, 3}, [&](glm::ivec3 p) {
+                auto target = p + position;
+                if (inside(united, target) && other.get(p) != 0)
+                {
+                    expectedUnited.set(target, other.get(p));
+                    expectedSubtracted.set(target, 0);
+                }
+            });
+
+            united.unite(other, position);
+            subtracted.subtract(other, position);
+            CHECK(sameVoxels(united, expectedUnited));
+            CHECK(sameVoxels(subtracted, expectedSubtracted));
+        }
+
+        // With itself, shifted so that it overlaps itself.
+        auto grid = randomGrid({7, 6, 5}, 10);
+        auto expected = copyOf(grid);
+        auto copy = copyOf(grid);
+        expected.unite(copy, {2, -1, 1});
+        grid.unite(grid, {2, -1, 1});
+        CHECK(sameVoxels(grid, expected));
+
+        grid = randomGrid({7, 6, 5}, 10);
+        expected = copyOf(grid);
+        expected.subtract(copy, {-1, 1, 0});
+        grid.subtract(grid, {-1, 1, 0});
+        CHECK(sameVoxels(grid, expected));
+    }
+
+    SUBCASE("downsample rounds odd sizes up and keeps the most common material")
+    {
+        for (auto [size, factor] : {std::pair{glm::uvec3{7, 5, 3}, 2U}, std::pair{glm::uvec3{9, 9, 10}, 4U},
+                                    std::pair{glm::uvec3{5, 1, 2}, 3U}, std::pair{glm::uvec3{4, 4, 4}, 1U},
+                                    std::pair{glm::uvec3{3, 2, 1}, 8U}})
+        {
+            auto grid = randomGrid(size, factor);
+            auto result = grid.downsample(factor);
+            REQUIRE(result.size() == (size + factor - 1U) / factor);
+
+            auto f = static_cast<int>(factor);
+            forEachIn({0, 0, 0}, glm::ivec3{result.size()}, [&](glm::ivec3 p) {
+                // Count the materials of the block, which may be cut short by the edges.
+                std::map<uint16_t, int> counts;
+                int volume = 0;
+                forEachIn(p * f, glm::min(p * f + f, glm::ivec3{size}), [&](glm::ivec3 q) {
+                    volume += 1;
+                    if (grid.get(q) != 0)
+                    {
+                        counts[grid.get(q)] += 1;
+                    }
+                });
+
+                int solid = 0;
+                uint16_t best = 0;
+                int bestCount = 0;
+                for (auto [mat, count] : counts)
+                {
+                    solid += count;
+                    if (count > bestCount)
+                    {
+                        best = mat;
+                        bestCount = count;
+                    }
+                }
+
+                CHECK(result.get(p) == (solid * 2 >= volume ? best : 0));
+            });
+        }
+
+        // A single voxel in a 1x1x1 block at the edge still counts as a whole block.
+        VoxelGrid grid{glm::uvec3{3, 1, 1}};
+        grid.set({2, 0, 0}, 5);
+        auto result = grid.downsample(2);
+        CHECK(result.size() == glm::uvec3{2, 1, 1});
+        CHECK(result.get({0, 0, 0}) == 0);
+        CHECK(result.get({1, 0, 0}) == 5);
+    }
+
+    SUBCASE("downsampling a box updates only that box of a downsampled grid")
+    {
+        auto grid = randomGrid({300, 40, 40}, 3);
+        auto level = grid.downsample(4);
+        REQUIRE(level.chunkCount() == glm::uvec3{3, 1, 1});
+        auto built = level.generation();
+
+        // Change a chunk of the grid, which is inside the second chunk of the downsampled grid.
+        grid.fill({128, 0, 0}, {160, 32, 32}, 7);
+        grid.downsample(4, {32, 0, 0}, {40, 8, 8}, level);
+        CHECK(sameVoxels(level, grid.downsample(4)));
+        CHECK(level.chunkGeneration({0, 0, 0}) <= built);
+        CHECK(level.chunkGeneration({1, 0, 0}) > built);
+        CHECK(level.chunkGeneration({2, 0, 0}) <= built);
+
+        // Boxes are clipped to the downsampled grid.
+        grid.fill({280, 0, 0}, {300, 40, 40}, 0);
+        grid.downsample(4, {64, 0, 0}, {100, 100, 100}, level);
+        CHECK(sameVoxels(level, grid.downsample(4)));
+    }
+}
@@ -795,6 +795,7 @@ static bool generate(const GenerateOptions& options)
     file << "#include <cubos/core/ecs/component/vec_storage.hpp>" << std::endl;
     file << "#include <cubos/core/ecs/component/map_storage.hpp>" << std::endl;
     file << "#include <cubos/core/ecs/component/null_storage.hpp>" << std::endl;
+    file << "#include <cubos/core/ecs/component/shared_storage.hpp>" << std::endl;
     file << std::endl;
 
     // Include all the component headers.
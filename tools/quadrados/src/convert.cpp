@@ -9,6 +9,7 @@
 #include <cubos/core/memory/endianness.hpp>
 #include <cubos/core/memory/standard_stream.hpp>
 
+#include <cubos/engine/voxels/compressed_grid.hpp>
 #include <cubos/engine/voxels/grid.hpp>
 #include <cubos/engine/voxels/palette.hpp>
 
@@ -29,6 +30,7 @@ struct ConvertOptions
     bool write = false;                              ///< Whether to write to the palette.
     bool verbose = false;                            ///< Enables verbose mode.
     bool force = false;                              ///< Enables force mode.
+    bool compress = false;                           ///< Writes grids in the compressed format.
     bool help = false;                               ///< Prints the help message.
     float similarity = 1.0F;                         ///< The similarity threshold.
 };
@@ -51,6 +53,7 @@ static void printHelp()
     std::cerr << "  -w           Allows the palette to be written to." << std::endl;
     std::cerr << "  -v           Enables verbose mode." << std::endl;
     std::cerr << "  -f           Disables asking for confirmation when overwriting files." << std::endl;
+    std::cerr << "  -c           Writes the grids compressed, to be loaded from .pgrd files." << std::endl;
     std::cerr << "  -h           Prints this help message." << std::endl;
     std::cerr << "  -s <VAL>     Specifies the minimum similarity for two materials to be merged," << std::endl;
     std::cerr << "               from 0.0 to 1.0 (default 1.0)" << std::endl;
@@ -136,6 +139,10 @@ static bool parseArguments(int argc, char** argv, ConvertOptions& options)
         {
             options.force = true;
         }
+        else if (std::string(argv[i]) == "-c")
+        {
+            options.compress = true;
+        }
         else if (std::string(argv[i]) == "-h")
         {
             options.help = true;
@@ -381,7 +388,9 @@ static bool savePalette(const fs::path& path, const VoxelPalette& palette)
 /// Saves the given grid to the given path.
 /// @param path The path of the grid.
 /// @param grid The grid to export.
-static bool saveGrid(const fs::path& path, const VoxelGrid& grid)
+/// @param compress Whether to save the grid compressed.
+/// @param verbose Whether to print the size of the compressed grid.
+static bool saveGrid(const fs::path& path, const VoxelGrid& grid, bool compress, bool verbose)
 {
     auto* file = fopen(path.string().c_str(), "wb");
     if (file == nullptr)
@@ -391,7 +400,23 @@ static bool saveGrid(const fs::path& path, const VoxelGrid& grid)
 
     auto stream = memory::StandardStream(file, true);
     auto serializer = data::old::BinarySerializer(stream);
-    serializer.write(grid, nullptr);
+    if (compress)
+    {
+        CompressedVoxelGrid compressed{grid};
+        if (verbose)
+        {
+            auto volume = static_cast<std::size_t>(grid.size().x) * grid.size().y * grid.size().z;
+            std::cout << "Compressed " << volume * sizeof(uint16_t) << " bytes of voxels into " << compressed.memory()
+                      << " bytes" << std::endl;
+        }
+
+        serializer.write(compressed, nullptr);
+    }
+    else
+    {
+        serializer.write(grid, nullptr);
+    }
+
     if (serializer.failed())
     {
         std::cerr << "Failed to serialize grid." << std::endl;
@@ -511,7 +536,7 @@ static bool convert(const ConvertOptions& options)
             }
 
             // Save the grid to the given path.
-            if (!saveGrid(path, model[i].grid))
+            if (!saveGrid(path, model[i].grid, options.compress, options.verbose))
             {
                 std::cerr << "Failed to save grid " << i << " to " << path << "." << std::endl;
                 return false;